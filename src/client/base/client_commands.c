@@ -455,6 +455,10 @@ void CL_InitCommands()
 	Cmd_AddCommand("disconnect", CL_Disconnect_f);
 	Cmd_AddCommand("record", CL_Record_f);
 	Cmd_AddCommand("stop", CL_Stop_f);
+	Cmd_AddCommand("cmdrecord", CL_CmdRecord_f);
+	Cmd_AddCommand("cmdstop", CL_CmdStop_f);
+	Cmd_AddCommand("framestats", CL_FrameStats_f);
+	Cmd_AddCommand("msgbench", CL_MsgBench_f);
 
 	Cmd_AddCommand("quit", CL_Quit_f);
 
@@ -22,22 +22,141 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <client/client.h>
 
+/*
+====================
+CL_WriteDemoBlock
+
+Writes a message to the demo, prefixed by the length
+====================
+*/
+static void CL_WriteDemoBlock(uint8_t* data, int32_t length)
+{
+	int32_t 	swlen;
+
+	swlen = LittleInt(length);
+	fwrite(&swlen, 4, 1, cls.demofile);
+	fwrite(data, length, 1, cls.demofile);
+	cls.demowritten += 4 + length;
+}
+
+/*
+====================
+CL_WriteDemoKeyframe
+
+Writes the serverdata, configstrings and baselines, so playback can start from here.
+The last message is left in buf, for the caller to add to and write out.
+Returns the offset of the keyframe in the demo.
+====================
+*/
+static int32_t CL_WriteDemoKeyframe(sizebuf_t* buf)
+{
+	int32_t 	offset;
+	int32_t 	i;
+	entity_state_t* ent;
+	entity_state_t	nullstate;
+
+	offset = cls.demowritten;
+
+	// send the serverdata
+	MSG_WriteByte(buf, svc_serverdata);
+	// the frames are saved as they arrive, so keep the protocol they were sent with
+	MSG_WriteInt(buf, cls.server_protocol);
+
+	if (cl.frame_quantize)
+	{
+		MSG_WriteByte(buf, cl.quantize.coord_bits);
+		MSG_WriteByte(buf, cl.quantize.angle_bits);
+	}
+
+	MSG_WriteInt(buf, 0x10000 + cl.servercount);
+	MSG_WriteByte(buf, 1);	// demos are always attract loops
+	MSG_WriteString(buf, cl.gamedir);
+	MSG_WriteShort(buf, cl.playernum);
+
+	MSG_WriteString(buf, cl.configstrings[CS_NAME]);
+
+	// configstrings
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		if (cl.configstrings[i][0])
+		{
+			if (buf->cursize + strlen(cl.configstrings[i]) + 32 > buf->maxsize)
+			{	// write it out
+				CL_WriteDemoBlock(buf->data, buf->cursize);
+				buf->cursize = 0;
+			}
+
+			MSG_WriteByte(buf, svc_configstring);
+			MSG_WriteShort(buf, i);
+			MSG_WriteString(buf, cl.configstrings[i]);
+		}
+
+	}
+
+	// baselines
+	memset(&nullstate, 0, sizeof(nullstate));
+	for (i = 0; i < MAX_EDICTS; i++)
+	{
+		ent = &cl_entities[i].baseline;
+		if (!ent->modelindex)
+			continue;
+
+		if (buf->cursize + 64 > buf->maxsize)
+		{	// write it out
+			CL_WriteDemoBlock(buf->data, buf->cursize);
+			buf->cursize = 0;
+		}
+
+		MSG_WriteByte(buf, svc_spawnbaseline);
+		MSG_WriteDeltaEntity(&nullstate, &cl_entities[i].baseline, buf, true, true);
+	}
+
+	cls.demolastkeyframe = cls.realtime;
+	return offset;
+}
+
 /*
 ====================
 CL_WriteDemoMessage
 
-Dumps the current net message, prefixed by the length
+Dumps the current net message, prefixed by the length.
+
+Every cl_demo_keyframe seconds the client asks for an uncompressed frame, and
+writes a keyframe before the packet that brings it. The first frame of each
+keyframe goes in <demo>.idx, so the demo can be seeked back and forth.
 ====================
 */
 void CL_WriteDemoMessage()
 {
-	int32_t 	len, swlen;
+	char		buf_data[MAX_MSGLEN];
+	sizebuf_t	buf;
+	demoindex_t	entry;
 
-	// the first eight bytes are just packet sequencing stuff
-	len = net_message.cursize - 8;
-	swlen = LittleInt(len);
-	fwrite(&swlen, 4, 1, cls.demofile);
-	fwrite(net_message.data + 8, len, 1, cls.demofile);
+	if (cls.demokeyframe && cl.frame.deltaframe <= 0)
+	{
+		SZ_Init(&buf, buf_data, sizeof(buf_data));
+		cls.demoindexpending = CL_WriteDemoKeyframe(&buf);
+		CL_WriteDemoBlock(buf.data, buf.cursize);
+		cls.demokeyframe = false;
+	}
+
+	// a keyframe is indexed by the uncompressed frame that follows it
+	if (cls.demoindexpending >= 0)
+	{
+		entry.frame = LittleInt(cl.frame.serverframe);
+		entry.offset = LittleInt(cls.demoindexpending);
+		fwrite(&entry, sizeof(entry), 1, cls.demoindexfile);
+		fflush(cls.demoindexfile);
+		fflush(cls.demofile);
+		cls.demoindexpending = -1;
+	}
+
+	// skip the packet sequencing stuff
+	CL_WriteDemoBlock(net_message.data + cls.netchan.incoming_payload, net_message.cursize - cls.netchan.incoming_payload);
+
+	if (cl_demo_keyframe->value > 0
+		&& cls.realtime - cls.demolastkeyframe >= cl_demo_keyframe->value * 1000)
+		cls.demokeyframe = true;
 }
 
 
@@ -62,8 +181,11 @@ void CL_Stop_f()
 	len = -1;
 	fwrite(&len, 4, 1, cls.demofile);
 	fclose(cls.demofile);
+	fclose(cls.demoindexfile);
 	cls.demofile = NULL;
+	cls.demoindexfile = NULL;
 	cls.demorecording = false;
+	cls.demokeyframe = false;
 	Com_Printf("Stopped demo.\n");
 }
 
@@ -81,10 +203,7 @@ void CL_Record_f()
 	char	name[MAX_OSPATH];
 	char	buf_data[MAX_MSGLEN];
 	sizebuf_t	buf;
-	int32_t 	i;
-	int32_t 	len;
-	entity_state_t* ent;
-	entity_state_t	nullstate;
+	int32_t 	header[2];
 
 	if (Cmd_Argc() != 2)
 	{
@@ -117,7 +236,23 @@ void CL_Record_f()
 		Com_Printf("ERROR: couldn't open.\n");
 		return;
 	}
+
+	cls.demoindexfile = fopen(va("%s.idx", name), "wb");
+	if (!cls.demoindexfile)
+	{
+		Com_Printf("ERROR: couldn't open %s.idx.\n", name);
+		fclose(cls.demofile);
+		cls.demofile = NULL;
+		return;
+	}
+
+	header[0] = LittleInt(DEMO_INDEX_MAGIC);
+	header[1] = LittleInt(DEMO_INDEX_VERSION);
+	fwrite(header, sizeof(header), 1, cls.demoindexfile);
+
 	cls.demorecording = true;
+	cls.demowritten = 0;
+	cls.demokeyframe = false;
 
 	// don't start saving messages until a non-delta compressed message is received
 	cls.demowaiting = true;
@@ -126,65 +261,90 @@ void CL_Record_f()
 	// write out messages to hold the startup information
 	//
 	SZ_Init(&buf, buf_data, sizeof(buf_data));
+	cls.demoindexpending = CL_WriteDemoKeyframe(&buf);
 
-	// send the serverdata
-	MSG_WriteByte(&buf, svc_serverdata);
-	MSG_WriteInt(&buf, PROTOCOL_VERSION);
-	MSG_WriteInt(&buf, 0x10000 + cl.servercount);
-	MSG_WriteByte(&buf, 1);	// demos are always attract loops
-	MSG_WriteString(&buf, cl.gamedir);
-	MSG_WriteShort(&buf, cl.playernum);
+	MSG_WriteByte(&buf, svc_stufftext);
+	MSG_WriteString(&buf, "precache\n");
 
-	MSG_WriteString(&buf, cl.configstrings[CS_NAME]);
+	// write it to the demo file
+	CL_WriteDemoBlock(buf.data, buf.cursize);
 
-	// configstrings
-	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
-	{
-		if (cl.configstrings[i][0])
-		{
-			if (buf.cursize + strlen(cl.configstrings[i]) + 32 > buf.maxsize)
-			{	// write it out
-				len = LittleInt(buf.cursize);
-				fwrite(&len, 4, 1, cls.demofile);
-				fwrite(buf.data, buf.cursize, 1, cls.demofile);
-				buf.cursize = 0;
-			}
+	// the rest of the demo file will be individual frames
+}
 
-			MSG_WriteByte(&buf, svc_configstring);
-			MSG_WriteShort(&buf, i);
-			MSG_WriteString(&buf, cl.configstrings[i]);
-		}
+/*
+====================
+CL_WriteCmd
 
-	}
+Appends a usercmd to the cmdrecord file
+====================
+*/
+void CL_WriteCmd(usercmd_t* cmd)
+{
+	sizebuf_t	buf;
+	uint8_t		data[64];
 
-	// baselines
-	memset(&nullstate, 0, sizeof(nullstate));
-	for (i = 0; i < MAX_EDICTS; i++)
+	SZ_Init(&buf, data, sizeof(data));
+	MSG_WriteDeltaUsercmd(&buf, &cls.cmdfile_last, cmd);
+	fwrite(buf.data, buf.cursize, 1, cls.cmdfile);
+
+	cls.cmdfile_last = *cmd;
+}
+
+/*
+====================
+CL_CmdStop_f
+====================
+*/
+void CL_CmdStop_f()
+{
+	if (!cls.cmdfile)
 	{
-		ent = &cl_entities[i].baseline;
-		if (!ent->modelindex)
-			continue;
+		Com_Printf("Not recording usercmds.\n");
+		return;
+	}
 
-		if (buf.cursize + 64 > buf.maxsize)
-		{	// write it out
-			len = LittleInt(buf.cursize);
-			fwrite(&len, 4, 1, cls.demofile);
-			fwrite(buf.data, buf.cursize, 1, cls.demofile);
-			buf.cursize = 0;
-		}
+	fclose(cls.cmdfile);
+	cls.cmdfile = NULL;
+	Com_Printf("Stopped recording usercmds.\n");
+}
+
+/*
+====================
+CL_CmdRecord_f
+
+cmdrecord <name>
+
+Records the usercmds sent to the server, for replaying with the server's loadtest command
+====================
+*/
+void CL_CmdRecord_f()
+{
+	char	name[MAX_OSPATH];
 
-		MSG_WriteByte(&buf, svc_spawnbaseline);
-		MSG_WriteDeltaEntity(&nullstate, &cl_entities[i].baseline, &buf, true, true);
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("cmdrecord <name>\n");
+		return;
 	}
 
-	MSG_WriteByte(&buf, svc_stufftext);
-	MSG_WriteString(&buf, "precache\n");
+	if (cls.cmdfile)
+	{
+		Com_Printf("Already recording usercmds.\n");
+		return;
+	}
 
-	// write it to the demo file
+	snprintf(name, sizeof(name), "%s/cmds/%s.cmd", FS_Gamedir(), Cmd_Argv(1));
 
-	len = LittleInt(buf.cursize);
-	fwrite(&len, 4, 1, cls.demofile);
-	fwrite(buf.data, buf.cursize, 1, cls.demofile);
+	FS_CreatePath(name);
+	cls.cmdfile = fopen(name, "wb");
 
-	// the rest of the demo file will be individual frames
-}
\ No newline at end of file
+	if (!cls.cmdfile)
+	{
+		Com_Printf("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+
+	memset(&cls.cmdfile_last, 0, sizeof(cls.cmdfile_last));
+	Com_Printf("recording usercmds to %s.\n", name);
+}
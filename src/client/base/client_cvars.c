@@ -45,6 +45,7 @@ cvar_t* cl_autoskins;
 cvar_t* cl_footsteps;
 cvar_t* cl_timeout;
 cvar_t* cl_predict;
+cvar_t* cl_predict_cache;
 cvar_t* cl_maxfps;
 cvar_t* cl_gun;
 
@@ -56,7 +57,10 @@ cvar_t* cl_add_blend;
 cvar_t* cl_drawhud;
 
 cvar_t* cl_shownet;
+cvar_t* cl_protocol;		// frame encoding to ask servers for
+cvar_t* cl_framestats;		// measure frame sizes for both encodings
 cvar_t* cl_showmiss;
+cvar_t* cl_showpredict;
 cvar_t* cl_showclamp;
 cvar_t* cl_showinfo;
 
@@ -70,6 +74,7 @@ cvar_t* cl_intro2_time;
 
 cvar_t* cl_paused;
 cvar_t* cl_timedemo;
+cvar_t* cl_demo_keyframe;
 
 cvar_t* cl_console_fraction;
 cvar_t* cl_console_disabled;
@@ -126,6 +131,7 @@ void CL_InitCvars()
 	cl_noskins = Cvar_Get("cl_noskins", "0", 0);
 	cl_autoskins = Cvar_Get("cl_autoskins", "0", 0);
 	cl_predict = Cvar_Get("cl_predict", "1", 0);
+	cl_predict_cache = Cvar_Get("cl_predict_cache", "1", 0);
 	cl_maxfps = Cvar_Get("cl_maxfps", "90", 0);
 
 	cl_upspeed = Cvar_Get("cl_upspeed", "200", 0);
@@ -146,7 +152,10 @@ void CL_InitCvars()
 	m_side = Cvar_Get("m_side", "1", 0);
 
 	cl_shownet = Cvar_Get("cl_shownet", "0", 0);
+	cl_protocol = Cvar_Get("cl_protocol", va("%i", PROTOCOL_VERSION_QUANTIZED), CVAR_ARCHIVE);
+	cl_framestats = Cvar_Get("cl_framestats", "0", 0);
 	cl_showmiss = Cvar_Get("cl_showmiss", "0", 0);
+	cl_showpredict = Cvar_Get("cl_showpredict", "0", 0);
 	cl_showclamp = Cvar_Get("showclamp", "0", 0);
 #ifndef NDEBUG
 	cl_showinfo = Cvar_Get("cl_showinfo", "1", 0);
@@ -156,6 +165,7 @@ void CL_InitCvars()
 	cl_timeout = Cvar_Get("cl_timeout", "120", 0);
 	cl_paused = Cvar_Get("paused", "0", 0);
 	cl_timedemo = Cvar_Get("timedemo", "0", 0);
+	cl_demo_keyframe = Cvar_Get("cl_demo_keyframe", "10", CVAR_ARCHIVE);
 
 	cl_console_fraction = Cvar_Get("cl_console_fraction", "0.5", 0);
 	cl_console_disabled = Cvar_Get("cl_console_disabled", "0", 0);
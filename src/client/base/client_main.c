@@ -74,10 +74,12 @@ void CL_SendConnectPacket()
 		adr.port = BigShort(PORT_SERVER);
 
 	port = Cvar_VariableValue("qport");
+	cls.netchan_port = port;
 	userinfo_modified = false;
 
-	Netchan_OutOfBandPrint(NS_CLIENT, adr, "connect %i %i %i \"%s\"\n",
-		PROTOCOL_VERSION, port, cls.challenge, Cvar_Userinfo());
+	Netchan_OutOfBandPrint(NS_CLIENT, adr, "connect %i %i %i \"%s\" %i\n",
+		cl_protocol->value == PROTOCOL_VERSION ? PROTOCOL_VERSION : PROTOCOL_VERSION_QUANTIZED,
+		port, cls.challenge, Cvar_Userinfo(), Netchan_SupportedFlags());
 }
 
 /*
@@ -166,14 +168,7 @@ void CL_Disconnect()
 		return;
 
 	if (cl_timedemo && cl_timedemo->value)
-	{
-		int32_t time;
-
-		time = Sys_Milliseconds() - cl.timedemo_start;
-		if (time > 0)
-			Com_Printf("%i frames, %3.1f seconds: %3.1f fps\n", cl.timedemo_frames,
-				time / 1000.0, cl.timedemo_frames * 1000.0 / time);
-	}
+		CL_TimedemoReport();
 
 	VectorClear3(cl.refdef.blend);
 
@@ -254,7 +249,8 @@ void CL_ConnectionlessPacket()
 			Com_Printf("Dup connect received.  Ignored.\n");
 			return;
 		}
-		Netchan_Setup(NS_CLIENT, &cls.netchan, net_from, cls.netchan_port);
+		// the server echoes back the netchan capabilities it accepted
+		Netchan_Setup(NS_CLIENT, &cls.netchan, net_from, cls.netchan_port, atoi(Cmd_Argv(1)) & Netchan_SupportedFlags());
 		MSG_WriteChar(&cls.netchan.message, clc_stringcmd);
 		MSG_WriteString(&cls.netchan.message, "new");
 		cls.state = ca_connected;
@@ -338,6 +334,8 @@ CL_ReadPackets
 */
 void CL_ReadPackets()
 {
+	int64_t perf_start;
+
 	while (Net_GetPacket(NS_CLIENT, &net_from, &net_message))
 	{
 		//	Com_Printf ("packet\n");
@@ -371,7 +369,9 @@ void CL_ReadPackets()
 		}
 		if (!Netchan_Process(&cls.netchan, &net_message))
 			continue;		// wasn't accepted for some reason
+		perf_start = CL_TimedemoBegin();
 		CL_ParseServerMessage();
+		CL_TimedemoEnd(clperf_parse, perf_start);
 	}
 
 	//
@@ -411,6 +411,7 @@ void CL_InitLocal()
 
 	CL_InitCvars();
 	CL_InitCommands();
+	CL_TimedemoInit();
 }
 
 /*
@@ -559,6 +560,7 @@ void CL_Frame(int32_t msec)
 {
 	static int32_t extratime;
 	static int64_t lasttimecalled;
+	int64_t frame_start, perf_start;
 
 	if (dedicated->value)
 		return;
@@ -574,6 +576,8 @@ void CL_Frame(int32_t msec)
 	}
 
 
+	frame_start = CL_TimedemoBegin();
+
 	// let the mouse activate or deactivate
 	if (!cls.disable_input)
 		Input_Frame();
@@ -593,13 +597,21 @@ void CL_Frame(int32_t msec)
 		cls.netchan.last_received = Sys_Milliseconds();
 
 	// fetch results from server
+	TIMELINE_BEGIN("CL_ReadPackets");
 	CL_ReadPackets();
+	TIMELINE_END();
 
 	// send a new command message to the server
+	TIMELINE_BEGIN("CL_SendCommand");
 	CL_SendCommand();
+	TIMELINE_END();
 
 	// predict all unacknowledged movements
+	TIMELINE_BEGIN("CL_PredictMovement");
+	perf_start = CL_TimedemoBegin();
 	CL_PredictMovement();
+	CL_TimedemoEnd(clperf_predict, perf_start);
+	TIMELINE_END();
 
 	// allow rendering DLL change
 	Vid_CheckChanges();
@@ -609,12 +621,18 @@ void CL_Frame(int32_t msec)
 	// update the screen
 	if (profile_all->value)
 		time_before_ref = Sys_Nanoseconds();
+	TIMELINE_BEGIN("Render_UpdateScreen");
+	perf_start = CL_TimedemoBegin();
 	Render_UpdateScreen();
+	CL_TimedemoEnd(clperf_screen, perf_start);
+	TIMELINE_END();
 	if (profile_all->value)
 		time_after_ref = Sys_Nanoseconds();
 
 	// update audio
+	perf_start = CL_TimedemoBegin();
 	S_Update(cl.refdef.vieworigin, cl.v_forward, cl.v_right, cl.v_up);
+	CL_TimedemoEnd(clperf_sound, perf_start);
 
 	Miniaudio_Update();
 
@@ -629,6 +647,8 @@ void CL_Frame(int32_t msec)
 
 	cls.framecount++;
 
+	CL_TimedemoFrame(frame_start);
+
 	if (cls.state == ca_active)
 	{
 		if (!lasttimecalled)
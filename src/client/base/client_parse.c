@@ -99,10 +99,25 @@ void CL_ParseServerData()
 	i = MSG_ReadInt(&net_message);
 	cls.server_protocol = i;
 
-	if (i != PROTOCOL_VERSION)
+	if (i != PROTOCOL_VERSION
+		&& i != PROTOCOL_VERSION_QUANTIZED)
 		Com_Error(ERR_DROP,
 			"Server returned protocol version %i, not %i\nEither your engine is incompatible with the server, or you need to re-record the demo file you're trying to play.", i, PROTOCOL_VERSION);
 
+	// bit packed frames need the precision they were quantized to
+	if (i == PROTOCOL_VERSION_QUANTIZED)
+	{
+		cl.quantize.coord_bits = MSG_ReadByte(&net_message);
+		cl.quantize.angle_bits = MSG_ReadByte(&net_message);
+
+		if (cl.quantize.coord_bits > 8
+			|| cl.quantize.angle_bits < 8
+			|| cl.quantize.angle_bits > 16)
+			Com_Error(ERR_DROP, "Server sent bad frame precision %i/%i", cl.quantize.coord_bits, cl.quantize.angle_bits);
+
+		cl.frame_quantize = &cl.quantize;
+	}
+
 	cl.servercount = MSG_ReadInt(&net_message);
 	cl.attractloop = MSG_ReadByte(&net_message);
 
@@ -146,9 +161,10 @@ void CL_ParseBaseline()
 
 	memset(&nullstate, 0, sizeof(nullstate));
 
-	newnum = CL_ParseEntityBits(&bits);
+	// baselines are part of the signon, which is byte aligned for every protocol
+	newnum = CL_ParseEntityBits(&bits, NULL);
 	es = &cl_entities[newnum].baseline;
-	CL_ParseDelta(&nullstate, es, newnum, bits);
+	MSG_ReadDeltaEntity(&net_message, &nullstate, es, newnum, bits, NULL);
 }
 
 
@@ -351,6 +367,12 @@ void CL_ParseConfigString()
 		if (cl.refresh_prepped && strcmp(olds, s))
 			CL_ParseClientinfo(i - CS_PLAYERSKINS);
 	}
+	else if (i >= CS_PHYS_STOPSPEED && i <= CS_PHYS_FRICTION_WATER)
+	{
+		// CL_PredictMovement picks them up
+		if (strcmp(olds, s))
+			cl.physics_parsed = false;
+	}
 }
 
 
@@ -446,6 +468,7 @@ void CL_ParseServerMessage()
 	char	str_tempbuf[MAX_UI_STRLEN] = { 0 };		
 	char	str_tempbuf2[MAX_UI_STRLEN] = { 0 };
 	int32_t i = 0;
+	int64_t perf_start;
 
 	//
 	// if recording demos, copy the message out
@@ -559,7 +582,9 @@ void CL_ParseServerMessage()
 			break;
 
 		case svc_frame:
+			perf_start = CL_TimedemoBegin();
 			CL_ParseFrame();
+			CL_TimedemoEnd(clperf_parseframe, perf_start);
 			break;
 			
 		case svc_event:
@@ -191,23 +191,99 @@ int32_t CL_PMpointcontents(vec3_t point)
 }
 
 
+/*
+=================
+CL_ParsePhysics
+
+The physics parameters from the configstrings, only when one has changed
+=================
+*/
+static void CL_ParsePhysics()
+{
+	phys_stopspeed = (float)atof(cl.configstrings[CS_PHYS_STOPSPEED]);
+	phys_maxspeed_player = (float)atof(cl.configstrings[CS_PHYS_MAXSPEED_PLAYER]);
+	phys_maxspeed_director = (float)atof(cl.configstrings[CS_PHYS_MAXSPEED_DIRECTOR]);
+	phys_duckspeed = (float)atof(cl.configstrings[CS_PHYS_DUCKSPEED]);
+	phys_accelerate_player = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_PLAYER]);
+	phys_accelerate_director = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_DIRECTOR]);
+	phys_airaccelerate = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_AIR]);
+	phys_wateraccelerate = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_WATER]);
+	phys_friction = (float)atof(cl.configstrings[CS_PHYS_FRICTION]);
+	phys_waterfriction = (float)atof(cl.configstrings[CS_PHYS_FRICTION_WATER]);
+}
+
+/*
+=================
+CL_PredictionAgrees
+
+Whether the server put us where we predicted we'd be after a command. With
+quantized frames both sides round the origin and velocity after every move,
+so they still have to be the same.
+=================
+*/
+static bool CL_PredictionAgrees(pmove_state_t* server, pmove_state_t* predicted)
+{
+	int32_t i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (server->origin[i] != predicted->origin[i]
+			|| server->velocity[i] != predicted->velocity[i]
+			|| server->delta_angles[i] != predicted->delta_angles[i])
+			return false;
+	}
+
+	return server->pm_type == predicted->pm_type
+		&& server->pm_flags == predicted->pm_flags
+		&& server->pm_time == predicted->pm_time
+		&& server->gravity == predicted->gravity;
+}
+
+// for cl_showpredict
+static int32_t	predict_moves;
+static int32_t	predict_frames;
+static int32_t	predict_corrections;
+static int32_t	predict_report_time;
+
 /*
 =================
 CL_PredictMovement
 
 Sets cl.predicted_origin and cl.predicted_angles
+
+Commands that have already been run are only run again when the server
+disagrees with where one of them left us, otherwise this carries on from the
+newest one, so a frame usually runs one pmove rather than one per command in
+flight: at 250 fps and 100 ms ping about 260 a second instead of 7100.
+cl_predict_cache 0 runs every unacknowledged command every frame.
 =================
 */
 void CL_PredictMovement()
 {
-	int32_t 	ack, current;
-	int32_t 	frame;
-	int32_t 	oldframe;
-	usercmd_t*	cmd;
-	pmove_t		pm;
-	int32_t 	i;
-	int32_t 	step;
-	int32_t 	oldz;
+	int32_t 		ack, current;
+	int32_t 		sequence;
+	int32_t 		frame;
+	int32_t 		oldframe;
+	pmove_t			pm;
+	int32_t 		snap_scale;
+	pmove_state_t*	server;
+	pmove_state_t*	predicted;
+	float*			angles;
+	int32_t 		i;
+	int32_t 		step;
+	int32_t 		oldz;
+
+	if (cl_showpredict->value && cls.realtime - predict_report_time >= 1000)
+	{
+		if (predict_report_time)
+		{
+			Com_Printf("prediction: %i pmoves, %i frames, %i corrections in %i ms\n",
+				predict_moves, predict_frames, predict_corrections, cls.realtime - predict_report_time);
+		}
+
+		predict_moves = predict_frames = predict_corrections = 0;
+		predict_report_time = cls.realtime;
+	}
 
 	if (cls.state != ca_active)
 		return;
@@ -235,45 +311,83 @@ void CL_PredictMovement()
 		return;
 	}
 
+	if (!cl.physics_parsed)
+	{
+		CL_ParsePhysics();
+		cl.physics_parsed = true;
+		cl.predicted_valid = false;		// the commands already run used the old ones
+	}
+
+	predict_frames++;
+
+	// can we carry on from the commands already run?
+	server = &cl.frame.playerstate.pmove;
+
+	if (!cl_predict_cache->value
+		|| !cl.predicted_valid
+		|| ack < cl.predicted_ack
+		|| ack > cl.predicted_last)
+	{
+		cl.predicted_last = ack;
+	}
+	else if (!CL_PredictionAgrees(server, ack == cl.predicted_ack ? &cl.predicted_ack_state : &cl.predicted_states[ack & (CMD_BACKUP - 1)]))
+	{
+		// corrected, run them all again from what the server says
+		cl.predicted_last = ack;
+		predict_corrections++;
+	}
+
+	cl.predicted_ack = ack;
+	cl.predicted_ack_state = *server;
+	cl.predicted_valid = true;
+
 	// copy current state to pmove
 	memset(&pm, 0, sizeof(pm));
 	pm.trace = CL_PMTrace;
 	pm.pointcontents = CL_PMpointcontents;
 
-	phys_stopspeed = (float)atof(cl.configstrings[CS_PHYS_STOPSPEED]);
-	phys_maxspeed_player = (float)atof(cl.configstrings[CS_PHYS_MAXSPEED_PLAYER]);
-	phys_maxspeed_director = (float)atof(cl.configstrings[CS_PHYS_MAXSPEED_DIRECTOR]);
-	phys_duckspeed = (float)atof(cl.configstrings[CS_PHYS_DUCKSPEED]);
-	phys_accelerate_player = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_PLAYER]);
-	phys_accelerate_director = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_DIRECTOR]);
-	phys_airaccelerate = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_AIR]);
-	phys_wateraccelerate = (float)atof(cl.configstrings[CS_PHYS_ACCELERATE_WATER]);
-	phys_friction = (float)atof(cl.configstrings[CS_PHYS_FRICTION]);
-	phys_waterfriction = (float)atof(cl.configstrings[CS_PHYS_FRICTION_WATER]);
-
 	VectorCopy3(cl.frame.playerstate.vieworigin, pm.vieworigin);
-	pm.s = cl.frame.playerstate.pmove;
+	pm.s = cl.predicted_last == ack ? *server : cl.predicted_states[cl.predicted_last & (CMD_BACKUP - 1)];
 
-	frame = 0;
+	// run the commands that haven't been, rounding like the server does
+	snap_scale = Player_MoveSnapScale(cl.frame_quantize);
 
-	// run frames
-	while (++ack < current)
+	for (sequence = cl.predicted_last + 1; sequence < current; sequence++)
 	{
-		frame = ack & (CMD_BACKUP - 1);
-		cmd = &cl.cmds[frame];
+		frame = sequence & (CMD_BACKUP - 1);
 
-		pm.cmd = *cmd;
-		Player_Move(&pm);
+		pm.cmd = cl.cmds[frame];
+		Player_MoveSnapped(&pm, snap_scale);
+		predict_moves++;
 
-		// save for debug checking
-		VectorCopy3(pm.vieworigin, cl.predicted_origins[frame]);
+		cl.predicted_states[frame] = pm.s;
+		VectorCopy3(pm.viewangles, cl.predicted_viewangles[frame]);
 	}
 
-	oldframe = (ack - 2) & (CMD_BACKUP - 1);
+	if (current - 1 > cl.predicted_last)
+		cl.predicted_last = current - 1;
+
+	// save for debug checking, pmove doesn't move the vieworigin so they all get the frame's
+	for (sequence = ack + 1; sequence < current; sequence++)
+		VectorCopy3(pm.vieworigin, cl.predicted_origins[sequence & (CMD_BACKUP - 1)]);
+
+	// where the newest command left us, or the server's state if they've all been acknowledged
+	if (current - 1 > ack)
+	{
+		predicted = &cl.predicted_states[(current - 1) & (CMD_BACKUP - 1)];
+		angles = cl.predicted_viewangles[(current - 1) & (CMD_BACKUP - 1)];
+	}
+	else
+	{
+		predicted = server;
+		angles = vec3_origin;
+	}
+
+	oldframe = (current - 2) & (CMD_BACKUP - 1);
 	oldz = cl.predicted_origins[oldframe][2];
 	step = pm.vieworigin[2] - oldz;
 
-	if (step > 63 && step < 160 && (pm.s.pm_flags & PMF_ON_GROUND))
+	if (step > 63 && step < 160 && (predicted->pm_flags & PMF_ON_GROUND))
 	{
 		cl.predicted_step = step;
 		cl.predicted_step_time = cls.realtime - cls.frametime * 500;
@@ -285,5 +399,5 @@ void CL_PredictMovement()
 	cl.predicted_origin[1] = pm.vieworigin[1];
 	cl.predicted_origin[2] = pm.vieworigin[2];
 
-	VectorCopy3(pm.viewangles, cl.predicted_angles);
-}
\ No newline at end of file
+	VectorCopy3(angles, cl.predicted_angles);
+}
@@ -0,0 +1,258 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// client_timedemo.c -- per subsystem timing for timedemo
+//
+// With timedemo set every client frame is timed, along with the parts of it
+// that matter for client CPU time. When the demo ends the percentiles are
+// printed, and written as JSON to timedemo_file in the game directory if it is
+// set. timedemo_quit 1 quits afterwards, so a benchmark can run unattended,
+// for example on the Headless configuration of zombono.vcxproj, which links
+// null/vid_null.c and null/snddma_null.c and needs no window or GPU:
+//
+//	+set timedemo 1 +set timedemo_file bench.json +set timedemo_quit 1 +demomap bench.dm2
+//
+// That configuration is Windows only. There is no Linux build of it yet:
+// platform/linux and null/sys_null.c are older than the engine's current sys,
+// net and thread functions, and there's no build file for them.
+
+#include <client/client.h>
+
+#define TIMEDEMO_MIN_FRAMES		4096
+#define TIMEDEMO_MAX_FRAMES		262144		// 16mb of samples, later frames are left out of the percentiles
+
+static const char* timedemo_phases[clperf_max] =
+{
+	"frame",
+	"parse",
+	"parseframe",
+	"predict",
+	"packetentities",
+	"particles",
+	"sound",
+	"screen",
+};
+
+static int64_t	timedemo_current[clperf_max];		// this frame so far
+static int64_t*	timedemo_samples;					// timedemo_frames * clperf_max
+static int32_t 	timedemo_frames;
+static int32_t 	timedemo_size;						// frames timedemo_samples has room for
+
+static cvar_t*	timedemo_file;
+static cvar_t*	timedemo_quit;
+
+/*
+==================
+CL_TimedemoBegin
+==================
+*/
+int64_t CL_TimedemoBegin()
+{
+	if (!cl_timedemo->value)
+		return 0;
+
+	return Sys_Nanoseconds();
+}
+
+void CL_TimedemoEnd(clperf_t phase, int64_t start)
+{
+	if (!start)
+		return;
+
+	timedemo_current[phase] += Sys_Nanoseconds() - start;
+}
+
+/*
+==================
+CL_TimedemoFrame
+
+Called at the end of CL_Frame with the time it started
+==================
+*/
+void CL_TimedemoFrame(int64_t start)
+{
+	int64_t*	samples;
+	int32_t 	i;
+
+	if (!start)
+		return;
+
+	CL_TimedemoEnd(clperf_frame, start);
+
+	// only frames that were drawn, like the fps count
+	if (cls.state != ca_active || !cl.timedemo_start)
+	{
+		memset(timedemo_current, 0, sizeof(timedemo_current));
+		return;
+	}
+
+	if (timedemo_frames >= timedemo_size && timedemo_size < TIMEDEMO_MAX_FRAMES)
+	{
+		timedemo_size = timedemo_size ? timedemo_size * 2 : TIMEDEMO_MIN_FRAMES;
+		samples = Memory_ZoneMalloc(timedemo_size * clperf_max * sizeof(int64_t));
+
+		if (timedemo_samples)
+		{
+			memcpy(samples, timedemo_samples, timedemo_frames * clperf_max * sizeof(int64_t));
+			Memory_ZoneFree(timedemo_samples);
+		}
+
+		timedemo_samples = samples;
+	}
+
+	if (timedemo_frames < timedemo_size)
+	{
+		for (i = 0; i < clperf_max; i++)
+			timedemo_samples[timedemo_frames * clperf_max + i] = timedemo_current[i];
+
+		timedemo_frames++;
+	}
+
+	memset(timedemo_current, 0, sizeof(timedemo_current));
+}
+
+static int CL_TimedemoCompare(const void* a, const void* b)
+{
+	int64_t x = *(int64_t*)a, y = *(int64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+==================
+CL_TimedemoStats
+
+Milliseconds for one phase: avg, p50, p95, p99, max
+==================
+*/
+static void CL_TimedemoStats(int64_t* sorted, clperf_t phase, double* stats)
+{
+	int64_t 	total;
+	int32_t 	i;
+
+	total = 0;
+
+	for (i = 0; i < timedemo_frames; i++)
+	{
+		sorted[i] = timedemo_samples[i * clperf_max + phase];
+		total += sorted[i];
+	}
+
+	qsort(sorted, timedemo_frames, sizeof(int64_t), CL_TimedemoCompare);
+
+	stats[0] = total / (double)timedemo_frames / 1000000.0;
+	stats[1] = sorted[timedemo_frames / 2] / 1000000.0;
+	stats[2] = sorted[timedemo_frames * 95 / 100] / 1000000.0;
+	stats[3] = sorted[timedemo_frames * 99 / 100] / 1000000.0;
+	stats[4] = sorted[timedemo_frames - 1] / 1000000.0;
+}
+
+/*
+==================
+CL_TimedemoReport
+
+Called when the demo ends
+==================
+*/
+void CL_TimedemoReport()
+{
+	char		name[MAX_OSPATH];
+	char		temp_name[MAX_OSPATH];
+	FILE*		file;
+	int64_t*	sorted;
+	double		stats[clperf_max][5];
+	int32_t 	time, i;
+
+	time = Sys_Milliseconds() - cl.timedemo_start;
+
+	if (!cl.timedemo_start || time <= 0)
+		return;
+
+	Com_Printf("%i frames, %3.1f seconds: %3.1f fps\n", cl.timedemo_frames,
+		time / 1000.0, cl.timedemo_frames * 1000.0 / time);
+
+	if (!timedemo_frames)
+		return;
+
+	sorted = Memory_ZoneMalloc(timedemo_frames * sizeof(int64_t));
+
+	Com_Printf("%-16s %9s %9s %9s %9s %9s\n", "ms", "avg", "p50", "p95", "p99", "max");
+
+	for (i = 0; i < clperf_max; i++)
+	{
+		CL_TimedemoStats(sorted, i, stats[i]);
+		Com_Printf("%-16s %9.3f %9.3f %9.3f %9.3f %9.3f\n", timedemo_phases[i],
+			stats[i][0], stats[i][1], stats[i][2], stats[i][3], stats[i][4]);
+	}
+
+	Memory_ZoneFree(sorted);
+
+	if (timedemo_file->string[0])
+	{
+		// written to a temporary file first, so a CI job never picks up half of it
+		snprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), timedemo_file->string);
+		snprintf(temp_name, sizeof(temp_name), "%s.tmp", name);
+
+		FS_CreatePath(name);
+		file = fopen(temp_name, "w");
+
+		if (!file)
+		{
+			Com_Printf("CL_TimedemoReport: couldn't open %s\n", temp_name);
+		}
+		else
+		{
+			fprintf(file, "{\n\t\"frames\": %i,\n\t\"seconds\": %.3f,\n\t\"fps\": %.2f,\n\t\"phases\": {\n",
+				cl.timedemo_frames, time / 1000.0, cl.timedemo_frames * 1000.0 / time);
+
+			for (i = 0; i < clperf_max; i++)
+			{
+				fprintf(file, "\t\t\"%s\": { \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+					timedemo_phases[i], stats[i][0], stats[i][1], stats[i][2], stats[i][3], stats[i][4],
+					i < clperf_max - 1 ? "," : "");
+			}
+
+			fprintf(file, "\t}\n}\n");
+			fclose(file);
+
+			if (!Sys_ReplaceFile(temp_name, name))
+				Com_Printf("CL_TimedemoReport: couldn't rename %s to %s\n", temp_name, name);
+			else
+				Com_Printf("Wrote %s\n", name);
+		}
+	}
+
+	Memory_ZoneFree(timedemo_samples);
+	timedemo_samples = NULL;
+	timedemo_frames = timedemo_size = 0;
+
+	if (timedemo_quit->value)
+		Cbuf_AddText("quit\n");
+}
+
+/*
+==================
+CL_TimedemoInit
+==================
+*/
+void CL_TimedemoInit()
+{
+	timedemo_file = Cvar_Get("timedemo_file", "", 0);
+	timedemo_quit = Cvar_Get("timedemo_quit", "0", 0);
+}
@@ -114,6 +114,15 @@ typedef struct client_state_s
 	vec3_t			predicted_angles;
 	vec3_t			prediction_error;
 
+	// what each command CL_PredictMovement ran came out as, so it only has to run new ones
+	pmove_state_t	predicted_states[CMD_BACKUP];
+	vec3_t			predicted_viewangles[CMD_BACKUP];
+	int32_t 		predicted_ack;		// the acknowledged command they carry on from
+	pmove_state_t	predicted_ack_state;	// and the state the server sent for it
+	int32_t 		predicted_last;		// the newest command run
+	bool			predicted_valid;
+	bool			physics_parsed;		// phys_ have been set from the configstrings since they last changed
+
 	frame_t			frame;				// received from server
 	frame_t			frames[UPDATE_BACKUP];
 
@@ -148,6 +157,8 @@ typedef struct client_state_s
 	int32_t 		servercount;		// server identification for prespawns
 	char			gamedir[MAX_QPATH];
 	int32_t 		playernum;
+	msg_quantize_t	quantize;			// frame precision sent by a PROTOCOL_VERSION_QUANTIZED server
+	msg_quantize_t*	frame_quantize;		// &quantize, or NULL for byte aligned frames
 
 	char			configstrings[MAX_CONFIGSTRINGS][MAX_QPATH];
 
@@ -244,7 +255,16 @@ typedef struct
 	// demo recording info must be here, so it isn't cleared on level change
 	bool		demorecording;
 	bool		demowaiting;	// don't record until a non-delta message is received
+	bool		demokeyframe;	// asking for a non-delta frame to write the next keyframe before
 	FILE* demofile;
+	FILE* demoindexfile;	// <demo>.idx
+	int32_t 	demowritten;	// bytes written to the demo so far
+	int32_t 	demolastkeyframe;	// cls.realtime
+	int32_t 	demoindexpending;	// offset of a keyframe waiting for its frame number, or -1
+
+	// usercmd recording for the server load test (cmdrecord)
+	FILE* cmdfile;
+	usercmd_t	cmdfile_last;	// each cmd is written as a delta from the previous one
 } client_static_t;
 
 extern client_static_t cls;
@@ -263,6 +283,7 @@ extern cvar_t* cl_add_lights;
 extern cvar_t* cl_add_particles;
 extern cvar_t* cl_add_entities;
 extern cvar_t* cl_predict;
+extern cvar_t* cl_predict_cache;
 extern cvar_t* cl_footsteps;
 extern cvar_t* cl_noskins;
 extern cvar_t* cl_autoskins;
@@ -279,7 +300,10 @@ extern cvar_t* cl_run;
 extern cvar_t* cl_anglespeedkey;
 
 extern cvar_t* cl_shownet;
+extern cvar_t* cl_protocol;
+extern cvar_t* cl_framestats;
 extern cvar_t* cl_showmiss;
+extern cvar_t* cl_showpredict;
 extern cvar_t* cl_showclamp;
 extern cvar_t* cl_showinfo;
 
@@ -297,6 +321,7 @@ extern cvar_t* cl_lightlevel;	// FIXME HACK
 
 extern cvar_t* cl_paused;
 extern cvar_t* cl_timedemo;
+extern cvar_t* cl_demo_keyframe;
 
 extern cvar_t* cl_console_fraction;
 extern cvar_t* cl_console_disabled;
@@ -419,9 +444,10 @@ void CL_ParticleSteamEffect(vec3_t org, vec3_t dir, color4_t color, int32_t coun
 void CL_ColorFlash(int32_t ent, vec3_t pos, int32_t intensity, color4_t color);
 void CL_ParticleSmokeEffect(vec3_t org, vec3_t dir, color4_t color, int32_t count, int32_t magnitude);
 
-int32_t CL_ParseEntityBits(uint32_t* bits);
-void CL_ParseDelta(entity_state_t* from, entity_state_t* to, int32_t number, int32_t bits);
+int32_t CL_ParseEntityBits(uint32_t* bits, msg_quantize_t* quant);
 void CL_ParseFrame();
+void CL_FrameStats_f();
+void CL_MsgBench_f();
 
 void CL_ParseTEnt();
 void CL_ParseConfigString();
@@ -475,6 +501,32 @@ void CL_InitCommands();
 void CL_WriteDemoMessage();
 void CL_Stop_f();
 void CL_Record_f();
+void CL_WriteCmd(usercmd_t* cmd);
+void CL_CmdRecord_f();
+void CL_CmdStop_f();
+
+//
+// client_timedemo.c
+//
+typedef enum clperf_e
+{
+	clperf_frame,
+	clperf_parse,				// CL_ParseServerMessage, including parseframe
+	clperf_parseframe,
+	clperf_predict,
+	clperf_packetentities,
+	clperf_particles,
+	clperf_sound,
+	clperf_screen,				// Render_UpdateScreen, including packetentities and particles
+
+	clperf_max,
+} clperf_t;
+
+void CL_TimedemoInit();
+int64_t CL_TimedemoBegin();
+void CL_TimedemoEnd(clperf_t phase, int64_t start);
+void CL_TimedemoFrame(int64_t start);
+void CL_TimedemoReport();
 
 //
 // client_parse.c
@@ -40,123 +40,21 @@ Returns the entity number and the header bits
 =================
 */
 int32_t bitcounts[32];	/// just for protocol profiling
-int32_t CL_ParseEntityBits(uint32_t* bits)
+int32_t CL_ParseEntityBits(uint32_t* bits, msg_quantize_t* quant)
 {
-	uint32_t		b, total;
 	int32_t 		i;
 	int32_t 		number;
 
-	total = MSG_ReadByte(&net_message);
-	if (total & U_MOREBITS1)
-	{
-		b = MSG_ReadByte(&net_message);
-		total |= b << 8;
-	}
-	if (total & U_MOREBITS2)
-	{
-		b = MSG_ReadByte(&net_message);
-		total |= b << 16;
-	}
-	if (total & U_MOREBITS3)
-	{
-		b = MSG_ReadByte(&net_message);
-		total |= b << 24;
-	}
+	number = MSG_ReadEntityBits(&net_message, bits, quant);
 
 	// count the bits for net profiling
 	for (i = 0; i < 32; i++)
-		if (total & (1 << i))
+		if (*bits & (1 << i))
 			bitcounts[i]++;
 
-	if (total & U_NUMBER16)
-		number = MSG_ReadShort(&net_message);
-	else
-		number = MSG_ReadByte(&net_message);
-
-	*bits = total;
-
 	return number;
 }
 
-/*
-==================
-CL_ParseDelta
-
-Can go from either a baseline or a previous packet_entity
-==================
-*/
-void CL_ParseDelta(entity_state_t* from, entity_state_t* to, int32_t number, int32_t bits)
-{
-	// set everything to the state we are delta'ing from
-	*to = *from;
-
-	VectorCopy3(from->origin, to->old_origin);
-	to->number = number;
-
-	if (bits & U_MODEL)
-		to->modelindex = MSG_ReadByte(&net_message);
-	if (bits & U_MODEL2)
-		to->modelindex2 = MSG_ReadByte(&net_message);
-	if (bits & U_MODEL3)
-		to->modelindex3 = MSG_ReadByte(&net_message);
-	if (bits & U_MODEL4)
-		to->modelindex4 = MSG_ReadByte(&net_message);
-
-	if (bits & U_FRAME8)
-		to->frame = MSG_ReadByte(&net_message);
-	if (bits & U_FRAME16)
-		to->frame = MSG_ReadShort(&net_message);
-
-	if ((bits & U_SKIN8) && (bits & U_SKIN16))		//used for laser colors
-		to->skinnum = MSG_ReadInt(&net_message);
-	else if (bits & U_SKIN8)
-		to->skinnum = MSG_ReadByte(&net_message);
-	else if (bits & U_SKIN16)
-		to->skinnum = MSG_ReadShort(&net_message);
-
-	if ((bits & (U_EFFECTS8 | U_EFFECTS16)) == (U_EFFECTS8 | U_EFFECTS16))
-		to->effects = MSG_ReadInt(&net_message);
-	else if (bits & U_EFFECTS8)
-		to->effects = MSG_ReadByte(&net_message);
-	else if (bits & U_EFFECTS16)
-		to->effects = MSG_ReadShort(&net_message);
-
-	if ((bits & (U_RENDERFX8 | U_RENDERFX16)) == (U_RENDERFX8 | U_RENDERFX16))
-		to->renderfx = MSG_ReadInt(&net_message);
-	else if (bits & U_RENDERFX8)
-		to->renderfx = MSG_ReadByte(&net_message);
-	else if (bits & U_RENDERFX16)
-		to->renderfx = MSG_ReadShort(&net_message);
-
-	if (bits & U_ORIGIN1)
-		to->origin[0] = MSG_ReadCoord(&net_message);
-	if (bits & U_ORIGIN2)
-		to->origin[1] = MSG_ReadCoord(&net_message);
-	if (bits & U_ORIGIN3)
-		to->origin[2] = MSG_ReadCoord(&net_message);
-
-	if (bits & U_ANGLE1)
-		to->angles[0] = MSG_ReadAngle(&net_message);
-	if (bits & U_ANGLE2)
-		to->angles[1] = MSG_ReadAngle(&net_message);
-	if (bits & U_ANGLE3)
-		to->angles[2] = MSG_ReadAngle(&net_message);
-
-	if (bits & U_OLDORIGIN)
-		MSG_ReadPos(&net_message, to->old_origin);
-
-	if (bits & U_SOUND)
-		to->sound = MSG_ReadByte(&net_message);
-
-	if (bits & U_EVENT)
-		to->event = MSG_ReadByte(&net_message);
-	else
-		to->event = 0;
-
-	if (bits & U_SOLID)
-		to->solid = MSG_ReadShort(&net_message);
-}
-
 /*
 ==================
 CL_DeltaEntity
@@ -176,7 +74,7 @@ void CL_DeltaEntity(frame_t* frame, int32_t newnum, entity_state_t* old, int32_t
 	cl.parse_entities++;
 	frame->num_entities++;
 
-	CL_ParseDelta(old, state, newnum, bits);
+	MSG_ReadDeltaEntity(&net_message, old, state, newnum, bits, cl.frame_quantize);
 
 	// some data changes will force no lerping
 	if (state->modelindex != ent->current.modelindex
@@ -253,7 +151,7 @@ void CL_ParsePacketEntities(frame_t* oldframe, frame_t* newframe)
 
 	while (1)
 	{
-		newnum = CL_ParseEntityBits(&bits);
+		newnum = CL_ParseEntityBits(&bits, cl.frame_quantize);
 		if (newnum >= MAX_EDICTS)
 			Com_Error(ERR_DROP, "CL_ParsePacketEntities: bad number:%i", newnum);
 
@@ -348,6 +246,31 @@ void CL_ParsePacketEntities(frame_t* oldframe, frame_t* newframe)
 
 
 
+/*
+===================
+CL_GetPlayerstate
+
+The byte aligned fields of CL_ParsePlayerstate, from a message with MSG_MAX_PLAYERSTATE left
+===================
+*/
+static void CL_GetPlayerstate(uint8_t** p, player_state_t* state, int32_t flags)
+{
+	int32_t 		i;
+	int32_t 		statbits;
+
+#define GET_FIELD(flag, kind, member)	if (flags & (flag)) state->member = MSG_GET_##kind(p);
+
+	MSG_PLAYERSTATE_FIELDS(GET_FIELD)
+
+#undef GET_FIELD
+
+	// parse stats
+	statbits = MSG_GetInt(p);
+	for (i = 0; i < MAX_STATS; i++)
+		if (statbits & (1 << i))
+			state->stats[i] = MSG_GetShort(p);
+}
+
 /*
 ===================
 CL_ParsePlayerstate
@@ -359,6 +282,8 @@ void CL_ParsePlayerstate(frame_t* oldframe, frame_t* newframe)
 	player_state_t* state;
 	int32_t 		i;
 	int32_t 		statbits;
+	msg_quantize_t* quant = cl.frame_quantize;
+	uint8_t*		p;
 
 	state = &newframe->playerstate;
 
@@ -368,105 +293,344 @@ void CL_ParsePlayerstate(frame_t* oldframe, frame_t* newframe)
 	else
 		memset(state, 0, sizeof(*state));
 
-	flags = MSG_ReadInt(&net_message);
-
-	//
-	// parse the pmove_state_t
-	//
-	if (flags & PS_M_TYPE)
-		state->pmove.pm_type = MSG_ReadByte(&net_message);
+	if (quant)
+		flags = MSG_ReadBits(&net_message, PS_NUMBITS);
+	else
+		flags = MSG_ReadInt(&net_message);
 
-	if (flags & PS_M_ORIGIN)
-		MSG_ReadPos(&net_message, &state->pmove.origin);
+	// byte aligned, and the message is long enough for the largest playerstate
+	if (!quant && (p = MSG_BeginRead(&net_message, MSG_MAX_PLAYERSTATE)))
+	{
+		CL_GetPlayerstate(&p, state, flags);
+		MSG_EndRead(&net_message, p);
 
-	if (flags & PS_M_VELOCITY)
-		MSG_ReadPos(&net_message, &state->pmove.velocity);
+		if (cl.attractloop)
+			state->pmove.pm_type = PM_FREEZE;		// demo playback
 
-	if (flags & PS_M_TIME)
-		state->pmove.pm_time = MSG_ReadByte(&net_message);
+		return;
+	}
 
-	if (flags & PS_M_FLAGS)
-		state->pmove.pm_flags = MSG_ReadByte(&net_message);
+#define READ_FIELD(flag, kind, member)	if (flags & (flag)) state->member = MSG_READ_##kind(&net_message, quant);
 
-	if (flags & PS_M_GRAVITY)
-		state->pmove.gravity = MSG_ReadShort(&net_message);
+	MSG_PLAYERSTATE_FIELDS(READ_FIELD)
 
-	if (flags & PS_M_DELTA_ANGLES)
-	{
-		state->pmove.delta_angles[0] = MSG_ReadShort(&net_message);
-		state->pmove.delta_angles[1] = MSG_ReadShort(&net_message);
-		state->pmove.delta_angles[2] = MSG_ReadShort(&net_message);
-	}
+#undef READ_FIELD
 
 	if (cl.attractloop)
 		state->pmove.pm_type = PM_FREEZE;		// demo playback
 
-	//
-	// parse the rest of the player_state_t
-	//
+	// parse stats
+	statbits = MSG_ReadPacked(&net_message, 32, false, quant);
+	for (i = 0; i < MAX_STATS; i++)
+		if (statbits & (1 << i))
+			state->stats[i] = MSG_ReadPacked(&net_message, 16, true, quant);
+}
+
+
+/*
+==================
+CL_FrameStats
+
+Re-encodes a parsed frame with both frame encodings, so recorded demos
+can be used to compare the bandwidth of PROTOCOL_VERSION and
+PROTOCOL_VERSION_QUANTIZED
+==================
+*/
+
+// the server defaults, used when the frames being parsed are byte aligned
+static msg_quantize_t framestats_quantize = { 3, 10 };
 
-	if (flags & PS_VIEWORIGIN)
-		MSG_ReadPos(&net_message, &state->vieworigin);
+static int32_t	framestats_frames;
+static int64_t	framestats_bytes[2];
+static uint8_t	framestats_buf[MAX_MSGLEN * 2];
 
-	if (flags & PS_CAMERATYPE)
-		state->camera_type = MSG_ReadByte(&net_message);
+static void CL_FrameStatsEncode(frame_t* oldframe, frame_t* newframe, sizebuf_t* msg, msg_quantize_t* quant)
+{
+	player_state_t	nullstate;
+	entity_state_t	*oldstate = NULL, *newstate = NULL;
+	int32_t 		oldindex, newindex;
+	int32_t 		oldnum, newnum;
+	int32_t 		old_num_entities;
+	int32_t 		maxclients;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+	maxclients = atoi(cl.configstrings[CS_MAXCLIENTS]);
+
+	MSG_WriteByte(msg, svc_playerinfo);
+	MSG_WriteDeltaPlayerstate(oldframe ? &oldframe->playerstate : &nullstate, &newframe->playerstate, msg, quant);
 
-	if (flags & PS_VIEWOFFSET)
+	// same walk as SV_EmitPacketEntities
+	MSG_WriteByte(msg, svc_packetentities);
+
+	old_num_entities = oldframe ? oldframe->num_entities : 0;
+	oldindex = 0;
+	newindex = 0;
+
+	while (newindex < newframe->num_entities || oldindex < old_num_entities)
 	{
-		state->viewoffset[0] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->viewoffset[1] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->viewoffset[2] = (float)MSG_ReadChar(&net_message) * 0.25f;
+		if (newindex >= newframe->num_entities)
+			newnum = 9999;
+		else
+		{
+			newstate = &cl_parse_entities[(newframe->parse_entities + newindex) & (MAX_PARSE_ENTITIES - 1)];
+			newnum = newstate->number;
+		}
+
+		if (oldindex >= old_num_entities)
+			oldnum = 9999;
+		else
+		{
+			oldstate = &cl_parse_entities[(oldframe->parse_entities + oldindex) & (MAX_PARSE_ENTITIES - 1)];
+			oldnum = oldstate->number;
+		}
+
+		if (newnum == oldnum)
+		{
+			MSG_WriteDeltaEntityPacked(oldstate, newstate, msg, false, newnum <= maxclients, quant);
+			oldindex++;
+			newindex++;
+		}
+		else if (newnum < oldnum)
+		{
+			MSG_WriteDeltaEntityPacked(&cl_entities[newnum].baseline, newstate, msg, true, true, quant);
+			newindex++;
+		}
+		else
+		{
+			MSG_WriteEntityHeader(msg, U_REMOVE, oldnum, quant);
+			oldindex++;
+		}
 	}
 
-	if (flags & PS_VIEWANGLES)
+	MSG_WriteEntityHeader(msg, 0, 0, quant);
+}
+
+static void CL_FrameStats(frame_t* oldframe, frame_t* newframe)
+{
+	sizebuf_t	msg;
+
+	SZ_Init(&msg, framestats_buf, sizeof(framestats_buf));
+	msg.allowoverflow = true;
+
+	CL_FrameStatsEncode(oldframe, newframe, &msg, NULL);
+	framestats_bytes[0] += msg.cursize;
+
+	SZ_Clear(&msg);
+	CL_FrameStatsEncode(oldframe, newframe, &msg, cl.frame_quantize ? cl.frame_quantize : &framestats_quantize);
+	framestats_bytes[1] += msg.cursize;
+
+	framestats_frames++;
+}
+
+/*
+==================
+CL_FrameStats_f
+
+Prints the average frame size for each encoding since the last framestats
+==================
+*/
+void CL_FrameStats_f()
+{
+	if (!framestats_frames)
 	{
-		state->viewangles[0] = MSG_ReadAngle16(&net_message);
-		state->viewangles[1] = MSG_ReadAngle16(&net_message);
-		state->viewangles[2] = MSG_ReadAngle16(&net_message);
+		Com_Printf("No frames measured. Set cl_framestats 1 and play a demo or join a server.\n");
+		return;
 	}
 
-	if (flags & PS_KICKANGLES)
+	Com_Printf("%i frames\n", framestats_frames);
+	Com_Printf("protocol %i: %.1f bytes/frame\n", PROTOCOL_VERSION, (double)framestats_bytes[0] / framestats_frames);
+	Com_Printf("protocol %i: %.1f bytes/frame (%.1f%%)\n", PROTOCOL_VERSION_QUANTIZED, (double)framestats_bytes[1] / framestats_frames,
+		framestats_bytes[0] ? 100.0 * framestats_bytes[1] / framestats_bytes[0] : 0.0);
+
+	framestats_frames = 0;
+	framestats_bytes[0] = framestats_bytes[1] = 0;
+}
+
+/*
+==================
+CL_MsgBench_f
+
+msgbench [rounds]: times writing and reading byte aligned entities and a playerstate with
+msg_bulk on and off, for the current frame (play a demo for a recorded set) and for a
+synthetic set with every field changing
+==================
+*/
+#define MSGBENCH_SYNTHETIC		512
+
+static entity_state_t	msgbench_entities[MAX_PARSE_ENTITIES];
+static uint8_t			msgbench_buf[2][MAX_PARSE_ENTITIES * MSG_MAX_ENTITY + MSG_MAX_PLAYERSTATE];
+
+static void CL_MsgBenchWrite(sizebuf_t* msg, player_state_t* ps, int32_t count)
+{
+	entity_state_t	nullstate;
+	player_state_t	nullps;
+	int32_t 		i;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+	memset(&nullps, 0, sizeof(nullps));
+
+	SZ_Clear(msg);
+	MSG_WriteDeltaPlayerstate(&nullps, ps, msg, NULL);
+
+	for (i = 0; i < count; i++)
+		MSG_WriteDeltaEntity(&nullstate, &msgbench_entities[i], msg, true, true);
+}
+
+static void CL_MsgBenchRead(sizebuf_t* msg, int32_t count)
+{
+	entity_state_t	nullstate, state;
+	sizebuf_t		saved_message;
+	msg_quantize_t* saved_quantize;
+	frame_t			frame;
+	uint32_t		bits;
+	int32_t 		i, number;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+
+	// the parsers read net_message with the current frame encoding
+	saved_message = net_message;
+	saved_quantize = cl.frame_quantize;
+	net_message = *msg;
+	cl.frame_quantize = NULL;
+	MSG_BeginReading(&net_message);
+
+	CL_ParsePlayerstate(NULL, &frame);
+
+	for (i = 0; i < count; i++)
 	{
-		state->kick_angles[0] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->kick_angles[1] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->kick_angles[2] = (float)MSG_ReadChar(&net_message) * 0.25f;
+		number = CL_ParseEntityBits(&bits, NULL);
+		MSG_ReadDeltaEntity(&net_message, &nullstate, &state, number, bits, NULL);
 	}
 
-	if (flags & PS_WEAPONINDEX)
+	net_message = saved_message;
+	cl.frame_quantize = saved_quantize;
+}
+
+static void CL_MsgBenchRun(char* name, player_state_t* ps, int32_t count, int32_t rounds)
+{
+	sizebuf_t	msg[2];
+	int64_t 	start, write[2], read[2];
+	float		saved_bulk;
+	int32_t 	i, j;
+
+	saved_bulk = msg_bulk->value;
+
+	// 0 with msg_bulk on, 1 with it off
+	for (i = 0; i < 2; i++)
 	{
-		state->gunindex = MSG_ReadByte(&net_message);
+		Cvar_SetValue("msg_bulk", !i);
+		SZ_Init(&msg[i], msgbench_buf[i], sizeof(msgbench_buf[i]));
+
+		start = Sys_Nanoseconds();
+
+		for (j = 0; j < rounds; j++)
+			CL_MsgBenchWrite(&msg[i], ps, count);
+
+		write[i] = Sys_Nanoseconds() - start;
+		start = Sys_Nanoseconds();
+
+		for (j = 0; j < rounds; j++)
+			CL_MsgBenchRead(&msg[i], count);
+
+		read[i] = Sys_Nanoseconds() - start;
 	}
 
-	if (flags & PS_WEAPONFRAME)
+	Cvar_SetValue("msg_bulk", saved_bulk);
+
+	if (msg[0].cursize != msg[1].cursize
+		|| memcmp(msg[0].data, msg[1].data, msg[0].cursize))
 	{
-		state->gunframe = MSG_ReadByte(&net_message);
-		state->gunoffset[0] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->gunoffset[1] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->gunoffset[2] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->gunangles[0] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->gunangles[1] = (float)MSG_ReadChar(&net_message) * 0.25f;
-		state->gunangles[2] = (float)MSG_ReadChar(&net_message) * 0.25f;
+		Com_Printf("%s: the bulk and checked paths wrote different messages!\n", name);
+		return;
 	}
 
-	if (flags & PS_BLEND)
+	Com_Printf("%s: %i entities, %i bytes\n", name, count, msg[0].cursize);
+	Com_Printf("  write: %7.1f ns/entity bulk, %7.1f checked, %.0f MB/s bulk\n",
+		write[0] / (double)(rounds * count), write[1] / (double)(rounds * count),
+		write[0] ? (double)msg[0].cursize * rounds * 1000.0 / write[0] : 0.0);
+	Com_Printf("  read:  %7.1f ns/entity bulk, %7.1f checked, %.0f MB/s bulk\n",
+		read[0] / (double)(rounds * count), read[1] / (double)(rounds * count),
+		read[0] ? (double)msg[0].cursize * rounds * 1000.0 / read[0] : 0.0);
+}
+
+void CL_MsgBench_f()
+{
+	player_state_t	ps;
+	entity_state_t* es;
+	int32_t 		rounds, i;
+
+	rounds = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 1000;
+
+	if (rounds <= 0)
+		rounds = 1;
+
+	// the entities of the frame being shown
+	if (cls.state == ca_active && cl.frame.valid && cl.frame.num_entities)
 	{
-		state->blend[0] = (float)MSG_ReadByte(&net_message) / 255.0f;
-		state->blend[1] = (float)MSG_ReadByte(&net_message) / 255.0f;
-		state->blend[2] = (float)MSG_ReadByte(&net_message) / 255.0f;
-		state->blend[3] = (float)MSG_ReadByte(&net_message) / 255.0f;
+		for (i = 0; i < cl.frame.num_entities; i++)
+			msgbench_entities[i] = cl_parse_entities[(cl.frame.parse_entities + i) & (MAX_PARSE_ENTITIES - 1)];
+
+		CL_MsgBenchRun("current frame", &cl.frame.playerstate, cl.frame.num_entities, rounds);
 	}
 
-	if (flags & PS_FOV)
-		state->fov = MSG_ReadByte(&net_message);
+	// every field set, including 16 bit entity numbers and 32 bit skins, effects and renderfx
+	srand(1);
+	memset(msgbench_entities, 0, sizeof(msgbench_entities));
 
-	if (flags & PS_RDFLAGS)
-		state->rdflags = MSG_ReadByte(&net_message);
+	for (i = 0; i < MSGBENCH_SYNTHETIC; i++)
+	{
+		es = &msgbench_entities[i];
+		es->number = i + 1;
+		es->modelindex = 1 + rand() % 255;
+		es->modelindex2 = rand() % 256;
+		es->modelindex3 = rand() % 256;
+		es->modelindex4 = rand() % 256;
+		es->frame = rand() % 1024;
+		es->skinnum = rand() | (i & 1 ? 0x10000 : 0);
+		es->effects = rand() | (i & 1 ? 0x10000 : 0);
+		es->renderfx = rand() | (i & 1 ? 0x10000 : 0);
+		es->origin[0] = (rand() % 8192) - 4096.0f;
+		es->origin[1] = (rand() % 8192) - 4096.0f;
+		es->origin[2] = (rand() % 8192) - 4096.0f;
+		es->angles[0] = rand() % 360;
+		es->angles[1] = rand() % 360;
+		es->angles[2] = rand() % 360;
+		VectorCopy3(es->origin, es->old_origin);
+		es->sound = rand() % 256;
+		es->event = 1 + rand() % 255;
+		es->solid = rand() % 0x8000;
+	}
+
+	memset(&ps, 0, sizeof(ps));
+	ps.pmove.pm_type = PM_NORMAL + 1;
+	ps.pmove.origin[0] = 1024.5f;
+	ps.pmove.origin[1] = -512.25f;
+	ps.pmove.origin[2] = 64.0f;
+	ps.pmove.velocity[0] = 320.0f;
+	ps.pmove.velocity[1] = -200.0f;
+	ps.pmove.velocity[2] = 10.0f;
+	ps.pmove.pm_time = 20;
+	ps.pmove.pm_flags = 3;
+	ps.pmove.gravity = 800;
+	ps.pmove.delta_angles[0] = ps.pmove.delta_angles[1] = ps.pmove.delta_angles[2] = 1000;
+	ps.vieworigin[0] = ps.vieworigin[1] = ps.vieworigin[2] = 8.0f;
+	ps.camera_type = 1;
+	ps.viewoffset[2] = 22.0f;
+	ps.viewangles[0] = 10.0f;
+	ps.viewangles[1] = 90.0f;
+	ps.viewangles[2] = 1.0f;
+	ps.kick_angles[0] = ps.kick_angles[1] = ps.kick_angles[2] = 2.0f;
+	ps.gunindex = 1;
+	ps.gunframe = 5;
+	ps.gunoffset[0] = ps.gunangles[0] = 1.0f;
+	ps.blend[0] = ps.blend[3] = 0.5f;
+	ps.fov = 90;
+	ps.rdflags = 1;
 
-	// parse stats
-	statbits = MSG_ReadInt(&net_message);
 	for (i = 0; i < MAX_STATS; i++)
-		if (statbits & (1 << i))
-			state->stats[i] = MSG_ReadShort(&net_message);
+		ps.stats[i] = i + 1;
+
+	CL_MsgBenchRun("synthetic", &ps, MSGBENCH_SYNTHETIC, rounds);
 }
 
 
@@ -573,6 +737,9 @@ void CL_ParseFrame()
 
 	CL_ParsePacketEntities(old, &cl.frame);
 
+	if (cl_framestats->value && cl.frame.valid)
+		CL_FrameStats(old, &cl.frame);
+
 	// save the frame off in the backup array for later delta comparisons
 	cl.frames[cl.frame.serverframe & UPDATE_MASK] = cl.frame;
 
@@ -1097,6 +1264,8 @@ Emits all entities, particles, and lights to the refresh
 */
 void CL_AddEntities()
 {
+	int64_t perf_start;
+
 	if (cls.state != ca_active)
 		return;
 
@@ -1122,9 +1291,13 @@ void CL_AddEntities()
 
 	CL_CalcViewValues();
 	// PMM - moved this here so the heat beam has the right values for the vieworg, and can lock the beam to the gun
+	perf_start = CL_TimedemoBegin();
 	CL_AddPacketEntities(&cl.frame);
+	CL_TimedemoEnd(clperf_packetentities, perf_start);
 	CL_AddTEnts();
+	perf_start = CL_TimedemoBegin();
 	CL_AddParticles();
+	CL_TimedemoEnd(clperf_particles, perf_start);
 	CL_AddDLights();
 	CL_AddLightStyles();
 }
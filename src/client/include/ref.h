@@ -128,7 +128,7 @@ typedef struct refdef_s
 	particle_t*		particles;
 } refdef_t;
 
-#define	API_VERSION		14
+#define	API_VERSION		15
 
 //
 // these are the functions exported by the refresh module
@@ -228,6 +228,17 @@ typedef struct
 	void	(*Vid_ChangeResolution)();
 
 	void	(*Com_Quit)();
+
+	// trace_start zones, see TIMELINE_BEGIN in gl_local.h
+	bool*	timeline_active;
+	void	(*Timeline_Begin)(const char* name);
+	void	(*Timeline_End)();
+
+	// see jobs.c for what a job may touch
+	void	(*Job_Run)(job_counter_t* counter, const char* name, void (*func)(void* arg), void* arg);
+	void	(*Job_Wait)(job_counter_t* counter);
+	void	(*Job_ParallelFor)(const char* name, int32_t count, int32_t batch, void (*func)(void* arg, int32_t start, int32_t end), void* arg);
+	int32_t	(*Job_NumThreads)();
 } refimport_t;
 
 
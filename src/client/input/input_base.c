@@ -31,6 +31,9 @@ uint32_t		frame_msec;
 uint32_t		old_sys_frame_time;
 extern bool		mouse_initialized;
 
+extern cvar_t*	vid_borderless;
+extern cvar_t*	vid_fullscreen;
+
 extern void Input_MLookDown();
 extern void Input_MLookUp();
 
@@ -101,8 +104,8 @@ void Input_Frame()
 		|| cls.input_dest == key_menu)
 	{
 		// temporarily deactivate if in windowed
-		if (Cvar_VariableValue("vid_borderless") == 0
-			&& Cvar_VariableValue("vid_fullscreen") == 0)
+		if (!vid_borderless->value
+			&& !vid_fullscreen->value)
 		{
 			Input_MouseDeactivate();
 			return;
@@ -528,7 +531,7 @@ void CL_SendCmd()
 
 	if (cls.state == ca_connected)
 	{
-		if (cls.netchan.message.cursize || curtime - cls.netchan.last_sent > 1000)
+		if (Netchan_NeedTransmit(&cls.netchan) || curtime - cls.netchan.last_sent > 1000)
 			Netchan_Transmit(&cls.netchan, 0, buf.data);
 		return;
 	}
@@ -542,6 +545,9 @@ void CL_SendCmd()
 		MSG_WriteString(&cls.netchan.message, Cvar_Userinfo());
 	}
 
+	if (cls.cmdfile)
+		CL_WriteCmd(cmd);
+
 	SZ_Init(&buf, data, sizeof(data));
 
 	// begin a client move command
@@ -553,7 +559,7 @@ void CL_SendCmd()
 
 	// let the server know what the last frame we
 	// got was, so the next message can be delta compressed
-	if (cl_nodelta->value || !cl.frame.valid || cls.demowaiting)
+	if (cl_nodelta->value || !cl.frame.valid || cls.demowaiting || cls.demokeyframe)
 		MSG_WriteInt(&buf, -1);	// no compression
 	else
 		MSG_WriteInt(&buf, cl.frame.serverframe);
@@ -181,6 +181,8 @@ void Render3D_PrepRefresh()
 	if (!cl.configstrings[CS_MODELS + 1][0])
 		return;		// no map loaded
 
+	TIMELINE_BEGIN("Render3D_PrepRefresh");
+
 	Render2D_AddDirtyPoint(0, 0);
 	Render2D_AddDirtyPoint(r_width->value - 1, r_height->value - 1);
 
@@ -278,6 +280,8 @@ void Render3D_PrepRefresh()
 	// start the cd track
 	int32_t track = atoi(cl.configstrings[CS_CDTRACK]);
 	Miniaudio_Play(track, true);
+
+	TIMELINE_END();
 }
 
 /*
@@ -179,6 +179,13 @@ bool Vid_LoadRefresh(char* name)
 	ri.Cvar_SetValue = Cvar_SetValue;
 	ri.Vid_ChangeResolution = Vid_ChangeResolution;
 	ri.Com_Quit = Com_Quit;
+	ri.timeline_active = &timeline_active;
+	ri.Timeline_Begin = Timeline_Begin;
+	ri.Timeline_End = Timeline_End;
+	ri.Job_Run = Job_Run;
+	ri.Job_Wait = Job_Wait;
+	ri.Job_ParallelFor = Job_ParallelFor;
+	ri.Job_NumThreads = Job_NumThreads;
 
 	if ((GetRefAPI = (void*)GetProcAddress(reflib_library, "GetRefAPI")) == 0)
 		Com_Error(ERR_FATAL, "GetProcAddress failed on %s", name);
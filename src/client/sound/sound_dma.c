@@ -107,6 +107,11 @@ void S_SoundInfo_f()
 	Com_Printf("0x%x dma buffer\n", dma.buffer);
 }
 
+// rebuild the scale tables when the volume changes
+static void S_VolumeChanged(cvar_t* var)
+{
+	S_InitScaletable();
+}
 
 
 /*
@@ -142,6 +147,7 @@ void S_Init()
 			return;
 
 		S_InitScaletable();
+		Cvar_AddCallback(s_volume_sfx, S_VolumeChanged);
 
 		sound_started = 1;
 		num_sfx = 0;
@@ -946,10 +952,6 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 		return;
 	}
 
-	// rebuild scale tables if volume is modified
-	if (s_volume_sfx->modified)
-		S_InitScaletable();
-
 	VectorCopy3(origin, listener_origin);
 	VectorCopy3(forward, listener_forward);
 	VectorCopy3(right, listener_right);
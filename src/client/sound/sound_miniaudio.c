@@ -232,7 +232,7 @@ void Miniaudio_Play(int32_t track, bool looping)
 	paused = false;
 	trackFinished = false;
 
-	if ( Cvar_VariableValue("s_volume_music") == 0 )
+	if (s_volume_music->value == 0)
 		Miniaudio_Pause();
 
 	ma_device_set_master_volume(&device, s_volume_music->value);
@@ -33,27 +33,7 @@ void S_WriteLinearBlastStereo16();
 
 void S_WriteLinearBlastStereo16()
 {
-	int32_t 	i;
-	int32_t 	val;
-
-	for (i = 0; i < snd_linear_count; i += 2)
-	{
-		val = snd_p[i] >> 8;
-		if (val > 0x7fff)
-			snd_out[i] = 0x7fff;
-		else if (val < (int16_t)0x8000)
-			snd_out[i] = (int16_t)0x8000;
-		else
-			snd_out[i] = val;
-
-		val = snd_p[i + 1] >> 8;
-		if (val > 0x7fff)
-			snd_out[i + 1] = 0x7fff;
-		else if (val < (int16_t)0x8000)
-			snd_out[i + 1] = (int16_t)0x8000;
-		else
-			snd_out[i + 1] = val;
-	}
+	Com_ClipSamples(snd_out, snd_p, snd_linear_count);
 }
 
 void S_TransferStereo16(uint64_t* pbuf, int32_t endtime)
@@ -344,26 +324,14 @@ void S_PaintChannelFrom8(channel_t* ch, sfxcache_t* sc, int32_t count, int32_t o
 
 void S_PaintChannelFrom16(channel_t* ch, sfxcache_t* sc, int32_t count, int32_t offset)
 {
-	int32_t data;
-	int32_t left, right;
 	int32_t leftvol, rightvol;
 	int16_t* sfx;
-	int32_t i;
-	portable_samplepair_t* samp;
 
 	leftvol = ch->leftvol * snd_vol;
 	rightvol = ch->rightvol * snd_vol;
 	sfx = (int16_t*)sc->data + ch->pos;
 
-	samp = &paintbuffer[offset];
-	for (i = 0; i < count; i++, samp++)
-	{
-		data = sfx[i];
-		left = (data * leftvol) >> 8;
-		right = (data * rightvol) >> 8;
-		samp->left += left;
-		samp->right += right;
-	}
+	Com_MixMono16((int32_t*)&paintbuffer[offset], sfx, count, leftvol, rightvol);
 
 	ch->pos += count;
 }
@@ -24,15 +24,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <client/include/client_api.h>
 
 #define	MAX_ALIAS_NAME	32
+#define	CMD_HASH_SIZE	512		// for commands and aliases, which are matched without case
 
 typedef struct cmdalias_s
 {
 	struct cmdalias_s	*next;
+	struct cmdalias_s	*hash_next;
 	char	name[MAX_ALIAS_NAME];
 	char	*value;
 } cmdalias_t;
 
 cmdalias_t	*cmd_alias;
+static cmdalias_t*	cmd_alias_hash[CMD_HASH_SIZE];
 
 bool	cmd_wait;
 
@@ -42,6 +45,50 @@ int32_t 	alias_count;		// for detecting runaway loops
 
 //=============================================================================
 
+/*
+============
+Cmd_HashName
+
+Com_HashString, but without case
+============
+*/
+static uint32_t Cmd_HashName (char *name)
+{
+	uint32_t	hash = 2166136261u;
+	uint8_t		c;
+
+	while (*name)
+	{
+		c = *name++;
+
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		hash ^= c;
+		hash *= 16777619u;
+	}
+
+	return hash & (CMD_HASH_SIZE - 1);
+}
+
+/*
+============
+Cmd_FindAlias
+============
+*/
+static cmdalias_t *Cmd_FindAlias (char *name)
+{
+	cmdalias_t	*a;
+
+	for (a = cmd_alias_hash[Cmd_HashName(name)] ; a ; a=a->hash_next)
+	{
+		if (!Q_strcasecmp(name, a->name))
+			return a;
+	}
+
+	return NULL;
+}
+
 /*
 ============
 Cmd_Wait_f
@@ -445,20 +492,19 @@ void Cmd_Alias_f ()
 	}
 
 	// if the alias already exists, reuse it
-	for (a = cmd_alias ; a ; a=a->next)
+	a = Cmd_FindAlias (s);
+
+	if (a)
 	{
-		if (!strcmp(s, a->name))
-		{
-			Memory_ZoneFree (a->value);
-			break;
-		}
+		Memory_ZoneFree (a->value);
 	}
-
-	if (!a)
+	else
 	{
 		a = Memory_ZoneMalloc (sizeof(cmdalias_t));
 		a->next = cmd_alias;
 		cmd_alias = a;
+		a->hash_next = cmd_alias_hash[Cmd_HashName(s)];
+		cmd_alias_hash[Cmd_HashName(s)] = a;
 	}
 	strcpy (a->name, s);	
 
@@ -487,6 +533,7 @@ void Cmd_Alias_f ()
 typedef struct cmd_function_s
 {
 	struct cmd_function_s	*next;
+	struct cmd_function_s	*hash_next;
 	char					*name;
 	xcommand_t				function;
 } cmd_function_t;
@@ -496,8 +543,28 @@ static int32_t cmd_argc;
 static char*	cmd_argv[MAX_STRING_TOKENS];
 static char*	cmd_null_string = "";
 static char		cmd_args[MAX_STRING_CHARS];
+static char		cmd_tokens[MAX_STRING_CHARS + MAX_STRING_TOKENS];	// cmd_argv points in here, so tokenizing never allocates
 
 static cmd_function_t* cmd_functions;		// possible commands to execute
+static cmd_function_t* cmd_function_hash[CMD_HASH_SIZE];
+
+/*
+============
+Cmd_FindCommand
+============
+*/
+static cmd_function_t *Cmd_FindCommand (char *name)
+{
+	cmd_function_t	*cmd;
+
+	for (cmd = cmd_function_hash[Cmd_HashName(name)] ; cmd ; cmd=cmd->hash_next)
+	{
+		if (!Q_strcasecmp(name, cmd->name))
+			return cmd;
+	}
+
+	return NULL;
+}
 
 /*
 ============
@@ -619,15 +686,13 @@ $Cvars will be expanded unless they are in a quoted token
 */
 void Cmd_TokenizeString (char *text, bool macro_expand)
 {
-	int32_t 	i;
+	int32_t 	used, length;
 	char	*com_token;
 
 // clear the args from the last string
-	for (i=0 ; i<cmd_argc ; i++)
-		Memory_ZoneFree (cmd_argv[i]);
-		
 	cmd_argc = 0;
 	cmd_args[0] = 0;
+	used = 0;
 	
 	// macro expand the text
 	if (macro_expand)
@@ -673,10 +738,14 @@ void Cmd_TokenizeString (char *text, bool macro_expand)
 		if (!text)
 			return;
 
-		if (cmd_argc < MAX_STRING_TOKENS)
+		length = (int32_t)strlen(com_token) + 1;
+
+		if (cmd_argc < MAX_STRING_TOKENS
+			&& used + length <= sizeof(cmd_tokens))
 		{
-			cmd_argv[cmd_argc] = Memory_ZoneMalloc ((int32_t)strlen(com_token)+1);
-			strcpy (cmd_argv[cmd_argc], com_token);
+			cmd_argv[cmd_argc] = cmd_tokens + used;
+			memcpy (cmd_argv[cmd_argc], com_token, length);
+			used += length;
 			cmd_argc++;
 		}
 	}
@@ -701,13 +770,10 @@ void Cmd_AddCommand (char *cmd_name, xcommand_t function)
 	}
 	
 // fail if the command already exists
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	if (Cmd_FindCommand (cmd_name))
 	{
-		if (!strcmp (cmd_name, cmd->name))
-		{
-			Com_Printf ("Cmd_AddCommand: %s already defined\n", cmd_name);
-			return;
-		}
+		Com_Printf ("Cmd_AddCommand: %s already defined\n", cmd_name);
+		return;
 	}
 
 	cmd = Memory_ZoneMalloc (sizeof(cmd_function_t));
@@ -715,6 +781,8 @@ void Cmd_AddCommand (char *cmd_name, xcommand_t function)
 	cmd->function = function;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+	cmd->hash_next = cmd_function_hash[Cmd_HashName(cmd_name)];
+	cmd_function_hash[Cmd_HashName(cmd_name)] = cmd;
 }
 
 /*
@@ -726,6 +794,16 @@ void Cmd_RemoveCommand (char *cmd_name)
 {
 	cmd_function_t	*cmd, **back;
 
+	// unlink it from its hash chain, then from the list
+	for (back = &cmd_function_hash[Cmd_HashName(cmd_name)] ; *back ; back = &(*back)->hash_next)
+	{
+		if (!strcmp (cmd_name, (*back)->name))
+		{
+			*back = (*back)->hash_next;
+			break;
+		}
+	}
+
 	back = &cmd_functions;
 	while (1)
 	{
@@ -752,15 +830,7 @@ Cmd_Exists
 */
 bool Cmd_Exists (char *cmd_name)
 {
-	cmd_function_t	*cmd;
-
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
-	{
-		if (!strcmp (cmd_name,cmd->name))
-			return true;
-	}
-
-	return false;
+	return Cmd_FindCommand (cmd_name) != NULL;
 }
 
 
@@ -806,7 +876,6 @@ char *Cmd_CompleteCommand (char *partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 void	Cmd_ExecuteString (char *text)
@@ -821,33 +890,31 @@ void	Cmd_ExecuteString (char *text)
 		return;		// no tokens
 
 	// check functions
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	cmd = Cmd_FindCommand (cmd_argv[0]);
+
+	if (cmd)
 	{
-		if (!Q_strcasecmp (cmd_argv[0],cmd->name))
-		{
-			if (!cmd->function)
-			{	// forward to server command
-				Cmd_ExecuteString (va("cmd %s", text));
-			}
-			else
-				cmd->function ();
-			return;
+		if (!cmd->function)
+		{	// forward to server command
+			Cmd_ExecuteString (va("cmd %s", text));
 		}
+		else
+			cmd->function ();
+		return;
 	}
 
 	// check alias
-	for (a=cmd_alias ; a ; a=a->next)
+	a = Cmd_FindAlias (cmd_argv[0]);
+
+	if (a)
 	{
-		if (!Q_strcasecmp (cmd_argv[0], a->name))
+		if (++alias_count == ALIAS_LOOP_COUNT)
 		{
-			if (++alias_count == ALIAS_LOOP_COUNT)
-			{
-				Com_Printf ("ALIAS_LOOP_COUNT\n");
-				return;
-			}
-			Cbuf_InsertText (a->value);
+			Com_Printf ("ALIAS_LOOP_COUNT\n");
 			return;
 		}
+		Cbuf_InsertText (a->value);
+		return;
 	}
 	
 	// check cvars
@@ -874,6 +941,80 @@ void Cmd_List_f ()
 	Com_Printf ("%i commands\n", i);
 }
 
+static int32_t cmd_bench_calls;
+
+static void Cmd_BenchNop_f ()
+{
+	cmd_bench_calls += Cmd_Argc ();
+}
+
+/*
+============
+Cmd_Bench_f
+
+cmd_bench [lines]: times Cbuf_Execute on a script like a busy server's, with
+commands, quoted arguments, cvar reads and sets, macro expansion and an alias
+============
+*/
+void Cmd_Bench_f ()
+{
+	static char* script[] =
+	{
+		"cmd_bench_alias\n",		// only first in each batch, as alias_count is only reset by Cbuf_Execute
+		"cmd_bench_nop\n",
+		"cmd_bench_nop 1 2 3 \"four five\" six\n",
+		"cmd_bench_var\n",
+		"cmd_bench_var 1;cmd_bench_nop $cmd_bench_var\n",
+		"cmd_bench_nop \"a fairly long quoted argument, like a say\" 123 456\n",
+	};
+	int32_t 	num_script = sizeof(script) / sizeof(script[0]);
+	char		saved[sizeof(cmd_text_buf)];
+	int32_t 	saved_size, lines, executed, batch;
+	int64_t 	start, time;
+
+	lines = Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 100000;
+
+	if (lines <= 0)
+		lines = 1;
+
+	// the rest of the buffer that called this runs after the benchmark, not in it
+	saved_size = cmd_text.cursize;
+	memcpy (saved, cmd_text.data, saved_size);
+	SZ_Clear (&cmd_text);
+
+	Cvar_Get ("cmd_bench_var", "0", 0);
+	Cmd_AddCommand ("cmd_bench_nop", Cmd_BenchNop_f);
+	Cbuf_AddText ("alias cmd_bench_alias \"cmd_bench_nop alias\"\n");
+	Cbuf_Execute ();
+
+	cmd_bench_calls = executed = 0;
+	time = 0;
+
+	while (executed < lines)
+	{
+		for (batch = 0; batch < 64 && executed < lines; batch++)
+		{
+			Cbuf_AddText (script[batch ? 1 + (batch - 1) % (num_script - 1) : 0]);
+			executed++;
+		}
+
+		start = Sys_Nanoseconds ();
+		Cbuf_Execute ();
+		time += Sys_Nanoseconds () - start;
+	}
+
+	Cmd_RemoveCommand ("cmd_bench_nop");
+
+	memcpy (cmd_text.data, saved, saved_size);
+	cmd_text.cursize = saved_size;
+
+	if (!time)
+		time = 1;
+
+	Com_Printf ("%i lines in %.2f ms: %.0f lines per second, %.1f ns per line\n", executed,
+		time / 1000000.0, executed * 1000000000.0 / time, time / (double)executed);
+}
+
 /*
 ============
 Cmd_Init
@@ -889,5 +1030,6 @@ void Cmd_Init ()
 	Cmd_AddCommand ("echo",Cmd_Echo_f);
 	Cmd_AddCommand ("alias",Cmd_Alias_f);
 	Cmd_AddCommand ("wait", Cmd_Wait_f);
+	Cmd_AddCommand ("cmd_bench", Cmd_Bench_f);
 }
 
@@ -48,12 +48,11 @@ cvar_t* timescale;
 cvar_t* fixedtime;
 cvar_t* logfile_active;	// 1 = buffer log, 2 = flush after each print, 3 = append
 cvar_t* showtrace;
+cvar_t* msg_bulk;
 cvar_t* dedicated;
 cvar_t* engine_version;
 cvar_t* debug_console;		// debug console toggle for Windows
 
-FILE* logfile;
-
 int32_t server_state;
 
 // host_speeds times
@@ -134,27 +133,8 @@ void Com_Printf(char* fmt, ...)
 
 	Con_Print(msg);
 
-	// also echo to debugging console
-	Sys_ConsoleOutput(msg);
-
-	// logfile
-	if (logfile_active && logfile_active->value)
-	{
-		char name[MAX_QPATH];
-
-		if (!logfile)
-		{
-			snprintf(name, sizeof(name), "%s/qconsole.log", FS_Gamedir());
-			if (logfile_active->value > 2)
-				logfile = fopen(name, "a");
-			else
-				logfile = fopen(name, "w");
-		}
-		if (logfile)
-			fprintf(logfile, "%s", msg);
-		if (logfile_active->value > 1)
-			fflush(logfile);		// force it to save every time
-	}
+	// the debugging console and the logfile, from the logger thread
+	Log_Print(msg);
 }
 
 
@@ -202,6 +182,8 @@ void Com_Error(int32_t code, char* fmt, ...)
 	vsnprintf(msg, MAXPRINTMSG, fmt, argptr);
 	va_end(argptr);
 
+	Timeline_EndZones();
+
 	if (code == ERR_DISCONNECT)
 	{
 		client.CL_Drop();
@@ -211,6 +193,7 @@ void Com_Error(int32_t code, char* fmt, ...)
 	else if (code == ERR_DROP)
 	{
 		Com_Printf("********************\nERROR: %s\n********************\n", msg);
+		Log_Flush();
 		SV_Shutdown(va("Server crashed: %s\n", msg), false);
 		client.CL_Drop();
 		recursive = false;
@@ -224,11 +207,7 @@ void Com_Error(int32_t code, char* fmt, ...)
 		client.CL_Shutdown();
 	}
 
-	if (logfile)
-	{
-		fclose(logfile);
-		logfile = NULL;
-	}
+	Log_Shutdown();
 
 	Sys_Error("%s", msg);
 }
@@ -246,12 +225,8 @@ void Com_Quit()
 	SV_Shutdown("Server quit\n", false);
 	SV_ShutdownGameProgs();
 	client.CL_Shutdown();
-
-	if (logfile)
-	{
-		fclose(logfile);
-		logfile = NULL;
-	}
+	Job_Shutdown();
+	Log_Shutdown();
 
 	Sys_Quit();
 }
@@ -372,6 +347,101 @@ void MSG_WriteAngle16(sizebuf_t* sb, float f)
 	MSG_WriteShort(sb, ANGLE2SHORT(f));
 }
 
+/*
+==================
+MSG_WriteBits
+
+Writes the low bits of value, least significant bit first. Consecutive
+calls share bytes; any other write starts a new byte.
+==================
+*/
+void MSG_WriteBits(sizebuf_t* sb, int32_t value, int32_t bits)
+{
+	uint32_t	v = (uint32_t)value;
+	uint8_t*	buf;
+	int32_t 	used, count;
+
+	// only carry on in the last byte if the last bit write left it partly filled
+	if (!(sb->writebit & 7) || (sb->writebit >> 3) != sb->cursize - 1)
+		sb->writebit = sb->cursize << 3;
+
+	while (bits > 0)
+	{
+		used = sb->writebit & 7;
+
+		if (!used)
+		{
+			buf = SZ_GetSpace(sb, 1);
+			buf[0] = 0;
+			sb->writebit = (sb->cursize - 1) << 3;
+		}
+
+		count = 8 - used;
+
+		if (count > bits)
+			count = bits;
+
+		sb->data[sb->cursize - 1] |= (v & ((1 << count) - 1)) << used;
+		v >>= count;
+		bits -= count;
+		sb->writebit += count;
+	}
+}
+
+/*
+==================
+MSG_WritePacked
+
+Writes an integer field of a frame. Bit packed for PROTOCOL_VERSION_QUANTIZED,
+otherwise as a byte, short or int.
+==================
+*/
+void MSG_WritePacked(sizebuf_t* sb, int32_t value, int32_t bits, msg_quantize_t* quant)
+{
+	if (quant)
+		MSG_WriteBits(sb, value, bits);
+	else if (bits == 8)
+		MSG_WriteByte(sb, value);
+	else if (bits == 16)
+		MSG_WriteShort(sb, value);
+	else
+		MSG_WriteInt(sb, value);
+}
+
+void MSG_WritePackedCoord(sizebuf_t* sb, float f, msg_quantize_t* quant)
+{
+	int32_t 	bits, limit;
+	int32_t 	value;
+
+	if (!quant)
+	{
+		MSG_WriteCoord(sb, f);
+		return;
+	}
+
+	bits = COORD_INTEGER_BITS + quant->coord_bits;
+	limit = (1 << (bits - 1)) - 1;
+	value = (int32_t)floorf(f * (1 << quant->coord_bits) + 0.5f);
+
+	if (value > limit)
+		value = limit;
+	else if (value < -limit)
+		value = -limit;
+
+	MSG_WriteBits(sb, value, bits);
+}
+
+void MSG_WritePackedAngle(sizebuf_t* sb, float f, msg_quantize_t* quant)
+{
+	if (!quant)
+	{
+		MSG_WriteAngle(sb, f);
+		return;
+	}
+
+	MSG_WriteBits(sb, (int32_t)floorf(f * (1 << quant->angle_bits) / 360 + 0.5f), quant->angle_bits);
+}
+
 
 void MSG_WriteDeltaUsercmd(sizebuf_t* buf, usercmd_t* from, usercmd_t* cmd)
 {
@@ -469,6 +539,99 @@ void MSG_ReadDir(sizebuf_t* sb, vec3_t dir)
 }
 
 
+/*
+==================
+MSG_WriteEntityHeader
+
+Writes the U_* bits and entity number that start every entity in a
+packetentities message, U_REMOVE markers and the end of the message
+==================
+*/
+void MSG_WriteEntityHeader(sizebuf_t* msg, int32_t bits, int32_t number, msg_quantize_t* quant)
+{
+	// the packed encoding always sends ENTITY_NUMBER_BITS
+	if (!quant && number >= 256)
+		bits |= U_NUMBER16;		// number8 is implicit otherwise
+
+	if (bits & 0xff000000)
+		bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x00ff0000)
+		bits |= U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x0000ff00)
+		bits |= U_MOREBITS1;
+
+	MSG_WritePacked(msg, bits & 255, 8, quant);
+
+	if (bits & 0xff000000)
+	{
+		MSG_WritePacked(msg, (bits >> 8) & 255, 8, quant);
+		MSG_WritePacked(msg, (bits >> 16) & 255, 8, quant);
+		MSG_WritePacked(msg, (bits >> 24) & 255, 8, quant);
+	}
+	else if (bits & 0x00ff0000)
+	{
+		MSG_WritePacked(msg, (bits >> 8) & 255, 8, quant);
+		MSG_WritePacked(msg, (bits >> 16) & 255, 8, quant);
+	}
+	else if (bits & 0x0000ff00)
+	{
+		MSG_WritePacked(msg, (bits >> 8) & 255, 8, quant);
+	}
+
+	if (quant)
+		MSG_WriteBits(msg, number, ENTITY_NUMBER_BITS);
+	else if (bits & U_NUMBER16)
+		MSG_WriteShort(msg, number);
+	else
+		MSG_WriteByte(msg, number);
+}
+
+/*
+==================
+MSG_PutDeltaEntity
+
+The byte aligned MSG_WriteEntityHeader and fields of MSG_WriteDeltaEntityPacked,
+for a buffer with room for MSG_MAX_ENTITY
+==================
+*/
+static void MSG_PutDeltaEntity(uint8_t** p, entity_state_t* to, int32_t bits)
+{
+	if (to->number >= 256)
+		bits |= U_NUMBER16;		// number8 is implicit otherwise
+
+	if (bits & 0xff000000)
+		bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x00ff0000)
+		bits |= U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x0000ff00)
+		bits |= U_MOREBITS1;
+
+	MSG_PutByte(p, bits & 255);
+
+	if (bits & U_MOREBITS1)
+		MSG_PutByte(p, (bits >> 8) & 255);
+	if (bits & U_MOREBITS2)
+		MSG_PutByte(p, (bits >> 16) & 255);
+	if (bits & U_MOREBITS3)
+		MSG_PutByte(p, (bits >> 24) & 255);
+
+	if (bits & U_NUMBER16)
+		MSG_PutShort(p, to->number);
+	else
+		MSG_PutByte(p, to->number);
+
+#define PUT_FIELD(flag, kind, member)	if (bits & (flag)) MSG_PUT_##kind(p, to->member);
+#define PUT_SIZED(flag8, flag16, member) \
+	if ((bits & ((flag8) | (flag16))) == ((flag8) | (flag16))) MSG_PUT_INT(p, to->member); \
+	else if (bits & (flag8)) MSG_PUT_BYTE(p, to->member); \
+	else if (bits & (flag16)) MSG_PUT_SHORT(p, to->member);
+
+	MSG_ENTITY_FIELDS(PUT_FIELD, PUT_SIZED)
+
+#undef PUT_FIELD
+#undef PUT_SIZED
+}
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -478,8 +641,21 @@ Can delta from either a baseline or a previous packet_entity
 ==================
 */
 void MSG_WriteDeltaEntity(entity_state_t* from, entity_state_t* to, sizebuf_t* msg, bool force, bool newentity)
+{
+	MSG_WriteDeltaEntityPacked(from, to, msg, force, newentity, NULL);
+}
+
+/*
+==================
+MSG_WriteDeltaEntityPacked
+
+MSG_WriteDeltaEntity for either encoding
+==================
+*/
+void MSG_WriteDeltaEntityPacked(entity_state_t* from, entity_state_t* to, sizebuf_t* msg, bool force, bool newentity, msg_quantize_t* quant)
 {
 	int32_t 	bits;
+	uint8_t*	out;
 
 	if (!to->number)
 		Com_Error(ERR_FATAL, "Unset entity number");
@@ -489,9 +665,6 @@ void MSG_WriteDeltaEntity(entity_state_t* from, entity_state_t* to, sizebuf_t* m
 	// send an update
 	bits = 0;
 
-	if (to->number >= 256)
-		bits |= U_NUMBER16;		// number8 is implicit otherwise
-
 	if (to->origin[0] != from->origin[0])
 		bits |= U_ORIGIN1;
 	if (to->origin[1] != from->origin[1])
@@ -572,103 +745,180 @@ void MSG_WriteDeltaEntity(entity_state_t* from, entity_state_t* to, sizebuf_t* m
 	if (!bits && !force)
 		return;		// nothing to send!
 
+	// byte aligned, and there is room for the largest entity
+	if (!quant && (out = MSG_BeginWrite(msg, MSG_MAX_ENTITY)))
+	{
+		MSG_PutDeltaEntity(&out, to, bits);
+		MSG_EndWrite(msg, out);
+		return;
+	}
+
 	//----------
 
-	if (bits & 0xff000000)
-		bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
-	else if (bits & 0x00ff0000)
-		bits |= U_MOREBITS2 | U_MOREBITS1;
-	else if (bits & 0x0000ff00)
-		bits |= U_MOREBITS1;
+	MSG_WriteEntityHeader(msg, bits, to->number, quant);
 
-	MSG_WriteByte(msg, bits & 255);
+	//----------
 
-	if (bits & 0xff000000)
-	{
-		MSG_WriteByte(msg, (bits >> 8) & 255);
-		MSG_WriteByte(msg, (bits >> 16) & 255);
-		MSG_WriteByte(msg, (bits >> 24) & 255);
-	}
-	else if (bits & 0x00ff0000)
-	{
-		MSG_WriteByte(msg, (bits >> 8) & 255);
-		MSG_WriteByte(msg, (bits >> 16) & 255);
-	}
-	else if (bits & 0x0000ff00)
-	{
-		MSG_WriteByte(msg, (bits >> 8) & 255);
-	}
+#define WRITE_FIELD(flag, kind, member)	if (bits & (flag)) MSG_WRITE_##kind(msg, to->member, quant);
+#define WRITE_SIZED(flag8, flag16, member) \
+	if ((bits & ((flag8) | (flag16))) == ((flag8) | (flag16))) MSG_WRITE_INT(msg, to->member, quant); \
+	else if (bits & (flag8)) MSG_WRITE_BYTE(msg, to->member, quant); \
+	else if (bits & (flag16)) MSG_WRITE_SHORT(msg, to->member, quant);
 
-	//----------
+	MSG_ENTITY_FIELDS(WRITE_FIELD, WRITE_SIZED)
 
-	if (bits & U_NUMBER16)
-		MSG_WriteShort(msg, to->number);
-	else
-		MSG_WriteByte(msg, to->number);
-
-	if (bits & U_MODEL)
-		MSG_WriteByte(msg, to->modelindex);
-	if (bits & U_MODEL2)
-		MSG_WriteByte(msg, to->modelindex2);
-	if (bits & U_MODEL3)
-		MSG_WriteByte(msg, to->modelindex3);
-	if (bits & U_MODEL4)
-		MSG_WriteByte(msg, to->modelindex4);
-
-	if (bits & U_FRAME8)
-		MSG_WriteByte(msg, to->frame);
-	if (bits & U_FRAME16)
-		MSG_WriteShort(msg, to->frame);
-
-	if ((bits & U_SKIN8) && (bits & U_SKIN16))		//used for laser colors
-		MSG_WriteInt(msg, to->skinnum);
-	else if (bits & U_SKIN8)
-		MSG_WriteByte(msg, to->skinnum);
-	else if (bits & U_SKIN16)
-		MSG_WriteShort(msg, to->skinnum);
-
-
-	if ((bits & (U_EFFECTS8 | U_EFFECTS16)) == (U_EFFECTS8 | U_EFFECTS16))
-		MSG_WriteInt(msg, to->effects);
-	else if (bits & U_EFFECTS8)
-		MSG_WriteByte(msg, to->effects);
-	else if (bits & U_EFFECTS16)
-		MSG_WriteShort(msg, to->effects);
-
-	if ((bits & (U_RENDERFX8 | U_RENDERFX16)) == (U_RENDERFX8 | U_RENDERFX16))
-		MSG_WriteInt(msg, to->renderfx);
-	else if (bits & U_RENDERFX8)
-		MSG_WriteByte(msg, to->renderfx);
-	else if (bits & U_RENDERFX16)
-		MSG_WriteShort(msg, to->renderfx);
-
-	if (bits & U_ORIGIN1)
-		MSG_WriteCoord(msg, to->origin[0]);
-	if (bits & U_ORIGIN2)
-		MSG_WriteCoord(msg, to->origin[1]);
-	if (bits & U_ORIGIN3)
-		MSG_WriteCoord(msg, to->origin[2]);
-
-	if (bits & U_ANGLE1)
-		MSG_WriteAngle(msg, to->angles[0]);
-	if (bits & U_ANGLE2)
-		MSG_WriteAngle(msg, to->angles[1]);
-	if (bits & U_ANGLE3)
-		MSG_WriteAngle(msg, to->angles[2]);
-
-	if (bits & U_OLDORIGIN)
+#undef WRITE_FIELD
+#undef WRITE_SIZED
+}
+
+/*
+==================
+MSG_PutDeltaPlayerstate
+
+The byte aligned fields of MSG_WriteDeltaPlayerstate, for a buffer with room for MSG_MAX_PLAYERSTATE
+==================
+*/
+static void MSG_PutDeltaPlayerstate(uint8_t** p, player_state_t* ops, player_state_t* ps, int32_t pflags)
+{
+	int32_t 		i;
+	int32_t 		statbits;
+
+	MSG_PutInt(p, pflags);
+
+#define PUT_FIELD(flag, kind, member)	if (pflags & (flag)) MSG_PUT_##kind(p, ps->member);
+
+	MSG_PLAYERSTATE_FIELDS(PUT_FIELD)
+
+#undef PUT_FIELD
+
+	// send stats
+	statbits = 0;
+	for (i = 0; i < MAX_STATS; i++)
+		if (ps->stats[i] != ops->stats[i])
+			statbits |= 1 << i;
+	MSG_PutInt(p, statbits);
+	for (i = 0; i < MAX_STATS; i++)
+		if (statbits & (1 << i))
+			MSG_PutShort(p, ps->stats[i]);
+}
+
+/*
+==================
+MSG_WriteDeltaPlayerstate
+
+Writes the body of an svc_playerinfo
+==================
+*/
+void MSG_WriteDeltaPlayerstate(player_state_t* ops, player_state_t* ps, sizebuf_t* msg, msg_quantize_t* quant)
+{
+	int32_t 		i;
+	int32_t 		pflags;
+	int32_t 		statbits;
+	uint8_t*		out;
+
+	//
+	// determine what needs to be sent
+	//
+	pflags = 0;
+
+	if (ps->pmove.pm_type != ops->pmove.pm_type)
+		pflags |= PS_M_TYPE;
+
+	if (ps->pmove.origin[0] != ops->pmove.origin[0]
+		|| ps->pmove.origin[1] != ops->pmove.origin[1]
+		|| ps->pmove.origin[2] != ops->pmove.origin[2])
+		pflags |= PS_M_ORIGIN;
+
+	if (ps->pmove.velocity[0] != ops->pmove.velocity[0]
+		|| ps->pmove.velocity[1] != ops->pmove.velocity[1]
+		|| ps->pmove.velocity[2] != ops->pmove.velocity[2])
+		pflags |= PS_M_VELOCITY;
+
+	if (ps->pmove.pm_time != ops->pmove.pm_time)
+		pflags |= PS_M_TIME;
+
+	if (ps->pmove.pm_flags != ops->pmove.pm_flags)
+		pflags |= PS_M_FLAGS;
+
+	if (ps->pmove.gravity != ops->pmove.gravity)
+		pflags |= PS_M_GRAVITY;
+
+	if (ps->pmove.delta_angles[0] != ops->pmove.delta_angles[0]
+		|| ps->pmove.delta_angles[1] != ops->pmove.delta_angles[1]
+		|| ps->pmove.delta_angles[2] != ops->pmove.delta_angles[2])
+		pflags |= PS_M_DELTA_ANGLES;
+
+	if (ps->vieworigin[0] != ops->vieworigin[0]
+		|| ps->vieworigin[1] != ops->vieworigin[1]
+		|| ps->vieworigin[2] != ops->vieworigin[2])
+		pflags |= PS_VIEWORIGIN;
+
+	if (ps->camera_type != ops->camera_type)
+		pflags |= PS_CAMERATYPE;
+
+	if (ps->viewoffset[0] != ops->viewoffset[0]
+		|| ps->viewoffset[1] != ops->viewoffset[1]
+		|| ps->viewoffset[2] != ops->viewoffset[2])
+		pflags |= PS_VIEWOFFSET;
+
+	if (ps->viewangles[0] != ops->viewangles[0]
+		|| ps->viewangles[1] != ops->viewangles[1]
+		|| ps->viewangles[2] != ops->viewangles[2])
+		pflags |= PS_VIEWANGLES;
+
+	if (ps->kick_angles[0] != ops->kick_angles[0]
+		|| ps->kick_angles[1] != ops->kick_angles[1]
+		|| ps->kick_angles[2] != ops->kick_angles[2])
+		pflags |= PS_KICKANGLES;
+
+	if (ps->blend[0] != ops->blend[0]
+		|| ps->blend[1] != ops->blend[1]
+		|| ps->blend[2] != ops->blend[2]
+		|| ps->blend[3] != ops->blend[3])
+		pflags |= PS_BLEND;
+
+	if (ps->fov != ops->fov)
+		pflags |= PS_FOV;
+
+	if (ps->rdflags != ops->rdflags)
+		pflags |= PS_RDFLAGS;
+
+	if (ps->gunframe != ops->gunframe)
+		pflags |= PS_WEAPONFRAME;
+
+	pflags |= PS_WEAPONINDEX;
+
+	// byte aligned, and there is room for the largest playerstate
+	if (!quant && (out = MSG_BeginWrite(msg, MSG_MAX_PLAYERSTATE)))
 	{
-		MSG_WriteCoord(msg, to->old_origin[0]);
-		MSG_WriteCoord(msg, to->old_origin[1]);
-		MSG_WriteCoord(msg, to->old_origin[2]);
+		MSG_PutDeltaPlayerstate(&out, ops, ps, pflags);
+		MSG_EndWrite(msg, out);
+		return;
 	}
 
-	if (bits & U_SOUND)
-		MSG_WriteByte(msg, to->sound);
-	if (bits & U_EVENT)
-		MSG_WriteByte(msg, to->event);
-	if (bits & U_SOLID)
-		MSG_WriteShort(msg, to->solid);
+	//
+	// write it
+	//
+	if (quant)
+		MSG_WriteBits(msg, pflags, PS_NUMBITS);
+	else
+		MSG_WriteInt(msg, pflags);
+
+#define WRITE_FIELD(flag, kind, member)	if (pflags & (flag)) MSG_WRITE_##kind(msg, ps->member, quant);
+
+	MSG_PLAYERSTATE_FIELDS(WRITE_FIELD)
+
+#undef WRITE_FIELD
+
+	// send stats
+	statbits = 0;
+	for (i = 0; i < MAX_STATS; i++)
+		if (ps->stats[i] != ops->stats[i])
+			statbits |= 1 << i;
+	MSG_WritePacked(msg, statbits, 32, quant);
+	for (i = 0; i < MAX_STATS; i++)
+		if (statbits & (1 << i))
+			MSG_WritePacked(msg, ps->stats[i], 16, quant);
 }
 
 
@@ -681,6 +931,7 @@ void MSG_WriteDeltaEntity(entity_state_t* from, entity_state_t* to, sizebuf_t* m
 void MSG_BeginReading(sizebuf_t* msg)
 {
 	msg->readcount = 0;
+	msg->readbit = 0;
 }
 
 // returns -1 if no more characters are available
@@ -837,6 +1088,99 @@ float MSG_ReadAngle16(sizebuf_t* msg_read)
 	return SHORT2ANGLE(MSG_ReadShort(msg_read));
 }
 
+/*
+==================
+MSG_ReadBits
+
+Reads bits written by MSG_WriteBits. Returns -1 past the end of the message,
+like the other reading functions.
+==================
+*/
+int32_t MSG_ReadBits(sizebuf_t* msg_read, int32_t bits)
+{
+	uint32_t	value = 0;
+	int32_t 	shift = 0;
+	int32_t 	used, count;
+
+	if (!(msg_read->readbit & 7) || (msg_read->readbit >> 3) != msg_read->readcount - 1)
+		msg_read->readbit = msg_read->readcount << 3;
+
+	while (bits > 0)
+	{
+		used = msg_read->readbit & 7;
+
+		if (!used)
+		{
+			if (msg_read->readcount >= msg_read->cursize)
+			{
+				msg_read->readcount = msg_read->cursize + 1;
+				return -1;
+			}
+
+			msg_read->readcount++;
+			msg_read->readbit = (msg_read->readcount - 1) << 3;
+		}
+
+		count = 8 - used;
+
+		if (count > bits)
+			count = bits;
+
+		value |= ((msg_read->data[msg_read->readcount - 1] >> used) & ((1 << count) - 1)) << shift;
+		shift += count;
+		bits -= count;
+		msg_read->readbit += count;
+	}
+
+	return (int32_t)value;
+}
+
+/*
+==================
+MSG_ReadPacked
+
+Reads a field written by MSG_WritePacked. Signed fields are sign extended
+the same way MSG_ReadChar and MSG_ReadShort do.
+==================
+*/
+int32_t MSG_ReadPacked(sizebuf_t* msg_read, int32_t bits, bool is_signed, msg_quantize_t* quant)
+{
+	int32_t 	value;
+
+	if (!quant)
+	{
+		if (bits == 8)
+			return is_signed ? MSG_ReadChar(msg_read) : MSG_ReadByte(msg_read);
+		else if (bits == 16)
+			return is_signed ? MSG_ReadShort(msg_read) : (MSG_ReadShort(msg_read) & 0xffff);
+		else
+			return MSG_ReadInt(msg_read);
+	}
+
+	value = MSG_ReadBits(msg_read, bits);
+
+	if (is_signed && bits < 32 && (value & (1 << (bits - 1))))
+		value |= ~((1 << bits) - 1);
+
+	return value;
+}
+
+float MSG_ReadPackedCoord(sizebuf_t* msg_read, msg_quantize_t* quant)
+{
+	if (!quant)
+		return MSG_ReadCoord(msg_read);
+
+	return (float)MSG_ReadPacked(msg_read, COORD_INTEGER_BITS + quant->coord_bits, true, quant) / (1 << quant->coord_bits);
+}
+
+float MSG_ReadPackedAngle(sizebuf_t* msg_read, msg_quantize_t* quant)
+{
+	if (!quant)
+		return MSG_ReadAngle(msg_read);
+
+	return MSG_ReadPacked(msg_read, quant->angle_bits, true, quant) * (360.0f / (1 << quant->angle_bits));
+}
+
 void MSG_ReadDeltaUsercmd(sizebuf_t* msg_read, usercmd_t* from, usercmd_t* move)
 {
 	int32_t bits;
@@ -876,6 +1220,112 @@ void MSG_ReadDeltaUsercmd(sizebuf_t* msg_read, usercmd_t* from, usercmd_t* move)
 }
 
 
+/*
+==================
+MSG_ReadEntityBits
+
+Reads the header MSG_WriteEntityHeader writes, returns the entity number and the U_* bits
+==================
+*/
+int32_t MSG_ReadEntityBits(sizebuf_t* msg_read, uint32_t* bits, msg_quantize_t* quant)
+{
+	uint32_t		b, total;
+	int32_t 		number;
+
+	total = MSG_ReadPacked(msg_read, 8, false, quant);
+	if (total & U_MOREBITS1)
+	{
+		b = MSG_ReadPacked(msg_read, 8, false, quant);
+		total |= b << 8;
+	}
+	if (total & U_MOREBITS2)
+	{
+		b = MSG_ReadPacked(msg_read, 8, false, quant);
+		total |= b << 16;
+	}
+	if (total & U_MOREBITS3)
+	{
+		b = MSG_ReadPacked(msg_read, 8, false, quant);
+		total |= b << 24;
+	}
+
+	if (quant)
+		number = MSG_ReadBits(msg_read, ENTITY_NUMBER_BITS);
+	else if (total & U_NUMBER16)
+		number = MSG_ReadShort(msg_read);
+	else
+		number = MSG_ReadByte(msg_read);
+
+	*bits = total;
+
+	return number;
+}
+
+/*
+==================
+MSG_GetDeltaEntity
+
+The byte aligned fields of MSG_ReadDeltaEntity, from a message with MSG_MAX_ENTITY left
+==================
+*/
+static void MSG_GetDeltaEntity(uint8_t** p, entity_state_t* to, int32_t bits)
+{
+#define GET_FIELD(flag, kind, member)	if (bits & (flag)) to->member = MSG_GET_##kind(p);
+#define GET_SIZED(flag8, flag16, member) \
+	if ((bits & ((flag8) | (flag16))) == ((flag8) | (flag16))) to->member = MSG_GET_INT(p); \
+	else if (bits & (flag8)) to->member = MSG_GET_BYTE(p); \
+	else if (bits & (flag16)) to->member = MSG_GET_SHORT(p);
+
+	// event is not delta compressed, just 0 compressed
+	to->event = 0;
+
+	MSG_ENTITY_FIELDS(GET_FIELD, GET_SIZED)
+
+#undef GET_FIELD
+#undef GET_SIZED
+}
+
+/*
+==================
+MSG_ReadDeltaEntity
+
+Can go from either a baseline or a previous packet_entity
+==================
+*/
+void MSG_ReadDeltaEntity(sizebuf_t* msg_read, entity_state_t* from, entity_state_t* to, int32_t number, int32_t bits, msg_quantize_t* quant)
+{
+	uint8_t* p;
+
+	// set everything to the state we are delta'ing from
+	*to = *from;
+
+	VectorCopy3(from->origin, to->old_origin);
+	to->number = number;
+
+	// byte aligned, and the message is long enough for the largest entity
+	if (!quant && (p = MSG_BeginRead(msg_read, MSG_MAX_ENTITY)))
+	{
+		MSG_GetDeltaEntity(&p, to, bits);
+		MSG_EndRead(msg_read, p);
+		return;
+	}
+
+#define READ_FIELD(flag, kind, member)	if (bits & (flag)) to->member = MSG_READ_##kind(msg_read, quant);
+#define READ_SIZED(flag8, flag16, member) \
+	if ((bits & ((flag8) | (flag16))) == ((flag8) | (flag16))) to->member = MSG_READ_INT(msg_read, quant); \
+	else if (bits & (flag8)) to->member = MSG_READ_BYTE(msg_read, quant); \
+	else if (bits & (flag16)) to->member = MSG_READ_SHORT(msg_read, quant);
+
+	// event is not delta compressed, just 0 compressed
+	to->event = 0;
+
+	MSG_ENTITY_FIELDS(READ_FIELD, READ_SIZED)
+
+#undef READ_FIELD
+#undef READ_SIZED
+}
+
+
 void MSG_ReadData(sizebuf_t* msg_read, void* data, int32_t len)
 {
 	int32_t 	i;
@@ -897,6 +1347,7 @@ void SZ_Init(sizebuf_t* buf, uint8_t* data, int32_t length)
 void SZ_Clear(sizebuf_t* buf)
 {
 	buf->cursize = 0;
+	buf->writebit = 0;
 	buf->overflowed = false;
 }
 
@@ -1004,6 +1455,19 @@ char* CopyString(char* in)
 	return out;
 }
 
+uint32_t Com_HashString(char* string)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*string)
+	{
+		hash ^= (uint8_t)*string++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 /*
 ============================================================================
 
@@ -1431,6 +1895,7 @@ void Common_Init(int32_t argc, char** argv)
 	//
 	Cmd_AddCommand("memory_zonestats", Memory_ZoneStats_f);
 	Cmd_AddCommand("error", Com_Error_f);
+	Cmd_AddCommand("checksum_bench", Com_ChecksumBench_f);
 
 	profile_all = Cvar_Get("profile_all", "0", 0);
 	log_memalloc = Cvar_Get("log_memalloc", "0", 0);
@@ -1450,6 +1915,7 @@ void Common_Init(int32_t argc, char** argv)
 	fixedtime = Cvar_Get("fixedtime", "0", 0);
 	logfile_active = Cvar_Get("logfile", "0", 0);
 	showtrace = Cvar_Get("showtrace", "0", 0);
+	msg_bulk = Cvar_Get("msg_bulk", "1", 0);
 #ifdef DEDICATED_ONLY
 	dedicated = Cvar_Get("dedicated", "1", CVAR_NOSET);
 #else
@@ -1461,6 +1927,8 @@ void Common_Init(int32_t argc, char** argv)
 	debug_console = Cvar_Get("debug_console", "0", CVAR_NOSET);
 #endif
 
+	Log_Init();
+
 	s = va("%d.%d.%d.%d %s %s %s %s", ENGINE_VERSION_MAJOR, ENGINE_VERSION_MINOR, ENGINE_VERSION_REVISION, ENGINE_VERSION_BUILD, BUILD_PLATFORM, __DATE__, __TIME__, BUILD_CONFIG);
 	engine_version = Cvar_Get("version", s, CVAR_SERVERINFO | CVAR_NOSET);
 
@@ -1471,9 +1939,13 @@ void Common_Init(int32_t argc, char** argv)
 
 	Net_Init();					// Open sockets
 	Netchan_Init();				// Initialise networking channels
+	Timeline_Init();			// Initialise trace_start
 
 	Localisation_Init();		// Initialise localisaiton system
 	CPUID_Init();				// Initialise CPUID
+	CPU_DispatchInit();			// Pick the SIMD kernels for it
+	Job_Init();					// Start the job worker threads
+	Player_MoveInit();			// pmove_record and pmove_test
 
 	if (!Netservices_Init())	// Initialise CURL/the game's network services
 	{
@@ -1536,6 +2008,7 @@ void Common_Frame(int32_t msec)
 {
 	char* s;
 	int64_t 	time_before, time_between, time_after;
+	int64_t 	perf_start;
 
 	if (setjmp(abortframe))
 	{
@@ -1545,6 +2018,9 @@ void Common_Frame(int32_t msec)
 		return;			// an ERR_DROP was thrown
 	}
 
+	Timeline_Frame();
+	TIMELINE_BEGIN("Common_Frame");
+
 	if (log_stats->modified)
 	{
 		log_stats->modified = false;
@@ -1598,17 +2074,25 @@ void Common_Frame(int32_t msec)
 	Cbuf_Execute();
 
 	// Poll for netservices transfers
+	TIMELINE_BEGIN("Netservices_Frame");
+	perf_start = SV_PerfBegin();
 	Netservices_Frame();
+	SV_PerfNetservices(perf_start);
+	TIMELINE_END();
 
 	if (profile_all->value)
 		time_before = Sys_Nanoseconds();
 
+	TIMELINE_BEGIN("SV_Frame");
 	SV_Frame(msec);
+	TIMELINE_END();
 
 	if (profile_all->value)
 		time_between = Sys_Nanoseconds();
 
+	TIMELINE_BEGIN("CL_Frame");
 	client.CL_Frame(msec);
+	TIMELINE_END();
 
 	if (profile_all->value)
 		time_after = Sys_Nanoseconds();
@@ -1627,6 +2111,8 @@ void Common_Frame(int32_t msec)
 		Com_Printf("Server: %3f GameDLL: %3f Client: %3f Renderer: %3f Total: %3f\n",
 			sv, gm, cl, rf, all);
 	}
+
+	TIMELINE_END();
 }
 
 /*
@@ -1636,5 +2122,6 @@ Qcommon_Shutdown
 */
 void Common_Shutdown()
 {
+	Log_Shutdown();
 	Localisation_Shutdown();
 }
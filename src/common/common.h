@@ -40,6 +40,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define BUILD_CONFIG "Release"
 #elif PLAYTEST
 #define BUILD_CONFIG "Playtest"
+#elif HEADLESS
+#define BUILD_CONFIG "Headless"
 #else
 #define BUILD_CONFIG "Debug"
 #endif
@@ -76,6 +78,8 @@ typedef struct sizebuf_s
 	int32_t 	maxsize;
 	int32_t 	cursize;
 	int32_t 	readcount;
+	int32_t 	writebit;		// bit position of the last MSG_WriteBits, for packing into a partly filled byte
+	int32_t 	readbit;		// bit position of the last MSG_ReadBits
 } sizebuf_t;
 
 void SZ_Init(sizebuf_t* buf, uint8_t* data, int32_t length);
@@ -89,6 +93,14 @@ void SZ_Print(sizebuf_t* buf, char* data);	// strcats onto the sizebuf
 struct usercmd_s;
 struct entity_state_s;
 
+// Precision of the bit packed frame encoding used by PROTOCOL_VERSION_QUANTIZED.
+// Passing NULL to the MSG_*Packed functions selects the byte aligned PROTOCOL_VERSION encoding.
+typedef struct msg_quantize_s
+{
+	int32_t 	coord_bits;		// fractional bits of coordinates
+	int32_t 	angle_bits;		// bits per entity angle
+} msg_quantize_t;
+
 void MSG_WriteChar(sizebuf_t* sb, int32_t c);
 void MSG_WriteByte(sizebuf_t* sb, int32_t c);
 void MSG_WriteShort(sizebuf_t* sb, int32_t c);
@@ -104,6 +116,14 @@ void MSG_WriteDeltaEntity(entity_state_t* from, entity_state_t* to, sizebuf_t* m
 void MSG_WriteDir(sizebuf_t* sb, vec3_t vector);
 void MSG_WriteColor(sizebuf_t* msg_read, color4_t color);
 
+void MSG_WriteBits(sizebuf_t* sb, int32_t value, int32_t bits);
+void MSG_WritePacked(sizebuf_t* sb, int32_t value, int32_t bits, msg_quantize_t* quant);
+void MSG_WritePackedCoord(sizebuf_t* sb, float f, msg_quantize_t* quant);
+void MSG_WritePackedAngle(sizebuf_t* sb, float f, msg_quantize_t* quant);
+void MSG_WriteEntityHeader(sizebuf_t* msg, int32_t bits, int32_t number, msg_quantize_t* quant);
+void MSG_WriteDeltaEntityPacked(entity_state_t* from, entity_state_t* to, sizebuf_t* msg, bool force, bool newentity, msg_quantize_t* quant);
+void MSG_WriteDeltaPlayerstate(player_state_t* from, player_state_t* to, sizebuf_t* msg, msg_quantize_t* quant);
+
 void MSG_BeginReading(sizebuf_t* sb);
 
 int32_t MSG_ReadChar(sizebuf_t* sb);
@@ -122,9 +142,176 @@ float MSG_ReadAngle16(sizebuf_t* msg_read);
 void MSG_ReadColor(sizebuf_t* msg_read, color4_t color);
 
 void MSG_ReadDeltaUsercmd(sizebuf_t* msg_read, usercmd_t* from, usercmd_t* move);
+int32_t MSG_ReadEntityBits(sizebuf_t* msg_read, uint32_t* bits, msg_quantize_t* quant);
+void MSG_ReadDeltaEntity(sizebuf_t* msg_read, entity_state_t* from, entity_state_t* to, int32_t number, int32_t bits, msg_quantize_t* quant);
 
 void MSG_ReadData(sizebuf_t* sb, void* buffer, int32_t size);
 
+int32_t MSG_ReadBits(sizebuf_t* sb, int32_t bits);
+int32_t MSG_ReadPacked(sizebuf_t* sb, int32_t bits, bool is_signed, msg_quantize_t* quant);
+float MSG_ReadPackedCoord(sizebuf_t* sb, msg_quantize_t* quant);
+float MSG_ReadPackedAngle(sizebuf_t* sb, msg_quantize_t* quant);
+
+//
+// Bulk access for the byte aligned encoding of entities and playerstates, which are
+// many small fields. Space for the largest possible entity or playerstate is checked
+// once, then every field goes in or out through a pointer with no checks of its own.
+// When there isn't room for the largest case the checked MSG_ functions are used, so
+// overflows and reads past the end behave exactly as they always have.
+//
+#define MSG_MAX_ENTITY			64					// header, number and every field of an entity_state_t
+#define MSG_MAX_PLAYERSTATE		(96 + MAX_STATS * 2)	// every field of a player_state_t and its stats
+
+extern cvar_t* msg_bulk;	// 0 always uses the checked functions, for comparing them
+
+// returns where to write length bytes, or NULL if they might not fit
+static inline uint8_t* MSG_BeginWrite(sizebuf_t* sb, int32_t length)
+{
+	if (!msg_bulk->value || sb->cursize + length > sb->maxsize)
+		return NULL;
+
+	return sb->data + sb->cursize;
+}
+
+static inline void MSG_EndWrite(sizebuf_t* sb, uint8_t* p)
+{
+	sb->cursize = (int32_t)(p - sb->data);
+}
+
+// returns where to read length bytes from, or NULL if the message might not have them
+static inline uint8_t* MSG_BeginRead(sizebuf_t* sb, int32_t length)
+{
+	if (!msg_bulk->value || sb->readcount + length > sb->cursize)
+		return NULL;
+
+	return sb->data + sb->readcount;
+}
+
+static inline void MSG_EndRead(sizebuf_t* sb, uint8_t* p)
+{
+	sb->readcount = (int32_t)(p - sb->data);
+}
+
+static inline void MSG_PutByte(uint8_t** p, int32_t c)
+{
+	*(*p)++ = (uint8_t)c;
+}
+
+static inline void MSG_PutShort(uint8_t** p, int32_t c)
+{
+	(*p)[0] = c & 0xff;
+	(*p)[1] = (c >> 8) & 0xff;
+	*p += 2;
+}
+
+static inline void MSG_PutInt(uint8_t** p, int32_t c)
+{
+	(*p)[0] = c & 0xff;
+	(*p)[1] = (c >> 8) & 0xff;
+	(*p)[2] = (c >> 16) & 0xff;
+	(*p)[3] = (c >> 24) & 0xff;
+	*p += 4;
+}
+
+static inline void MSG_PutFloat(uint8_t** p, float f)
+{
+	union
+	{
+		float	f;
+		int32_t l;
+	} dat;
+
+	dat.f = f;
+	MSG_PutInt(p, dat.l);
+}
+
+static inline int32_t MSG_GetByte(uint8_t** p)
+{
+	return *(*p)++;
+}
+
+static inline int32_t MSG_GetChar(uint8_t** p)
+{
+	return (signed char)*(*p)++;
+}
+
+static inline int32_t MSG_GetShort(uint8_t** p)
+{
+	int32_t c = (int16_t)((*p)[0] | ((*p)[1] << 8));
+
+	*p += 2;
+	return c;
+}
+
+static inline int32_t MSG_GetInt(uint8_t** p)
+{
+	int32_t c = (int32_t)((uint32_t)(*p)[0] | ((uint32_t)(*p)[1] << 8) | ((uint32_t)(*p)[2] << 16) | ((uint32_t)(*p)[3] << 24));
+
+	*p += 4;
+	return c;
+}
+
+static inline float MSG_GetFloat(uint8_t** p)
+{
+	union
+	{
+		float	f;
+		int32_t l;
+	} dat;
+
+	dat.l = MSG_GetInt(p);
+	return dat.f;
+}
+
+//
+// How each kind of field in MSG_ENTITY_FIELDS and MSG_PLAYERSTATE_FIELDS goes in and out
+// of the bulk (PUT, GET) and checked (WRITE, READ) paths. The checked ones also do the
+// packed encoding when quant is set.
+//
+#define MSG_PUT_BYTE(p, v)				MSG_PutByte(p, v)
+#define MSG_GET_BYTE(p)					MSG_GetByte(p)
+#define MSG_WRITE_BYTE(msg, v, quant)	MSG_WritePacked(msg, v, 8, quant)
+#define MSG_READ_BYTE(msg, quant)		MSG_ReadPacked(msg, 8, false, quant)
+
+#define MSG_PUT_SHORT(p, v)				MSG_PutShort(p, v)
+#define MSG_GET_SHORT(p)				MSG_GetShort(p)
+#define MSG_WRITE_SHORT(msg, v, quant)	MSG_WritePacked(msg, v, 16, quant)
+#define MSG_READ_SHORT(msg, quant)		MSG_ReadPacked(msg, 16, true, quant)
+
+#define MSG_PUT_INT(p, v)				MSG_PutInt(p, v)
+#define MSG_GET_INT(p)					MSG_GetInt(p)
+#define MSG_WRITE_INT(msg, v, quant)	MSG_WritePacked(msg, v, 32, quant)
+#define MSG_READ_INT(msg, quant)		MSG_ReadPacked(msg, 32, true, quant)
+
+#define MSG_PUT_COORD(p, v)				MSG_PutFloat(p, v)
+#define MSG_GET_COORD(p)				MSG_GetFloat(p)
+#define MSG_WRITE_COORD(msg, v, quant)	MSG_WritePackedCoord(msg, v, quant)
+#define MSG_READ_COORD(msg, quant)		MSG_ReadPackedCoord(msg, quant)
+
+// an entity angle in a byte
+#define MSG_PUT_ANGLE8(p, v)			MSG_PutByte(p, (int32_t)((v) * 256 / 360) & 255)
+#define MSG_GET_ANGLE8(p)				(MSG_GetChar(p) * (360.0 / 256))
+#define MSG_WRITE_ANGLE8(msg, v, quant)	MSG_WritePackedAngle(msg, v, quant)
+#define MSG_READ_ANGLE8(msg, quant)		MSG_ReadPackedAngle(msg, quant)
+
+// a view angle in a short
+#define MSG_PUT_ANGLE16(p, v)			MSG_PutShort(p, ANGLE2SHORT(v))
+#define MSG_GET_ANGLE16(p)				SHORT2ANGLE(MSG_GetShort(p))
+#define MSG_WRITE_ANGLE16(msg, v, quant)	MSG_WritePacked(msg, ANGLE2SHORT(v), 16, quant)
+#define MSG_READ_ANGLE16(msg, quant)	SHORT2ANGLE(MSG_ReadPacked(msg, 16, true, quant))
+
+// a small offset in quarter units, in a signed byte
+#define MSG_PUT_QUARTER(p, v)			MSG_PutByte(p, (int32_t)((v) * 4))
+#define MSG_GET_QUARTER(p)				((float)MSG_GetChar(p) * 0.25f)
+#define MSG_WRITE_QUARTER(msg, v, quant)	MSG_WritePacked(msg, (v) * 4, 8, quant)
+#define MSG_READ_QUARTER(msg, quant)	((float)MSG_ReadPacked(msg, 8, true, quant) * 0.25f)
+
+// 0 to 1 in a byte
+#define MSG_PUT_UNIT(p, v)				MSG_PutByte(p, (int32_t)((v) * 255))
+#define MSG_GET_UNIT(p)					((float)MSG_GetByte(p) / 255.0f)
+#define MSG_WRITE_UNIT(msg, v, quant)	MSG_WritePacked(msg, (v) * 255, 8, quant)
+#define MSG_READ_UNIT(msg, quant)		((float)MSG_ReadPacked(msg, 8, false, quant) / 255.0f)
+
 //============================================================================
 
 extern bool big_endian;
@@ -151,6 +338,9 @@ void	COM_InitArgv(int32_t argc, char** argv);
 
 char* CopyString(char* in);
 
+uint32_t Com_HashString(char* string);
+// FNV-1a, for the engine's name lookup tables
+
 //============================================================================
 
 void Info_Print(char* s);
@@ -161,6 +351,29 @@ void CRC_Init(uint16_t* crcvalue);
 void CRC_ProcessByte(uint16_t* crcvalue, uint8_t data);
 uint16_t CRC_Value(uint16_t crcvalue);
 uint16_t CRC_Block(uint8_t* start, int32_t count);
+void Com_ChecksumBench_f();
+
+/* huffman.c */
+
+void Huffman_Init();
+int32_t Huffman_Compress(uint8_t* in, int32_t in_length, uint8_t* out, int32_t out_size);
+int32_t Huffman_Decompress(uint8_t* in, int32_t in_length, uint8_t* out, int32_t out_length);
+
+#define DEMO_COMPRESSED		0x40000000		// set in the length of huffman coded serverrecord messages
+
+/* timeline.c */
+
+// Scoped zones for trace_start captures. They must nest, and the names must outlive the capture.
+extern bool timeline_active;
+
+void Timeline_Init();
+void Timeline_Frame();
+void Timeline_Begin(const char* name);
+void Timeline_End();
+void Timeline_EndZones();
+
+#define TIMELINE_BEGIN(name)	do { if (timeline_active) Timeline_Begin(name); } while (0)
+#define TIMELINE_END()			do { if (timeline_active) Timeline_End(); } while (0)
 
 // portable case insensitive compare
 int32_t Q_stricmp(char* s1, char* s2);
@@ -194,6 +407,13 @@ PROTOCOL
 
 #define	PROTOCOL_VERSION	1
 
+// Same messages, but frames (svc_playerinfo and svc_packetentities) are bit packed,
+// with coordinates and entity angles quantized to the precision sent in svc_serverdata
+#define PROTOCOL_VERSION_QUANTIZED	2
+
+#define ENTITY_NUMBER_BITS	11		// enough for MAX_EDICTS
+#define COORD_INTEGER_BITS	18		// integer part of quantized coordinates, including the sign
+
 //=========================================
 
 #define	PORT_MASTER	27900
@@ -202,6 +422,19 @@ PROTOCOL
 
 //=========================================
 
+// <demo>.idx, written next to serverrecord and client demos: a header of the magic and
+// version, then the first server frame and file offset of every keyframe in the demo
+#define DEMO_INDEX_MAGIC		(('X' << 24) + ('D' << 16) + ('I' << 8) + 'D')	// "DIDX"
+#define DEMO_INDEX_VERSION		1
+
+typedef struct demoindex_s
+{
+	int32_t 	frame;			// the first svc_frame after the keyframe
+	int32_t 	offset;			// of the keyframe's serverdata, from the start of the demo
+} demoindex_t;
+
+//=========================================
+
 #define	UPDATE_BACKUP	16	// copies of entity_state_t to keep buffered
 							// must be power of two
 #define	UPDATE_MASK		(UPDATE_BACKUP-1)
@@ -284,6 +517,53 @@ typedef enum clc_ops_e
 #define	PS_RDFLAGS			(1<<15)
 #define PS_CAMERATYPE		(1<<16)
 
+#define PS_NUMBITS			17		// bits in a packed PS_* mask
+
+// The fields of a player_state_t in the order they're sent, for MSG_WriteDeltaPlayerstate
+// and CL_ParsePlayerstate in both encodings. FIELD(flag, kind, member) is sent when flag
+// is set, as a MSG_*_<kind>. The stats follow, with their own mask.
+#define MSG_PLAYERSTATE_FIELDS(FIELD) \
+	FIELD(PS_M_TYPE,			BYTE,		pmove.pm_type) \
+	FIELD(PS_M_ORIGIN,			COORD,		pmove.origin[0]) \
+	FIELD(PS_M_ORIGIN,			COORD,		pmove.origin[1]) \
+	FIELD(PS_M_ORIGIN,			COORD,		pmove.origin[2]) \
+	FIELD(PS_M_VELOCITY,		COORD,		pmove.velocity[0]) \
+	FIELD(PS_M_VELOCITY,		COORD,		pmove.velocity[1]) \
+	FIELD(PS_M_VELOCITY,		COORD,		pmove.velocity[2]) \
+	FIELD(PS_M_TIME,			BYTE,		pmove.pm_time) \
+	FIELD(PS_M_FLAGS,			BYTE,		pmove.pm_flags) \
+	FIELD(PS_M_GRAVITY,			SHORT,		pmove.gravity) \
+	FIELD(PS_M_DELTA_ANGLES,	SHORT,		pmove.delta_angles[0]) \
+	FIELD(PS_M_DELTA_ANGLES,	SHORT,		pmove.delta_angles[1]) \
+	FIELD(PS_M_DELTA_ANGLES,	SHORT,		pmove.delta_angles[2]) \
+	FIELD(PS_VIEWORIGIN,		COORD,		vieworigin[0]) \
+	FIELD(PS_VIEWORIGIN,		COORD,		vieworigin[1]) \
+	FIELD(PS_VIEWORIGIN,		COORD,		vieworigin[2]) \
+	FIELD(PS_CAMERATYPE,		BYTE,		camera_type) \
+	FIELD(PS_VIEWOFFSET,		QUARTER,	viewoffset[0]) \
+	FIELD(PS_VIEWOFFSET,		QUARTER,	viewoffset[1]) \
+	FIELD(PS_VIEWOFFSET,		QUARTER,	viewoffset[2]) \
+	FIELD(PS_VIEWANGLES,		ANGLE16,	viewangles[0]) \
+	FIELD(PS_VIEWANGLES,		ANGLE16,	viewangles[1]) \
+	FIELD(PS_VIEWANGLES,		ANGLE16,	viewangles[2]) \
+	FIELD(PS_KICKANGLES,		QUARTER,	kick_angles[0]) \
+	FIELD(PS_KICKANGLES,		QUARTER,	kick_angles[1]) \
+	FIELD(PS_KICKANGLES,		QUARTER,	kick_angles[2]) \
+	FIELD(PS_WEAPONINDEX,		BYTE,		gunindex) \
+	FIELD(PS_WEAPONFRAME,		BYTE,		gunframe) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunoffset[0]) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunoffset[1]) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunoffset[2]) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunangles[0]) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunangles[1]) \
+	FIELD(PS_WEAPONFRAME,		QUARTER,	gunangles[2]) \
+	FIELD(PS_BLEND,				UNIT,		blend[0]) \
+	FIELD(PS_BLEND,				UNIT,		blend[1]) \
+	FIELD(PS_BLEND,				UNIT,		blend[2]) \
+	FIELD(PS_BLEND,				UNIT,		blend[3]) \
+	FIELD(PS_FOV,				BYTE,		fov) \
+	FIELD(PS_RDFLAGS,			BYTE,		rdflags)
+
 //==============================================
 
 // user_cmd_t communication
@@ -349,6 +629,33 @@ typedef enum clc_ops_e
 #define	U_SOUND		(1<<26)
 #define	U_SOLID		(1<<27)
 
+// The fields of an entity_state_t in the order they're sent after the header, for
+// MSG_WriteDeltaEntityPacked and MSG_ReadDeltaEntity in both encodings. FIELD(flag, kind,
+// member) is sent when flag is set, as a MSG_*_<kind>. SIZED(flag8, flag16, member) is a
+// byte, a short, or an int when both flags are set.
+#define MSG_ENTITY_FIELDS(FIELD, SIZED) \
+	FIELD(U_MODEL,		BYTE,		modelindex) \
+	FIELD(U_MODEL2,		BYTE,		modelindex2) \
+	FIELD(U_MODEL3,		BYTE,		modelindex3) \
+	FIELD(U_MODEL4,		BYTE,		modelindex4) \
+	FIELD(U_FRAME8,		BYTE,		frame) \
+	FIELD(U_FRAME16,	SHORT,		frame) \
+	SIZED(U_SKIN8,		U_SKIN16,		skinnum) \
+	SIZED(U_EFFECTS8,	U_EFFECTS16,	effects) \
+	SIZED(U_RENDERFX8,	U_RENDERFX16,	renderfx) \
+	FIELD(U_ORIGIN1,	COORD,		origin[0]) \
+	FIELD(U_ORIGIN2,	COORD,		origin[1]) \
+	FIELD(U_ORIGIN3,	COORD,		origin[2]) \
+	FIELD(U_ANGLE1,		ANGLE8,		angles[0]) \
+	FIELD(U_ANGLE2,		ANGLE8,		angles[1]) \
+	FIELD(U_ANGLE3,		ANGLE8,		angles[2]) \
+	FIELD(U_OLDORIGIN,	COORD,		old_origin[0]) \
+	FIELD(U_OLDORIGIN,	COORD,		old_origin[1]) \
+	FIELD(U_OLDORIGIN,	COORD,		old_origin[2]) \
+	FIELD(U_SOUND,		BYTE,		sound) \
+	FIELD(U_EVENT,		BYTE,		event) \
+	FIELD(U_SOLID,		SHORT,		solid)
+
 
 /*
 ==============================================================
@@ -499,6 +806,15 @@ float Cvar_VariableValue(char* var_name);
 char* Cvar_VariableString(char* var_name);
 // returns an empty string if not defined
 
+typedef void (*cvar_callback_t)(cvar_t* var);
+
+void Cvar_AddCallback(cvar_t* var, cvar_callback_t callback);
+// callback is called every time the value of var changes, after it has changed
+// so systems can react to it instead of checking var->modified every frame
+// adding the same callback twice does nothing
+
+void Cvar_RemoveCallback(cvar_t* var, cvar_callback_t callback);
+
 char* Cvar_CompleteVariable(char* partial);
 // attempts to match a partial variable name for command line completion
 // returns NULL if nothing fits
@@ -560,7 +876,7 @@ enum cpu_feature_e
 	cpu_feature_mmx = 0x1,				// Pentium MMX (1997)
 	cpu_feature_3dnow = 0x2,			// AMD K6-2 (1999), removed in Zen 1 (2017)
 	cpu_feature_sse1 = 0x4,				// Intel Pentium III 'Katmai' (1999)
-	cpu_feature_sse2 = 0x6,				// Intel Pentium 4 'Williamette' (2000)
+	cpu_feature_sse2 = 0x800,			// Intel Pentium 4 'Williamette' (2000)
 	cpu_feature_sse3 = 0x8,				// Intel Pentium 4 'Prescott' (2004)
 	cpu_feature_ssse3 = 0x10,			// Intel Core 2 'Merom' (2006) / Tejas (cancelled)
 	cpu_feature_sse4a = 0x20,			// AMD K10/Phenom II (2007)
@@ -582,6 +898,40 @@ extern cvar_t* cpu_features;
 void CPUID_Init();
 bool CPUID_IsDefectiveIntelCPU(); // Intel Core 13th and 14th generation. These CPUs may fail due to a combination of manufacturing and microcode defects
 
+// cpu_dispatch.c: picks the scalar, SSE2, AVX2 or NEON version of each kernel once cpu_features is known
+
+typedef enum cpu_tier_e
+{
+	cpu_tier_scalar,					// the reference, always present
+	cpu_tier_sse2,
+	cpu_tier_avx2,
+	cpu_tier_neon,
+	cpu_tier_max,
+} cpu_tier_t;
+
+// a kernel checks a variant against the scalar version, printing what doesn't match
+typedef bool (*cpu_kernel_test_t)(void* variant, void* reference);
+
+typedef struct cpu_kernel_s
+{
+	char*				name;
+	void**				func;							// what callers go through
+	void*				variants[cpu_tier_max];			// NULL where there is no version for a tier
+	cpu_tier_t			tier;							// the one in use
+	cpu_kernel_test_t	test;
+	struct cpu_kernel_s* next;
+} cpu_kernel_t;
+
+void CPU_DispatchInit();
+void CPU_RegisterKernel(cpu_kernel_t* kernel);
+
+// dst |= src, for pvs and phs rows
+extern void (*Com_OrBytes)(uint8_t* dst, uint8_t* src, int32_t length);
+// the mixer's 24.8 samples to 16 bits, clamped
+extern void (*Com_ClipSamples)(int16_t* out, int32_t* in, int32_t count);
+// a 16 bit mono sound into interleaved left/right 24.8 samples
+extern void (*Com_MixMono16)(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol);
+
 /*
 ==============================================================
 NET
@@ -599,7 +949,8 @@ typedef enum
 { 
 	NA_LOOPBACK,
 	NA_BROADCAST, 
-	NA_IP 
+	NA_IP,
+	NA_BOT			// server_loadtest.c synthetic client, port is the bot number
 } netadrtype_t;
 
 typedef enum 
@@ -631,6 +982,11 @@ bool Net_IsLocalAddress(netadr_t adr);
 char* Net_AdrToString(netadr_t a);
 bool Net_StringToAdr(char* s, netadr_t* a);
 void Net_Sleep(int32_t msec);
+bool Net_Wait(int64_t nsec);
+
+// server_loadtest.c transport for NA_BOT addresses
+bool LoadTest_GetPacket(netadr_t* net_from, sizebuf_t* net_message);
+void LoadTest_SendPacket(netsrc_t sock, int32_t length, void* data, netadr_t to);
 
 //============================================================================
 
@@ -638,10 +994,28 @@ void Net_Sleep(int32_t msec);
 
 #define	MAX_LATENT	32
 
+// capabilities negotiated per connection in the connect / client_connect handshake
+#define NETCHAN_FLAG_WINDOW		1				// windowed, fragmented reliable stream
+#define NETCHAN_FLAG_COMPRESS	2				// huffman coded payloads
+
+#define NETCHAN_FRAGMENT_SIZE	1024			// largest reliable fragment
+#define NETCHAN_WINDOW			16				// fragments that may be unacknowledged at once
+#define NETCHAN_QUEUE			32				// queued fragments, must be a power of two
+
+typedef struct netchan_fragment_s
+{
+	uint16_t	sequence;			// reliable stream sequence
+	uint16_t	length;
+	bool		last;				// last fragment of a reliable message
+	int32_t 	sent_sequence;		// packet that last carried it, 0 if it needs to be sent
+	uint8_t		data[NETCHAN_FRAGMENT_SIZE];
+} netchan_fragment_t;
+
 typedef struct
 {
 	bool		fatal_error;
 	netsrc_t	sock;
+	int32_t 	flags;				// NETCHAN_FLAG_*
 
 	int32_t 	last_received;		// for timeouts
 	int32_t 	last_sent;			// for retransmits
@@ -656,6 +1030,8 @@ typedef struct
 
 	int32_t 	incoming_reliable_sequence;		// single bit, maintained local
 
+	int32_t 	incoming_payload;			// offset of the payload in the last processed message
+
 	int32_t 	outgoing_sequence;
 	int32_t 	reliable_sequence;			// single bit
 	int32_t 	last_reliable_sequence;		// sequence number of last send
@@ -667,6 +1043,17 @@ typedef struct
 	// message is copied to this buffer when it is first transfered
 	int32_t 	reliable_length;
 	uint8_t		reliable_buf[MAX_MSGLEN - 16];	// unacked reliable message
+
+	// windowed reliable stream (NETCHAN_FLAG_WINDOW)
+	uint16_t	fragment_acknowledged;		// oldest unacknowledged outgoing fragment
+	uint16_t	fragment_sequence;			// next outgoing fragment
+	netchan_fragment_t fragments[NETCHAN_QUEUE];
+
+	uint16_t	incoming_fragment_sequence;	// next fragment expected from the remote side
+	bool		fragment_ack_pending;		// received fragments the remote side doesn't know about yet
+	int32_t 	incoming_reliable_length;	// completed reliable messages at the start of the payload, the unreliable part follows
+	int32_t 	fragment_length;
+	uint8_t		fragment_buf[MAX_MSGLEN - 16];	// incoming reliable message being reassembled
 } netchan_t;
 
 extern	netadr_t	net_from;
@@ -674,9 +1061,11 @@ extern	sizebuf_t	net_message;
 extern	uint8_t		net_message_buffer[MAX_MSGLEN];
 
 void Netchan_Init();
-void Netchan_Setup(netsrc_t sock, netchan_t* chan, netadr_t adr, int32_t qport);
+void Netchan_Setup(netsrc_t sock, netchan_t* chan, netadr_t adr, int32_t qport, int32_t flags);
+int32_t Netchan_SupportedFlags();
 
 bool Netchan_NeedReliable(netchan_t* chan);
+bool Netchan_NeedTransmit(netchan_t* chan);
 void Netchan_Transmit(netchan_t* chan, int32_t length, uint8_t* data);
 void Netchan_OutOfBand(int32_t net_socket, netadr_t adr, int32_t length, uint8_t* data);
 void Netchan_OutOfBandPrint(int32_t net_socket, netadr_t adr, char* format, ...);
@@ -729,6 +1118,7 @@ bool		Map_AreasConnected(int32_t area1, int32_t area2);
 int32_t 	Map_WriteAreaBits(uint8_t* buffer, int32_t area);
 bool		Map_HeadnodeVisible(int32_t headnode, uint8_t* visbits);
 
+void*		Map_PortalState(int32_t* length);
 void		Map_WritePortalState(FILE* f);
 void		Map_ReadPortalState(FILE* f);
 int32_t 	Map_PointLeafnum(vec3_t p);
@@ -744,6 +1134,12 @@ Common between server and client so prediction matches
 */
 
 void Player_Move(pmove_t* pmove);
+void Player_MoveSnapped(pmove_t* pmove, int32_t snap_scale);
+int32_t Player_MoveSnapScale(msg_quantize_t* quant);
+void Player_MoveBatch(pmove_batch_t* batch, int32_t count);
+void Player_MoveRecord(int32_t stream, pmove_state_t* state, usercmd_t* cmd);
+void Player_MoveInit();
+void Player_MoveReference(pmove_t* pmove, int32_t snap_scale);		// pmove_reference.c, the old Player_Move for pmove_test
 
 // physics parameters
 extern float phys_stopspeed;
@@ -815,6 +1211,12 @@ void Com_DPrintf(char* fmt, ...);
 void Com_Error(int32_t code, char* fmt, ...);
 void Com_Quit();
 
+// log.c: Com_Printf's terminal and logfile output, written by a logger thread
+void Log_Init();
+void Log_Shutdown();
+void Log_Print(char* text);
+void Log_Flush();
+
 int32_t Com_GetServerState();		// this should have just been a cvar...
 void	Com_SetServerState(int32_t state);
 
@@ -826,6 +1228,7 @@ float crand();	// -1 to 1
 
 extern cvar_t* developer;
 extern cvar_t* dedicated;
+extern cvar_t* sys_eventloop;
 extern cvar_t* profile_all;
 extern cvar_t* log_stats;
 extern cvar_t* debug_console;
@@ -858,6 +1261,10 @@ extern cvar_t* hunk_areas;
 
 void Common_Init(int32_t argc, char** argv);
 void Common_Frame(int32_t msec);
+
+int32_t SV_FrameDelay();		// milliseconds until the server wants to run a frame
+int64_t SV_PerfBegin();			// 0 unless sv_perf_enable is set
+void SV_PerfNetservices(int64_t start);
 void Common_Shutdown();
 
 #define NUM_VERTEX_NORMALS	162
@@ -889,21 +1296,11 @@ typedef struct localisation_entry_s
 	char value[LOCALISATION_MAX_LENGTH_VALUE];
 } localisation_entry_t;
 
-// As we cannot change the size of a preallocated const char*, we have to dynamically allocate localised strings.
-// This struct lets us do that...
-
-typedef struct cached_string_s
-{
-	char* key; // the key the localised string is tied to
-	char* value;
-} cached_string_t;
-
 extern localisation_entry_t localisation_entries[LOCALISATION_ENTRIES_MAX];
-extern cached_string_t cached_strings[LOCALISATION_ENTRIES_MAX];
 
 void Localisation_Init();
 localisation_entry_t* Localisation_GetString(char* key);
-char* Localisation_ProcessString(char* value);
+char* Localisation_ProcessString(char* value);		// copy the result to keep it past the next call, see localisation.c
 void Localisation_Shutdown();
 
 /*
@@ -930,5 +1327,45 @@ void	Sys_Error(char* error, ...);
 int32_t	Sys_Msgbox(char* title, uint32_t buttons, char* text, ...);
 void	Sys_Quit();
 char*	Sys_GetClipboardData(void);
+bool	Sys_ReplaceFile(char* from, char* to);	// renames from over to, which is never missing or half written
+
+// threads
+typedef struct sys_thread_s sys_thread_t;
+typedef struct sys_mutex_s sys_mutex_t;
+typedef struct sys_cond_s sys_cond_t;
+
+sys_thread_t* Sys_ThreadCreate(void (*func)(void* arg), void* arg, char* name);
+void	Sys_ThreadJoin(sys_thread_t* thread);
+int32_t	Sys_CPUCount();
+
+sys_mutex_t* Sys_MutexCreate();
+void	Sys_MutexDestroy(sys_mutex_t* mutex);
+void	Sys_MutexLock(sys_mutex_t* mutex);
+void	Sys_MutexUnlock(sys_mutex_t* mutex);
+
+sys_cond_t* Sys_CondCreate();
+void	Sys_CondDestroy(sys_cond_t* cond);
+void	Sys_CondWait(sys_cond_t* cond, sys_mutex_t* mutex);
+void	Sys_CondSignal(sys_cond_t* cond);
+void	Sys_CondBroadcast(sys_cond_t* cond);
+
+// jobs.c: fork/join jobs on worker threads, see the top of jobs.c for what a job may touch
+
+#define JOB_MAX_THREADS		16		// with the main thread, as many as the timeline keeps events for
+
+typedef struct job_counter_s
+{
+	volatile int32_t	count;			// jobs started and not finished yet, start it at 0
+} job_counter_t;
+
+extern cvar_t* sys_threads;
+
+void	Job_Init();
+void	Job_Shutdown();
+void	Job_Run(job_counter_t* counter, const char* name, void (*func)(void* arg), void* arg);
+void	Job_Wait(job_counter_t* counter);
+void	Job_ParallelFor(const char* name, int32_t count, int32_t batch, void (*func)(void* arg, int32_t start, int32_t end), void* arg);
+int32_t	Job_NumThreads();
+int32_t	Job_ThreadIndex();
 
 
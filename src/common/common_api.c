@@ -143,6 +143,14 @@ void CommonAPI_Init()
 
 	// Physics
 	common.Player_Move = Player_Move;
+	common.Player_MoveBatch = Player_MoveBatch;
+
+	// Jobs
+	common.Job_NumThreads = Job_NumThreads;
+	common.Job_ParallelFor = Job_ParallelFor;
+	common.Job_Run = Job_Run;
+	common.Job_Wait = Job_Wait;
+
 	// Endianness stuff
 	common.BigFloat = BigFloat;
 	common.BigInt = BigInt;
@@ -0,0 +1,610 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cpu_dispatch.c -- picks a version of each hot kernel for the CPU
+//
+// A kernel is a function pointer with a scalar version and any of SSE2, AVX2
+// and NEON versions. Once CPUID_Init has filled in cpu_features, every kernel
+// is pointed at the best version the CPU can run, falling back a tier at a
+// time to the scalar one. cpu_dispatch forces a lower tier, for finding out
+// whether a problem is in a SIMD version.
+//
+// Every version has to give exactly the same results as the scalar one.
+// cpu_dispatch_test runs them all against it.
+
+#include <common/common.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CPU_NEON
+#include <arm_neon.h>
+#endif
+
+// msvc lets any function use any instruction set, gcc and clang have to be told
+#ifdef __GNUC__
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+static char* cpu_tier_names[cpu_tier_max] =
+{
+	"scalar",
+	"sse2",
+	"avx2",
+	"neon",
+};
+
+static cpu_kernel_t*	cpu_kernels;
+static cpu_tier_t		cpu_tier;				// what cpu_dispatch came to
+static cvar_t*			cpu_dispatch;
+
+/*
+===============================================================================
+
+KERNELS
+
+===============================================================================
+*/
+
+static void Com_OrBytes_Scalar(uint8_t* dst, uint8_t* src, int32_t length)
+{
+	int32_t i;
+
+	for (i = 0; i < length; i++)
+		dst[i] |= src[i];
+}
+
+static void Com_ClipSamples_Scalar(int16_t* out, int32_t* in, int32_t count)
+{
+	int32_t i, val;
+
+	for (i = 0; i < count; i++)
+	{
+		val = in[i] >> 8;
+
+		if (val > 0x7fff)
+			val = 0x7fff;
+		else if (val < (int16_t)0x8000)
+			val = (int16_t)0x8000;
+
+		out[i] = val;
+	}
+}
+
+static void Com_MixMono16_Scalar(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol)
+{
+	int32_t i, data;
+
+	for (i = 0; i < count; i++)
+	{
+		data = in[i];
+		out[i * 2] += (data * leftvol) >> 8;
+		out[i * 2 + 1] += (data * rightvol) >> 8;
+	}
+}
+
+#ifdef CPU_X86
+static void Com_OrBytes_SSE2(uint8_t* dst, uint8_t* src, int32_t length)
+{
+	int32_t i;
+
+	for (i = 0; i + 16 <= length; i += 16)
+	{
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_loadu_si128((__m128i*)(dst + i)),
+			_mm_loadu_si128((__m128i*)(src + i))));
+	}
+
+	Com_OrBytes_Scalar(dst + i, src + i, length - i);
+}
+
+// packs saturates to 16 bits, which is exactly the scalar clamp
+static void Com_ClipSamples_SSE2(int16_t* out, int32_t* in, int32_t count)
+{
+	__m128i a, b;
+	int32_t i;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		a = _mm_srai_epi32(_mm_loadu_si128((__m128i*)(in + i)), 8);
+		b = _mm_srai_epi32(_mm_loadu_si128((__m128i*)(in + i + 4)), 8);
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+	}
+
+	Com_ClipSamples_Scalar(out + i, in + i, count - i);
+}
+
+CPU_TARGET("avx2")
+static void Com_OrBytes_AVX2(uint8_t* dst, uint8_t* src, int32_t length)
+{
+	int32_t i;
+
+	for (i = 0; i + 32 <= length; i += 32)
+	{
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_loadu_si256((__m256i*)(dst + i)),
+			_mm256_loadu_si256((__m256i*)(src + i))));
+	}
+
+	Com_OrBytes_Scalar(dst + i, src + i, length - i);
+}
+
+CPU_TARGET("avx2")
+static void Com_ClipSamples_AVX2(int16_t* out, int32_t* in, int32_t count)
+{
+	__m256i a, b;
+	int32_t i;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		a = _mm256_srai_epi32(_mm256_loadu_si256((__m256i*)(in + i)), 8);
+		b = _mm256_srai_epi32(_mm256_loadu_si256((__m256i*)(in + i + 8)), 8);
+
+		// packs works within each 128 bit lane, so put the quarters back in order
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8));
+	}
+
+	Com_ClipSamples_Scalar(out + i, in + i, count - i);
+}
+
+// sse2 has no 32 bit multiply, so this kernel starts at avx2
+CPU_TARGET("avx2")
+static void Com_MixMono16_AVX2(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol)
+{
+	__m256i vol, spread, data;
+	int32_t i;
+
+	vol = _mm256_setr_epi32(leftvol, rightvol, leftvol, rightvol, leftvol, rightvol, leftvol, rightvol);
+	spread = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		data = _mm256_cvtepi16_epi32(_mm_loadl_epi64((__m128i*)(in + i)));
+		data = _mm256_permutevar8x32_epi32(data, spread);
+		data = _mm256_srai_epi32(_mm256_mullo_epi32(data, vol), 8);
+		_mm256_storeu_si256((__m256i*)(out + i * 2), _mm256_add_epi32(_mm256_loadu_si256((__m256i*)(out + i * 2)), data));
+	}
+
+	Com_MixMono16_Scalar(out + i * 2, in + i, count - i, leftvol, rightvol);
+}
+#endif
+
+#ifdef CPU_NEON
+static void Com_OrBytes_NEON(uint8_t* dst, uint8_t* src, int32_t length)
+{
+	int32_t i;
+
+	for (i = 0; i + 16 <= length; i += 16)
+		vst1q_u8(dst + i, vorrq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+
+	Com_OrBytes_Scalar(dst + i, src + i, length - i);
+}
+
+static void Com_ClipSamples_NEON(int16_t* out, int32_t* in, int32_t count)
+{
+	int32_t i;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vshrq_n_s32(vld1q_s32(in + i), 8)),
+			vqmovn_s32(vshrq_n_s32(vld1q_s32(in + i + 4), 8))));
+	}
+
+	Com_ClipSamples_Scalar(out + i, in + i, count - i);
+}
+
+static void Com_MixMono16_NEON(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol)
+{
+	int32x4x2_t	mixed;
+	int32x4_t	data;
+	int32_t 	i;
+
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		// vld2/vst2 split the pairs into a left and a right vector and put them back
+		mixed = vld2q_s32(out + i * 2);
+		data = vmovl_s16(vld1_s16(in + i));
+		mixed.val[0] = vaddq_s32(mixed.val[0], vshrq_n_s32(vmulq_n_s32(data, leftvol), 8));
+		mixed.val[1] = vaddq_s32(mixed.val[1], vshrq_n_s32(vmulq_n_s32(data, rightvol), 8));
+		vst2q_s32(out + i * 2, mixed);
+	}
+
+	Com_MixMono16_Scalar(out + i * 2, in + i, count - i, leftvol, rightvol);
+}
+#endif
+
+void (*Com_OrBytes)(uint8_t* dst, uint8_t* src, int32_t length) = Com_OrBytes_Scalar;
+void (*Com_ClipSamples)(int16_t* out, int32_t* in, int32_t count) = Com_ClipSamples_Scalar;
+void (*Com_MixMono16)(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol) = Com_MixMono16_Scalar;
+
+/*
+===============================================================================
+
+CONFORMANCE TESTS
+
+Every length up to a few vectors past the widest one, so the tail is covered too
+
+===============================================================================
+*/
+
+#define CPU_TEST_LENGTH		200
+
+static int32_t CPU_TestRandom()
+{
+	// rand() only guarantees 15 bits
+	return (int32_t)(((uint32_t)rand() << 17) ^ ((uint32_t)rand() << 8) ^ (uint32_t)rand());
+}
+
+static bool CPU_TestOrBytes(void* variant, void* reference)
+{
+	void		(*func)(uint8_t* dst, uint8_t* src, int32_t length) = variant;
+	void		(*ref)(uint8_t* dst, uint8_t* src, int32_t length) = reference;
+	uint8_t 	src[CPU_TEST_LENGTH + 1], dst[2][CPU_TEST_LENGTH + 1];
+	int32_t 	length, i;
+
+	for (length = 0; length < CPU_TEST_LENGTH; length++)
+	{
+		for (i = 0; i < CPU_TEST_LENGTH + 1; i++)
+		{
+			src[i] = rand();
+			dst[0][i] = dst[1][i] = rand() & rand();
+		}
+
+		// from one byte in, so unaligned loads are tried
+		func(dst[0] + 1, src + 1, length);
+		ref(dst[1] + 1, src + 1, length);
+
+		if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+		{
+			Com_Printf("%i bytes differ\n", length);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool CPU_TestClipSamples(void* variant, void* reference)
+{
+	void		(*func)(int16_t* out, int32_t* in, int32_t count) = variant;
+	void		(*ref)(int16_t* out, int32_t* in, int32_t count) = reference;
+	int32_t 	in[CPU_TEST_LENGTH + 1];
+	int16_t 	out[2][CPU_TEST_LENGTH + 1];
+	int32_t 	count, i;
+
+	for (count = 0; count < CPU_TEST_LENGTH; count++)
+	{
+		// mostly in range, with some far enough out to clip
+		for (i = 0; i < CPU_TEST_LENGTH + 1; i++)
+			in[i] = (i & 3) ? CPU_TestRandom() >> 7 : CPU_TestRandom();
+
+		memset(out, 0, sizeof(out));
+		func(out[0] + 1, in + 1, count);
+		ref(out[1] + 1, in + 1, count);
+
+		if (memcmp(out[0], out[1], sizeof(out[0])))
+		{
+			Com_Printf("%i samples differ\n", count);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool CPU_TestMixMono16(void* variant, void* reference)
+{
+	void		(*func)(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol) = variant;
+	void		(*ref)(int32_t* out, int16_t* in, int32_t count, int32_t leftvol, int32_t rightvol) = reference;
+	int16_t 	in[CPU_TEST_LENGTH + 1];
+	int32_t 	out[2][CPU_TEST_LENGTH * 2 + 2];
+	int32_t 	leftvol, rightvol, count, i;
+
+	for (count = 0; count < CPU_TEST_LENGTH; count++)
+	{
+		for (i = 0; i < CPU_TEST_LENGTH + 1; i++)
+			in[i] = rand() ^ (rand() << 8);
+
+		for (i = 0; i < CPU_TEST_LENGTH * 2 + 2; i++)
+			out[0][i] = out[1][i] = CPU_TestRandom() >> 8;
+
+		// the largest the mixer uses is 255 * 256
+		leftvol = (CPU_TestRandom() & 0x7fffffff) % (255 * 256 + 1);
+		rightvol = (CPU_TestRandom() & 0x7fffffff) % (255 * 256 + 1);
+
+		func(out[0] + 2, in + 1, count, leftvol, rightvol);
+		ref(out[1] + 2, in + 1, count, leftvol, rightvol);
+
+		if (memcmp(out[0], out[1], sizeof(out[0])))
+		{
+			Com_Printf("%i samples at volume %i/%i differ\n", count, leftvol, rightvol);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static cpu_kernel_t cpu_kernel_or_bytes =
+{
+	"Com_OrBytes", (void**)&Com_OrBytes,
+#if defined(CPU_X86)
+	{ Com_OrBytes_Scalar, Com_OrBytes_SSE2, Com_OrBytes_AVX2, NULL },
+#elif defined(CPU_NEON)
+	{ Com_OrBytes_Scalar, NULL, NULL, Com_OrBytes_NEON },
+#else
+	{ Com_OrBytes_Scalar },
+#endif
+	cpu_tier_scalar, CPU_TestOrBytes,
+};
+
+static cpu_kernel_t cpu_kernel_clip_samples =
+{
+	"Com_ClipSamples", (void**)&Com_ClipSamples,
+#if defined(CPU_X86)
+	{ Com_ClipSamples_Scalar, Com_ClipSamples_SSE2, Com_ClipSamples_AVX2, NULL },
+#elif defined(CPU_NEON)
+	{ Com_ClipSamples_Scalar, NULL, NULL, Com_ClipSamples_NEON },
+#else
+	{ Com_ClipSamples_Scalar },
+#endif
+	cpu_tier_scalar, CPU_TestClipSamples,
+};
+
+static cpu_kernel_t cpu_kernel_mix_mono16 =
+{
+	"Com_MixMono16", (void**)&Com_MixMono16,
+#if defined(CPU_X86)
+	{ Com_MixMono16_Scalar, NULL, Com_MixMono16_AVX2, NULL },
+#elif defined(CPU_NEON)
+	{ Com_MixMono16_Scalar, NULL, NULL, Com_MixMono16_NEON },
+#else
+	{ Com_MixMono16_Scalar },
+#endif
+	cpu_tier_scalar, CPU_TestMixMono16,
+};
+
+/*
+===============================================================================
+
+DISPATCH
+
+===============================================================================
+*/
+
+/*
+==================
+CPU_BestTier
+
+The highest tier the CPU can run
+==================
+*/
+static cpu_tier_t CPU_BestTier()
+{
+#if defined(CPU_NEON)
+	// part of the armv8 baseline
+	return cpu_tier_neon;
+#elif defined(CPU_X86)
+	int32_t features = (int32_t)cpu_features->value;
+
+	if (features & cpu_feature_avx2)
+		return cpu_tier_avx2;
+
+#if defined(_M_X64) || defined(__x86_64__)
+	// part of the x64 baseline, whatever cpuid says
+	return cpu_tier_sse2;
+#else
+	return (features & cpu_feature_sse2) ? cpu_tier_sse2 : cpu_tier_scalar;
+#endif
+#else
+	return cpu_tier_scalar;
+#endif
+}
+
+/*
+==================
+CPU_WantedTier
+
+The tier cpu_dispatch asks for, no higher than the CPU can run
+==================
+*/
+static cpu_tier_t CPU_WantedTier()
+{
+	cpu_tier_t	best, tier;
+
+	best = CPU_BestTier();
+
+	if (!Q_stricmp(cpu_dispatch->string, "auto") || !cpu_dispatch->string[0])
+		return best;
+
+	for (tier = cpu_tier_scalar; tier < cpu_tier_max; tier++)
+	{
+		if (!Q_stricmp(cpu_dispatch->string, cpu_tier_names[tier]))
+			break;
+	}
+
+	if (tier == cpu_tier_max)
+	{
+		Com_Printf("cpu_dispatch: unknown tier %s, should be auto, scalar, sse2, avx2 or neon\n", cpu_dispatch->string);
+		return best;
+	}
+
+	// neon and the x86 tiers don't mix
+	if ((tier == cpu_tier_neon) != (best == cpu_tier_neon) && tier != cpu_tier_scalar)
+	{
+		Com_Printf("cpu_dispatch: %s isn't available on this CPU\n", cpu_tier_names[tier]);
+		return best;
+	}
+
+	if (tier > best)
+	{
+		Com_Printf("cpu_dispatch: %s isn't available on this CPU, using %s\n", cpu_tier_names[tier], cpu_tier_names[best]);
+		return best;
+	}
+
+	return tier;
+}
+
+static void CPU_SelectKernel(cpu_kernel_t* kernel, cpu_tier_t tier)
+{
+	// neon has nothing below it but scalar
+	if (tier == cpu_tier_neon && !kernel->variants[tier])
+		tier = cpu_tier_scalar;
+
+	while (tier > cpu_tier_scalar && !kernel->variants[tier])
+		tier--;
+
+	kernel->tier = tier;
+	*kernel->func = kernel->variants[tier];
+}
+
+static void CPU_SelectKernels()
+{
+	cpu_kernel_t* kernel;
+
+	cpu_tier = CPU_WantedTier();
+
+	for (kernel = cpu_kernels; kernel; kernel = kernel->next)
+		CPU_SelectKernel(kernel, cpu_tier);
+}
+
+/*
+==================
+CPU_RegisterKernel
+
+Kernels outside this file can register themselves too, after CPU_DispatchInit or before it
+==================
+*/
+void CPU_RegisterKernel(cpu_kernel_t* kernel)
+{
+	if (!kernel->variants[cpu_tier_scalar])
+		Com_Error(ERR_FATAL, "CPU_RegisterKernel: %s has no scalar version", kernel->name);
+
+	kernel->next = cpu_kernels;
+	cpu_kernels = kernel;
+
+	if (cpu_dispatch)
+		CPU_SelectKernel(kernel, cpu_tier);
+	else
+		*kernel->func = kernel->variants[cpu_tier_scalar];
+}
+
+static void CPU_DispatchChanged(cvar_t* var)
+{
+	CPU_SelectKernels();
+	Com_Printf("Using %s kernels\n", cpu_tier_names[cpu_tier]);
+}
+
+/*
+==================
+CPU_DispatchList_f
+==================
+*/
+static void CPU_DispatchList_f()
+{
+	cpu_kernel_t*	kernel;
+	cpu_tier_t		tier;
+
+	Com_Printf("%-20s %-8s %s\n", "kernel", "using", "available");
+
+	for (kernel = cpu_kernels; kernel; kernel = kernel->next)
+	{
+		Com_Printf("%-20s %-8s", kernel->name, cpu_tier_names[kernel->tier]);
+
+		for (tier = cpu_tier_scalar; tier < cpu_tier_max; tier++)
+		{
+			if (kernel->variants[tier])
+				Com_Printf(" %s", cpu_tier_names[tier]);
+		}
+
+		Com_Printf("\n");
+	}
+}
+
+/*
+==================
+CPU_DispatchTest_f
+
+Runs every version of every kernel the CPU can run against its scalar version
+==================
+*/
+static void CPU_DispatchTest_f()
+{
+	cpu_kernel_t*	kernel;
+	cpu_tier_t		tier, best;
+	int32_t 		tested, failed;
+
+	best = CPU_BestTier();
+	tested = failed = 0;
+	srand(Sys_Milliseconds());
+
+	for (kernel = cpu_kernels; kernel; kernel = kernel->next)
+	{
+		for (tier = cpu_tier_sse2; tier < cpu_tier_max; tier++)
+		{
+			if (!kernel->variants[tier])
+				continue;
+
+			if (tier > best || (tier == cpu_tier_neon) != (best == cpu_tier_neon))
+			{
+				Com_Printf("%s %s: skipped, not available on this CPU\n", kernel->name, cpu_tier_names[tier]);
+				continue;
+			}
+
+			Com_Printf("%s %s: ", kernel->name, cpu_tier_names[tier]);
+			tested++;
+
+			if (kernel->test(kernel->variants[tier], kernel->variants[cpu_tier_scalar]))
+			{
+				Com_Printf("ok\n");
+			}
+			else
+			{
+				Com_Printf("FAILED\n");
+				failed++;
+			}
+		}
+	}
+
+	Com_Printf("%i of %i kernel versions match the scalar ones\n", tested - failed, tested);
+}
+
+/*
+==================
+CPU_DispatchInit
+
+Called after CPUID_Init
+==================
+*/
+void CPU_DispatchInit()
+{
+	CPU_RegisterKernel(&cpu_kernel_or_bytes);
+	CPU_RegisterKernel(&cpu_kernel_clip_samples);
+	CPU_RegisterKernel(&cpu_kernel_mix_mono16);
+
+	cpu_dispatch = Cvar_Get("cpu_dispatch", "auto", CVAR_ARCHIVE);
+	Cvar_AddCallback(cpu_dispatch, CPU_DispatchChanged);
+
+	Cmd_AddCommand("cpu_dispatch_list", CPU_DispatchList_f);
+	Cmd_AddCommand("cpu_dispatch_test", CPU_DispatchTest_f);
+
+	CPU_SelectKernels();
+	Com_Printf("CPU_DispatchInit: %s kernels\n", cpu_tier_names[cpu_tier]);
+}
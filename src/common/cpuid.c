@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #ifdef __GNUC__
 #include <cpuid.h>
+#else
+#include <immintrin.h>
 #endif
 
 cvar_t* cpu_name;
@@ -56,6 +58,7 @@ cvar_t* fake_defective_cpu;
 #define BIT_FMA3 (1 << 12)
 #define BIT_SSE41 (1 << 19)
 #define BIT_SSE42 (1 << 20)
+#define BIT_OSXSAVE (1 << 27)
 #define BIT_AVX1 (1 << 28)
 
 //EAX=7h, EBX
@@ -74,6 +77,19 @@ char* cpu_known_defective_warning_title = "[STRING_WARNING_CPU_DEFECTIVE_TITLE]"
 char* cpu_known_defective_warning_description =
 "[STRING_WARNING_CPU_DEFECTIVE_DESCRIPTION]";
 
+// the OS has to save the ymm registers on a context switch (XCR0 bits 1 and 2), or AVX code can't be used
+static bool CPUID_OSSavesAVX()
+{
+#ifdef _MSC_VER
+	return (_xgetbv(0) & 6) == 6;
+#else
+	uint32_t eax, edx;
+
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (eax & 6) == 6;
+#endif
+}
+
 void CPUID_Init()
 {
 	uint32_t regs[4] = { 0x00 };
@@ -172,12 +188,15 @@ void CPUID_Init()
 	// Feature identification
 
 	int32_t features = 0;
+	bool avx_usable = false;
 
 	// first, identify basic features
 	if (highest_basic_leaf >= 1)
 	{
 		__cpuidex(regs, 0x1, 0x0);
 
+		avx_usable = (ECX & BIT_OSXSAVE) && CPUID_OSSavesAVX();
+
 		if (EDX & BIT_MMX)
 			features |= cpu_feature_mmx;
 
@@ -193,7 +212,7 @@ void CPUID_Init()
 		if (ECX & BIT_SSSE3)
 			features |= cpu_feature_ssse3;
 		
-		if (ECX & BIT_FMA3)
+		if ((ECX & BIT_FMA3) && avx_usable)
 			features |= cpu_feature_fma3;
 
 		if (ECX & BIT_SSE41)
@@ -202,7 +221,7 @@ void CPUID_Init()
 		if (ECX & BIT_SSE42)
 			features |= cpu_feature_sse42;
 
-		if (ECX & BIT_AVX1)
+		if ((ECX & BIT_AVX1) && avx_usable)
 			features |= cpu_feature_avx1;
 	}
 
@@ -211,7 +230,7 @@ void CPUID_Init()
 	{
 		__cpuidex(regs, 0x7, 0x0);
 
-		if (EBX & BIT_AVX2)
+		if ((EBX & BIT_AVX2) && avx_usable)
 			features |= cpu_feature_avx2;
 	}
 
@@ -65,6 +65,26 @@ static uint16_t crctable[256] =
 	0x6e17,	0x7e36,	0x4e55,	0x5e74,	0x2e93,	0x3eb2,	0x0ed1,	0x1ef0
 };
 
+// crctable extended for slicing by 8: crcslice[k][b] is the crc of b followed by k zero bytes,
+// so eight bytes can be folded in with eight independent lookups instead of a chain of eight
+static uint16_t crcslice[8][256];
+static bool		crcslice_built;
+
+static void CRC_BuildSliceTables()
+{
+	int32_t i, k;
+
+	for (i = 0; i < 256; i++)
+	{
+		crcslice[0][i] = crctable[i];
+
+		for (k = 1; k < 8; k++)
+			crcslice[k][i] = (crcslice[k - 1][i] << 8) ^ crctable[crcslice[k - 1][i] >> 8];
+	}
+
+	crcslice_built = true;
+}
+
 void CRC_Init(uint16_t *crcvalue)
 {
 	*crcvalue = CRC_INIT_VALUE;
@@ -84,9 +104,130 @@ uint16_t CRC_Block (uint8_t *start, int32_t count)
 {
 	uint16_t crc;
 
+	if (!crcslice_built)
+		CRC_BuildSliceTables();
+
 	CRC_Init (&crc);
+
+	// the crc only touches the first two bytes of each group, the rest go straight through the tables
+	while (count >= 8)
+	{
+		crc = crcslice[7][start[0] ^ (crc >> 8)] ^ crcslice[6][start[1] ^ (crc & 0xff)]
+			^ crcslice[5][start[2]] ^ crcslice[4][start[3]]
+			^ crcslice[3][start[4]] ^ crcslice[2][start[5]]
+			^ crcslice[1][start[6]] ^ crcslice[0][start[7]];
+
+		start += 8;
+		count -= 8;
+	}
+
 	while (count--)
 		crc = (crc << 8) ^ crctable[(crc >> 8) ^ *start++];
 
 	return crc;
 }
+
+/*
+==================
+Com_ChecksumBench_f
+
+checksum_bench [megabytes]: checks CRC_Block and Com_BlockChecksum against known values and
+the byte at a time crc, then times them
+==================
+*/
+typedef struct checksum_golden_s
+{
+	char*		data;
+	uint16_t	crc;
+	uint32_t	md4[4];		// the digest as little endian words, as Com_BlockChecksum sees it
+} checksum_golden_t;
+
+// the MD4 test suite from RFC 1320, covering every way the padding can fall
+static checksum_golden_t checksum_golden[] =
+{
+	{ "", 0xffff, { 0xe0cfd631, 0x31e96ad1, 0xd7593cb7, 0xc089c0e0 } },
+	{ "a", 0x9d77, { 0xb32ce5bd, 0x463ee31d, 0xfb055e24, 0x24fbd6db } },
+	{ "abc", 0x514a, { 0x7a0148a4, 0x52d821af, 0xe80ac15f, 0x9d72a67a } },
+	{ "message digest", 0x32cc, { 0x810a13d9, 0xe89f5464, 0x06488718, 0x4b01c7e1 } },
+	{ "abcdefghijklmnopqrstuvwxyz", 0x53e2, { 0x301c9ed7, 0xcdbba58a, 0x63eda8ee, 0xa92d41df } },
+	{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb46b, { 0x82853f04, 0x35db41f2, 0xe127e61c, 0xe4f0e753 } },
+	{ "12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0xdadf, { 0xdc4d3be3, 0x19f2389c, 0x167b3e9c, 0x3605cc4f } },
+	{ "123456789", 0x29b1, { 0x7823e52a, 0x4daf0c5d, 0xc157b52f, 0x5c181620 } },
+};
+
+void Com_ChecksumBench_f()
+{
+	checksum_golden_t*	golden;
+	uint8_t*			buffer;
+	uint16_t			crc;
+	uint32_t			sum;
+	int64_t 			start, crc_time, md4_time;
+	int32_t 			size, length, offset, failed, i, j;
+
+	failed = 0;
+
+	for (i = 0; i < sizeof(checksum_golden) / sizeof(checksum_golden[0]); i++)
+	{
+		golden = &checksum_golden[i];
+		length = (int32_t)strlen(golden->data);
+
+		if (CRC_Block((uint8_t*)golden->data, length) != golden->crc)
+		{
+			Com_Printf("checksum_bench: CRC_Block is wrong for \"%s\"\n", golden->data);
+			failed++;
+		}
+
+		if (Com_BlockChecksum(golden->data, length)
+			!= (golden->md4[0] ^ golden->md4[1] ^ golden->md4[2] ^ golden->md4[3]))
+		{
+			Com_Printf("checksum_bench: Com_BlockChecksum is wrong for \"%s\"\n", golden->data);
+			failed++;
+		}
+	}
+
+	size = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 64;
+
+	if (size <= 0)
+		size = 1;
+
+	size *= 1024 * 1024;
+	buffer = Memory_ZoneMalloc(size + 8);
+
+	srand(1);
+
+	for (i = 0; i < size + 8; i++)
+		buffer[i] = rand();
+
+	// every length the 8 byte loop can leave over, from every alignment
+	for (offset = 0; offset < 8; offset++)
+	{
+		for (length = 0; length < 300; length++)
+		{
+			CRC_Init(&crc);
+
+			for (j = 0; j < length; j++)
+				CRC_ProcessByte(&crc, buffer[offset + j]);
+
+			if (CRC_Value(crc) != CRC_Block(buffer + offset, length))
+			{
+				Com_Printf("checksum_bench: CRC_Block doesn't match CRC_ProcessByte for %i bytes at +%i\n", length, offset);
+				failed++;
+			}
+		}
+	}
+
+	start = Sys_Nanoseconds();
+	crc = CRC_Block(buffer, size);
+	crc_time = Sys_Nanoseconds() - start;
+
+	start = Sys_Nanoseconds();
+	sum = Com_BlockChecksum(buffer, size);
+	md4_time = Sys_Nanoseconds() - start;
+
+	Memory_ZoneFree(buffer);
+
+	Com_Printf("%s, %i bytes: crc %04x in %.2f ms (%.0f MB/s), md4 %08x in %.2f ms (%.0f MB/s)\n",
+		failed ? "FAILED" : "ok", size,
+		crc, crc_time / 1000000.0, crc_time ? size * 1000.0 / crc_time : 0.0,
+		sum, md4_time / 1000000.0, md4_time ? size * 1000.0 / md4_time : 0.0);
+}
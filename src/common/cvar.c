@@ -22,7 +22,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "common.h"
 
+#define CVAR_HASH_SIZE		1024		// a power of two comfortably above the ~600 cvars a client has
+
+typedef struct cvarcallback_s
+{
+	cvar_callback_t			callback;
+	struct cvarcallback_s*	next;
+} cvarcallback_t;
+
 cvar_t* cvar_vars;
+static cvar_t* cvar_hash[CVAR_HASH_SIZE];
 
 /*
 ============
@@ -49,13 +58,74 @@ static cvar_t* Cvar_FindVar(char* var_name)
 {
 	cvar_t* var;
 
-	for (var = cvar_vars; var; var = var->next)
+	for (var = cvar_hash[Com_HashString(var_name) & (CVAR_HASH_SIZE - 1)]; var; var = var->hash_next)
 		if (!strcmp(var_name, var->name))
 			return var;
 
 	return NULL;
 }
 
+/*
+============
+Cvar_Changed
+
+Calls everything waiting for var to change
+============
+*/
+static void Cvar_Changed(cvar_t* var)
+{
+	cvarcallback_t* callback;
+	cvarcallback_t* next;
+
+	// a callback may remove itself
+	for (callback = var->callbacks; callback; callback = next)
+	{
+		next = callback->next;
+		callback->callback(var);
+	}
+}
+
+/*
+============
+Cvar_AddCallback
+============
+*/
+void Cvar_AddCallback(cvar_t* var, cvar_callback_t callback)
+{
+	cvarcallback_t* entry;
+
+	for (entry = var->callbacks; entry; entry = entry->next)
+		if (entry->callback == callback)
+			return;
+
+	entry = Memory_ZoneMalloc(sizeof(cvarcallback_t));
+	entry->callback = callback;
+	entry->next = var->callbacks;
+	var->callbacks = entry;
+}
+
+/*
+============
+Cvar_RemoveCallback
+============
+*/
+void Cvar_RemoveCallback(cvar_t* var, cvar_callback_t callback)
+{
+	cvarcallback_t** link;
+	cvarcallback_t* entry;
+
+	for (link = &var->callbacks; *link; link = &(*link)->next)
+	{
+		if ((*link)->callback == callback)
+		{
+			entry = *link;
+			*link = entry->next;
+			Memory_ZoneFree(entry);
+			return;
+		}
+	}
+}
+
 /*
 ============
 Cvar_VariableValue
@@ -128,6 +198,7 @@ The flags will be or'ed in if the variable exists.
 cvar_t* Cvar_Get(char* var_name, char* var_value, int32_t flags)
 {
 	cvar_t* var;
+	uint32_t hash;
 
 	if (flags & (CVAR_USERINFO | CVAR_SERVERINFO))
 	{
@@ -167,6 +238,10 @@ cvar_t* Cvar_Get(char* var_name, char* var_value, int32_t flags)
 	var->next = cvar_vars;
 	cvar_vars = var;
 
+	hash = Com_HashString(var_name) & (CVAR_HASH_SIZE - 1);
+	var->hash_next = cvar_hash[hash];
+	cvar_hash[hash] = var;
+
 	var->flags = flags;
 
 	return var;
@@ -233,6 +308,8 @@ cvar_t* Cvar_Set2(char* var_name, char* value, bool force)
 					FS_SetGamedir(var->string);
 					FS_ExecAutoexec();
 				}
+
+				Cvar_Changed(var);
 			}
 			return var;
 		}
@@ -259,6 +336,8 @@ cvar_t* Cvar_Set2(char* var_name, char* value, bool force)
 	var->string = CopyString(value);
 	var->value = strtof(var->string, NULL);
 
+	Cvar_Changed(var);
+
 	return var;
 }
 
@@ -290,6 +369,7 @@ Cvar_FullSet
 cvar_t* Cvar_FullSet(char* var_name, char* value, int32_t flags)
 {
 	cvar_t* var;
+	bool	changed;
 
 	var = Cvar_FindVar(var_name);
 	if (!var)
@@ -302,12 +382,17 @@ cvar_t* Cvar_FullSet(char* var_name, char* value, int32_t flags)
 	if (var->flags & CVAR_USERINFO)
 		userinfo_modified = true;	// transmit at next oportunity
 
+	changed = strcmp(value, var->string) != 0;
+
 	Memory_ZoneFree(var->string);	// free the old value string
 
 	var->string = CopyString(value);
 	var->value = strtof(var->string, NULL);
 	var->flags = flags;
 
+	if (changed)
+		Cvar_Changed(var);
+
 	return var;
 }
 
@@ -357,6 +442,8 @@ void Cvar_GetLatchedVars()
 			FS_ExecAutoexec();
 			var->modified = false;
 		}
+
+		Cvar_Changed(var);
 	}
 }
 
@@ -541,6 +628,66 @@ char* Cvar_Serverinfo()
 	return Cvar_BitInfo(CVAR_SERVERINFO);
 }
 
+/*
+============
+Cvar_Bench_f
+
+cvar_bench [rounds]: times looking every cvar up by name through the hash table, and by walking the list as it used to be
+============
+*/
+static void Cvar_Bench_f()
+{
+	cvar_t*		var;
+	cvar_t*		find;
+	int32_t 	rounds, count, found, i;
+	int64_t 	start, hashed, walked;
+
+	rounds = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100;
+
+	if (rounds <= 0)
+		rounds = 1;
+
+	count = found = 0;
+
+	for (var = cvar_vars; var; var = var->next)
+		count++;
+
+	start = Sys_Nanoseconds();
+
+	for (i = 0; i < rounds; i++)
+	{
+		for (var = cvar_vars; var; var = var->next)
+			found += Cvar_FindVar(var->name) == var;
+	}
+
+	hashed = Sys_Nanoseconds() - start;
+	start = Sys_Nanoseconds();
+
+	for (i = 0; i < rounds; i++)
+	{
+		for (var = cvar_vars; var; var = var->next)
+		{
+			for (find = cvar_vars; find; find = find->next)
+				if (!strcmp(var->name, find->name))
+					break;
+
+			found += find == var;
+		}
+	}
+
+	walked = Sys_Nanoseconds() - start;
+
+	if (!count || found != count * rounds * 2)
+	{
+		Com_Printf("cvar_bench: %i of %i lookups failed\n", count * rounds * 2 - found, count * rounds * 2);
+		return;
+	}
+
+	Com_Printf("%i cvars, %i rounds\n", count, rounds);
+	Com_Printf("hashed: %8.1f ns per lookup\n", hashed / (double)(count * rounds));
+	Com_Printf("list:   %8.1f ns per lookup\n", walked / (double)(count * rounds));
+}
+
 /*
 ============
 Cvar_Init
@@ -552,4 +699,5 @@ void Cvar_Init()
 {
 	Cmd_AddCommand("set", Cvar_Set_f);
 	Cmd_AddCommand("cvarlist", Cvar_List_f);
+	Cmd_AddCommand("cvar_bench", Cvar_Bench_f);
 }
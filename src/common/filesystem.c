@@ -289,18 +289,22 @@ int32_t FS_LoadFile(char* path, void** buffer)
 
 	buf = NULL;	// quiet compiler warning
 
+	TIMELINE_BEGIN("FS_LoadFile");
+
 	// look for it in the filesystem or pack files
 	len = FS_FOpenFile(path, &h);
 	if (!h)
 	{
 		if (buffer)
 			*buffer = NULL;
+		TIMELINE_END();
 		return -1;
 	}
 
 	if (!buffer)
 	{
 		fclose(h);
+		TIMELINE_END();
 		return len;
 	}
 
@@ -311,6 +315,7 @@ int32_t FS_LoadFile(char* path, void** buffer)
 
 	fclose(h);
 
+	TIMELINE_END();
 	return len;
 }
 
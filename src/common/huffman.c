@@ -0,0 +1,545 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+/* huffman.c - static huffman coding of netchan payloads */
+
+#include "common.h"
+
+// The model is a fixed table of byte frequencies shared by both ends of a
+// connection, so nothing about it is ever sent. Changing it changes the wire
+// format of compressed connections and of compressed serverrecord demos.
+// huffman_train <demo> [demo...] prints a new table built from recorded traffic.
+
+#define HUFF_SYMBOLS		256
+#define HUFF_MAX_BITS		24		// longest code, so a code always fits in the bit buffer
+#define HUFF_LOOKUP_BITS	10		// codes up to this length decode with one table lookup
+
+// Generated with the huffman_train scaling from 58.2 MB of messages written by the
+// engine's own encoders for a simulated three minute, 16 player match at sv_tickrate 40:
+// MSG_WriteDeltaPlayerstate and MSG_WriteDeltaEntityPacked frames for 8 protocol 1 and
+// 8 protocol 2 clients (sv_quantize_coordbits 3, sv_quantize_anglebits 10), the
+// SV_RecordDemoMessage frames, and each client's clc_move. The players, rockets and items
+// were moved by a script, not by a game, and configstrings, prints, sounds and temp
+// entities aren't in it. Regenerate it from serverrecord demos of real matches when there are some.
+static uint32_t huff_frequencies[HUFF_SYMBOLS] =
+{
+	65536, 10429,  4680,  2572,  1637,  2082,  2102,  1583,  1759,  3235,  1352,  1329,  1707,   758,   789,   863,
+	 2710,  1285,   828,  1577,   882,   665,   673,   605,  1458,  2279,   594,   649,   647,   473,   487,   813,
+	 1080,   485,   810,   423,   462,   414,   579,   394,  1631,   539,   574,   620,   585,   508,   423,   409,
+	 1338,   348,   344,   335,   398,   316,   353,   350,   605,   349,   349,   337,   480,   350,   491,   924,
+	 1940,  3545,  1775,  6929,  6227,   518,   439,   518,   707,   469,   431,   477,   467,   378,   390,   485,
+	 1509,   413,   420,   452,   464,   426,   789,   435,   676,   407,   417,   420,   479,   395,   417,   604,
+	 1557,   405,   576,   403,   451,   399,   402,   428,   603,   396,   411,   395,   427,   398,   410,   469,
+	  641,   313,   310,   328,   351,   294,   313,   318,   499,   321,   315,   310,   373,   361,   371,  1001,
+	 9204,   701,   490,  3849,  2838,   396,  1479,  2988,   488,   364,   389,   358,   460,   377,   934,   417,
+	 1782,   733,   465,   355,   414,   349,   382,  1598,   531,   550,   367,   409,   438,   364,   383,   586,
+	 1171,   374,   362,   368,   421,   357,   369,   513,   553,   347,   364,   377,  1708,   352,   353,   447,
+	  666,   351,   394,   355,   456,   372,   353,   599,   518,   351,   385,   353,   520,   350,   401,   777,
+	 3505,   599,  1085,  3155,  7208,   364,   350,   369,   544,   329,  2004,   297,   328,   290,   880,   382,
+	  594,   317,   347,   319,   344,   304,   321,   332,   413,   310,   321,   324,   345,   310,   324,   589,
+	 1519,   428,   327,   325,   354,   323,   355,   359,   437,   335,   371,   395,   419,   382,   392,   454,
+	  596,   400,   416,   444,   487,   453,   555,   526,   596,   561,   748,   770,   858,   945,  1573,  4411,
+};
+
+typedef struct huff_lookup_s
+{
+	uint8_t		symbol;
+	uint8_t		length;				// 0 if the code is longer than HUFF_LOOKUP_BITS
+} huff_lookup_t;
+
+static uint8_t		huff_lengths[HUFF_SYMBOLS];
+static uint32_t		huff_codes[HUFF_SYMBOLS];		// bit reversed, so they can be written least significant bit first
+
+// canonical decoding tables
+static int32_t 		huff_count[HUFF_MAX_BITS + 1];	// number of codes of each length
+static int32_t 		huff_first[HUFF_MAX_BITS + 1];	// first code of each length
+static int32_t 		huff_offset[HUFF_MAX_BITS + 1];	// index in huff_sorted of the first code of each length
+static uint8_t		huff_sorted[HUFF_SYMBOLS];		// symbols ordered by code
+
+static huff_lookup_t huff_lookup[1 << HUFF_LOOKUP_BITS];
+
+/*
+===============
+Huffman_BuildLengths
+
+Builds a huffman tree from the frequencies and returns the longest code length
+================
+*/
+static int32_t Huffman_BuildLengths(uint32_t* frequencies)
+{
+	uint32_t	weight[HUFF_SYMBOLS * 2];
+	int32_t 	parent[HUFF_SYMBOLS * 2];
+	bool		merged[HUFF_SYMBOLS * 2];
+	int32_t 	nodes = HUFF_SYMBOLS;
+	int32_t 	lowest[2];
+	int32_t 	max_length = 0;
+	int32_t 	length;
+	int32_t 	i, j, n;
+
+	memset(merged, 0, sizeof(merged));
+
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+		weight[i] = frequencies[i] ? frequencies[i] : 1;	// every byte needs a code
+
+	// repeatedly merge the two lightest nodes, this only runs when the model is built
+	while (nodes < HUFF_SYMBOLS * 2 - 1)
+	{
+		for (j = 0; j < 2; j++)
+		{
+			lowest[j] = -1;
+
+			for (i = 0; i < nodes; i++)
+			{
+				if (merged[i])
+					continue;
+
+				if (lowest[j] == -1 || weight[i] < weight[lowest[j]])
+					lowest[j] = i;
+			}
+
+			merged[lowest[j]] = true;
+		}
+
+		weight[nodes] = weight[lowest[0]] + weight[lowest[1]];
+		parent[lowest[0]] = nodes;
+		parent[lowest[1]] = nodes;
+		nodes++;
+	}
+
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+	{
+		length = 0;
+
+		for (n = i; n != nodes - 1; n = parent[n])
+			length++;
+
+		huff_lengths[i] = length;
+
+		if (length > max_length)
+			max_length = length;
+	}
+
+	return max_length;
+}
+
+/*
+===============
+Huffman_BuildModel
+
+Assigns canonical codes from the code lengths and fills the decoding tables
+================
+*/
+static void Huffman_BuildModel()
+{
+	uint32_t	frequencies[HUFF_SYMBOLS];
+	int32_t 	next[HUFF_MAX_BITS + 1];
+	int32_t 	code, reversed;
+	int32_t 	length;
+	int32_t 	i, j;
+
+	memcpy(frequencies, huff_frequencies, sizeof(frequencies));
+
+	// flatten the distribution until no code is too long
+	while (Huffman_BuildLengths(frequencies) > HUFF_MAX_BITS)
+	{
+		for (i = 0; i < HUFF_SYMBOLS; i++)
+			frequencies[i] = (frequencies[i] >> 1) + 1;
+	}
+
+	memset(huff_count, 0, sizeof(huff_count));
+
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+		huff_count[huff_lengths[i]]++;
+
+	code = 0;
+	huff_offset[0] = 0;
+
+	for (length = 1; length <= HUFF_MAX_BITS; length++)
+	{
+		code = (code + huff_count[length - 1]) << 1;
+		huff_first[length] = code;
+		next[length] = code;
+		huff_offset[length] = huff_offset[length - 1] + huff_count[length - 1];
+	}
+
+	for (length = 1; length <= HUFF_MAX_BITS; length++)
+	{
+		j = huff_offset[length];
+
+		for (i = 0; i < HUFF_SYMBOLS; i++)
+		{
+			if (huff_lengths[i] == length)
+				huff_sorted[j++] = i;
+		}
+	}
+
+	memset(huff_lookup, 0, sizeof(huff_lookup));
+
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+	{
+		length = huff_lengths[i];
+		code = next[length]++;
+
+		// codes are read most significant bit first out of a least significant bit first stream
+		reversed = 0;
+		for (j = 0; j < length; j++)
+			reversed |= ((code >> j) & 1) << (length - 1 - j);
+
+		huff_codes[i] = reversed;
+
+		if (length > HUFF_LOOKUP_BITS)
+			continue;
+
+		for (j = reversed; j < (1 << HUFF_LOOKUP_BITS); j += (1 << length))
+		{
+			huff_lookup[j].symbol = i;
+			huff_lookup[j].length = length;
+		}
+	}
+}
+
+/*
+===============
+Huffman_Compress
+
+Returns the compressed length, or -1 if it wouldn't fit in out_size
+================
+*/
+int32_t Huffman_Compress(uint8_t* in, int32_t in_length, uint8_t* out, int32_t out_size)
+{
+	uint64_t	bits = 0;
+	int32_t 	bit_count = 0;
+	int32_t 	out_length = 0;
+	int32_t 	i;
+
+	for (i = 0; i < in_length; i++)
+	{
+		bits |= (uint64_t)huff_codes[in[i]] << bit_count;
+		bit_count += huff_lengths[in[i]];
+
+		while (bit_count >= 8)
+		{
+			if (out_length >= out_size)
+				return -1;
+
+			out[out_length++] = (uint8_t)bits;
+			bits >>= 8;
+			bit_count -= 8;
+		}
+	}
+
+	if (bit_count)
+	{
+		if (out_length >= out_size)
+			return -1;
+
+		out[out_length++] = (uint8_t)bits;
+	}
+
+	return out_length;
+}
+
+/*
+===============
+Huffman_Decompress
+
+Decodes exactly out_length bytes. Returns -1 if the input runs out first.
+================
+*/
+int32_t Huffman_Decompress(uint8_t* in, int32_t in_length, uint8_t* out, int32_t out_length)
+{
+	uint64_t	bits = 0;
+	int32_t 	bit_count = 0;
+	int32_t 	in_pos = 0;
+	int32_t 	out_pos = 0;
+	huff_lookup_t* entry;
+	int32_t 	code, length;
+
+	while (out_pos < out_length)
+	{
+		while (bit_count <= 56 && in_pos < in_length)
+		{
+			bits |= (uint64_t)in[in_pos++] << bit_count;
+			bit_count += 8;
+		}
+
+		entry = &huff_lookup[bits & ((1 << HUFF_LOOKUP_BITS) - 1)];
+
+		if (entry->length && entry->length <= bit_count)
+		{
+			out[out_pos++] = entry->symbol;
+			bits >>= entry->length;
+			bit_count -= entry->length;
+			continue;
+		}
+
+		// long code, walk the canonical code one bit at a time
+		code = 0;
+
+		for (length = 1; length <= HUFF_MAX_BITS; length++)
+		{
+			if (!bit_count)
+				return -1;
+
+			code = (code << 1) | (int32_t)(bits & 1);
+			bits >>= 1;
+			bit_count--;
+
+			if ((uint32_t)(code - huff_first[length]) < (uint32_t)huff_count[length])
+				break;
+		}
+
+		if (length > HUFF_MAX_BITS)
+			return -1;
+
+		out[out_pos++] = huff_sorted[huff_offset[length] + code - huff_first[length]];
+	}
+
+	return out_pos;
+}
+
+/*
+===============
+Huffman_LoadDemo
+
+Loads a demo for the commands below, returns the length or -1
+================
+*/
+static int32_t Huffman_LoadDemo(char* name, uint8_t** buffer)
+{
+	char	path[MAX_OSPATH];
+	int32_t length;
+
+	snprintf(path, sizeof(path), "demos/%s", name);
+	COM_DefaultExtension(path, ".dm2");
+
+	length = FS_LoadFile(path, (void**)buffer);
+
+	if (length < 0)
+		Com_Printf("Couldn't load %s\n", path);
+
+	return length;
+}
+
+/*
+===============
+Huffman_DemoMessage
+
+The message at *pos in a loaded demo, huffman decoded into out if it was written with
+sv_demo_compress. Moves *pos past it, returns its length or -1 at the end of the demo.
+================
+*/
+static int32_t Huffman_DemoMessage(uint8_t* demo, int32_t demo_length, int32_t* pos, uint8_t* out)
+{
+	int32_t length, compressed_length;
+
+	if (*pos + 4 > demo_length)
+		return -1;
+
+	length = LittleInt(*(int32_t*)(demo + *pos));
+	*pos += 4;
+
+	if (length == -1)
+		return -1;
+
+	if (length & DEMO_COMPRESSED)
+	{
+		compressed_length = length & ~DEMO_COMPRESSED;
+
+		if (*pos + 4 > demo_length)
+			return -1;
+
+		length = LittleInt(*(int32_t*)(demo + *pos));
+		*pos += 4;
+
+		if (length < 0 || length > MAX_MSGLEN || compressed_length > demo_length - *pos
+			|| Huffman_Decompress(demo + *pos, compressed_length, out, length) != length)
+		{
+			Com_Printf("Bad compressed message at %i\n", *pos);
+			return -1;
+		}
+
+		*pos += compressed_length;
+		return length;
+	}
+
+	if (length < 0 || length > MAX_MSGLEN || length > demo_length - *pos)
+	{
+		Com_Printf("Bad message length %i at %i\n", length, *pos);
+		return -1;
+	}
+
+	memcpy(out, demo + *pos, length);
+	*pos += length;
+	return length;
+}
+
+/*
+===============
+Huffman_Bench_f
+
+Compresses and decompresses every message in a demo, reporting the ratio and cost
+================
+*/
+void Huffman_Bench_f()
+{
+	uint8_t*	demo;
+	uint8_t		message[MAX_MSGLEN];
+	uint8_t		packed[MAX_MSGLEN * 3];		// codes can be up to HUFF_MAX_BITS long
+	uint8_t		unpacked[MAX_MSGLEN];
+	int32_t 	demo_length;
+	int32_t 	pos, length, packed_length;
+	int32_t 	messages = 0;
+	int64_t 	raw_bytes = 0, packed_bytes = 0;
+	int64_t 	encode_ns = 0, decode_ns = 0;
+	int64_t 	start;
+
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("huffman_bench <demo> : compress every message in a demo and report ratio and cost\n");
+		return;
+	}
+
+	demo_length = Huffman_LoadDemo(Cmd_Argv(1), &demo);
+
+	if (demo_length < 0)
+		return;
+
+	// a compressed demo's messages are decoded first, so they're measured as they were sent
+	for (pos = 0; (length = Huffman_DemoMessage(demo, demo_length, &pos, message)) >= 0; )
+	{
+		start = Sys_Nanoseconds();
+		packed_length = Huffman_Compress(message, length, packed, sizeof(packed));
+		encode_ns += Sys_Nanoseconds() - start;
+
+		start = Sys_Nanoseconds();
+		Huffman_Decompress(packed, packed_length, unpacked, length);
+		decode_ns += Sys_Nanoseconds() - start;
+
+		if (memcmp(message, unpacked, length))
+		{
+			Com_Printf("Round trip mismatch in message %i\n", messages);
+			break;
+		}
+
+		messages++;
+		raw_bytes += length;
+		packed_bytes += packed_length;
+	}
+
+	FS_FreeFile(demo);
+
+	if (!raw_bytes)
+	{
+		Com_Printf("No messages\n");
+		return;
+	}
+
+	Com_Printf("%i messages, %lld -> %lld bytes (%.1f%%)\n", messages,
+		(long long)raw_bytes, (long long)packed_bytes, 100.0 * packed_bytes / raw_bytes);
+	Com_Printf("encode %.2f ns/byte, decode %.2f ns/byte\n",
+		(double)encode_ns / raw_bytes, (double)decode_ns / raw_bytes);
+}
+
+/*
+===============
+Huffman_Train_f
+
+Counts the bytes in demos and prints a frequency table to replace huff_frequencies with,
+headed by where it came from
+================
+*/
+void Huffman_Train_f()
+{
+	uint8_t*	demo;
+	uint8_t		message[MAX_MSGLEN];
+	int32_t 	demo_length;
+	int32_t 	pos, length;
+	uint64_t	counts[HUFF_SYMBOLS];
+	uint64_t	max_count = 0;
+	uint64_t	total = 0;
+	int32_t 	messages = 0;
+	int32_t 	i, j;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("huffman_train <demo> [demo...] : print a byte frequency table built from demos\n");
+		return;
+	}
+
+	memset(counts, 0, sizeof(counts));
+
+	for (j = 1; j < Cmd_Argc(); j++)
+	{
+		demo_length = Huffman_LoadDemo(Cmd_Argv(j), &demo);
+
+		if (demo_length < 0)
+			return;
+
+		for (pos = 0; (length = Huffman_DemoMessage(demo, demo_length, &pos, message)) >= 0; )
+		{
+			for (i = 0; i < length; i++)
+				counts[message[i]]++;
+
+			messages++;
+			total += length;
+		}
+
+		FS_FreeFile(demo);
+	}
+
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+	{
+		if (counts[i] > max_count)
+			max_count = counts[i];
+	}
+
+	if (!max_count)
+	{
+		Com_Printf("No messages\n");
+		return;
+	}
+
+	Com_Printf("// Generated by huffman_train from %i messages, %lld bytes, in", messages, (long long)total);
+
+	for (j = 1; j < Cmd_Argc(); j++)
+		Com_Printf(" %s", Cmd_Argv(j));
+
+	Com_Printf("\n");
+
+	// scale into 16 bits, keeping every byte representable
+	for (i = 0; i < HUFF_SYMBOLS; i++)
+	{
+		Com_Printf("%s%5u,%s", (i & 15) ? "" : "\t", (uint32_t)(counts[i] * 65535 / max_count) + 1, ((i & 15) == 15) ? "\n" : " ");
+	}
+}
+
+/*
+===============
+Huffman_Init
+================
+*/
+void Huffman_Init()
+{
+	Huffman_BuildModel();
+
+	Cmd_AddCommand("huffman_bench", Huffman_Bench_f);
+	Cmd_AddCommand("huffman_train", Huffman_Train_f);
+}
@@ -83,7 +83,9 @@ typedef struct common_api_export_s
 
 	// Localisation
 	localisation_entry_t* (*Localisation_GetString)(char* key);					// Get a localisation string
-	char*		(*Localisation_ProcessString)(char* value);						// Process a string for localisation entries.
+	char*		(*Localisation_ProcessString)(char* value);						// Process a string for localisation entries. The result is value itself or
+																				// a cached string, which is freed when the language changes or a later call
+																				// finds the cache full. Copy it to keep it past the next call.
 
 	// CMod / Map
 	cmodel_t*	(*Map_Load)(char* name, bool clientload, uint32_t* checksum);	// Start loading a map
@@ -190,6 +192,18 @@ typedef struct common_api_export_s
 
 	// System-specific Services
 
+	// Everything from here on was added without changing COMMON_API_VERSION, so it stays at the end
+	// where it doesn't move anything a game built against the older table uses
+
+	// Jobs
+	void		(*Job_Run)(job_counter_t* counter, const char* name, void (*func)(void* arg), void* arg);	// Run a job on a worker thread
+	void		(*Job_Wait)(job_counter_t* counter);							// Run jobs until the counter's have all finished
+	void		(*Job_ParallelFor)(const char* name, int32_t count, int32_t batch,
+				void (*func)(void* arg, int32_t start, int32_t end), void* arg);	// Split a loop across the job threads
+	int32_t		(*Job_NumThreads)();											// Worker threads plus the main thread
+
+	// Pmove
+	void		(*Player_MoveBatch)(pmove_batch_t* batch, int32_t count);		// Move players on the job threads, traces must be thread safe
 } common_api_export_t;
 
 // the instance of the common_api_export
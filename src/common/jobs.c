@@ -0,0 +1,540 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// jobs.c -- the job system
+//
+// A job is a function and an argument. They're run by sys_threads - 1 worker
+// threads and by whichever thread is waiting for them. Every thread has its
+// own deque: it pushes and pops its own jobs at the bottom, newest first, and
+// a thread that's out of work steals the oldest job from the top of someone
+// else's.
+//
+// A job_counter_t counts the jobs of one fork/join. Job_Run adds one, the job
+// finishing takes it away again, and Job_Wait runs jobs until it's zero, so
+// jobs can start jobs and wait for them without tying up a thread.
+//
+// The deques have a lock each rather than being lock free, as increments are
+// the only atomics the engine has on every compiler. A thread only ever waits
+// for a thief, and thieves only come when they're out of work of their own.
+//
+// Very little of the engine is thread safe: no cvars, commands, printing,
+// zone allocation or file access from inside a job. Traces are (Map_BoxTrace
+// and the rest of the map_loader.c queries, SV_Trace, SV_PointContents), as
+// long as nothing links, unlinks or loads at the same time.
+
+#include "common.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define JOB_THREAD				__declspec(thread)
+#define JOB_INCREMENT(x)		_InterlockedIncrement((volatile long*)&(x))
+#define JOB_DECREMENT(x)		_InterlockedDecrement((volatile long*)&(x))
+#else
+#define JOB_THREAD				_Thread_local
+#define JOB_INCREMENT(x)		__sync_add_and_fetch(&(x), 1)
+#define JOB_DECREMENT(x)		__sync_sub_and_fetch(&(x), 1)
+#endif
+
+#define JOB_DEQUE_SIZE			1024		// a power of two. Jobs pushed past it run straight away
+
+typedef struct job_s
+{
+	void			(*func)(void* arg);
+	void*			arg;
+	job_counter_t*	counter;
+	const char*		name;
+} job_t;
+
+typedef struct job_thread_s
+{
+	sys_mutex_t*	lock;
+	job_t			jobs[JOB_DEQUE_SIZE];
+	int32_t 		top;				// the oldest job, where thieves take from
+	int32_t 		bottom;				// one past the newest, where the owner pushes and pops
+	sys_thread_t*	thread;				// NULL for the main thread
+
+	// only written by the thread itself, cleared by job_stats
+	int32_t 		jobs_run;
+	int32_t 		jobs_stolen;
+	int64_t 		busy;
+} job_thread_t;
+
+typedef struct job_parallel_s
+{
+	void			(*func)(void* arg, int32_t start, int32_t end);
+	void*			arg;
+	int32_t 		count;
+	int32_t 		batch;
+	volatile int32_t next;				// batches handed out
+} job_parallel_t;
+
+cvar_t* sys_threads;
+
+static job_thread_t		job_threads[JOB_MAX_THREADS];
+static int32_t 			job_num_threads = 1;		// the main thread and the workers
+static volatile int32_t job_queued;					// jobs in all of the deques
+static volatile int32_t job_sleepers;				// workers waiting on job_wake
+static volatile bool	job_quit;
+
+static sys_mutex_t*		job_sleep_lock;
+static sys_cond_t*		job_wake;					// workers wait for jobs on this
+static sys_cond_t*		job_done;					// Job_Wait waits for counters on this
+
+// 0 for the main thread and any thread the job system didn't start
+static JOB_THREAD int32_t job_thread_index;
+
+/*
+==================
+Job_Push
+
+Onto the bottom of the thread's own deque
+==================
+*/
+static bool Job_Push(job_thread_t* thread, job_t* job)
+{
+	Sys_MutexLock(thread->lock);
+
+	if (thread->bottom - thread->top >= JOB_DEQUE_SIZE)
+	{
+		Sys_MutexUnlock(thread->lock);
+		return false;
+	}
+
+	thread->jobs[thread->bottom & (JOB_DEQUE_SIZE - 1)] = *job;
+	thread->bottom++;
+	Sys_MutexUnlock(thread->lock);
+
+	// both this and a worker going to sleep change one count and then read the other, with a
+	// full barrier between, so either this sees the sleeper or the sleeper sees the job
+	JOB_INCREMENT(job_queued);
+
+	if (job_sleepers)
+	{
+		Sys_MutexLock(job_sleep_lock);
+		Sys_CondSignal(job_wake);
+		Sys_MutexUnlock(job_sleep_lock);
+	}
+
+	return true;
+}
+
+/*
+==================
+Job_Get
+
+The newest job of the thread's own, or the oldest one another thread has
+==================
+*/
+static bool Job_Get(int32_t index, job_t* job)
+{
+	job_thread_t*	thread;
+	int32_t 		i;
+
+	if (!job_queued)
+		return false;
+
+	for (i = 0; i < job_num_threads; i++)
+	{
+		thread = &job_threads[(index + i) % job_num_threads];
+		Sys_MutexLock(thread->lock);
+
+		if (thread->bottom > thread->top)
+		{
+			if (!i)
+			{
+				thread->bottom--;
+				*job = thread->jobs[thread->bottom & (JOB_DEQUE_SIZE - 1)];
+			}
+			else
+			{
+				*job = thread->jobs[thread->top & (JOB_DEQUE_SIZE - 1)];
+				thread->top++;
+				job_threads[index].jobs_stolen++;
+			}
+
+			Sys_MutexUnlock(thread->lock);
+			JOB_DECREMENT(job_queued);
+			return true;
+		}
+
+		Sys_MutexUnlock(thread->lock);
+	}
+
+	return false;
+}
+
+static void Job_Execute(int32_t index, job_t* job)
+{
+	job_thread_t*	thread = &job_threads[index];
+	int64_t 		start;
+
+	start = Sys_Nanoseconds();
+	TIMELINE_BEGIN(job->name);
+
+	job->func(job->arg);
+
+	TIMELINE_END();
+	thread->busy += Sys_Nanoseconds() - start;
+	thread->jobs_run++;
+
+	if (job->counter && !JOB_DECREMENT(job->counter->count))
+	{
+		Sys_MutexLock(job_sleep_lock);
+		Sys_CondBroadcast(job_done);
+		Sys_MutexUnlock(job_sleep_lock);
+	}
+}
+
+static void Job_WorkerThread(void* arg)
+{
+	int32_t index = (int32_t)(intptr_t)arg;
+	job_t	job;
+
+	job_thread_index = index;
+
+	while (!job_quit)
+	{
+		if (Job_Get(index, &job))
+		{
+			Job_Execute(index, &job);
+			continue;
+		}
+
+		Sys_MutexLock(job_sleep_lock);
+		JOB_INCREMENT(job_sleepers);
+
+		while (!job_queued && !job_quit)
+			Sys_CondWait(job_wake, job_sleep_lock);
+
+		JOB_DECREMENT(job_sleepers);
+		Sys_MutexUnlock(job_sleep_lock);
+	}
+}
+
+/*
+==================
+Job_Run
+
+Runs func(arg) on whichever thread gets to it first, adding it to counter if there is one.
+With no worker threads, or the deque full, it runs straight away.
+==================
+*/
+void Job_Run(job_counter_t* counter, const char* name, void (*func)(void* arg), void* arg)
+{
+	job_t job;
+
+	job.func = func;
+	job.arg = arg;
+	job.counter = counter;
+	job.name = name;
+
+	if (counter)
+		JOB_INCREMENT(counter->count);
+
+	if (job_num_threads > 1
+		&& Job_Push(&job_threads[job_thread_index], &job))
+		return;
+
+	Job_Execute(job_thread_index, &job);
+}
+
+/*
+==================
+Job_Wait
+
+Runs jobs until every job added to counter has finished
+==================
+*/
+void Job_Wait(job_counter_t* counter)
+{
+	job_t job;
+
+	while (counter->count > 0)
+	{
+		if (Job_Get(job_thread_index, &job))
+		{
+			Job_Execute(job_thread_index, &job);
+			continue;
+		}
+
+		// the last job of a counter to finish always broadcasts, so this can't miss it
+		Sys_MutexLock(job_sleep_lock);
+
+		while (counter->count > 0 && !job_queued)
+			Sys_CondWait(job_done, job_sleep_lock);
+
+		Sys_MutexUnlock(job_sleep_lock);
+	}
+}
+
+static void Job_ParallelBatches(void* arg)
+{
+	job_parallel_t* parallel = arg;
+	int32_t 		start;
+
+	while ((start = (JOB_INCREMENT(parallel->next) - 1) * parallel->batch) < parallel->count)
+	{
+		parallel->func(parallel->arg, start,
+			start + parallel->batch < parallel->count ? start + parallel->batch : parallel->count);
+	}
+}
+
+/*
+==================
+Job_ParallelFor
+
+Calls func(arg, start, end) for batches covering 0 to count and waits for them all. Batches
+are handed out as threads ask for them, so uneven ones balance out. A batch of 0 picks one.
+==================
+*/
+void Job_ParallelFor(const char* name, int32_t count, int32_t batch, void (*func)(void* arg, int32_t start, int32_t end), void* arg)
+{
+	job_parallel_t	parallel;
+	job_counter_t	counter;
+	int32_t 		batches, i;
+
+	if (count <= 0)
+		return;
+
+	if (batch <= 0)
+	{
+		// a few per thread, so a slow one doesn't hold the rest up
+		batch = count / (job_num_threads * 4);
+
+		if (batch < 1)
+			batch = 1;
+	}
+
+	batches = (count + batch - 1) / batch;
+
+	if (batches == 1 || job_num_threads == 1)
+	{
+		func(arg, 0, count);
+		return;
+	}
+
+	parallel.func = func;
+	parallel.arg = arg;
+	parallel.count = count;
+	parallel.batch = batch;
+	parallel.next = 0;
+	counter.count = 0;
+
+	for (i = 1; i < job_num_threads && i < batches; i++)
+		Job_Run(&counter, name, Job_ParallelBatches, &parallel);
+
+	// this thread takes batches too, rather than only waiting
+	TIMELINE_BEGIN(name);
+	Job_ParallelBatches(&parallel);
+	TIMELINE_END();
+
+	Job_Wait(&counter);
+}
+
+/*
+==================
+Job_ThreadIndex
+
+0 for the main thread, 1 up for the workers, for things that keep something per thread
+==================
+*/
+int32_t Job_ThreadIndex()
+{
+	return job_thread_index;
+}
+
+/*
+==================
+Job_NumThreads
+
+The workers and the main thread, for sizing work
+==================
+*/
+int32_t Job_NumThreads()
+{
+	return job_num_threads;
+}
+
+static void Job_StartWorkers()
+{
+	char	name[32];
+	int32_t threads, i;
+
+	threads = (int32_t)sys_threads->value;
+
+	if (threads <= 0)
+		threads = Sys_CPUCount();
+
+	if (threads > JOB_MAX_THREADS)
+		threads = JOB_MAX_THREADS;
+
+	if (threads < 1)
+		threads = 1;
+
+	job_quit = false;
+	job_num_threads = threads;
+
+	for (i = 1; i < threads; i++)
+	{
+		snprintf(name, sizeof(name), "job worker %i", i);
+		job_threads[i].thread = Sys_ThreadCreate(Job_WorkerThread, (void*)(intptr_t)i, name);
+	}
+}
+
+static void Job_StopWorkers()
+{
+	int32_t i;
+
+	Sys_MutexLock(job_sleep_lock);
+	job_quit = true;
+	Sys_CondBroadcast(job_wake);
+	Sys_MutexUnlock(job_sleep_lock);
+
+	for (i = 1; i < job_num_threads; i++)
+	{
+		Sys_ThreadJoin(job_threads[i].thread);
+		job_threads[i].thread = NULL;
+	}
+
+	job_num_threads = 1;
+}
+
+static void Job_ThreadsChanged(cvar_t* var)
+{
+	// only ever changed from the console, between frames, when nothing is in flight
+	Job_StopWorkers();
+	Job_StartWorkers();
+	Com_Printf("%i job threads\n", job_num_threads);
+}
+
+/*
+==================
+Job_Stats_f
+
+What each thread has done since the last job_stats
+==================
+*/
+static void Job_Stats_f()
+{
+	job_thread_t*	thread;
+	int32_t 		i;
+
+	Com_Printf("%-8s %10s %10s %12s\n", "thread", "jobs", "stolen", "busy ms");
+
+	for (i = 0; i < job_num_threads; i++)
+	{
+		thread = &job_threads[i];
+		Com_Printf("%-8i %10i %10i %12.2f\n", i, thread->jobs_run, thread->jobs_stolen, thread->busy / 1000000.0);
+
+		thread->jobs_run = thread->jobs_stolen = 0;
+		thread->busy = 0;
+	}
+}
+
+/*
+==================
+Job_Bench_f
+
+job_bench [jobs]: the cost of starting and waiting for empty jobs, and a parallel for that
+checks every index is covered exactly once
+==================
+*/
+static void Job_BenchEmpty(void* arg)
+{
+}
+
+static void Job_BenchMark(void* arg, int32_t start, int32_t end)
+{
+	uint8_t*	marks = arg;
+	int32_t 	i;
+
+	for (i = start; i < end; i++)
+		marks[i]++;
+}
+
+static void Job_Bench_f()
+{
+	job_counter_t	counter;
+	uint8_t*		marks;
+	int64_t 		start, run_time, parallel_time;
+	int32_t 		jobs, i, bad;
+
+	jobs = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+
+	if (jobs <= 0)
+		jobs = 1;
+
+	counter.count = 0;
+	start = Sys_Nanoseconds();
+
+	for (i = 0; i < jobs; i++)
+		Job_Run(&counter, "job_bench", Job_BenchEmpty, NULL);
+
+	Job_Wait(&counter);
+	run_time = Sys_Nanoseconds() - start;
+
+	marks = Memory_ZoneMalloc(jobs);
+	start = Sys_Nanoseconds();
+	Job_ParallelFor("job_bench", jobs, 0, Job_BenchMark, marks);
+	parallel_time = Sys_Nanoseconds() - start;
+
+	for (i = 0, bad = 0; i < jobs; i++)
+	{
+		if (marks[i] != 1)
+			bad++;
+	}
+
+	Memory_ZoneFree(marks);
+
+	Com_Printf("%i threads: %.1f ns per empty job, parallel for over %i in %.3f ms%s\n", job_num_threads,
+		run_time / (double)jobs, jobs, parallel_time / 1000000.0, bad ? ", WRONG" : "");
+}
+
+/*
+==================
+Job_Init
+==================
+*/
+void Job_Init()
+{
+	int32_t i;
+
+	for (i = 0; i < JOB_MAX_THREADS; i++)
+		job_threads[i].lock = Sys_MutexCreate();
+
+	job_sleep_lock = Sys_MutexCreate();
+	job_wake = Sys_CondCreate();
+	job_done = Sys_CondCreate();
+
+	// 0 is one per cpu, 1 runs everything on the thread that asks for it
+	sys_threads = Cvar_Get("sys_threads", "0", CVAR_ARCHIVE);
+	Cvar_AddCallback(sys_threads, Job_ThreadsChanged);
+
+	Cmd_AddCommand("job_stats", Job_Stats_f);
+	Cmd_AddCommand("job_bench", Job_Bench_f);
+
+	Job_StartWorkers();
+	Com_Printf("Job_Init: %i threads\n", job_num_threads);
+}
+
+void Job_Shutdown()
+{
+	if (job_sleep_lock)
+		Job_StopWorkers();
+}
@@ -26,25 +26,50 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // cvars
 cvar_t* language;
 
+#define LOCALISATION_HASH_SIZE		2048	// buckets for the dictionary, a power of two
+#define LOCALISATION_CACHE_MAX		1024	// processed strings kept before the cache is emptied, a power of two
+
+// A string that has been through Localisation_ProcessString.
+typedef struct processed_string_s
+{
+	struct processed_string_s* next;
+	uint32_t hash;
+	char* output;		// NULL if there was nothing to localise
+	char input[1];		// variable sized, followed by output
+} processed_string_t;
+
 // globals
 localisation_entry_t localisation_entries[LOCALISATION_ENTRIES_MAX];
-cached_string_t cached_strings[LOCALISATION_ENTRIES_MAX];
 
 uint32_t localisation_entries_count;		// Counts the number of localisation string entries for the current language.
-uint32_t cached_strings_count;			// Counts the number of cached localisation strings for the current language.
+
+static int32_t localisation_hash[LOCALISATION_HASH_SIZE];			// index + 1 of the first entry with each hash
+static int32_t localisation_hash_next[LOCALISATION_ENTRIES_MAX];	// index + 1 of the next entry with the same hash
+
+static processed_string_t* processed_strings[LOCALISATION_CACHE_MAX];
+static int32_t processed_strings_count;
 
 // Determines if the localisation subsystem has been initialised.
 bool localisation_initialised;
 
 // functions only used in this translation unit
 void Localisation_LoadCurrentLanguage();
+static void Localisation_FlushCache();
+
+// reload localisation files when the language changes
+static void Localisation_LanguageChanged(cvar_t* var)
+{
+	Localisation_LoadCurrentLanguage();
+	var->modified = false;
+}
 
 // ran when localisation system initialised
-// AND when changing language
 void Localisation_Init()
 {
 	language = Cvar_Get("language", "english", CVAR_ARCHIVE);
+	Cvar_AddCallback(language, Localisation_LanguageChanged);
 	Localisation_LoadCurrentLanguage();
+	language->modified = false;
 	localisation_initialised = true;
 }
 
@@ -59,6 +84,10 @@ void Localisation_LoadCurrentLanguage()
 	char* token_ptr;
 
 	localisation_entries_count = 0;
+	memset(localisation_entries, 0, sizeof(localisation_entries));
+
+	// strings processed in the old language
+	Localisation_FlushCache();
 
 	snprintf(loc_filename, MAX_QPATH, "text/%s/%s", language->string, LOCALISATION_DICTIONARY_FILENAME);
 
@@ -169,22 +198,26 @@ void Localisation_LoadCurrentLanguage()
 		continue;
 	}
 
+	// hash the keys, backwards so the first of any duplicates is found first like before
+	memset(localisation_hash, 0, sizeof(localisation_hash));
+
+	for (int32_t text_string_id = localisation_entries_count - 1; text_string_id >= 0; text_string_id--)
+	{
+		uint32_t hash = Com_HashString(localisation_entries[text_string_id].key) & (LOCALISATION_HASH_SIZE - 1);
+
+		localisation_hash_next[text_string_id] = localisation_hash[hash];
+		localisation_hash[hash] = text_string_id + 1;
+	}
+
 	Com_Printf("Loaded %d localisation strings\n", localisation_entries_count);
 }
 
 // Returns the value for the key key.
 localisation_entry_t* Localisation_GetString(char* key)
 {
-	// if language has changed, reload localisation files
-	if (language->modified)
+	for (int32_t index = localisation_hash[Com_HashString(key) & (LOCALISATION_HASH_SIZE - 1)]; index; index = localisation_hash_next[index - 1])
 	{
-		Localisation_LoadCurrentLanguage();
-		language->modified = false;
-	}
-
-	for (int32_t text_string_id = 0; text_string_id < localisation_entries_count; text_string_id++)
-	{
-		localisation_entry_t* value = &localisation_entries[text_string_id];
+		localisation_entry_t* value = &localisation_entries[index - 1];
 
 		if (!strcmp(value->key, key))
 			return value;
@@ -199,205 +232,137 @@ localisation_entry_t* Localisation_GetString(char* key)
 #define LOCALISATION_KEY_END	"]"
 #define LOCALISATION_KEY_END_CHAR	']' // needed for some comparisons
 
-// really big buffer for strtok to use
+// really big buffer to expand strings into
 #define STRING_TEMP_BUF_SIZE	0x10000
 char string_temp_buf[STRING_TEMP_BUF_SIZE] = { 0 };
 
-// This code sucks
-char* Localisation_ProcessString(char* value)
+// Replaces every [key] in value with its localised string, leaving keys that aren't in the dictionary alone.
+// Returns false if there was nothing to replace.
+static bool Localisation_ExpandString(char* value, char* output, int32_t output_size)
 {
-	// if language has changed, reload localisation files
-	if (language->modified)
-	{
-		Localisation_LoadCurrentLanguage();
-		language->modified = false;
-	}
-
-	// don't continuously clear the big buffer we use for the localisation string, just clear whatever is left
-	uint32_t clear_amount = 0;
+	char key[LOCALISATION_MAX_LENGTH_KEY];
+	bool localised = false;
+	int32_t used = 0;
 
-	while (clear_amount < STRING_TEMP_BUF_SIZE
-		&& string_temp_buf[clear_amount] != 0x00)
+	while (*value
+		&& used < output_size - 1)
 	{
-		clear_amount++;
-	}
+		char* key_end_ptr = NULL;
 
-	memset(string_temp_buf, 0x00, clear_amount);
+		if (*value == LOCALISATION_KEY_START_CHAR)
+			key_end_ptr = strchr(value + 1, LOCALISATION_KEY_END_CHAR);
 
-	strncpy(string_temp_buf, value, strlen(value));
+		if (key_end_ptr)
+		{
+			int32_t localisation_key_length = key_end_ptr - value - 1;
 
-	size_t localisation_string_length = 0;
-	char loc_string_key_buf[LOCALISATION_MAX_LENGTH_KEY] = { 0 };
-	size_t string_length = strlen(string_temp_buf);
-	size_t string_length_original = string_length;
+			if (localisation_key_length > 0
+				&& localisation_key_length < LOCALISATION_MAX_LENGTH_KEY)
+			{
+				memcpy(key, value + 1, localisation_key_length);
+				key[localisation_key_length] = '\0';
 
-	// strstr can only find the first use of the character so we can't use that
-	// however we still need to start the string temp without breaking further [ charcters,
-	// so just check if thw first character is a localisation start character and set the buffer to the start of the string
-	// and use first_token below to determine if we need to call strtok or not
+				localisation_entry_t* loc_string = Localisation_GetString(key);
 
-	bool first_char_is_key = (string_temp_buf[0] == LOCALISATION_KEY_START_CHAR);
+				if (loc_string)
+				{
+					int32_t localisation_string_length = strlen(loc_string->value);
 
-	char* token_ptr = string_temp_buf;
+					if (localisation_string_length > output_size - 1 - used)
+						localisation_string_length = output_size - 1 - used;
 
-	if (!first_char_is_key)
-		token_ptr = strtok(string_temp_buf, LOCALISATION_KEY_START);
+					memcpy(output + used, loc_string->value, localisation_string_length);
+					used += localisation_string_length;
+					value = key_end_ptr + 1;
+					localised = true;
+					continue;
+				}
+			}
+		}
 
-	if (!token_ptr)
-		return value; // no string here
+		output[used++] = *value++;
+	}
 
-	if (string_length > STRING_TEMP_BUF_SIZE)
-		Sys_Error("Passed string more than 0x10000 bytes in length to Localisation_ProcessString?!");
+	output[used] = '\0';
+	return localised;
+}
 
-	// determine the length of the string
-	while (token_ptr < (string_temp_buf + string_length))
+// Empties the processed string cache, when the language changes or it fills up
+static void Localisation_FlushCache()
+{
+	for (int32_t bucket = 0; bucket < LOCALISATION_CACHE_MAX; bucket++)
 	{
-		char* key_start_ptr = NULL;
+		processed_string_t* next;
 
-		if (first_char_is_key)
+		for (processed_string_t* processed = processed_strings[bucket]; processed; processed = next)
 		{
-			key_start_ptr = strtok(string_temp_buf, LOCALISATION_KEY_START);
+			next = processed->next;
+			Memory_ZoneFree(processed);
 		}
-		else
-		{
-			key_start_ptr = strtok(NULL, LOCALISATION_KEY_START);
-		}
-
-		// no localisation to do
-		if (!key_start_ptr)
-			return value;
-
-		// iterate through each part of the string
 
-		int32_t localisation_key_length = 0;
-
-		char* key_end_ptr = strchr(key_start_ptr, LOCALISATION_KEY_END_CHAR);
+		processed_strings[bucket] = NULL;
+	}
 
-		localisation_key_length = key_end_ptr - key_start_ptr;
+	processed_strings_count = 0;
+}
 
-		if (localisation_key_length > LOCALISATION_MAX_LENGTH_KEY)
-		{
-			Com_Printf("Warning: Localisation string key length of %d, more than %d\n", localisation_key_length, LOCALISATION_MAX_LENGTH_KEY);
-			continue;
-		}
-		else if (localisation_key_length <= 0)
-		{
-			Com_Printf("Warning: Empty localisation string key, skipping\n");
-			continue;
-		}
+// Localises every [key] in value. The text drawing code calls this for every string it draws, every frame,
+// so the result is kept and the same string comes straight back out of the cache next time.
+// The returned string is value itself or belongs to the cache, which is emptied when the language changes or a new string
+// finds it full, and that can be the very next call. Callers that keep the result past that (the game DLL included) copy it.
+char* Localisation_ProcessString(char* value)
+{
+	// nothing to localise
+	if (!strchr(value, LOCALISATION_KEY_START_CHAR))
+		return value;
 
-		// get the localisation string
-		strncpy(loc_string_key_buf, key_start_ptr, localisation_key_length);
+	uint32_t hash = Com_HashString(value);
+	processed_string_t* processed;
 
-		// was this string already localised?
-			// if so, return
-		for (uint32_t localisation_string_id = 0; localisation_string_id < localisation_entries_count; localisation_string_id++)
+	for (processed = processed_strings[hash & (LOCALISATION_CACHE_MAX - 1)]; processed; processed = processed->next)
+	{
+		if (processed->hash == hash
+			&& !strcmp(processed->input, value))
 		{
-			if (!strcmp(localisation_entries[localisation_string_id].key, loc_string_key_buf))
-				return localisation_entries[localisation_string_id].value;
+			return processed->output ? processed->output : value;
 		}
-
-		char* loc_string = Localisation_GetString(loc_string_key_buf);
-
-		if (!loc_string)
-			return value;
-		
-		localisation_string_length = strlen(loc_string);
-
-		// figure out the new length of the string
-		string_length = string_length - localisation_key_length + localisation_string_length;
-
-		token_ptr = strtok(NULL, LOCALISATION_KEY_START);
-
-		// done so break
-		if (!token_ptr)
-			break;
 	}
 
-	if (cached_strings_count >= LOCALISATION_ENTRIES_MAX)
-	{
-		Com_Printf("Too many localisation strings! (%d > %d)", cached_strings_count, LOCALISATION_ENTRIES_MAX);
-		return NULL;
-	}
+	// text with numbers in it can be different every frame, so don't let the cache grow forever
+	if (processed_strings_count >= LOCALISATION_CACHE_MAX)
+		Localisation_FlushCache();
+
+	bool localised = Localisation_ExpandString(value, string_temp_buf, STRING_TEMP_BUF_SIZE);
+	int32_t input_length = strlen(value) + 1;
+	int32_t output_length = localised ? strlen(string_temp_buf) + 1 : 0;
 
-	// allocate memory for the string
-	// zero it since loading this happens rarely
-	
-	cached_strings[cached_strings_count].value = (char*)Memory_ZoneMallocTagged(string_length, TAG_LOCALISATION);
+	processed = (processed_string_t*)Memory_ZoneMallocTagged(sizeof(processed_string_t) + input_length + output_length, TAG_LOCALISATION);
 
-	if (!cached_strings[cached_strings_count].value)
+	if (!processed)
 	{
 		Sys_Error("Failed to allocate memory for localisation string information");
 		return NULL;
 	}
 
-	// reset pointer
-	// this code might suck
-	token_ptr = strtok(string_temp_buf, LOCALISATION_KEY_START);
+	processed->hash = hash;
+	processed->output = NULL;
+	memcpy(processed->input, value, input_length);
 
-	// if we got to this point we need to un-terminate the string as modified by strtok
-	// so do that
-	while (token_ptr < (string_temp_buf + string_length_original))
+	if (localised)
 	{
-		if (*token_ptr == '\0')
-			*token_ptr = LOCALISATION_KEY_START_CHAR;
-
-		token_ptr++;
+		processed->output = processed->input + input_length;
+		memcpy(processed->output, string_temp_buf, output_length);
 	}
 
-	token_ptr = string_temp_buf;
+	processed->next = processed_strings[hash & (LOCALISATION_CACHE_MAX - 1)];
+	processed_strings[hash & (LOCALISATION_CACHE_MAX - 1)] = processed;
+	processed_strings_count++;
 
-	// actually copy it
-	while (token_ptr < (string_temp_buf + string_length_original))
-	{
-		// get the part actually after the LOCALISATION_KEY_START string
-		char* key_start_ptr = strtok(NULL, LOCALISATION_KEY_START);
-		char* key_end_ptr = key_start_ptr;
-
-		// copy part before the localisation string
-		strncpy(cached_strings[cached_strings_count].value, token_ptr, (key_start_ptr - token_ptr) - 1); // -1 to cut off the [
-
-		// iterate through each part of the string
-
-		int32_t localisation_key_length = 0;
-
-		key_end_ptr = strchr(key_start_ptr, LOCALISATION_KEY_END_CHAR);
-
-		localisation_key_length = key_end_ptr - key_start_ptr;
-
-		// get the localisation string
-		strncpy(loc_string_key_buf, key_start_ptr, localisation_key_length);
-
-		localisation_entry_t* loc_string = Localisation_GetString(loc_string_key_buf);
-
-		if (!loc_string)
-			return value;
-
-		cached_strings[cached_strings_count].key = loc_string->key;
-
-		uint32_t loc_string_current_length = strlen(cached_strings[cached_strings_count].value);
-
-		// copy the localisation string
-		strncpy(cached_strings[cached_strings_count].value + loc_string_current_length, loc_string->value, strlen(loc_string->value));
-
-		token_ptr = strtok(NULL, LOCALISATION_KEY_START);
-
-		// we are done
-		if (!token_ptr)
-			break;
-	}
-
-	// we are done
-	cached_strings_count++;
-	return cached_strings[cached_strings_count - 1].value;
+	return processed->output ? processed->output : value;
 }
 
 // Frees all localisation strins
 void Localisation_Shutdown()
 {
-	for (int32_t localisation_string_id = 0; localisation_string_id < localisation_entries_count; localisation_string_id++)
-	{
-		if (cached_strings[localisation_string_id].value != NULL)
-			Memory_ZoneFree((void*)cached_strings[localisation_string_id].value);
-	}
-}
\ No newline at end of file
+	Localisation_FlushCache();
+}
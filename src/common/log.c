@@ -0,0 +1,508 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// log.c -- the slow half of Com_Printf
+//
+// Com_Printf still puts text in the console straight away, but the terminal
+// and qconsole.log are written by a logger thread, so a burst of prints costs
+// the frame a copy into a ring buffer instead of a terminal or disk write each.
+//
+// The ring has one writer, the thread calling Com_Printf (which was never
+// thread safe), and one reader, the logger thread, so it needs no lock: each
+// side only moves its own index, after a barrier. If the ring is full the text
+// is dropped and counted rather than making the frame wait. The indexes count
+// bytes ever moved and wrap at 4 GB, which the unsigned differences don't mind.
+//
+// Lines repeated more than log_repeat times in a row are counted instead of
+// written. A line is often printed by several Com_Printf calls, so text is held
+// back until its '\n' and only whole lines are compared.
+//
+// Log_Flush waits for the logger to catch up. Com_Error and Sys_Error (through
+// Common_Shutdown) flush, so the last thing printed before a crash is kept.
+
+#include "common.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LOG_THREAD				__declspec(thread)
+#define LOG_INCREMENT(x)		_InterlockedIncrement((volatile long*)&(x))
+#define LOG_DECREMENT(x)		_InterlockedDecrement((volatile long*)&(x))
+#define LOG_READ(x)				_InterlockedOr((volatile long*)&(x), 0)
+#define LOG_PUBLISH(x, value)	_InterlockedExchange((volatile long*)&(x), (value))
+#else
+#define LOG_THREAD				_Thread_local
+#define LOG_INCREMENT(x)		__sync_add_and_fetch(&(x), 1)
+#define LOG_DECREMENT(x)		__sync_sub_and_fetch(&(x), 1)
+#define LOG_READ(x)				__sync_fetch_and_or(&(x), 0)
+#define LOG_PUBLISH(x, value)	do { __sync_synchronize(); (x) = (value); __sync_synchronize(); } while (0)
+#endif
+
+#define LOG_RING_SIZE			(1 << 20)		// a power of two
+#define LOG_CHUNK				4096			// the most handed to Sys_ConsoleOutput at once
+#define LOG_LINE_LENGTH			1024			// longer lines are never counted as repeats
+
+cvar_t* log_async;
+cvar_t* log_repeat;
+
+extern cvar_t* logfile_active;
+
+static FILE*			logfile;
+
+static char				log_ring[LOG_RING_SIZE];
+static volatile uint32_t log_head;			// bytes ever written, only moved by Com_Printf's thread
+static volatile uint32_t log_tail;			// bytes ever read, only moved by the logger
+static uint32_t 		log_tail_seen;		// log_tail when Com_Printf's thread last looked, so it needn't every time
+static volatile int32_t	log_sleeping;		// the logger is waiting on log_wake
+static volatile bool	log_quit;
+static int32_t 			log_dropped;		// since the logger was last told about it
+static int32_t 			log_dropped_total;
+
+static sys_thread_t*	log_thread;
+static sys_mutex_t*		log_lock;
+static sys_cond_t*		log_wake;			// the logger waits for text on this
+static sys_cond_t*		log_drained;		// Log_Flush waits for the logger on this
+
+static LOG_THREAD bool	log_is_logger;
+
+// the line being printed, held back until its '\n'
+static char				log_line[LOG_LINE_LENGTH];
+static int32_t 			log_line_length;
+static bool				log_line_long;		// too long to hold, the rest of it goes out as it comes
+
+// the last line and how many times in a row it's come since
+static char				log_last[LOG_LINE_LENGTH];
+static int32_t 			log_last_count;
+
+/*
+==================
+Log_Output
+
+Where the text ends up, on the logger thread or on the printing thread with log_async 0.
+Sys_ConsoleOutput locks the line being typed at the dedicated console, which the main thread edits.
+==================
+*/
+static void Log_Output(char* text)
+{
+	Sys_ConsoleOutput(text);
+
+	if (logfile)
+		fputs(text, logfile);
+}
+
+static void Log_Drain()
+{
+	char		chunk[LOG_CHUNK];
+	uint32_t	head, tail;
+	int32_t 	length, offset, first;
+
+	head = LOG_READ(log_head);
+	tail = log_tail;
+
+	while (tail != head)
+	{
+		length = head - tail;
+
+		if (length > LOG_CHUNK - 1)
+			length = LOG_CHUNK - 1;
+
+		offset = tail & (LOG_RING_SIZE - 1);
+		first = LOG_RING_SIZE - offset;
+
+		if (first >= length)
+		{
+			memcpy(chunk, log_ring + offset, length);
+		}
+		else
+		{
+			memcpy(chunk, log_ring + offset, first);
+			memcpy(chunk + first, log_ring, length - first);
+		}
+
+		chunk[length] = 0;
+		tail += length;
+
+		// free the space before the slow part
+		LOG_PUBLISH(log_tail, tail);
+		Log_Output(chunk);
+	}
+
+	if (logfile && logfile_active->value > 1)
+		fflush(logfile);
+}
+
+static void Log_Thread(void* arg)
+{
+	bool quit;
+
+	log_is_logger = true;
+
+	for (;;)
+	{
+		Log_Drain();
+
+		Sys_MutexLock(log_lock);
+		Sys_CondBroadcast(log_drained);
+
+		// the same handshake as the job workers: this changes log_sleeping and then reads log_head,
+		// Log_Enqueue changes log_head and then reads log_sleeping
+		LOG_INCREMENT(log_sleeping);
+
+		while (LOG_READ(log_head) == log_tail && !log_quit)
+			Sys_CondWait(log_wake, log_lock);
+
+		LOG_DECREMENT(log_sleeping);
+		quit = log_quit;
+		Sys_MutexUnlock(log_lock);
+
+		if (quit && LOG_READ(log_head) == log_tail)
+			break;
+	}
+
+	if (logfile)
+		fflush(logfile);
+}
+
+static bool Log_Enqueue(char* text, int32_t length)
+{
+	uint32_t	head;
+	int32_t 	offset, first;
+
+	head = log_head;
+
+	if (length > LOG_RING_SIZE - (int32_t)(head - log_tail_seen))
+	{
+		log_tail_seen = LOG_READ(log_tail);
+
+		if (length > LOG_RING_SIZE - (int32_t)(head - log_tail_seen))
+			return false;
+	}
+
+	offset = head & (LOG_RING_SIZE - 1);
+	first = LOG_RING_SIZE - offset;
+
+	if (first >= length)
+	{
+		memcpy(log_ring + offset, text, length);
+	}
+	else
+	{
+		memcpy(log_ring + offset, text, first);
+		memcpy(log_ring, text + first, length - first);
+	}
+
+	// publishing is a full barrier, so log_sleeping is read after log_head is out
+	LOG_PUBLISH(log_head, head + length);
+
+	if (log_sleeping)
+	{
+		Sys_MutexLock(log_lock);
+		Sys_CondSignal(log_wake);
+		Sys_MutexUnlock(log_lock);
+	}
+
+	return true;
+}
+
+static void Log_Send(char* text)
+{
+	char	notice[64];
+	int32_t length;
+
+	if (!log_thread)
+	{
+		Log_Output(text);
+
+		if (logfile && logfile_active->value > 1)
+			fflush(logfile);		// force it to save every time
+
+		return;
+	}
+
+	if (log_dropped)
+	{
+		length = snprintf(notice, sizeof(notice), "[%i lines dropped, the log couldn't keep up]\n", log_dropped);
+
+		if (!Log_Enqueue(notice, length))
+		{
+			log_dropped++;
+			log_dropped_total++;
+			return;
+		}
+
+		log_dropped = 0;
+	}
+
+	if (!Log_Enqueue(text, (int32_t)strlen(text)))
+	{
+		log_dropped++;
+		log_dropped_total++;
+	}
+}
+
+// A different line has come, so the count of the last one is written
+static void Log_EndRepeats()
+{
+	if (log_repeat && log_last_count > log_repeat->value)
+		Log_Send(va("(the line before repeated %i more times)\n", log_last_count - (int32_t)log_repeat->value));
+
+	log_last[0] = 0;
+	log_last_count = 0;
+}
+
+static void Log_Line(char* line)
+{
+	if (!strcmp(line, log_last))
+	{
+		if (++log_last_count > log_repeat->value)
+			return;
+	}
+	else
+	{
+		Log_EndRepeats();
+		strcpy(log_last, line);
+		log_last_count = 1;
+	}
+
+	Log_Send(line);
+}
+
+/*
+==================
+Log_SendPartial
+
+Sends what there is of the line being printed without waiting for the rest, which then can't be
+compared either
+==================
+*/
+static void Log_SendPartial()
+{
+	if (!log_line_length)
+		return;
+
+	if (!log_line_long)
+		Log_EndRepeats();
+
+	log_line[log_line_length] = 0;
+	Log_Send(log_line);
+
+	log_line_length = 0;
+	log_line_long = true;
+}
+
+/*
+==================
+Log_Print
+
+Called by Com_Printf after the console has the text
+==================
+*/
+void Log_Print(char* text)
+{
+	char	name[MAX_OSPATH];
+	char	c;
+
+	if (logfile_active && logfile_active->value && !logfile)
+	{
+		snprintf(name, sizeof(name), "%s/qconsole.log", FS_Gamedir());
+
+		if (logfile_active->value > 2)
+			logfile = fopen(name, "a");
+		else
+			logfile = fopen(name, "w");
+	}
+
+	if (!log_repeat || log_repeat->value <= 0)
+	{
+		Log_SendPartial();
+		Log_Send(text);
+		return;
+	}
+
+	while (*text)
+	{
+		// up to and including the next '\n', or as much as fits
+		while (*text && log_line_length < LOG_LINE_LENGTH - 1)
+		{
+			c = *text++;
+			log_line[log_line_length++] = c;
+
+			if (c == '\n')
+				break;
+		}
+
+		log_line[log_line_length] = 0;
+
+		if (log_line[log_line_length - 1] == '\n')
+		{
+			// the end of a line that was too long to compare
+			if (log_line_long)
+				Log_Send(log_line);
+			else
+				Log_Line(log_line);
+
+			log_line_length = 0;
+			log_line_long = false;
+		}
+		else if (log_line_length == LOG_LINE_LENGTH - 1)
+		{
+			Log_SendPartial();
+		}
+	}
+}
+
+/*
+==================
+Log_Flush
+
+Waits for the logger to write everything printed so far
+==================
+*/
+void Log_Flush()
+{
+	if (log_is_logger)
+		return;
+
+	// a crash can come in the middle of a line
+	Log_SendPartial();
+
+	if (!log_thread)
+		return;
+
+	Sys_MutexLock(log_lock);
+	Sys_CondSignal(log_wake);
+
+	while (LOG_READ(log_tail) != log_head)
+		Sys_CondWait(log_drained, log_lock);
+
+	Sys_MutexUnlock(log_lock);
+}
+
+static void Log_StartThread()
+{
+	log_quit = false;
+	log_thread = Sys_ThreadCreate(Log_Thread, NULL, "logger");
+}
+
+static void Log_StopThread()
+{
+	if (!log_thread || log_is_logger)
+		return;
+
+	Sys_MutexLock(log_lock);
+	log_quit = true;
+	Sys_CondSignal(log_wake);
+	Sys_MutexUnlock(log_lock);
+
+	Sys_ThreadJoin(log_thread);
+	log_thread = NULL;
+}
+
+static void Log_AsyncChanged(cvar_t* var)
+{
+	if (var->value && !log_thread)
+		Log_StartThread();
+	else if (!var->value && log_thread)
+		Log_StopThread();
+}
+
+/*
+==================
+Log_Bench_f
+
+log_bench [lines]: how long printing takes the printing thread, with the logger and without
+==================
+*/
+static void Log_Bench_f()
+{
+	int64_t 	start, time[2];
+	float		saved_async;
+	int32_t 	lines, i, j;
+
+	lines = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 2000;
+
+	if (lines <= 0)
+		lines = 1;
+
+	saved_async = log_async->value;
+
+	// 0 with the logger, 1 without
+	for (i = 0; i < 2; i++)
+	{
+		Cvar_SetValue("log_async", !i);
+		Log_Flush();
+
+		start = Sys_Nanoseconds();
+
+		// different lines, so log_repeat doesn't hide them
+		for (j = 0; j < lines; j++)
+			Com_Printf("log_bench %i: the quick brown fox jumps over the lazy dog\n", j);
+
+		time[i] = Sys_Nanoseconds() - start;
+		Log_Flush();
+	}
+
+	Cvar_SetValue("log_async", saved_async);
+
+	Com_Printf("%i lines: %.2f ms with the logger thread, %.2f ms without (%.2f us a line vs %.2f), %i dropped so far\n",
+		lines, time[0] / 1000000.0, time[1] / 1000000.0,
+		time[0] / 1000.0 / lines, time[1] / 1000.0 / lines, log_dropped_total);
+}
+
+/*
+==================
+Log_Init
+==================
+*/
+void Log_Init()
+{
+	log_lock = Sys_MutexCreate();
+	log_wake = Sys_CondCreate();
+	log_drained = Sys_CondCreate();
+
+	log_async = Cvar_Get("log_async", "1", 0);
+	log_repeat = Cvar_Get("log_repeat", "3", 0);
+	Cvar_AddCallback(log_async, Log_AsyncChanged);
+
+	Cmd_AddCommand("log_bench", Log_Bench_f);
+
+	if (log_async->value)
+		Log_StartThread();
+}
+
+/*
+==================
+Log_Shutdown
+
+Writes out what's left and closes the log
+==================
+*/
+void Log_Shutdown()
+{
+	if (log_is_logger)
+		return;
+
+	Log_SendPartial();
+	Log_StopThread();
+
+	if (logfile)
+	{
+		fclose(logfile);
+		logfile = NULL;
+	}
+}
@@ -19,9 +19,24 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 // cmodel.c -- model loading
+//
+// Traces and point contents can be run from several threads at once, so the
+// trace state below is per thread and every job thread has its own box hull.
+// Loading a map while they're running still isn't safe.
 
 #include "common.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MAP_THREAD				__declspec(thread)
+#define MAP_INCREMENT(x)		_InterlockedIncrement((volatile long*)&(x))
+#else
+#define MAP_THREAD				_Thread_local
+#define MAP_INCREMENT(x)		__sync_add_and_fetch(&(x), 1)
+#endif
+
+#define MAP_BOX_HULLS			JOB_MAX_THREADS		// one for each thread Job_ThreadIndex tells apart
+
 typedef struct
 {
 	cplane_t		*plane;
@@ -48,7 +63,7 @@ typedef struct
 	int32_t 		contents;
 	int32_t 		numsides;
 	int32_t 		firstbrushside;
-	int32_t 		checkcount;		// to avoid repeated testings
+	int32_t 		checkcount;		// to avoid repeated testings, see Map_BoxTrace
 } cbrush_t;
 
 typedef struct
@@ -59,34 +74,34 @@ typedef struct
 	int32_t 	floodvalid;
 } carea_t;
 
-int32_t 		checkcount;
+volatile int32_t checkcount;		// every trace gets its own
 
 char			map_name[MAX_QPATH];
 
 int32_t 		numbrushsides;
-cbrushside_t	map_brushsides[MAX_MAP_BRUSHSIDES];
+cbrushside_t	map_brushsides[MAX_MAP_BRUSHSIDES + 6 * MAP_BOX_HULLS];
 
 int32_t 		numtexinfo;
 mapsurface_t	map_surfaces[MAX_MAP_TEXINFO];
 
 int32_t 		numplanes;
-cplane_t		map_planes[MAX_MAP_PLANES+6];		// extra for box hull
+cplane_t		map_planes[MAX_MAP_PLANES + 12 * MAP_BOX_HULLS];		// extra for box hulls
 
 int32_t 		numnodes;
-cnode_t			map_nodes[MAX_MAP_NODES+6];		// extra for box hull
+cnode_t			map_nodes[MAX_MAP_NODES + 6 * MAP_BOX_HULLS];		// extra for box hulls
 
 int32_t 		numleafs = 1;	// allow leaf funcs to be called without a map
-cleaf_t			map_leafs[MAX_MAP_LEAFS];
+cleaf_t			map_leafs[MAX_MAP_LEAFS + MAP_BOX_HULLS];
 int32_t 		emptyleaf, solidleaf;
 
 int32_t 		numleafbrushes;
-uint32_t		map_leafbrushes[MAX_MAP_LEAFBRUSHES];
+uint32_t		map_leafbrushes[MAX_MAP_LEAFBRUSHES + MAP_BOX_HULLS];
 
 int32_t 		numcmodels;
 cmodel_t		map_cmodels[MAX_MAP_MODELS];
 
 int32_t 		numbrushes;
-cbrush_t		map_brushes[MAX_MAP_BRUSHES];
+cbrush_t		map_brushes[MAX_MAP_BRUSHES + MAP_BOX_HULLS];
 
 int32_t 		numvisibility;
 uint8_t			map_visibility[MAX_MAP_VISIBILITY];
@@ -115,6 +130,7 @@ void Map_InitBoxHull();
 void Map_FloodAreaConnections();
 
 
+// not atomic, so with traces on several threads they can come up a little short
 int32_t 	c_pointcontents;
 int32_t 	c_traces, c_brush_traces;
 
@@ -590,6 +606,8 @@ cmodel_t* Map_Load (char *name, bool clientload, uint32_t *checksum)
 		return &map_cmodels[0];
 	}
 
+	TIMELINE_BEGIN("Map_Load");
+
 	//
 	// load the file
 	//
@@ -633,6 +651,7 @@ cmodel_t* Map_Load (char *name, bool clientload, uint32_t *checksum)
 
 	strcpy (map_name, name);
 
+	TIMELINE_END();
 	return &map_cmodels[0];
 }
 
@@ -693,10 +712,7 @@ int32_t 	Map_LeafArea (int32_t leafnum)
 //=======================================================================
 
 
-cplane_t*	box_planes;
-int32_t 	box_headnode;
-cbrush_t*	box_brush;
-cleaf_t*	box_leaf;
+int32_t 	box_headnode;		// the first hull's, every headnode from here on is a box
 
 /*
 ===================
@@ -704,68 +720,77 @@ Map_InitBoxHull
 
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
+
+There are MAP_BOX_HULLS of them after the map's own, the arrays have room.
 ===================
 */
 void Map_InitBoxHull ()
 {
+	int32_t 		hull;
 	int32_t 		i;
 	int32_t 		side;
+	int32_t 		headnode, firstplane, brushnum, firstside, leafnum, leafbrush;
 	cnode_t		*c;
 	cplane_t	*p;
 	cbrushside_t	*s;
+	cbrush_t	*brush;
+	cleaf_t		*leaf;
 
 	box_headnode = numnodes;
-	box_planes = &map_planes[numplanes];
-	if (numnodes+6 > MAX_MAP_NODES
-		|| numbrushes+1 > MAX_MAP_BRUSHES
-		|| numleafbrushes+1 > MAX_MAP_LEAFBRUSHES
-		|| numbrushsides+6 > MAX_MAP_BRUSHSIDES
-		|| numplanes+12 > MAX_MAP_PLANES)
-		Com_Error (ERR_DROP, "Not enough room for box tree");
-
-	box_brush = &map_brushes[numbrushes];
-	box_brush->numsides = 6;
-	box_brush->firstbrushside = numbrushsides;
-	box_brush->contents = CONTENTS_MONSTER;
-
-	box_leaf = &map_leafs[numleafs];
-	box_leaf->contents = CONTENTS_MONSTER;
-	box_leaf->firstleafbrush = numleafbrushes;
-	box_leaf->numleafbrushes = 1;
-
-	map_leafbrushes[numleafbrushes] = numbrushes;
-
-	for (i=0 ; i<6 ; i++)
+
+	for (hull = 0; hull < MAP_BOX_HULLS; hull++)
 	{
-		side = i&1;
-
-		// brush sides
-		s = &map_brushsides[numbrushsides+i];
-		s->plane = 	map_planes + (numplanes+i*2+side);
-		s->surface = &nullsurface;
-
-		// nodes
-		c = &map_nodes[box_headnode+i];
-		c->plane = map_planes + (numplanes+i*2);
-		c->children[side] = -1 - emptyleaf;
-		if (i != 5)
-			c->children[side^1] = box_headnode+i + 1;
-		else
-			c->children[side^1] = -1 - numleafs;
-
-		// planes
-		p = &box_planes[i*2];
-		p->type = i>>1;
-		p->signbits = 0;
-		VectorClear3 (p->normal);
-		p->normal[i>>1] = 1;
-
-		p = &box_planes[i*2+1];
-		p->type = 3 + (i>>1);
-		p->signbits = 0;
-		VectorClear3 (p->normal);
-		p->normal[i>>1] = -1;
-	}	
+		headnode = box_headnode + hull * 6;
+		firstplane = numplanes + hull * 12;
+		brushnum = numbrushes + hull;
+		firstside = numbrushsides + hull * 6;
+		leafnum = numleafs + hull;
+		leafbrush = numleafbrushes + hull;
+
+		brush = &map_brushes[brushnum];
+		brush->numsides = 6;
+		brush->firstbrushside = firstside;
+		brush->contents = CONTENTS_MONSTER;
+
+		leaf = &map_leafs[leafnum];
+		leaf->contents = CONTENTS_MONSTER;
+		leaf->firstleafbrush = leafbrush;
+		leaf->numleafbrushes = 1;
+
+		map_leafbrushes[leafbrush] = brushnum;
+
+		for (i=0 ; i<6 ; i++)
+		{
+			side = i&1;
+
+			// brush sides
+			s = &map_brushsides[firstside+i];
+			s->plane = 	map_planes + (firstplane+i*2+side);
+			s->surface = &nullsurface;
+
+			// nodes
+			c = &map_nodes[headnode+i];
+			c->plane = map_planes + (firstplane+i*2);
+			c->children[side] = -1 - emptyleaf;
+			if (i != 5)
+				c->children[side^1] = headnode+i + 1;
+			else
+				c->children[side^1] = -1 - leafnum;
+
+			// planes
+			p = &map_planes[firstplane+i*2];
+			p->type = i>>1;
+			p->signbits = 0;
+			VectorClear3 (p->normal);
+			p->normal[i>>1] = 1;
+
+			p = &map_planes[firstplane+i*2+1];
+			p->type = 3 + (i>>1);
+			p->signbits = 0;
+			VectorClear3 (p->normal);
+			p->normal[i>>1] = -1;
+		}
+	}
 }
 
 
@@ -775,10 +800,18 @@ Map_HeadnodeForBox
 
 To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
+
+Each job thread has its own, so the headnode is only good on the thread that asked.
 ===================
 */
 int32_t Map_HeadnodeForBox (vec3_t mins, vec3_t maxs)
 {
+	int32_t 	hull;
+	cplane_t*	box_planes;
+
+	hull = Job_ThreadIndex ();
+	box_planes = &map_planes[numplanes + hull * 12];
+
 	box_planes[0].dist = maxs[0];
 	box_planes[1].dist = -maxs[0];
 	box_planes[2].dist = mins[0];
@@ -792,7 +825,7 @@ int32_t Map_HeadnodeForBox (vec3_t mins, vec3_t maxs)
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
-	return box_headnode;
+	return box_headnode + hull * 6;
 }
 
 
@@ -823,7 +856,7 @@ int32_t Map_PointLeafnum_r (vec3_t p, int32_t num)
 			num = node->children[0];
 	}
 
-	c_pointcontents++;		// optimize counter
+	MAP_INCREMENT (c_pointcontents);		// optimize counter, and sv_perf
 
 	return -1 - num;
 }
@@ -842,12 +875,12 @@ Map_BoxLeafnums
 Fills in a list of all the leafs touched
 =============
 */
-int32_t 	leaf_count;
-int32_t		leaf_maxcount;
-int32_t* 	leaf_list;
-float*		map_mins;
-float*		map_maxs;
-int32_t 	leaf_topnode;
+static MAP_THREAD int32_t 	leaf_count;
+static MAP_THREAD int32_t	leaf_maxcount;
+static MAP_THREAD int32_t* 	leaf_list;
+static MAP_THREAD float*	map_mins;
+static MAP_THREAD float*	map_maxs;
+static MAP_THREAD int32_t 	leaf_topnode;
 
 void MapRenderer_BoxLeafnums_r (int32_t nodenum)
 {
@@ -949,7 +982,7 @@ int32_t Map_TransformedPointContents (vec3_t p, int32_t headnode, vec3_t origin,
 	VectorSubtract3 (p, origin, p_l);
 
 	// rotate start and end into the models frame of reference
-	if (headnode != box_headnode && 
+	if (headnode < box_headnode && 
 	(angles[0] || angles[1] || angles[2]) )
 	{
 		AngleVectors (angles, forward, right, up);
@@ -977,13 +1010,14 @@ BOX TRACING
 // 1/32 epsilon to keep floating point happy
 #define	DIST_EPSILON	0.03125f
 
-vec3_t	trace_start, trace_end;
-vec3_t	trace_mins, trace_maxs;
-vec3_t	trace_extents;
+static MAP_THREAD vec3_t	trace_start, trace_end;
+static MAP_THREAD vec3_t	trace_mins, trace_maxs;
+static MAP_THREAD vec3_t	trace_extents;
 
-trace_t	trace_trace;
-int32_t 	trace_contents;
-bool	trace_ispoint;		// optimized case
+static MAP_THREAD trace_t	trace_trace;
+static MAP_THREAD int32_t 	trace_contents;
+static MAP_THREAD bool		trace_ispoint;		// optimized case
+static MAP_THREAD int32_t 	trace_checkcount;
 
 /*
 ================
@@ -1174,9 +1208,9 @@ void Map_TraceToLeaf (int32_t leafnum)
 	{
 		brushnum = map_leafbrushes[leaf->firstleafbrush+k];
 		b = &map_brushes[brushnum];
-		if (b->checkcount == checkcount)
+		if (b->checkcount == trace_checkcount)
 			continue;	// already checked this brush in another leaf
-		b->checkcount = checkcount;
+		b->checkcount = trace_checkcount;
 
 		if ( !(b->contents & trace_contents))
 			continue;
@@ -1208,9 +1242,9 @@ void Map_TestInLeaf (int32_t leafnum)
 	{
 		brushnum = map_leafbrushes[leaf->firstleafbrush+k];
 		b = &map_brushes[brushnum];
-		if (b->checkcount == checkcount)
+		if (b->checkcount == trace_checkcount)
 			continue;	// already checked this brush in another leaf
-		b->checkcount = checkcount;
+		b->checkcount = trace_checkcount;
 
 		if ( !(b->contents & trace_contents))
 			continue;
@@ -1347,9 +1381,11 @@ trace_t		Map_BoxTrace (vec3_t start, vec3_t end,
 {
 	int32_t 	i;
 
-	checkcount++;		// for multi-check avoidance
+	// for multi-check avoidance. Another thread's trace can overwrite the brush's count,
+	// which only means testing it again, and that can't change the result
+	trace_checkcount = MAP_INCREMENT (checkcount);
 
-	c_traces++;			// for statistics, may be zeroed
+	MAP_INCREMENT (c_traces);			// for statistics, may be zeroed
 
 	// fill in a default trace
 	memset (&trace_trace, 0, sizeof(trace_trace));
@@ -1459,7 +1495,7 @@ trace_t	 Map_TransformedBoxTrace (vec3_t start, vec3_t end,
 	VectorSubtract3 (end, origin, end_l);
 
 	// rotate start and end into the models frame of reference
-	if (headnode != box_headnode && 
+	if (headnode < box_headnode && 
 	(angles[0] || angles[1] || angles[2]) )
 		rotated = true;
 	else
@@ -1710,14 +1746,31 @@ int32_t Map_WriteAreaBits (uint8_t *buffer, int32_t area)
 
 /*
 ===================
-CM_WritePortalState
+Map_PortalState
 
-Writes the portal state to a savegame file
+The portal state for a savegame file, copied as is
+===================
+*/
+void*	Map_PortalState (int32_t *length)
+{
+	*length = sizeof(portalopen);
+	return portalopen;
+}
+
+/*
+===================
+Map_WritePortalState
+
+Writes the portal state to a savegame file, kept for the common API
 ===================
 */
 void	Map_WritePortalState (FILE *f)
 {
-	fwrite (portalopen, sizeof(portalopen), 1, f);
+	int32_t	length;
+	void*	portals;
+
+	portals = Map_PortalState (&length);
+	fwrite (portals, length, 1, f);
 }
 
 /*
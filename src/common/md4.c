@@ -7,6 +7,7 @@
  */
 
 #include <inttypes.h>
+#include <string.h>
 
 #define ROTATELEFT32(x, s) (((x) << (s)) | ((x) >> (32 - (s))))
 
@@ -30,18 +31,27 @@
 		a = ROTATELEFT32(a, s);	\
 	}
 
-static uint32_t X[16];
-static uint32_t A, AA;
-static uint32_t B, BB;
-static uint32_t C, CC;
-static uint32_t D, DD;
-
-static void DoMD4()
+/*
+ * The state lives on the stack rather than in statics, so the compiler can
+ * keep it in registers and more than one thread can checksum at once. Full
+ * blocks are read straight out of the buffer, only the padded tail is copied.
+ */
+static void DoMD4(uint32_t *state, const uint8_t *block)
 {
-	AA = A;
-	BB = B;
-	CC = C;
-	DD = D;
+	uint32_t X[16];
+	uint32_t A, B, C, D;
+	int32_t j;
+
+	for (j = 0; j < 16; j++, block += 4)
+	{
+		X[j] = ((uint32_t)block[0] << 0) | ((uint32_t)block[1] << 8) |
+			((uint32_t)block[2] << 16) | ((uint32_t)block[3] << 24);
+	}
+
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
 
 	S(A, B, C, D, 0, 3);
 	S(D, A, B, C, 1, 7);
@@ -94,117 +104,53 @@ static void DoMD4()
 	U(C, D, A, B, 7, 11);
 	U(B, C, D, A, 15, 15);
 
-	A += AA;
-	B += BB;
-	C += CC;
-	D += DD;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
 }
 
 static void
 PerformMD4(const uint8_t *buf, int32_t length, uint8_t *digest)
 {
-	int32_t len = length / 64; /* number of full blocks */
-	int32_t rem = length % 64; /* number of left over bytes */
-
-	int32_t i, j;
+	uint32_t state[4];
+	uint8_t tail[128];
+	int32_t rem, tail_length, j;
 	const uint8_t *ptr = buf;
 
 	/* initialize the MD buffer */
-	A = 0x67452301;
-	B = 0xEFCDAB89;
-	C = 0x98BADCFE;
-	D = 0x10325476;
-
-	for (i = 0; i < len; i++)
-	{
-		for (j = 0; j < 16; j++)
-		{
-			X[j] = ((ptr[0] << 0) | (ptr[1] << 8) |
-					(ptr[2] << 16) | (ptr[3] << 24));
-
-			ptr += 4;
-		}
-
-		DoMD4();
-	}
-
-	i = rem / 4;
-
-	for (j = 0; j < i; j++)
-	{
-		X[j] = ((ptr[0] << 0) | (ptr[1] << 8) |
-				(ptr[2] << 16) | (ptr[3] << 24));
-
-		ptr += 4;
-	}
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
 
-	switch (rem % 4)
-	{
-		case 0:
-			X[j] = 0x80U;
-			break;
-		case 1:
-			X[j] = ((ptr[0] << 0) | ((0x80U) << 8));
-			break;
-		case 2:
-			X[j] = ((ptr[0] << 0) | (ptr[1] << 8) | ((0x80U) << 16));
-			break;
-		case 3:
-			X[j] =
-				((ptr[0] <<
-				  0) | (ptr[1] << 8) | (ptr[2] << 16) | ((0x80U) << 24));
-			break;
-	}
+	for (rem = length; rem >= 64; rem -= 64, ptr += 64)
+		DoMD4(state, ptr);
 
-	j++;
+	/* the left over bytes, the 0x80 marker and the bit length, in one block or two */
+	tail_length = (rem < 56) ? 64 : 128;
 
-	if (j > 14)
-	{
-		for ( ; j < 16; j++)
-		{
-			X[j] = 0;
-		}
+	memcpy(tail, ptr, rem);
+	tail[rem] = 0x80;
+	memset(tail + rem + 1, 0, tail_length - rem - 1);
 
-		DoMD4();
+	tail[tail_length - 8] = (uint8_t)((uint32_t)length << 3);
+	tail[tail_length - 7] = (uint8_t)((uint32_t)length >> 5);
+	tail[tail_length - 6] = (uint8_t)((uint32_t)length >> 13);
+	tail[tail_length - 5] = (uint8_t)((uint32_t)length >> 21);
+	tail[tail_length - 4] = (uint8_t)((uint32_t)length >> 29);
 
-		j = 0;
-	}
+	DoMD4(state, tail);
 
-	for ( ; j < 14; j++)
-	{
-		X[j] = 0;
-	}
+	if (tail_length == 128)
+		DoMD4(state, tail + 64);
 
-	X[14] = (length & 0x1FFFFFFF) << 3;
-	X[15] = (length & ~0x1FFFFFFF) >> 29;
-
-	DoMD4();
-
-	digest[0] = (A & 0x000000FF) >> 0;
-	digest[1] = (A & 0x0000FF00) >> 8;
-	digest[2] = (A & 0x00FF0000) >> 16;
-	digest[3] = (A & 0xFF000000) >> 24;
-	digest[4] = (B & 0x000000FF) >> 0;
-	digest[5] = (B & 0x0000FF00) >> 8;
-	digest[6] = (B & 0x00FF0000) >> 16;
-	digest[7] = (B & 0xFF000000) >> 24;
-	digest[8] = (C & 0x000000FF) >> 0;
-	digest[9] = (C & 0x0000FF00) >> 8;
-	digest[10] = (C & 0x00FF0000) >> 16;
-	digest[11] = (C & 0xFF000000) >> 24;
-	digest[12] = (D & 0x000000FF) >> 0;
-	digest[13] = (D & 0x0000FF00) >> 8;
-	digest[14] = (D & 0x00FF0000) >> 16;
-	digest[15] = (D & 0xFF000000) >> 24;
-
-	A = AA = 0;
-	B = BB = 0;
-	C = CC = 0;
-	D = DD = 0;
-
-	for (j = 0; j < 16; j++)
+	for (j = 0; j < 4; j++)
 	{
-		X[j] = 0;
+		digest[j * 4 + 0] = (state[j] & 0x000000FF) >> 0;
+		digest[j * 4 + 1] = (state[j] & 0x0000FF00) >> 8;
+		digest[j * 4 + 2] = (state[j] & 0x00FF0000) >> 16;
+		digest[j * 4 + 3] = (state[j] & 0xFF000000) >> 24;
 	}
 }
 
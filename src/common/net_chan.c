@@ -71,11 +71,46 @@ If there is no information that needs to be transfered on a given frame,
 such as during the connection stage while waiting for the client to load,
 then a packet only needs to be delivered if there is something in the
 unacknowledged reliable
+
+windowed reliable stream
+------------------------
+If both sides offer NETCHAN_FLAG_WINDOW in the connect handshake, the single
+even/odd reliable message is replaced by a stream of numbered fragments of at
+most NETCHAN_FRAGMENT_SIZE bytes. Up to NETCHAN_WINDOW fragments can be in
+flight at once, so a burst of reliable data (such as the signon) no longer
+waits a full round trip per message. The reliable message buffer is split
+into fragments every transmit, so queued reliable data is no longer limited
+to a single MAX_MSGLEN message waiting for an ack.
+
+After the packet header (and qport), every packet carries a 16 bit count of
+the next fragment expected from the remote side, which acknowledges every
+fragment before it. If the reliable bit is set, a fragment count byte
+follows, then each fragment as
+
+16	fragment sequence
+15	length
+1	last fragment of a reliable message
+
+The receiver only accepts the fragment it expects next; anything after a gap
+is dropped and the sender goes back and resends every fragment from the first
+one the remote side has not acknowledged, once a packet sent after it has
+been acknowledged. Completed reliable messages are placed in front of the
+unreliable part of the packet, so the receiver reads the payload exactly as
+it would without the window.
+
+compression
+-----------
+If both sides offer NETCHAN_FLAG_COMPRESS, everything after the sequence
+numbers and qport is huffman coded with the static model in huffman.c. A 16
+bit word follows the qport: 15 bits of uncompressed length, and a flag set
+if the payload is compressed. Payloads that don't get smaller are sent as is.
 */
 
 cvar_t*	showpackets;
 cvar_t*	showdrop;
 cvar_t*	qport;
+cvar_t*	net_reliablewindow;
+cvar_t*	net_compress;
 
 netadr_t	net_from;
 sizebuf_t	net_message;
@@ -97,6 +132,30 @@ void Netchan_Init()
 	showpackets = Cvar_Get ("showpackets", "0", 0);
 	showdrop = Cvar_Get ("showdrop", "0", 0);
 	qport = Cvar_Get ("qport", va("%i", port), CVAR_NOSET);
+	net_reliablewindow = Cvar_Get ("net_reliablewindow", "1", CVAR_ARCHIVE);
+	net_compress = Cvar_Get ("net_compress", "0", CVAR_ARCHIVE);
+
+	Huffman_Init ();
+}
+
+/*
+===============
+Netchan_SupportedFlags
+
+Returns the NETCHAN_FLAG_* capabilities this side offers in the connect handshake
+================
+*/
+int32_t Netchan_SupportedFlags()
+{
+	int32_t flags = 0;
+
+	if (net_reliablewindow->value)
+		flags |= NETCHAN_FLAG_WINDOW;
+
+	if (net_compress->value)
+		flags |= NETCHAN_FLAG_COMPRESS;
+
+	return flags;
 }
 
 /*
@@ -148,11 +207,12 @@ Netchan_Setup
 called to open a channel to a remote system
 ==============
 */
-void Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int32_t qport)
+void Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int32_t qport, int32_t flags)
 {
 	memset (chan, 0, sizeof(*chan));
 	
 	chan->sock = sock;
+	chan->flags = flags;
 	chan->remote_address = adr;
 	chan->qport = qport;
 	chan->last_received = curtime;
@@ -173,16 +233,54 @@ Returns true if the last reliable message has acked
 */
 bool Netchan_CanReliable (netchan_t *chan)
 {
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
+		return (uint16_t)(chan->fragment_sequence - chan->fragment_acknowledged) 
+			+ (sizeof(chan->message_buf) + NETCHAN_FRAGMENT_SIZE - 1) / NETCHAN_FRAGMENT_SIZE <= NETCHAN_QUEUE;
+
 	if (chan->reliable_length)
 		return false;			// waiting for ack
 	return true;
 }
 
+/*
+===============
+Netchan_FragmentLost
+
+Returns true if a packet sent after the fragment was sent has been acknowledged,
+but the fragment itself hasn't been
+================
+*/
+static bool Netchan_FragmentLost (netchan_t *chan, netchan_fragment_t *frag)
+{
+	return frag->sent_sequence
+		&& chan->incoming_acknowledged >= frag->sent_sequence;
+}
 
 bool Netchan_NeedReliable (netchan_t *chan)
 {
 	bool send_reliable;
 
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
+	{
+		uint16_t	seq;
+		netchan_fragment_t* frag;
+
+		if (chan->message.cursize && Netchan_CanReliable (chan))
+			return true;
+
+		// anything in the window that was never sent or has been dropped
+		for (seq = chan->fragment_acknowledged; seq != chan->fragment_sequence
+			&& (uint16_t)(seq - chan->fragment_acknowledged) < NETCHAN_WINDOW; seq++)
+		{
+			frag = &chan->fragments[seq & (NETCHAN_QUEUE - 1)];
+
+			if (!frag->sent_sequence || Netchan_FragmentLost (chan, frag))
+				return true;
+		}
+
+		return false;
+	}
+
 // if the remote side dropped the last reliable message, resend it
 	send_reliable = false;
 
@@ -199,6 +297,225 @@ bool Netchan_NeedReliable (netchan_t *chan)
 	return send_reliable;
 }
 
+/*
+===============
+Netchan_NeedTransmit
+
+Returns true if there is reliable data to send, or the remote side is owed an
+acknowledgement for reliable fragments, so a packet should go out even when
+there is nothing else to send
+================
+*/
+bool Netchan_NeedTransmit (netchan_t *chan)
+{
+	if (chan->message.cursize)
+		return true;
+
+	if (chan->fragment_ack_pending)
+		return true;
+
+	return Netchan_NeedReliable (chan);
+}
+
+/*
+===============
+Netchan_QueueFragments
+
+Splits the reliable message buffer into fragments if there is room for all of them
+================
+*/
+static void Netchan_QueueFragments (netchan_t *chan)
+{
+	netchan_fragment_t* frag;
+	int32_t 	offset;
+	int32_t 	length;
+
+	if (!chan->message.cursize)
+		return;
+
+	// keep accumulating into the message buffer until enough fragments have been acknowledged
+	if (!Netchan_CanReliable (chan))
+		return;
+
+	for (offset = 0; offset < chan->message.cursize; offset += length)
+	{
+		length = chan->message.cursize - offset;
+
+		if (length > NETCHAN_FRAGMENT_SIZE)
+			length = NETCHAN_FRAGMENT_SIZE;
+
+		frag = &chan->fragments[chan->fragment_sequence & (NETCHAN_QUEUE - 1)];
+		frag->sequence = chan->fragment_sequence++;
+		frag->length = length;
+		frag->last = (offset + length == chan->message.cursize);
+		frag->sent_sequence = 0;
+		memcpy (frag->data, chan->message_buf + offset, length);
+	}
+
+	chan->message.cursize = 0;
+}
+
+/*
+===============
+Netchan_CheckFragmentLoss
+
+Goes back to the first dropped fragment, so it and everything sent after it
+are sent again. The remote side drops anything after a gap.
+================
+*/
+static void Netchan_CheckFragmentLoss (netchan_t *chan)
+{
+	uint16_t	seq;
+	netchan_fragment_t* frag;
+
+	for (seq = chan->fragment_acknowledged; seq != chan->fragment_sequence; seq++)
+	{
+		frag = &chan->fragments[seq & (NETCHAN_QUEUE - 1)];
+
+		if (!Netchan_FragmentLost (chan, frag))
+			continue;
+
+		if (showdrop->value)
+			Com_Printf ("%s:Resending reliable fragments %i-%i\n"
+				, Net_AdrToString (chan->remote_address)
+				, seq
+				, (uint16_t)(chan->fragment_sequence - 1));
+
+		for (; seq != chan->fragment_sequence; seq++)
+			chan->fragments[seq & (NETCHAN_QUEUE - 1)].sent_sequence = 0;
+
+		return;
+	}
+}
+
+/*
+===============
+Netchan_WriteFragments
+
+Writes as many unsent fragments in the window as fit, leaving room for the
+unreliable part. Stops after the end of a reliable message, so the remote
+side never completes more than one message per packet.
+================
+*/
+static void Netchan_WriteFragments (netchan_t *chan, sizebuf_t *send, int32_t length, int32_t sequence)
+{
+	uint16_t	seq;
+	netchan_fragment_t* frag;
+	int32_t 	count_offset;
+	int32_t 	count = 0;
+
+	count_offset = send->cursize;
+	MSG_WriteByte (send, 0);
+
+	for (seq = chan->fragment_acknowledged; seq != chan->fragment_sequence
+		&& (uint16_t)(seq - chan->fragment_acknowledged) < NETCHAN_WINDOW; seq++)
+	{
+		frag = &chan->fragments[seq & (NETCHAN_QUEUE - 1)];
+
+		if (frag->sent_sequence)
+			continue;
+
+		if (count 
+			&& send->cursize + 4 + frag->length + length > send->maxsize)
+			break;
+
+		MSG_WriteShort (send, frag->sequence);
+		MSG_WriteShort (send, frag->length | (frag->last ? 0x8000 : 0));
+		SZ_Write (send, frag->data, frag->length);
+		frag->sent_sequence = sequence;
+		count++;
+
+		if (frag->last)
+			break;
+	}
+
+	send->data[count_offset] = count;
+}
+
+/*
+===============
+Netchan_Compress
+
+Huffman codes everything in send after the first header_length bytes
+================
+*/
+static void Netchan_Compress (sizebuf_t *send, int32_t header_length)
+{
+	uint8_t		packed[MAX_MSGLEN];
+	int32_t 	length, packed_length;
+
+	length = send->cursize - header_length;
+	packed_length = Huffman_Compress (send->data + header_length, length, packed, length);
+
+	if (packed_length < 0)
+	{
+		// no smaller, send it as is behind the length
+		memmove (send->data + header_length + 2, send->data + header_length, length);
+		send->data[header_length] = length & 0xff;
+		send->data[header_length + 1] = length >> 8;
+		send->cursize += 2;
+		return;
+	}
+
+	send->data[header_length] = length & 0xff;
+	send->data[header_length + 1] = (length >> 8) | 0x80;
+	memcpy (send->data + header_length + 2, packed, packed_length);
+	send->cursize = header_length + 2 + packed_length;
+}
+
+/*
+===============
+Netchan_Decompress
+
+Expands the payload of msg in place, from the current read position
+================
+*/
+static bool Netchan_Decompress (netchan_t *chan, sizebuf_t *msg)
+{
+	uint8_t		unpacked[MAX_MSGLEN];
+	int32_t 	header_length;
+	int32_t 	info, length;
+
+	header_length = msg->readcount;
+	info = MSG_ReadShort (msg) & 0xffff;
+	length = info & 0x7fff;
+
+	if (msg->readcount > msg->cursize
+		|| header_length + length > msg->maxsize)
+	{
+		Com_Printf ("%s:Bad compressed packet\n"
+			, Net_AdrToString (chan->remote_address));
+		return false;
+	}
+
+	if (info & 0x8000)
+	{
+		if (Huffman_Decompress (msg->data + msg->readcount, msg->cursize - msg->readcount, unpacked, length) != length)
+		{
+			Com_Printf ("%s:Bad compressed packet\n"
+				, Net_AdrToString (chan->remote_address));
+			return false;
+		}
+
+		memcpy (msg->data + header_length, unpacked, length);
+	}
+	else
+	{
+		if (msg->readcount + length > msg->cursize)
+		{
+			Com_Printf ("%s:Bad compressed packet\n"
+				, Net_AdrToString (chan->remote_address));
+			return false;
+		}
+
+		memmove (msg->data + header_length, msg->data + msg->readcount, length);
+	}
+
+	msg->cursize = header_length + length;
+	msg->readcount = header_length;
+	return true;
+}
+
 /*
 ===============
 Netchan_Transmit
@@ -215,6 +532,7 @@ void Netchan_Transmit (netchan_t *chan, int32_t length, uint8_t *data)
 	uint8_t		send_buf[MAX_MSGLEN];
 	bool	send_reliable;
 	uint32_t	w1, w2;
+	int32_t 	header_length;
 
 // check for message overflow
 	if (chan->message.overflowed)
@@ -225,19 +543,27 @@ void Netchan_Transmit (netchan_t *chan, int32_t length, uint8_t *data)
 		return;
 	}
 
-	send_reliable = Netchan_NeedReliable (chan);
-
-	if (!chan->reliable_length && chan->message.cursize)
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
 	{
-		memcpy (chan->reliable_buf, chan->message_buf, chan->message.cursize);
-		chan->reliable_length = chan->message.cursize;
-		chan->message.cursize = 0;
-		chan->reliable_sequence ^= 1;
+		Netchan_CheckFragmentLoss (chan);
+		Netchan_QueueFragments (chan);
+		send_reliable = Netchan_NeedReliable (chan);
+	}
+	else
+	{
+		send_reliable = Netchan_NeedReliable (chan);
+
+		if (!chan->reliable_length && chan->message.cursize)
+		{
+			memcpy (chan->reliable_buf, chan->message_buf, chan->message.cursize);
+			chan->reliable_length = chan->message.cursize;
+			chan->message.cursize = 0;
+			chan->reliable_sequence ^= 1;
+		}
 	}
 
-
-// write the packet header
-	SZ_Init (&send, send_buf, sizeof(send_buf));
+// write the packet header, leaving room for the length of a compressed payload
+	SZ_Init (&send, send_buf, sizeof(send_buf) - ((chan->flags & NETCHAN_FLAG_COMPRESS) ? 2 : 0));
 
 	w1 = ( chan->outgoing_sequence & ~(1<<31) ) | (send_reliable<<31);
 	w2 = ( chan->incoming_sequence & ~(1<<31) ) | (chan->incoming_reliable_sequence<<31);
@@ -250,10 +576,21 @@ void Netchan_Transmit (netchan_t *chan, int32_t length, uint8_t *data)
 
 	// send the qport if we are a client
 	if (chan->sock == NS_CLIENT)
-		MSG_WriteShort (&send, qport->value);
+		MSG_WriteShort (&send, chan->qport);
+
+	header_length = send.cursize;
+
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
+	{
+		// acknowledge every fragment received so far
+		MSG_WriteShort (&send, chan->incoming_fragment_sequence);
+		chan->fragment_ack_pending = false;
 
+		if (send_reliable)
+			Netchan_WriteFragments (chan, &send, length, chan->outgoing_sequence - 1);
+	}
 // copy the reliable message to the packet first
-	if (send_reliable)
+	else if (send_reliable)
 	{
 		SZ_Write (&send, chan->reliable_buf, chan->reliable_length);
 		chan->last_reliable_sequence = chan->outgoing_sequence;
@@ -265,12 +602,25 @@ void Netchan_Transmit (netchan_t *chan, int32_t length, uint8_t *data)
 	else
 		Com_Printf ("Netchan_Transmit: dumped unreliable\n");
 
+	if (chan->flags & NETCHAN_FLAG_COMPRESS)
+		Netchan_Compress (&send, header_length);
+
 // send the datagram
+	TIMELINE_BEGIN("Net_SendPacket");
 	Net_SendPacket (chan->sock, send.cursize, send.data, chan->remote_address);
+	TIMELINE_END();
 
 	if (showpackets->value)
 	{
-		if (send_reliable)
+		if (chan->flags & NETCHAN_FLAG_WINDOW)
+			Com_Printf ("send %4i : s=%i frag=%i-%i ack=%i fack=%i\n"
+				, send.cursize
+				, chan->outgoing_sequence - 1
+				, chan->fragment_acknowledged
+				, chan->fragment_sequence
+				, chan->incoming_sequence
+				, chan->incoming_fragment_sequence);
+		else if (send_reliable)
 			Com_Printf ("send %4i : s=%i reliable=%i ack=%i rack=%i\n"
 				, send.cursize
 				, chan->outgoing_sequence - 1
@@ -286,6 +636,99 @@ void Netchan_Transmit (netchan_t *chan, int32_t length, uint8_t *data)
 	}
 }
 
+/*
+=================
+Netchan_ReadFragments
+
+Reassembles the reliable fragments in a packet and rewrites msg so that any
+completed reliable messages are followed by the unreliable part
+=================
+*/
+static bool Netchan_ReadFragments (netchan_t *chan, sizebuf_t *msg)
+{
+	uint8_t		delivered[MAX_MSGLEN];
+	int32_t 	delivered_length = 0;
+	int32_t 	count, i;
+	uint16_t	seq;
+	int32_t 	info, length;
+	int32_t 	unreliable_length;
+	uint8_t*	data;
+
+	count = MSG_ReadByte (msg);
+
+	for (i = 0; i < count; i++)
+	{
+		seq = MSG_ReadShort (msg) & 0xffff;
+		info = MSG_ReadShort (msg) & 0xffff;
+		length = info & 0x7fff;
+
+		if (msg->readcount > msg->cursize
+			|| length > NETCHAN_FRAGMENT_SIZE
+			|| msg->readcount + length > msg->cursize)
+		{
+			Com_Printf ("%s:Bad reliable fragment\n"
+				, Net_AdrToString (chan->remote_address));
+			return false;
+		}
+
+		data = msg->data + msg->readcount;
+		msg->readcount += length;
+
+		// a duplicate, or after a gap - the remote side will resend it
+		if (seq != chan->incoming_fragment_sequence)
+			continue;
+
+		if (chan->fragment_length + length > sizeof(chan->fragment_buf))
+		{
+			chan->fatal_error = true;
+			Com_Printf ("%s:Incoming reliable message overflow\n"
+				, Net_AdrToString (chan->remote_address));
+			return false;
+		}
+
+		memcpy (chan->fragment_buf + chan->fragment_length, data, length);
+		chan->fragment_length += length;
+		chan->incoming_fragment_sequence++;
+
+		if (info & 0x8000)
+		{
+			if (delivered_length + chan->fragment_length > sizeof(delivered))
+			{
+				chan->fatal_error = true;
+				Com_Printf ("%s:Incoming reliable message overflow\n"
+					, Net_AdrToString (chan->remote_address));
+				return false;
+			}
+
+			memcpy (delivered + delivered_length, chan->fragment_buf, chan->fragment_length);
+			delivered_length += chan->fragment_length;
+			chan->fragment_length = 0;
+		}
+	}
+
+	chan->fragment_ack_pending = true;
+
+	unreliable_length = msg->cursize - msg->readcount;
+
+	if (delivered_length + unreliable_length > msg->maxsize)
+	{
+		if (showdrop->value)
+			Com_Printf ("%s:Dropped unreliable behind reliable message\n"
+				, Net_AdrToString (chan->remote_address));
+
+		unreliable_length = 0;
+	}
+
+	memmove (msg->data + delivered_length, msg->data + msg->readcount, unreliable_length);
+	memcpy (msg->data, delivered, delivered_length);
+	msg->cursize = delivered_length + unreliable_length;
+	msg->readcount = 0;
+	msg->readbit = 0;
+	chan->incoming_reliable_length = delivered_length;
+
+	return true;
+}
+
 /*
 =================
 Netchan_Process
@@ -298,6 +741,7 @@ bool Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 {
 	uint32_t	sequence, sequence_ack;
 	uint32_t	reliable_ack, reliable_message;
+	uint16_t	fragment_ack = 0;
 	int32_t 		qport;
 
 // get sequence numbers		
@@ -309,6 +753,13 @@ bool Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 	if (chan->sock == NS_SERVER)
 		qport = MSG_ReadShort (msg);
 
+	if ((chan->flags & NETCHAN_FLAG_COMPRESS)
+		&& !Netchan_Decompress (chan, msg))
+		return false;
+
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
+		fragment_ack = MSG_ReadShort (msg) & 0xffff;
+
 	reliable_message = sequence >> 31;
 	reliable_ack = sequence_ack >> 31;
 
@@ -345,6 +796,25 @@ bool Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 		return false;
 	}
 
+	if (chan->flags & NETCHAN_FLAG_WINDOW)
+	{
+		// the remote side has every fragment before fragment_ack
+		if ((uint16_t)(fragment_ack - chan->fragment_acknowledged) 
+			<= (uint16_t)(chan->fragment_sequence - chan->fragment_acknowledged))
+			chan->fragment_acknowledged = fragment_ack;
+
+		chan->incoming_sequence = sequence;
+		chan->incoming_acknowledged = sequence_ack;
+		chan->last_received = curtime;
+		chan->incoming_reliable_length = 0;
+
+		if (reliable_message && !Netchan_ReadFragments (chan, msg))
+			return false;
+
+		chan->incoming_payload = msg->readcount;
+		return true;
+	}
+
 //
 // if the current outgoing reliable message has been acknowledged
 // clear the buffer to make way for the next
@@ -367,6 +837,7 @@ bool Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 // the message can now be read from the current message pointer
 //
 	chan->last_received = curtime;
+	chan->incoming_payload = msg->readcount;
 
 	return true;
 }
@@ -26,6 +26,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // all of the locals will be zeroed before each
 // pmove, just to make damn sure we don't have
 // any differences when running on client or server
+//
+// they live on Player_Move's stack and are passed down with the pmove_t,
+// so several players can be moved at once on different threads
 
 typedef struct
 {
@@ -42,10 +45,10 @@ typedef struct
 
 	vec3_t		previous_origin;
 	bool	ladder;
+
+	int32_t 	snap_scale;		// 1 << the fractional coordinate bits the state is kept at, 0 for full precision
 } pml_t;
 
-pmove_t* pm;
-pml_t		pml;
 
 // DEFAULT PHYSICS PARAMETERS
 // OVERRIDABLE BY SERVER
@@ -105,7 +108,7 @@ Does not modify any world state?
 */
 #define	MIN_STEP_NORMAL	0.7		// can't step up onto very steep slopes
 #define	MAX_CLIP_PLANES	5
-void PM_StepSlideMove_()
+void PM_StepSlideMove_(pmove_t* pm, pml_t* pml)
 {
 	int32_t 		bumpcount, numbumps;
 	vec3_t		dir;
@@ -120,27 +123,27 @@ void PM_StepSlideMove_()
 
 	numbumps = 4;
 
-	VectorCopy3(pml.velocity, primal_velocity);
+	VectorCopy3(pml->velocity, primal_velocity);
 	numplanes = 0;
 
-	time_left = pml.frametime;
+	time_left = pml->frametime;
 
 	for (bumpcount = 0; bumpcount < numbumps; bumpcount++)
 	{
 		for (i = 0; i < 3; i++)
-			end[i] = pml.origin[i] + time_left * pml.velocity[i];
+			end[i] = pml->origin[i] + time_left * pml->velocity[i];
 
-		trace = pm->trace(pml.origin, pm->mins, pm->maxs, end);
+		trace = pm->trace(pml->origin, pm->mins, pm->maxs, end);
 
 		if (trace.allsolid)
 		{	// entity is trapped in another solid
-			pml.velocity[2] = 0;	// don't build up falling damage
+			pml->velocity[2] = 0;	// don't build up falling damage
 			return;
 		}
 
 		if (trace.fraction > 0)
 		{	// actually covered some distance
-			VectorCopy3(trace.endpos, pml.origin);
+			VectorCopy3(trace.endpos, pml->origin);
 			numplanes = 0;
 		}
 
@@ -159,7 +162,7 @@ void PM_StepSlideMove_()
 		// slide along this plane
 		if (numplanes >= MAX_CLIP_PLANES)
 		{	// this shouldn't really happen
-			VectorCopy3(vec3_origin, pml.velocity);
+			VectorCopy3(vec3_origin, pml->velocity);
 			break;
 		}
 
@@ -171,11 +174,11 @@ void PM_StepSlideMove_()
 		//
 		for (i = 0; i < numplanes; i++)
 		{
-			PM_ClipVelocity(pml.velocity, planes[i], pml.velocity, 1.01);
+			PM_ClipVelocity(pml->velocity, planes[i], pml->velocity, 1.01);
 			for (j = 0; j < numplanes; j++)
 				if (j != i)
 				{
-					if (DotProduct3(pml.velocity, planes[j]) < 0)
+					if (DotProduct3(pml->velocity, planes[j]) < 0)
 						break;	// not ok
 				}
 			if (j == numplanes)
@@ -190,28 +193,28 @@ void PM_StepSlideMove_()
 			if (numplanes != 2)
 			{
 				//				Con_Printf ("clip velocity, numplanes == %i\n",numplanes);
-				VectorCopy3(vec3_origin, pml.velocity);
+				VectorCopy3(vec3_origin, pml->velocity);
 				break;
 			}
 			VectorCrossProduct(planes[0], planes[1], dir);
-			d = DotProduct3(dir, pml.velocity);
-			VectorScale3(dir, d, pml.velocity);
+			d = DotProduct3(dir, pml->velocity);
+			VectorScale3(dir, d, pml->velocity);
 		}
 
 		//
 		// if velocity is against the original velocity, stop dead
 		// to avoid tiny occilations in sloping corners
 		//
-		if (DotProduct3(pml.velocity, primal_velocity) <= 0)
+		if (DotProduct3(pml->velocity, primal_velocity) <= 0)
 		{
-			VectorCopy3(vec3_origin, pml.velocity);
+			VectorCopy3(vec3_origin, pml->velocity);
 			break;
 		}
 	}
 
 	if (pm->s.pm_time)
 	{
-		VectorCopy3(primal_velocity, pml.velocity);
+		VectorCopy3(primal_velocity, pml->velocity);
 	}
 }
 
@@ -221,7 +224,7 @@ PM_StepSlideMove
 
 ==================
 */
-void PM_StepSlideMove()
+void PM_StepSlideMove(pmove_t* pm, pml_t* pml)
 {
 	vec3_t		start_o, start_v;
 	vec3_t		down_o, down_v;
@@ -230,13 +233,13 @@ void PM_StepSlideMove()
 	//	vec3_t		delta;
 	vec3_t		up, down;
 
-	VectorCopy3(pml.origin, start_o);
-	VectorCopy3(pml.velocity, start_v);
+	VectorCopy3(pml->origin, start_o);
+	VectorCopy3(pml->velocity, start_v);
 
-	PM_StepSlideMove_();
+	PM_StepSlideMove_(pm, pml);
 
-	VectorCopy3(pml.origin, down_o);
-	VectorCopy3(pml.velocity, down_v);
+	VectorCopy3(pml->origin, down_o);
+	VectorCopy3(pml->velocity, down_v);
 
 	VectorCopy3(start_o, up);
 	up[2] += STEPSIZE;
@@ -246,21 +249,21 @@ void PM_StepSlideMove()
 		return;		// can't step up
 
 	// try sliding above
-	VectorCopy3(up, pml.origin);
-	VectorCopy3(start_v, pml.velocity);
+	VectorCopy3(up, pml->origin);
+	VectorCopy3(start_v, pml->velocity);
 
-	PM_StepSlideMove_();
+	PM_StepSlideMove_(pm, pml);
 
 	// push down the final amount
-	VectorCopy3(pml.origin, down);
+	VectorCopy3(pml->origin, down);
 	down[2] -= STEPSIZE;
-	trace = pm->trace(pml.origin, pm->mins, pm->maxs, down);
+	trace = pm->trace(pml->origin, pm->mins, pm->maxs, down);
 	if (!trace.allsolid)
 	{
-		VectorCopy3(trace.endpos, pml.origin);
+		VectorCopy3(trace.endpos, pml->origin);
 	}
 
-	VectorCopy3(pml.origin, up);
+	VectorCopy3(pml->origin, up);
 
 	// decide which one went farther
 	down_dist = (down_o[0] - start_o[0]) * (down_o[0] - start_o[0])
@@ -270,13 +273,13 @@ void PM_StepSlideMove()
 
 	if (down_dist > up_dist || trace.plane.normal[2] < MIN_STEP_NORMAL)
 	{
-		VectorCopy3(down_o, pml.origin);
-		VectorCopy3(down_v, pml.velocity);
+		VectorCopy3(down_o, pml->origin);
+		VectorCopy3(down_v, pml->velocity);
 		return;
 	}
 	//!! Special case
 	// if we were walking along a plane, then we need to copy the Z over
-	pml.velocity[2] = down_v[2];
+	pml->velocity[2] = down_v[2];
 }
 
 
@@ -287,14 +290,14 @@ PM_Friction
 Handles both ground friction and water friction
 ==================
 */
-void PM_Friction()
+void PM_Friction(pmove_t* pm, pml_t* pml)
 {
 	float* vel;
 	float speed, newspeed, control;
 	float friction;
 	float drop;
 
-	vel = pml.velocity;
+	vel = pml->velocity;
 
 	speed = sqrt(vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2]);
 	if (speed < 1)
@@ -307,16 +310,16 @@ void PM_Friction()
 	drop = 0;
 
 	// apply ground friction
-	if ((pm->groundentity && pml.groundsurface && !(pml.groundsurface->flags & SURF_SLICK)) || (pml.ladder))
+	if ((pm->groundentity && pml->groundsurface && !(pml->groundsurface->flags & SURF_SLICK)) || (pml->ladder))
 	{
 		friction = phys_friction;
 		control = speed < phys_stopspeed ? phys_stopspeed : speed;
-		drop += control * friction * pml.frametime;
+		drop += control * friction * pml->frametime;
 	}
 
 	// apply water friction
-	if (pm->waterlevel && !pml.ladder)
-		drop += speed * phys_waterfriction * pm->waterlevel * pml.frametime;
+	if (pm->waterlevel && !pml->ladder)
+		drop += speed * phys_waterfriction * pm->waterlevel * pml->frametime;
 
 	// scale the velocity
 	newspeed = speed - drop;
@@ -339,40 +342,40 @@ PM_Accelerate
 Handles user intended acceleration
 ==============
 */
-void PM_Accelerate(vec3_t wishdir, float wishspeed, float accel)
+void PM_Accelerate(pmove_t* pm, pml_t* pml, vec3_t wishdir, float wishspeed, float accel)
 {
 	int32_t 		i;
 	float		addspeed, accelspeed, currentspeed;
 
-	currentspeed = DotProduct3(pml.velocity, wishdir);
+	currentspeed = DotProduct3(pml->velocity, wishdir);
 	addspeed = wishspeed - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = accel * pml.frametime * wishspeed;
+	accelspeed = accel * pml->frametime * wishspeed;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 
 	for (i = 0; i < 3; i++)
-		pml.velocity[i] += accelspeed * wishdir[i];
+		pml->velocity[i] += accelspeed * wishdir[i];
 }
 
-void PM_AirAccelerate(vec3_t wishdir, float wishspeed, float accel)
+void PM_AirAccelerate(pmove_t* pm, pml_t* pml, vec3_t wishdir, float wishspeed, float accel)
 {
 	int32_t 		i;
 	float		addspeed, accelspeed, currentspeed, wishspd = wishspeed;
 
 	if (wishspd > 30)
 		wishspd = 30;
-	currentspeed = DotProduct3(pml.velocity, wishdir);
+	currentspeed = DotProduct3(pml->velocity, wishdir);
 	addspeed = wishspd - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = accel * wishspeed * pml.frametime;
+	accelspeed = accel * wishspeed * pml->frametime;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 
 	for (i = 0; i < 3; i++)
-		pml.velocity[i] += accelspeed * wishdir[i];
+		pml->velocity[i] += accelspeed * wishdir[i];
 }
 
 /*
@@ -380,7 +383,7 @@ void PM_AirAccelerate(vec3_t wishdir, float wishspeed, float accel)
 PM_AddCurrents
 =============
 */
-void PM_AddCurrents(vec3_t	wishvel)
+void PM_AddCurrents(pmove_t* pm, pml_t* pml, vec3_t	wishvel)
 {
 	vec3_t	v;
 	float	s;
@@ -389,7 +392,7 @@ void PM_AddCurrents(vec3_t	wishvel)
 	// account for ladders
 	//
 
-	if (pml.ladder && fabs(pml.velocity[2]) <= 200)
+	if (pml->ladder && fabs(pml->velocity[2]) <= 200)
 	{
 		if ((pm->viewangles[PITCH] <= -15) && (pm->cmd.forwardmove > 0))
 			wishvel[2] = 200;
@@ -451,17 +454,17 @@ void PM_AddCurrents(vec3_t	wishvel)
 	{
 		VectorClear3(v);
 
-		if (pml.groundcontents & CONTENTS_CURRENT_0)
+		if (pml->groundcontents & CONTENTS_CURRENT_0)
 			v[0] += 1;
-		if (pml.groundcontents & CONTENTS_CURRENT_90)
+		if (pml->groundcontents & CONTENTS_CURRENT_90)
 			v[1] += 1;
-		if (pml.groundcontents & CONTENTS_CURRENT_180)
+		if (pml->groundcontents & CONTENTS_CURRENT_180)
 			v[0] -= 1;
-		if (pml.groundcontents & CONTENTS_CURRENT_270)
+		if (pml->groundcontents & CONTENTS_CURRENT_270)
 			v[1] -= 1;
-		if (pml.groundcontents & CONTENTS_CURRENT_UP)
+		if (pml->groundcontents & CONTENTS_CURRENT_UP)
 			v[2] += 1;
-		if (pml.groundcontents & CONTENTS_CURRENT_DOWN)
+		if (pml->groundcontents & CONTENTS_CURRENT_DOWN)
 			v[2] -= 1;
 
 		VectorMA3(wishvel, 100 /* pm->groundentity->speed */, v, wishvel);
@@ -475,7 +478,7 @@ PM_WaterMove
 
 ===================
 */
-void PM_WaterMove()
+void PM_WaterMove(pmove_t* pm, pml_t* pml)
 {
 	int32_t 	i;
 	vec3_t	wishvel;
@@ -486,14 +489,14 @@ void PM_WaterMove()
 	// user intentions
 	//
 	for (i = 0; i < 3; i++)
-		wishvel[i] = pml.forward[i] * pm->cmd.forwardmove + pml.right[i] * pm->cmd.sidemove;
+		wishvel[i] = pml->forward[i] * pm->cmd.forwardmove + pml->right[i] * pm->cmd.sidemove;
 
 	if (!pm->cmd.forwardmove && !pm->cmd.sidemove && !pm->cmd.upmove)
 		wishvel[2] -= 60;		// drift towards bottom
 	else
 		wishvel[2] += pm->cmd.upmove;
 
-	PM_AddCurrents(wishvel);
+	PM_AddCurrents(pm, pml, wishvel);
 
 	VectorCopy3(wishvel, wishdir);
 	wishspeed = VectorNormalize3(wishdir);
@@ -505,9 +508,9 @@ void PM_WaterMove()
 	}
 	wishspeed *= 0.5;
 
-	PM_Accelerate(wishdir, wishspeed, phys_wateraccelerate);
+	PM_Accelerate(pm, pml, wishdir, wishspeed, phys_wateraccelerate);
 
-	PM_StepSlideMove();
+	PM_StepSlideMove(pm, pml);
 }
 
 
@@ -517,7 +520,7 @@ PM_AirMove
 
 ===================
 */
-void PM_AirMove()
+void PM_AirMove(pmove_t* pm, pml_t* pml)
 {
 	int32_t 		i;
 	vec3_t		wishvel;
@@ -531,10 +534,10 @@ void PM_AirMove()
 
 
 	for (i = 0; i < 2; i++)
-		wishvel[i] = pml.forward[i] * fmove + pml.right[i] * smove;
+		wishvel[i] = pml->forward[i] * fmove + pml->right[i] * smove;
 	wishvel[2] = 0;
 
-	PM_AddCurrents(wishvel);
+	PM_AddCurrents(pm, pml, wishvel);
 
 	VectorCopy3(wishvel, wishdir);
 	wishspeed = VectorNormalize3(wishdir);
@@ -550,51 +553,51 @@ void PM_AirMove()
 		wishspeed = maxspeed;
 	}
 
-	if (pml.ladder)
+	if (pml->ladder)
 	{
-		PM_Accelerate(wishdir, wishspeed, phys_accelerate_player);
+		PM_Accelerate(pm, pml, wishdir, wishspeed, phys_accelerate_player);
 		if (!wishvel[2])
 		{
-			if (pml.velocity[2] > 0)
+			if (pml->velocity[2] > 0)
 			{
-				pml.velocity[2] -= pm->s.gravity * pml.frametime;
-				if (pml.velocity[2] < 0)
-					pml.velocity[2] = 0;
+				pml->velocity[2] -= pm->s.gravity * pml->frametime;
+				if (pml->velocity[2] < 0)
+					pml->velocity[2] = 0;
 			}
 			else
 			{
-				pml.velocity[2] += pm->s.gravity * pml.frametime;
-				if (pml.velocity[2] > 0)
-					pml.velocity[2] = 0;
+				pml->velocity[2] += pm->s.gravity * pml->frametime;
+				if (pml->velocity[2] > 0)
+					pml->velocity[2] = 0;
 			}
 		}
-		PM_StepSlideMove();
+		PM_StepSlideMove(pm, pml);
 	}
 	else if (pm->groundentity)
 	{	// walking on ground
-		pml.velocity[2] = 0; //!!! this is before the accel
-		PM_Accelerate(wishdir, wishspeed, phys_accelerate_player);
+		pml->velocity[2] = 0; //!!! this is before the accel
+		PM_Accelerate(pm, pml, wishdir, wishspeed, phys_accelerate_player);
 
 		// PGM	-- fix for negative trigger_gravity fields
-		//		pml.velocity[2] = 0;
+		//		pml->velocity[2] = 0;
 		if (pm->s.gravity > 0)
-			pml.velocity[2] = 0;
+			pml->velocity[2] = 0;
 		else
-			pml.velocity[2] -= pm->s.gravity * pml.frametime;
+			pml->velocity[2] -= pm->s.gravity * pml->frametime;
 
-		if (!pml.velocity[0] && !pml.velocity[1])
+		if (!pml->velocity[0] && !pml->velocity[1])
 			return;
-		PM_StepSlideMove();
+		PM_StepSlideMove(pm, pml);
 	}
 	else
 	{	// not on ground, so little effect on velocity
 		if (phys_airaccelerate)
-			PM_AirAccelerate(wishdir, wishspeed, phys_accelerate_player);
+			PM_AirAccelerate(pm, pml, wishdir, wishspeed, phys_accelerate_player);
 		else
-			PM_Accelerate(wishdir, wishspeed, 1);
+			PM_Accelerate(pm, pml, wishdir, wishspeed, 1);
 		// add gravity
-		pml.velocity[2] -= pm->s.gravity * pml.frametime;
-		PM_StepSlideMove();
+		pml->velocity[2] -= pm->s.gravity * pml->frametime;
+		PM_StepSlideMove(pm, pml);
 	}
 }
 
@@ -605,7 +608,7 @@ void PM_AirMove()
 PM_CatagorizePosition
 =============
 */
-void PM_CatagorizePosition()
+void PM_CatagorizePosition(pmove_t* pm, pml_t* pml)
 {
 	vec3_t		point;
 	int32_t 		cont;
@@ -617,20 +620,20 @@ void PM_CatagorizePosition()
 	// is on ground
 
 	// see if standing on something solid	
-	point[0] = pml.origin[0];
-	point[1] = pml.origin[1];
-	point[2] = pml.origin[2] - 0.25;
-	if (pml.velocity[2] > 180) //!!ZOID changed from 100 to 180 (ramp accel)
+	point[0] = pml->origin[0];
+	point[1] = pml->origin[1];
+	point[2] = pml->origin[2] - 0.25;
+	if (pml->velocity[2] > 180) //!!ZOID changed from 100 to 180 (ramp accel)
 	{
 		pm->s.pm_flags &= ~PMF_ON_GROUND;
 		pm->groundentity = NULL;
 	}
 	else
 	{
-		trace = pm->trace(pml.origin, pm->mins, pm->maxs, point);
-		pml.groundplane = trace.plane;
-		pml.groundsurface = trace.surface;
-		pml.groundcontents = trace.contents;
+		trace = pm->trace(pml->origin, pm->mins, pm->maxs, point);
+		pml->groundplane = trace.plane;
+		pml->groundsurface = trace.surface;
+		pml->groundcontents = trace.contents;
 
 		if (!trace.ent || (trace.plane.normal[2] < 0.7 && !trace.startsolid))
 		{
@@ -652,11 +655,11 @@ void PM_CatagorizePosition()
 			{	// just hit the ground
 				pm->s.pm_flags |= PMF_ON_GROUND;
 				// don't do landing time if we were just going down a slope
-				if (pml.velocity[2] < -200)
+				if (pml->velocity[2] < -200)
 				{
 					pm->s.pm_flags |= PMF_TIME_LAND;
 					// don't allow another jump for a little while
-					if (pml.velocity[2] < -400)
+					if (pml->velocity[2] < -400)
 						pm->s.pm_time = 25;
 					else
 						pm->s.pm_time = 18;
@@ -680,19 +683,19 @@ void PM_CatagorizePosition()
 	sample2 = pm->viewheight - pm->mins[2];
 	sample1 = sample2 / 2;
 
-	point[2] = pml.origin[2] + pm->mins[2] + 1;
+	point[2] = pml->origin[2] + pm->mins[2] + 1;
 	cont = pm->pointcontents(point);
 
 	if (cont & MASK_WATER)
 	{
 		pm->watertype = cont;
 		pm->waterlevel = 1;
-		point[2] = pml.origin[2] + pm->mins[2] + sample1;
+		point[2] = pml->origin[2] + pm->mins[2] + sample1;
 		cont = pm->pointcontents(point);
 		if (cont & MASK_WATER)
 		{
 			pm->waterlevel = 2;
-			point[2] = pml.origin[2] + pm->mins[2] + sample2;
+			point[2] = pml->origin[2] + pm->mins[2] + sample2;
 			cont = pm->pointcontents(point);
 			if (cont & MASK_WATER)
 				pm->waterlevel = 3;
@@ -710,7 +713,7 @@ void PM_CatagorizePosition()
 PM_CheckJump
 =============
 */
-void PM_CheckJump()
+void PM_CheckJump(pmove_t* pm, pml_t* pml)
 {
 	if (pm->s.pm_flags & PMF_TIME_LAND)
 	{	// hasn't been long enough since landing to jump again
@@ -734,15 +737,15 @@ void PM_CheckJump()
 	{	// swimming, not jumping
 		pm->groundentity = NULL;
 
-		if (pml.velocity[2] <= -300)
+		if (pml->velocity[2] <= -300)
 			return;
 
 		if (pm->watertype == CONTENTS_WATER)
-			pml.velocity[2] = WATER_VELOCITY;
+			pml->velocity[2] = WATER_VELOCITY;
 		else if (pm->watertype == CONTENTS_SLIME)
-			pml.velocity[2] = SLIME_VELOCITY;
+			pml->velocity[2] = SLIME_VELOCITY;
 		else
-			pml.velocity[2] = WATER_VELOCITY_SLOW;
+			pml->velocity[2] = WATER_VELOCITY_SLOW;
 		return;
 	}
 
@@ -752,9 +755,9 @@ void PM_CheckJump()
 	pm->s.pm_flags |= PMF_JUMP_HELD;
 
 	pm->groundentity = NULL;
-	pml.velocity[2] += 270;
-	if (pml.velocity[2] < 270)
-		pml.velocity[2] = 270;
+	pml->velocity[2] += 270;
+	if (pml->velocity[2] < 270)
+		pml->velocity[2] = 270;
 }
 
 
@@ -763,7 +766,7 @@ void PM_CheckJump()
 PM_CheckSpecialMovement
 =============
 */
-void PM_CheckSpecialMovement()
+void PM_CheckSpecialMovement(pmove_t* pm, pml_t* pml)
 {
 	vec3_t	spot;
 	int32_t 	cont;
@@ -773,24 +776,24 @@ void PM_CheckSpecialMovement()
 	if (pm->s.pm_time)
 		return;
 
-	pml.ladder = false;
+	pml->ladder = false;
 
 	// check for ladder
-	flatforward[0] = pml.forward[0];
-	flatforward[1] = pml.forward[1];
+	flatforward[0] = pml->forward[0];
+	flatforward[1] = pml->forward[1];
 	flatforward[2] = 0;
 	VectorNormalize3(flatforward);
 
-	VectorMA3(pml.origin, 1, flatforward, spot);
-	trace = pm->trace(pml.origin, pm->mins, pm->maxs, spot);
+	VectorMA3(pml->origin, 1, flatforward, spot);
+	trace = pm->trace(pml->origin, pm->mins, pm->maxs, spot);
 	if ((trace.fraction < 1) && (trace.contents & CONTENTS_LADDER))
-		pml.ladder = true;
+		pml->ladder = true;
 
 	// check for water jump
 	if (pm->waterlevel != 2)
 		return;
 
-	VectorMA3(pml.origin, 30, flatforward, spot);
+	VectorMA3(pml->origin, 30, flatforward, spot);
 	spot[2] += 4;
 	cont = pm->pointcontents(spot);
 	if (!(cont & CONTENTS_SOLID))
@@ -801,8 +804,8 @@ void PM_CheckSpecialMovement()
 	if (cont)
 		return;
 	// jump out of water
-	VectorScale3(flatforward, 50, pml.velocity);
-	pml.velocity[2] = 350;
+	VectorScale3(flatforward, 50, pml->velocity);
+	pml->velocity[2] = 350;
 
 	pm->s.pm_flags |= PMF_TIME_WATERJUMP;
 	pm->s.pm_time = 255;
@@ -814,7 +817,7 @@ void PM_CheckSpecialMovement()
 PM_FlyMove
 ===============
 */
-void PM_FlyMove(bool doclip)
+void PM_FlyMove(pmove_t* pm, pml_t* pml, bool doclip)
 {
 	float	speed, drop, friction, control, newspeed;
 	float	currentspeed, addspeed, accelspeed;
@@ -830,10 +833,10 @@ void PM_FlyMove(bool doclip)
 
 	// friction
 
-	speed = VectorLength3(pml.velocity);
+	speed = VectorLength3(pml->velocity);
 	if (speed < 1)
 	{
-		VectorCopy3(vec3_origin, pml.velocity);
+		VectorCopy3(vec3_origin, pml->velocity);
 	}
 	else
 	{
@@ -841,7 +844,7 @@ void PM_FlyMove(bool doclip)
 
 		friction = phys_friction * 1.5;	// extra friction
 		control = speed < phys_stopspeed ? phys_stopspeed : speed;
-		drop += control * friction * pml.frametime;
+		drop += control * friction * pml->frametime;
 
 		// scale the velocity
 		newspeed = speed - drop;
@@ -849,18 +852,18 @@ void PM_FlyMove(bool doclip)
 			newspeed = 0;
 		newspeed /= speed;
 
-		VectorScale3(pml.velocity, newspeed, pml.velocity);
+		VectorScale3(pml->velocity, newspeed, pml->velocity);
 	}
 
 	// accelerate
 	fmove = pm->cmd.forwardmove;
 	smove = pm->cmd.sidemove;
 
-	VectorNormalize3(pml.forward);
-	VectorNormalize3(pml.right);
+	VectorNormalize3(pml->forward);
+	VectorNormalize3(pml->right);
 
 	for (i = 0; i < 3; i++)
-		wishvel[i] = pml.forward[i] * fmove + pml.right[i] * smove;
+		wishvel[i] = pml->forward[i] * fmove + pml->right[i] * smove;
 	wishvel[2] += pm->cmd.upmove;
 
 	VectorCopy3(wishvel, wishdir);
@@ -876,28 +879,28 @@ void PM_FlyMove(bool doclip)
 	}
 
 
-	currentspeed = DotProduct3(pml.velocity, wishdir);
+	currentspeed = DotProduct3(pml->velocity, wishdir);
 	addspeed = wishspeed - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = phys_accelerate_player * pml.frametime * wishspeed;
+	accelspeed = phys_accelerate_player * pml->frametime * wishspeed;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 
 	for (i = 0; i < 3; i++)
-		pml.velocity[i] += accelspeed * wishdir[i];
+		pml->velocity[i] += accelspeed * wishdir[i];
 
 	if (doclip) {
 		for (i = 0; i < 3; i++)
-			end[i] = pml.origin[i] + pml.frametime * pml.velocity[i];
+			end[i] = pml->origin[i] + pml->frametime * pml->velocity[i];
 
-		trace = pm->trace(pml.origin, pm->mins, pm->maxs, end);
+		trace = pm->trace(pml->origin, pm->mins, pm->maxs, end);
 
-		VectorCopy3(trace.endpos, pml.origin);
+		VectorCopy3(trace.endpos, pml->origin);
 	}
 	else {
 		// move
-		VectorMA3(pml.origin, pml.frametime, pml.velocity, pml.origin);
+		VectorMA3(pml->origin, pml->frametime, pml->velocity, pml->origin);
 	}
 }
 
@@ -909,7 +912,7 @@ PM_CheckDuck
 Sets mins, maxs, and pm->viewheight
 ==============
 */
-void PM_CheckDuck()
+void PM_CheckDuck(pmove_t* pm, pml_t* pml)
 {
 	trace_t	trace;
 
@@ -943,7 +946,7 @@ void PM_CheckDuck()
 		{
 			// try to stand up
 			pm->maxs[2] = 32;
-			trace = pm->trace(pml.origin, pm->mins, pm->maxs, pml.origin);
+			trace = pm->trace(pml->origin, pm->mins, pm->maxs, pml->origin);
 			if (!trace.allsolid)
 				pm->s.pm_flags &= ~PMF_DUCKED;
 		}
@@ -967,7 +970,7 @@ void PM_CheckDuck()
 PM_DeadMove
 ==============
 */
-void PM_DeadMove()
+void PM_DeadMove(pmove_t* pm, pml_t* pml)
 {
 	float	forward;
 
@@ -976,21 +979,21 @@ void PM_DeadMove()
 
 	// extra friction
 
-	forward = VectorLength3(pml.velocity);
+	forward = VectorLength3(pml->velocity);
 	forward -= 20;
 	if (forward <= 0)
 	{
-		VectorClear3(pml.velocity);
+		VectorClear3(pml->velocity);
 	}
 	else
 	{
-		VectorNormalize3(pml.velocity);
-		VectorScale3(pml.velocity, forward, pml.velocity);
+		VectorNormalize3(pml->velocity);
+		VectorScale3(pml->velocity, forward, pml->velocity);
 	}
 }
 
 
-bool	PM_GoodPosition()
+bool	PM_GoodPosition(pmove_t* pm, pml_t* pml)
 {
 	trace_t	trace;
 	vec3_t	origin, end;
@@ -1006,37 +1009,62 @@ bool	PM_GoodPosition()
 	return !trace.allsolid;
 }
 
+/*
+================
+Player_MoveSnapScale
+
+The snap scale that keeps a player's origin and velocity at the precision of
+quant's coordinates, 0 for full precision when quant is NULL
+================
+*/
+int32_t Player_MoveSnapScale(msg_quantize_t* quant)
+{
+	return quant ? 1 << quant->coord_bits : 0;
+}
+
+// rounds like MSG_WritePackedCoord, so the state is exactly what gets sent
+static float PM_Snap(pml_t* pml, float f)
+{
+	if (!pml->snap_scale)
+		return f;
+
+	return floorf(f * pml->snap_scale + 0.5f) / pml->snap_scale;
+}
+
 /*
 ================
 PM_SnapPosition
 
-On exit, the origin will have a value that is pre-quantized to the 0.125
+On exit, the origin will have a value that is pre-quantized to the
 precision of the network channel and in a valid position.
 ================
 */
-void PM_SnapPosition()
+void PM_SnapPosition(pmove_t* pm, pml_t* pml)
 {
 	int32_t 	sign[3];
 	int32_t 	i, j, bits;
 	float		base[3];
+	float		step;
 	// try all single bits first
 	static int32_t jitterbits[8] = { 0,4,1,2,3,5,6,7 };
 
-	// snap velocity to eigths
 	for (i = 0; i < 3; i++)
-		pm->s.velocity[i] = (pml.velocity[i]);
+		pm->s.velocity[i] = PM_Snap(pml, pml->velocity[i]);
 
+	// if rounding puts the origin in something solid, try a step back towards where it was
 	for (i = 0; i < 3; i++)
 	{
-		if (pml.origin[i] >= 0)
+		pm->s.origin[i] = PM_Snap(pml, pml->origin[i]);
+
+		if (pm->s.origin[i] == pml->origin[i])
+			sign[i] = 0;
+		else if (pml->origin[i] > pm->s.origin[i])
 			sign[i] = 1;
 		else
 			sign[i] = -1;
-		pm->s.origin[i] = (pml.origin[i]);
-		if (pm->s.origin[i] == pml.origin[i])
-			sign[i] = 0;
 	}
 	VectorCopy3(pm->s.origin, base);
+	step = pml->snap_scale ? 1.0f / pml->snap_scale : 0;
 
 	// try all combinations
 	for (j = 0; j < 8; j++)
@@ -1045,14 +1073,14 @@ void PM_SnapPosition()
 		VectorCopy3(base, pm->s.origin);
 		for (i = 0; i < 3; i++)
 			if (bits & (1 << i))
-				pm->s.origin[i] += sign[i];
+				pm->s.origin[i] += sign[i] * step;
 
-		if (PM_GoodPosition())
+		if (PM_GoodPosition(pm, pml))
 			return;
 	}
 
 	// go back to the last position
-	VectorCopy3(pml.previous_origin, pm->s.origin);
+	VectorCopy3(pml->previous_origin, pm->s.origin);
 	//	Com_DPrintf ("using previous_origin\n");
 }
 
@@ -1062,7 +1090,7 @@ PM_InitialSnapPosition
 
 ================
 */
-void PM_InitialSnapPosition()
+void PM_InitialSnapPosition(pmove_t* pm, pml_t* pml)
 {
 	int32_t        x, y, z;
 	int16_t      base[3];
@@ -1082,12 +1110,12 @@ void PM_InitialSnapPosition()
 			{
 				pm->s.origin[0] = base[0] + offset[x];
 
-				if (PM_GoodPosition())
+				if (PM_GoodPosition(pm, pml))
 				{
-					pml.origin[0] = pm->s.origin[0];
-					pml.origin[1] = pm->s.origin[1];
-					pml.origin[2] = pm->s.origin[2];
-					VectorCopy3(pm->s.origin, pml.previous_origin);
+					pml->origin[0] = pm->s.origin[0];
+					pml->origin[1] = pm->s.origin[1];
+					pml->origin[2] = pm->s.origin[2];
+					VectorCopy3(pm->s.origin, pml->previous_origin);
 					return;
 				}
 			}
@@ -1103,7 +1131,7 @@ PM_ClampAngles
 
 ================
 */
-void PM_ClampAngles()
+void PM_ClampAngles(pmove_t* pm, pml_t* pml)
 {
 	short	temp;
 	int32_t 	i;
@@ -1129,19 +1157,21 @@ void PM_ClampAngles()
 		else if (pm->viewangles[PITCH] < 271 && pm->viewangles[PITCH] >= 180)
 			pm->viewangles[PITCH] = 271;
 	}
-	AngleVectors(pm->viewangles, pml.forward, pml.right, pml.up);
+	AngleVectors(pm->viewangles, pml->forward, pml->right, pml->up);
 }
 
 /*
 ================
-Pmove
+Player_MoveSnapped
 
-Can be called by either the server or the client
+Can be called by either the server or the client. snap_scale is from
+Player_MoveSnapScale, so the state comes out at the precision it's sent with.
 ================
 */
-void Player_Move(pmove_t* pmove)
+void Player_MoveSnapped(pmove_t* pm, int32_t snap_scale)
 {
-	pm = pmove;
+	pml_t	locals;
+	pml_t*	pml = &locals;
 
 	// clear results
 	pm->numtouch = 0;
@@ -1152,28 +1182,29 @@ void Player_Move(pmove_t* pmove)
 	pm->waterlevel = 0;
 
 	// clear all pmove local vars
-	memset(&pml, 0, sizeof(pml));
+	memset(pml, 0, sizeof(*pml));
+	pml->snap_scale = snap_scale;
 
 	// convert origin and velocity to float values
-	pml.origin[0] = pm->s.origin[0];
-	pml.origin[1] = pm->s.origin[1];
-	pml.origin[2] = pm->s.origin[2];
+	pml->origin[0] = pm->s.origin[0];
+	pml->origin[1] = pm->s.origin[1];
+	pml->origin[2] = pm->s.origin[2];
 
-	pml.velocity[0] = pm->s.velocity[0];
-	pml.velocity[1] = pm->s.velocity[1];
-	pml.velocity[2] = pm->s.velocity[2];
+	pml->velocity[0] = pm->s.velocity[0];
+	pml->velocity[1] = pm->s.velocity[1];
+	pml->velocity[2] = pm->s.velocity[2];
 
 	// save old org in case we get stuck
-	VectorCopy3(pm->s.origin, pml.previous_origin);
+	VectorCopy3(pm->s.origin, pml->previous_origin);
 
-	pml.frametime = pm->cmd.msec * 0.001f;
+	pml->frametime = pm->cmd.msec * 0.001f;
 
-	PM_ClampAngles();
+	PM_ClampAngles(pm, pml);
 
 	if (pm->s.pm_type == PM_SPECTATOR)
 	{
-		PM_FlyMove(false);
-		PM_SnapPosition();
+		PM_FlyMove(pm, pml, false);
+		PM_SnapPosition(pm, pml);
 		return;
 	}
 
@@ -1188,18 +1219,18 @@ void Player_Move(pmove_t* pmove)
 		return;		// no movement at all
 
 	// set mins, maxs, and viewheight
-	PM_CheckDuck();
+	PM_CheckDuck(pm, pml);
 
 	if (pm->snapinitial)
-		PM_InitialSnapPosition();
+		PM_InitialSnapPosition(pm, pml);
 
 	// set groundentity, watertype, and waterlevel
-	PM_CatagorizePosition();
+	PM_CatagorizePosition(pm, pml);
 
 	if (pm->s.pm_type == PM_DEAD)
-		PM_DeadMove();
+		PM_DeadMove(pm, pml);
 
-	PM_CheckSpecialMovement();
+	PM_CheckSpecialMovement(pm, pml);
 
 	// drop timing counter
 	if (pm->s.pm_time)
@@ -1223,23 +1254,23 @@ void Player_Move(pmove_t* pmove)
 	}
 	else if (pm->s.pm_flags & PMF_TIME_WATERJUMP)
 	{	// waterjump has no control, but falls
-		pml.velocity[2] -= pm->s.gravity * pml.frametime;
-		if (pml.velocity[2] < 0)
+		pml->velocity[2] -= pm->s.gravity * pml->frametime;
+		if (pml->velocity[2] < 0)
 		{	// cancel as soon as we are falling down again
 			pm->s.pm_flags &= ~(PMF_TIME_WATERJUMP | PMF_TIME_LAND | PMF_TIME_TELEPORT);
 			pm->s.pm_time = 0;
 		}
 
-		PM_StepSlideMove();
+		PM_StepSlideMove(pm, pml);
 	}
 	else
 	{
-		PM_CheckJump();
+		PM_CheckJump(pm, pml);
 
-		PM_Friction();
+		PM_Friction(pm, pml);
 
 		if (pm->waterlevel >= 2)
-			PM_WaterMove();
+			PM_WaterMove(pm, pml);
 		else {
 			vec3_t	angles;
 
@@ -1248,14 +1279,398 @@ void Player_Move(pmove_t* pmove)
 				angles[PITCH] = angles[PITCH] - 360;
 			angles[PITCH] /= 3;
 
-			AngleVectors(angles, pml.forward, pml.right, pml.up);
+			AngleVectors(angles, pml->forward, pml->right, pml->up);
 
-			PM_AirMove();
+			PM_AirMove(pm, pml);
 		}
 	}
 
 	// set groundentity, watertype, and waterlevel for final spot
-	PM_CatagorizePosition();
+	PM_CatagorizePosition(pm, pml);
+
+	PM_SnapPosition(pm, pml);
+}
+
+/*
+================
+Player_Move
+
+At full precision, for the game and anything else that doesn't send the state quantized
+================
+*/
+void Player_Move(pmove_t* pm)
+{
+	Player_MoveSnapped(pm, 0);
+}
+
+/*
+===============================================================================
+
+BATCHED MOVEMENT
+
+===============================================================================
+*/
+
+// the commands pmove_record keeps from each client, for pmove_test to replay
+typedef struct pmove_stream_s
+{
+	pmove_state_t	start;			// before the first command
+	usercmd_t*		cmds;
+	int32_t 		numcmds;
+} pmove_stream_t;
+
+static pmove_stream_t	pmove_streams[MAX_CLIENTS];
+static int32_t 			pmove_record_length;		// commands kept from each client, 0 when not recording
+
+// pmove_test puts a box near where each stream starts, so entity hulls get traced as well as the world
+#define PMOVE_TEST_BOX_OFFSET	80
+
+// every other copy of a stream is moved at the precision of sv_quantize_coordbits 3, so one batch has both
+#define PMOVE_TEST_SNAP_SCALE	(1 << 3)
+
+static vec3_t			pmove_test_boxes[MAX_CLIENTS];
+static int32_t 			pmove_test_numboxes;
+static vec3_t			pmove_test_mins = { -16, -16, -24 };
+static vec3_t			pmove_test_maxs = { 16, 16, 32 };
+
+/*
+================
+Player_MoveCommands
+
+Runs one player's commands in order through move, keeping every entity any of them touched
+================
+*/
+static void Player_MoveCommands(pmove_batch_t* batch, void (*move)(pmove_t* pm, int32_t snap_scale))
+{
+	pmove_t*		pm = batch->pm;
+	struct edict_s* touched[MAXTOUCH];
+	int32_t 		numtouched;
+	int32_t 		i, j, k;
+
+	if (batch->numcmds <= 0)
+		return;
+
+	numtouched = 0;
+
+	for (i = 0; i < batch->numcmds; i++)
+	{
+		pm->cmd = batch->cmds[i];
+		move(pm, batch->snap_scale);
+
+		// the state is pmove's own from here on
+		pm->snapinitial = false;
+
+		for (j = 0; j < pm->numtouch; j++)
+		{
+			for (k = 0; k < numtouched; k++)
+			{
+				if (touched[k] == pm->touchents[j])
+					break;
+			}
+
+			if (k == numtouched && numtouched < MAXTOUCH)
+				touched[numtouched++] = pm->touchents[j];
+		}
+	}
+
+	memcpy(pm->touchents, touched, numtouched * sizeof(touched[0]));
+	pm->numtouch = numtouched;
+}
+
+static void Player_MoveBatchJob(void* arg, int32_t start, int32_t end)
+{
+	pmove_batch_t* batch = arg;
+
+	for (; start < end; start++)
+		Player_MoveCommands(&batch[start], Player_MoveSnapped);
+}
+
+/*
+================
+Player_MoveBatch
+
+Moves each player through their queued commands, at their own snap_scale, different
+players on different job threads, with the same results as moving them one at a time. numtouch and
+touchents come back with everything touched by any of the commands.
+
+The trace and pointcontents callbacks run on several threads at once. SV_Trace,
+SV_PointContents and the Map_ queries are fine with that, as long as nothing is
+linked or unlinked before this returns.
+================
+*/
+void Player_MoveBatch(pmove_batch_t* batch, int32_t count)
+{
+	Job_ParallelFor("Player_MoveBatch", count, 1, Player_MoveBatchJob, batch);
+}
+
+/*
+================
+Player_MoveRecord
+
+The server passes every command it's about to run through here, with the state
+it'll start from. Only kept while pmove_record is on.
+================
+*/
+void Player_MoveRecord(int32_t stream, pmove_state_t* state, usercmd_t* cmd)
+{
+	pmove_stream_t* recording;
+
+	if (!pmove_record_length
+		|| stream < 0
+		|| stream >= MAX_CLIENTS)
+		return;
+
+	recording = &pmove_streams[stream];
+
+	if (!recording->cmds)
+	{
+		recording->cmds = Memory_ZoneMalloc(pmove_record_length * sizeof(usercmd_t));
+		recording->start = *state;
+	}
+
+	if (recording->numcmds < pmove_record_length)
+		recording->cmds[recording->numcmds++] = *cmd;
+}
+
+static void Player_MoveClearRecording()
+{
+	int32_t i;
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (pmove_streams[i].cmds)
+			Memory_ZoneFree(pmove_streams[i].cmds);
+	}
 
-	PM_SnapPosition();
+	memset(pmove_streams, 0, sizeof(pmove_streams));
+}
+
+/*
+================
+Player_MoveRecord_f
+
+pmove_record [commands]: keeps the next commands each client sends for pmove_test, 0 stops
+================
+*/
+static void Player_MoveRecord_f()
+{
+	Player_MoveClearRecording();
+
+	pmove_record_length = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 1000;
+
+	if (pmove_record_length <= 0)
+	{
+		pmove_record_length = 0;
+		Com_Printf("pmove_record: stopped\n");
+		return;
+	}
+
+	Com_Printf("pmove_record: keeping the next %i commands from each client\n", pmove_record_length);
+}
+
+// the world and the test boxes, like CL_PMTrace does the world and the frame's entities
+static trace_t Player_MoveTestTrace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	trace_t 	trace, box;
+	int32_t 	headnode, i;
+
+	trace = Map_BoxTrace(start, end, mins, maxs, 0, MASK_PLAYERSOLID);
+
+	if (trace.fraction < 1.0)
+		trace.ent = (struct edict_s*)1;
+
+	for (i = 0; i < pmove_test_numboxes && !trace.allsolid; i++)
+	{
+		headnode = Map_HeadnodeForBox(pmove_test_mins, pmove_test_maxs);
+		box = Map_TransformedBoxTrace(start, end, mins, maxs, headnode, MASK_PLAYERSOLID, pmove_test_boxes[i], vec3_origin);
+
+		if (box.allsolid || box.startsolid || box.fraction < trace.fraction)
+		{
+			box.ent = (struct edict_s*)(intptr_t)(i + 2);
+
+			if (trace.startsolid)
+				box.startsolid = true;
+
+			trace = box;
+		}
+	}
+
+	return trace;
+}
+
+static int32_t Player_MoveTestContents(vec3_t point)
+{
+	int32_t contents, i;
+
+	contents = Map_PointContents(point, 0);
+
+	for (i = 0; i < pmove_test_numboxes; i++)
+		contents |= Map_TransformedPointContents(point, Map_HeadnodeForBox(pmove_test_mins, pmove_test_maxs), pmove_test_boxes[i], vec3_origin);
+
+	return contents;
+}
+
+// bit for bit, floats included
+static bool Player_MoveSame(pmove_t* a, pmove_t* b)
+{
+	return a->s.pm_type == b->s.pm_type
+		&& !memcmp(a->s.origin, b->s.origin, sizeof(vec3_t))
+		&& !memcmp(a->s.velocity, b->s.velocity, sizeof(vec3_t))
+		&& a->s.pm_flags == b->s.pm_flags
+		&& a->s.pm_time == b->s.pm_time
+		&& a->s.gravity == b->s.gravity
+		&& !memcmp(a->s.delta_angles, b->s.delta_angles, sizeof(a->s.delta_angles))
+		&& a->numtouch == b->numtouch
+		&& !memcmp(a->touchents, b->touchents, a->numtouch * sizeof(a->touchents[0]))
+		&& !memcmp(a->vieworigin, b->vieworigin, sizeof(vec3_t))
+		&& !memcmp(a->viewangles, b->viewangles, sizeof(vec3_t))
+		&& !memcmp(&a->viewheight, &b->viewheight, sizeof(float))
+		&& !memcmp(a->mins, b->mins, sizeof(vec3_t))
+		&& !memcmp(a->maxs, b->maxs, sizeof(vec3_t))
+		&& a->groundentity == b->groundentity
+		&& a->watertype == b->watertype
+		&& a->waterlevel == b->waterlevel;
+}
+
+/*
+================
+Player_MoveTest_f
+
+pmove_test [copies]: replays what pmove_record kept, each client's commands copies times over,
+half of them quantized, through the old Player_Move in pmove_reference.c, then one player at a
+time and with Player_MoveBatch, and checks both come out the same as the old code
+================
+*/
+static void Player_MoveTest_f()
+{
+	pmove_t*		reference;
+	pmove_t*		serial;
+	pmove_t*		parallel;
+	pmove_batch_t*	batch;
+	pmove_batch_t	one;
+	pmove_stream_t* stream;
+	int64_t 		start, reference_time, serial_time, batch_time;
+	int32_t 		copies, players, commands, serial_differ, batch_differ;
+	int32_t 		i, j;
+
+	copies = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 16;
+
+	// at least one copy at each precision
+	if (copies < 2)
+		copies = 2;
+
+	players = 0;
+	pmove_test_numboxes = 0;
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		stream = &pmove_streams[i];
+
+		if (!stream->numcmds)
+			continue;
+
+		VectorCopy3(stream->start.origin, pmove_test_boxes[pmove_test_numboxes]);
+		pmove_test_boxes[pmove_test_numboxes][0] += PMOVE_TEST_BOX_OFFSET;
+		pmove_test_numboxes++;
+		players += copies;
+	}
+
+	if (!players)
+	{
+		Com_Printf("pmove_test: nothing recorded, use pmove_record on a server with players first\n");
+		return;
+	}
+
+	reference = Memory_ZoneMalloc(players * sizeof(pmove_t));
+	serial = Memory_ZoneMalloc(players * sizeof(pmove_t));
+	parallel = Memory_ZoneMalloc(players * sizeof(pmove_t));
+	batch = Memory_ZoneMalloc(players * sizeof(pmove_batch_t));
+
+	players = 0;
+	commands = 0;
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		stream = &pmove_streams[i];
+
+		if (!stream->numcmds)
+			continue;
+
+		for (j = 0; j < copies; j++, players++)
+		{
+			serial[players].s = stream->start;
+			serial[players].snapinitial = true;
+			serial[players].trace = Player_MoveTestTrace;
+			serial[players].pointcontents = Player_MoveTestContents;
+			reference[players] = serial[players];
+			parallel[players] = serial[players];
+
+			batch[players].pm = &parallel[players];
+			batch[players].cmds = stream->cmds;
+			batch[players].numcmds = stream->numcmds;
+			batch[players].snap_scale = (j & 1) ? PMOVE_TEST_SNAP_SCALE : 0;
+			commands += stream->numcmds;
+		}
+	}
+
+	// the reference: the old code, one player after another on this thread
+	start = Sys_Nanoseconds();
+
+	for (i = 0; i < players; i++)
+	{
+		one = batch[i];
+		one.pm = &reference[i];
+		Player_MoveCommands(&one, Player_MoveReference);
+	}
+
+	reference_time = Sys_Nanoseconds() - start;
+
+	start = Sys_Nanoseconds();
+
+	for (i = 0; i < players; i++)
+	{
+		one = batch[i];
+		one.pm = &serial[i];
+		Player_MoveCommands(&one, Player_MoveSnapped);
+	}
+
+	serial_time = Sys_Nanoseconds() - start;
+
+	start = Sys_Nanoseconds();
+	Player_MoveBatch(batch, players);
+	batch_time = Sys_Nanoseconds() - start;
+
+	serial_differ = batch_differ = 0;
+
+	for (i = 0; i < players; i++)
+	{
+		if (!Player_MoveSame(&reference[i], &serial[i]))
+			serial_differ++;
+
+		if (!Player_MoveSame(&reference[i], &parallel[i]))
+			batch_differ++;
+	}
+
+	Com_Printf("pmove_test: %i players, %i commands. Against the old Player_Move, %i differ one at a time and %i batched\n",
+		players, commands, serial_differ, batch_differ);
+	Com_Printf("%.2f ms old, %.2f ms one at a time, %.2f ms batched on %i threads\n",
+		reference_time / 1000000.0, serial_time / 1000000.0, batch_time / 1000000.0, Job_NumThreads());
+
+	pmove_test_numboxes = 0;
+
+	Memory_ZoneFree(reference);
+	Memory_ZoneFree(serial);
+	Memory_ZoneFree(parallel);
+	Memory_ZoneFree(batch);
+}
+
+/*
+================
+Player_MoveInit
+================
+*/
+void Player_MoveInit()
+{
+	Cmd_AddCommand("pmove_record", Player_MoveRecord_f);
+	Cmd_AddCommand("pmove_test", Player_MoveTest_f);
 }
@@ -0,0 +1,360 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+/* timeline.c - scoped timing zones, saved as chrome://tracing / Perfetto JSON */
+
+#include "common.h"
+
+// Code marks zones with TIMELINE_BEGIN("name") / TIMELINE_END(). Names must be
+// string literals or otherwise live forever, only the pointer is stored.
+//
+// While nothing is being captured the macros are a test of timeline_active.
+// `trace_start <seconds>` starts a capture at the next frame boundary, and
+// once the time is up the events are written to timeline/<date>.json in the
+// game directory, which loads in chrome://tracing or ui.perfetto.dev.
+//
+// Every thread has its own event buffer, so recording takes no locks. The file
+// is written from the main thread after the capture is switched off; a zone
+// another thread is in the middle of at that point may be cut short.
+//
+// Com_Error longjmps out of whatever zones the main thread is in, so it calls
+// Timeline_EndZones to close them, otherwise every later zone would be nested
+// inside the ones that never ended.
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TIMELINE_THREAD			__declspec(thread)
+#define TIMELINE_INCREMENT(x)	(_InterlockedIncrement((volatile long*)&(x)) - 1)
+#else
+#define TIMELINE_THREAD			_Thread_local
+#define TIMELINE_INCREMENT(x)	__sync_fetch_and_add(&(x), 1)
+#endif
+
+#define TIMELINE_MAX_THREADS	16
+#define TIMELINE_MAX_EVENTS		262144			// per thread, 4mb each
+#define TIMELINE_MAX_SECONDS	60
+
+typedef struct timeline_event_s
+{
+	int64_t 	time;			// Sys_Nanoseconds
+	const char* name;			// NULL for the end of a zone
+} timeline_event_t;
+
+typedef struct timeline_thread_s
+{
+	timeline_event_t* events;
+	int32_t 	num_events;
+	int32_t 	dropped;		// events past TIMELINE_MAX_EVENTS
+	int32_t 	depth;			// zones begun and not yet ended
+	int32_t 	capture;		// the capture the events belong to
+} timeline_thread_t;
+
+bool	timeline_active;
+
+static timeline_thread_t	timeline_threads[TIMELINE_MAX_THREADS];
+static volatile int32_t 	timeline_num_threads;
+static TIMELINE_THREAD timeline_thread_t* timeline_thread;		// this thread's entry in timeline_threads
+
+static int32_t 		timeline_capture;			// bumped every capture, so threads know to rewind their buffer
+static int64_t 		timeline_start;				// Sys_Nanoseconds the capture started
+static int64_t 		timeline_end;				// and will stop
+static int64_t 		timeline_pending;			// length of the capture trace_start asked for, started at the next frame
+
+/*
+==================
+Timeline_GetThread
+
+Finds this thread's buffer, creating it on the first event it records
+==================
+*/
+static timeline_thread_t* Timeline_GetThread()
+{
+	int32_t 	index;
+
+	if (!timeline_thread)
+	{
+		index = TIMELINE_INCREMENT(timeline_num_threads);
+
+		// no room, this thread stays out of the captures
+		if (index >= TIMELINE_MAX_THREADS)
+			return NULL;
+
+		timeline_thread = &timeline_threads[index];
+		timeline_thread->events = malloc(TIMELINE_MAX_EVENTS * sizeof(timeline_event_t));
+	}
+
+	if (!timeline_thread->events)
+		return NULL;
+
+	if (timeline_thread->capture != timeline_capture)
+	{
+		timeline_thread->capture = timeline_capture;
+		timeline_thread->num_events = 0;
+		timeline_thread->dropped = 0;
+		timeline_thread->depth = 0;
+	}
+
+	return timeline_thread;
+}
+
+static void Timeline_Add(timeline_thread_t* thread, const char* name)
+{
+	timeline_event_t*	event;
+
+	if (thread->num_events >= TIMELINE_MAX_EVENTS)
+	{
+		thread->dropped++;
+		return;
+	}
+
+	event = &thread->events[thread->num_events++];
+	event->time = Sys_Nanoseconds();
+	event->name = name;
+}
+
+/*
+==================
+Timeline_Begin
+==================
+*/
+void Timeline_Begin(const char* name)
+{
+	timeline_thread_t*	thread;
+
+	thread = Timeline_GetThread();
+
+	if (!thread)
+		return;
+
+	Timeline_Add(thread, name);
+	thread->depth++;
+}
+
+/*
+==================
+Timeline_End
+==================
+*/
+void Timeline_End()
+{
+	timeline_thread_t*	thread;
+
+	thread = Timeline_GetThread();
+
+	// a zone that began before the capture did
+	if (!thread || thread->depth <= 0)
+		return;
+
+	Timeline_Add(thread, NULL);
+	thread->depth--;
+}
+
+/*
+==================
+Timeline_EndZones
+
+Ends every zone this thread is in, for when an error jumps out of them
+==================
+*/
+void Timeline_EndZones()
+{
+	timeline_thread_t*	thread;
+
+	if (!timeline_active)
+		return;
+
+	thread = Timeline_GetThread();
+
+	if (!thread)
+		return;
+
+	for (; thread->depth > 0; thread->depth--)
+		Timeline_Add(thread, NULL);
+}
+
+// The names are code identifiers and short descriptions, but quote them properly anyway
+static void Timeline_WriteString(FILE* file, const char* s)
+{
+	fputc('"', file);
+
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fputc('\\', file);
+
+		if ((uint8_t)*s >= ' ')
+			fputc(*s, file);
+	}
+
+	fputc('"', file);
+}
+
+/*
+==================
+Timeline_Write
+
+Writes the capture as trace event format JSON
+==================
+*/
+static void Timeline_Write()
+{
+	char				name[MAX_OSPATH];
+	FILE*				file;
+	timeline_thread_t*	thread;
+	timeline_event_t*	event;
+	int32_t 			num_threads, i, j;
+	int32_t 			events, dropped;
+	bool				first;
+	time_t				now;
+	struct tm*			local;
+
+	time(&now);
+	local = localtime(&now);
+
+	snprintf(name, sizeof(name), "%s/timeline/%04i%02i%02i-%02i%02i%02i.json", FS_Gamedir(),
+		local->tm_year + 1900, local->tm_mon + 1, local->tm_mday, local->tm_hour, local->tm_min, local->tm_sec);
+
+	FS_CreatePath(name);
+	file = fopen(name, "w");
+
+	if (!file)
+	{
+		Com_Printf("Timeline_Write: couldn't open %s\n", name);
+		return;
+	}
+
+	num_threads = timeline_num_threads < TIMELINE_MAX_THREADS ? timeline_num_threads : TIMELINE_MAX_THREADS;
+	events = dropped = 0;
+	first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (i = 0; i < num_threads; i++)
+	{
+		thread = &timeline_threads[i];
+
+		if (thread->capture != timeline_capture)
+			continue;
+
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", i, i ? va("thread %i", i) : "main");
+		first = false;
+
+		for (j = 0; j < thread->num_events; j++)
+		{
+			event = &thread->events[j];
+
+			// microseconds, with the fraction so short zones don't collapse to nothing
+			if (event->name)
+			{
+				fprintf(file, ",\n{\"ph\":\"B\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"name\":", i, (event->time - timeline_start) / 1000.0);
+				Timeline_WriteString(file, event->name);
+				fputc('}', file);
+			}
+			else
+			{
+				fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%i,\"ts\":%.3f}", i, (event->time - timeline_start) / 1000.0);
+			}
+		}
+
+		events += thread->num_events;
+		dropped += thread->dropped;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	Com_Printf("Wrote %i timeline events to %s\n", events, name);
+
+	if (dropped)
+		Com_Printf("%i events didn't fit in the buffers and were dropped\n", dropped);
+}
+
+/*
+==================
+Timeline_Frame
+
+Called at the top of Common_Frame, outside every zone, so captures start and
+stop on frame boundaries.
+==================
+*/
+void Timeline_Frame()
+{
+	if (timeline_pending)
+	{
+		timeline_capture++;
+		timeline_start = Sys_Nanoseconds();
+		timeline_end = timeline_start + timeline_pending;
+		timeline_pending = 0;
+		timeline_active = true;
+		return;
+	}
+
+	if (timeline_active
+		&& Sys_Nanoseconds() >= timeline_end)
+	{
+		timeline_active = false;
+		Timeline_Write();
+	}
+}
+
+/*
+==================
+Timeline_Start_f
+
+trace_start <seconds>
+==================
+*/
+static void Timeline_Start_f()
+{
+	float	seconds;
+
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("trace_start <seconds>: capture a timeline of every frame for that long\n");
+		return;
+	}
+
+	if (timeline_active || timeline_pending)
+	{
+		Com_Printf("Already capturing a timeline.\n");
+		return;
+	}
+
+	seconds = atof(Cmd_Argv(1));
+
+	if (seconds <= 0 || seconds > TIMELINE_MAX_SECONDS)
+	{
+		Com_Printf("Between 0 and %i seconds.\n", TIMELINE_MAX_SECONDS);
+		return;
+	}
+
+	timeline_pending = (int64_t)(seconds * 1000000000.0);
+	Com_Printf("Capturing a timeline for %g seconds.\n", seconds);
+}
+
+/*
+==================
+Timeline_Init
+==================
+*/
+void Timeline_Init()
+{
+	Cmd_AddCommand("trace_start", Timeline_Start_f);
+}
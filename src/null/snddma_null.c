@@ -19,24 +19,56 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
-// snddma_null.c
-// all other sound mixing is portable
+// snddma_null.c -- sound output that goes nowhere
+//
+// The "device" is a buffer in memory whose play position follows the system
+// clock, so a headless client still spatialises and mixes every sound as if
+// it were playing. s_initsound 0 turns sound off altogether. The Headless
+// configuration of zombono.vcxproj links this instead of win32_sound.c.
 
 #include <client/client.h>
 #include <client/include/sound_local.h>
 
+#define SNDDMA_NULL_SAMPLES		65536			// mono samples, a power of two
+
+static int32_t	snddma_start;					// Sys_Milliseconds when the buffer started playing
+
 bool SNDDMA_Init(void)
 {
-	return false;
+	dma.channels = 2;
+	dma.samplebits = 16;
+	dma.samples = SNDDMA_NULL_SAMPLES;
+	dma.submission_chunk = 1;
+	dma.samplepos = 0;
+
+	if (s_khz->value == 44)
+		dma.speed = 44100;
+	else if (s_khz->value == 22)
+		dma.speed = 22050;
+	else
+		dma.speed = 11025;
+
+	dma.buffer = Memory_ZoneMalloc(dma.samples * dma.samplebits / 8);
+	snddma_start = Sys_Milliseconds();
+	return true;
 }
 
 int32_t	SNDDMA_GetDMAPos(void)
 {
-	return 0;
+	int64_t played;
+
+	played = (int64_t)(Sys_Milliseconds() - snddma_start) * dma.speed / 1000 * dma.channels;
+	dma.samplepos = (int32_t)(played & (dma.samples - 1));
+	return dma.samplepos;
 }
 
 void SNDDMA_Shutdown(void)
 {
+	if (dma.buffer)
+	{
+		Memory_ZoneFree(dma.buffer);
+		dma.buffer = NULL;
+	}
 }
 
 void SNDDMA_BeginPainting (void)
@@ -46,3 +78,7 @@ void SNDDMA_BeginPainting (void)
 void SNDDMA_Submit(void)
 {
 }
+
+void S_Activate(bool activated)
+{
+}
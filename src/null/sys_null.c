@@ -112,6 +112,11 @@ void	Sys_Mkdir (char *path)
 {
 }
 
+bool	Sys_ReplaceFile (char *from, char *to)
+{
+	return rename (from, to) == 0;
+}
+
 char	*Sys_FindFirst (char *path, unsigned musthave, unsigned canthave)
 {
 	return NULL;
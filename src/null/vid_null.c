@@ -19,106 +19,184 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
-// Vid_null.c -- null video driver to aid porting efforts (and for the dedicated server binary)
-// this assumes that one of the refs is statically linked to the executable
+// vid_null.c -- headless video driver
+//
+// The Headless configuration of zombono.vcxproj links this instead of
+// client/render/render_interface.c, for a client with no window or GL context,
+// such as the timedemo benchmark on Windows machines without a GPU. `re` is
+// filled with functions that draw nothing, so the whole client
+// (parsing, prediction, entity and particle building, sound) still runs every
+// frame and only the renderer itself is left out.
 
-#include "../client/client.h"
+#include <client/client.h>
 
 refexport_t	re;
 
-GetRefAPI_t	GetRefAPI;
+cvar_t* vid_gamma;
+cvar_t* vid_ref;
+cvar_t* vid_xpos;
+cvar_t* vid_ypos;
+cvar_t* vid_borderless;
+cvar_t* vid_fullscreen;
+cvar_t* vid_refresh;
+cvar_t* viewsize;
 
-// misc stuff
-cvar_t* r_width;
-cvar_t* r_height;
-
-// Global variables used internally by this module
-#ifdef WIN32
-HINSTANCE	reflib_library;		// Handle to refresh DLL 
-#endif
+bool	graphics_mode = false;
 
 /*
 ==========================================================================
 
-DIRECT LINK GLUE
+NULL REFRESH
 
 ==========================================================================
 */
 
-#define	MAX_PRINT_MSG	4096
-void Vid_Printf(int32_t print_level, char* fmt, ...)
+static bool Ref_Null_Init()
 {
-	va_list		argptr;
-	char		msg[MAX_PRINT_MSG];
+	return true;
+}
 
-	va_start(argptr, fmt);
-	vsprintf(msg, fmt, argptr);
-	va_end(argptr);
+static void Ref_Null_Void()
+{
+}
 
-	if (print_level == PRINT_ALL)
-		Com_Printf("%s", msg);
-	else
-		Com_DPrintf("%s", msg);
+// models and images are never loaded, the client already copes with them not being found
+static struct model_s* Ref_Null_RegisterModel(char* name)
+{
+	return NULL;
 }
 
-void Vid_Error(int32_t err_level, char* fmt, ...)
+static struct image_s* Ref_Null_RegisterImage(char* name)
 {
-	va_list		argptr;
-	char		msg[MAX_PRINT_MSG];
+	return NULL;
+}
 
-	va_start(argptr, fmt);
-	vsprintf(msg, fmt, argptr);
-	va_end(argptr);
+static void Ref_Null_Name(char* name)
+{
+}
 
-	Com_Error(err_level, "%s", msg);
+static void Ref_Null_SetSky(char* name, float rotate, vec3_t axis)
+{
 }
 
-void Vid_ChangeResolution(int32_t width, int32_t height)
+static void Ref_Null_RenderFrame(refdef_t* fd)
 {
-	r_width->value = width;
-	r_height->value = height;
 }
 
+static void Ref_Null_DrawTileClear(int32_t x, int32_t y, int32_t w, int32_t h, char* name)
+{
+}
 
-void Vid_Init()
+static void Ref_Null_DrawFill(int32_t x, int32_t y, int32_t w, int32_t h, color4_t color)
 {
-	/* Create the video variables so we know how to start the graphics drivers */
-	r_width = Cvar_Get("r_width", "1366", CVAR_ARCHIVE);
-	r_height = Cvar_Get("r_height", "768", CVAR_ARCHIVE);
+}
 
-	/* Start the graphics mode and load refresh DLL */
-	Vid_CheckChanges();
+static void Ref_Null_DrawGetPicSize(int32_t* w, int32_t* h, char* name)
+{
+	*w = *h = 0;
 }
 
-void Vid_Shutdown(void)
+static void Ref_Null_DrawPic(int32_t x, int32_t y, char* name, color4_t color, bool use_scaled_assets)
 {
+}
 
+static void Ref_Null_DrawPicStretch(int32_t x, int32_t y, int32_t w, int32_t h, char* name, color4_t color, bool use_scaled_assets)
+{
 }
 
-void Vid_CheckChanges(void)
+static void Ref_Null_DrawPicRegion(int32_t x, int32_t y, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y, char* pic, color4_t color, bool use_scaled_assets)
 {
 }
 
-void Vid_MenuDraw(void)
+static void Ref_Null_SetProc(void* proc)
 {
 }
 
-void Render2D_BeginLoadingPlaque()
+static void Ref_Null_EnableCursor(bool enable)
 {
+}
 
+static void Ref_Null_GetCursorPosition(double* x, double* y)
+{
+	*x = *y = 0;
 }
 
-void Render2D_EndLoadingPlaque()
+static void Ref_Null_SetPosition(double x, double y)
 {
+}
+
+/*
+==========================================================================
+
+VIDEO
 
+==========================================================================
+*/
+
+void Vid_ChangeResolution()
+{
+	cl.force_refdef = true;
 }
 
-void Render2D_DebugGraph(float value, int32_t r, int32_t g, int32_t b, int32_t a)
+void Vid_Init()
 {
+	r_width = Cvar_Get("r_width", "1366", CVAR_ARCHIVE);
+	r_height = Cvar_Get("r_height", "768", CVAR_ARCHIVE);
 
+	// nothing reads these without a renderer, but other modules link against them
+	vid_ref = Cvar_Get("vid_ref", "null", CVAR_NOSET);
+	vid_xpos = Cvar_Get("vid_xpos", "3", CVAR_ARCHIVE);
+	vid_ypos = Cvar_Get("vid_ypos", "22", CVAR_ARCHIVE);
+	vid_borderless = Cvar_Get("vid_borderless", "0", CVAR_ARCHIVE);
+	vid_fullscreen = Cvar_Get("vid_fullscreen", "0", CVAR_ARCHIVE);
+	vid_refresh = Cvar_Get("vid_refresh", "0", CVAR_NOSET);
+	vid_gamma = Cvar_Get("vid_gamma", "1", CVAR_ARCHIVE);
+	viewsize = Cvar_Get("viewsize", "100", CVAR_ARCHIVE);
+
+	re.api_version = API_VERSION;
+	re.Init = Ref_Null_Init;
+	re.Shutdown = Ref_Null_Void;
+	re.BeginRegistration = Ref_Null_Name;
+	re.RegisterModel = Ref_Null_RegisterModel;
+	re.RegisterSkin = Ref_Null_RegisterImage;
+	re.RegisterPic = Ref_Null_RegisterImage;
+	re.SetSky = Ref_Null_SetSky;
+	re.EndRegistration = Ref_Null_Void;
+	re.RenderFrame = Ref_Null_RenderFrame;
+	re.DrawTileClear = Ref_Null_DrawTileClear;
+	re.DrawFill = Ref_Null_DrawFill;
+	re.LoadPic = Ref_Null_Name;
+	re.DrawGetPicSize = Ref_Null_DrawGetPicSize;
+	re.DrawPic = Ref_Null_DrawPic;
+	re.DrawPicStretch = Ref_Null_DrawPicStretch;
+	re.DrawPicRegion = Ref_Null_DrawPicRegion;
+	re.DrawFontChar = Ref_Null_DrawPicRegion;
+	re.DrawFadeScreen = Ref_Null_Void;
+	re.BeginFrame = Ref_Null_Void;
+	re.EndFrame = Ref_Null_Void;
+	re.EndWorldRenderpass = Ref_Null_Void;
+	re.SetMousePressedProc = (void*)Ref_Null_SetProc;
+	re.SetMouseScrollProc = (void*)Ref_Null_SetProc;
+	re.SetMouseMovedProc = (void*)Ref_Null_SetProc;
+	re.SetKeyPressedProc = (void*)Ref_Null_SetProc;
+	re.SetWindowFocusProc = (void*)Ref_Null_SetProc;
+	re.SetWindowIconifyProc = (void*)Ref_Null_SetProc;
+	re.EnableCursor = Ref_Null_EnableCursor;
+	re.GetCursorPosition = Ref_Null_GetCursorPosition;
+	re.SetCursorPosition = Ref_Null_SetPosition;
+	re.SetWindowPosition = Ref_Null_SetPosition;
+
+	vidref_val = VIDREF_OTHER;
+	graphics_mode = true;
+	Vid_ChangeResolution();
 }
 
-const char* Vid_MenuKey(int32_t k)
+void Vid_Shutdown()
+{
+	memset(&re, 0, sizeof(re));
+	graphics_mode = false;
+}
+
+void Vid_CheckChanges()
 {
-	return NULL;
 }
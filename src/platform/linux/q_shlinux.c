@@ -128,6 +128,12 @@ void Sys_Mkdir (char *path)
     mkdir (path, 0777);
 }
 
+// rename replaces an existing file atomically
+bool Sys_ReplaceFile (char *from, char *to)
+{
+	return rename (from, to) == 0;
+}
+
 char *strlwr (char *s)
 {
 	while (*s) {
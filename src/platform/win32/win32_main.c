@@ -40,11 +40,16 @@ static HANDLE	hinput, houtput;
 
 uint32_t		sys_msg_time;
 
+cvar_t*			sys_eventloop;			// dedicated servers sleep until the next frame or packet
+cvar_t*			sys_wake_early;			// microseconds before a frame to stop waiting on the socket
+cvar_t*			sys_jitter_target;		// microseconds a frame may start late before it counts as missed
+
 #define	MAX_NUM_ARGVS	128
 int32_t 		argc;
 char* argv[MAX_NUM_ARGVS];
 
 int32_t Sys_MsgboxV(char* title, uint32_t buttons, char* text, va_list args);
+void Sys_WakeStats_f();
 
 
 /*
@@ -91,12 +96,16 @@ int32_t Sys_Msgbox(char* title, uint32_t buttons, char* text, ...)
 	vsnprintf(text_processed, 1024, text, args);
 	va_end(args);
 
+	char title_processed[256] = { 0 };
+
 	char* title_processed_ptr = title;
 	char* text_processed_ptr = text_processed;
 
 	if (localisation_initialised)
 	{
-		title_processed_ptr = Localisation_ProcessString(title);
+		// processing the text can empty the cache the title came from
+		strncpy(title_processed, Localisation_ProcessString(title), sizeof(title_processed) - 1);
+		title_processed_ptr = title_processed;
 		text_processed_ptr = Localisation_ProcessString(text);
 	}
 
@@ -206,12 +215,21 @@ void Sys_Init()
 
 	// enable DPI awareness
 	Sys_SetDPIAwareness();
+
+	sys_eventloop = Cvar_Get("sys_eventloop", "1", CVAR_NOSET);
+	sys_wake_early = Cvar_Get("sys_wake_early", "1000", 0);
+	sys_jitter_target = Cvar_Get("sys_jitter_target", "250", 0);
+
+	Cmd_AddCommand("sys_wakestats", Sys_WakeStats_f);
 }
 
 
 static char	console_text[256];
 static int32_t console_textlen;
 
+// the logger thread redraws the line being typed around what it prints, so it's only touched under this
+static SRWLOCK	console_lock = SRWLOCK_INIT;
+
 /*
 ================
 Sys_ConsoleInput
@@ -247,6 +265,8 @@ char* Sys_ConsoleInput()
 			{
 				ch = recs[0].Event.KeyEvent.uChar.AsciiChar;
 
+				AcquireSRWLockExclusive(&console_lock);
+
 				switch (ch)
 				{
 				case '\r':
@@ -256,6 +276,7 @@ char* Sys_ConsoleInput()
 					{
 						console_text[console_textlen] = 0;
 						console_textlen = 0;
+						ReleaseSRWLockExclusive(&console_lock);
 						return console_text;
 					}
 					break;
@@ -282,6 +303,8 @@ char* Sys_ConsoleInput()
 					break;
 
 				}
+
+				ReleaseSRWLockExclusive(&console_lock);
 			}
 		}
 	}
@@ -312,6 +335,8 @@ void Sys_ConsoleOutput(char* string)
 		return;
 	}
 
+	AcquireSRWLockExclusive(&console_lock);
+
 	if (console_textlen)
 	{
 		text[0] = '\r';
@@ -325,6 +350,8 @@ void Sys_ConsoleOutput(char* string)
 
 	if (console_textlen)
 		WriteFile(houtput, console_text, console_textlen, &dummy, NULL);
+
+	ReleaseSRWLockExclusive(&console_lock);
 }
 
 /*
@@ -356,6 +383,19 @@ char* Sys_GetClipboardData(void)
 	return data;
 }
 
+/*
+================
+Sys_ReplaceFile
+
+Renames from over to in one step, so to is always either the old file or the new one. rename()
+won't replace an existing file here, and removing it first leaves a moment with neither.
+================
+*/
+bool Sys_ReplaceFile(char* from, char* to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
 
 /*
 ========================================================================
@@ -521,6 +561,240 @@ void ParseCommandLine(LPSTR lpCmdLine)
 
 }
 
+/*
+===============================================================================
+
+DEDICATED SERVER LOOP
+
+===============================================================================
+*/
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION	0x00000002
+#endif
+
+#define	WAKE_BUCKET_NS	50000		// width of a lateness histogram bucket
+#define	WAKE_BUCKETS	200			// the last bucket collects everything later than that
+
+#define	TIMER_SLACK_HIGH_RES	250000		// starting guesses at how late each kind of timer wakes up
+#define	TIMER_SLACK_LOW_RES		2000000
+#define	TIMER_SLACK_MAX			4000000		// never spin for longer than this
+
+static HANDLE	sys_timer;			// waitable timer, high resolution where the OS has them
+static int64_t	sys_timer_slack;	// how late sys_timer has been waking up, spun off the end of every wait
+
+static int32_t 	wake_count;
+static int32_t 	wake_missed;		// frames later than sys_jitter_target
+static int64_t	wake_total_ns;
+static int64_t	wake_max_ns;
+static int32_t 	wake_histogram[WAKE_BUCKETS];
+static int64_t	wake_stats_start;	// wall and cpu time when the stats were last reset
+static int64_t	wake_stats_start_cpu;
+
+/*
+================
+Sys_ProcessTime
+
+User and kernel time used by this process, in nanoseconds
+================
+*/
+static int64_t Sys_ProcessTime()
+{
+	FILETIME	creation, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+
+	return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+}
+
+/*
+================
+Sys_WakeStats_f
+
+Prints how late the dedicated server loop started its frames, and the CPU
+the process used, since the last time it was called
+================
+*/
+void Sys_WakeStats_f()
+{
+	int64_t 	wall, cpu;
+	int32_t 	i, total, p50, p99;
+
+	wall = Sys_Nanoseconds() - wake_stats_start;
+	cpu = Sys_ProcessTime() - wake_stats_start_cpu;
+
+	if (wake_stats_start && wall > 0)
+		Com_Printf("CPU: %.1f%% of one core over %.1f seconds\n", 100.0 * cpu / wall, wall / 1000000000.0);
+
+	if (!sys_eventloop->value || !dedicated->value)
+		Com_Printf("Wakeup lateness is only measured by the dedicated server event loop (sys_eventloop 1)\n");
+	else if (wake_count)
+	{
+		total = 0;
+		p50 = p99 = WAKE_BUCKETS - 1;
+
+		for (i = WAKE_BUCKETS - 1; i >= 0; i--)
+		{
+			total += wake_histogram[i];
+
+			if (total <= wake_count / 100)
+				p99 = i;
+			if (total <= wake_count / 2)
+				p50 = i;
+		}
+
+		Com_Printf("%i frames, late by: avg %lldus p50 <%ius p99 <%ius max %lldus\n", wake_count, wake_total_ns / wake_count / 1000,
+			p50 * (WAKE_BUCKET_NS / 1000), p99 * (WAKE_BUCKET_NS / 1000), wake_max_ns / 1000);
+		Com_Printf("%i frames (%.2f%%) missed the %ius jitter target\n", wake_missed, 100.0f * wake_missed / wake_count, (int32_t)sys_jitter_target->value);
+		Com_Printf("Spinning for the last %lldus of each wait\n", sys_timer_slack / 1000);
+	}
+
+	wake_count = wake_missed = 0;
+	wake_total_ns = wake_max_ns = 0;
+	memset(wake_histogram, 0, sizeof(wake_histogram));
+	wake_stats_start = Sys_Nanoseconds();
+	wake_stats_start_cpu = Sys_ProcessTime();
+}
+
+/*
+================
+Sys_WaitUntil
+
+Sleeps until deadline (in Sys_Nanoseconds time) without polling the network.
+The timer is set for sys_timer_slack before the deadline, and only what's left
+after it wakes up is spun away, so an idle server doesn't keep a core busy.
+================
+*/
+static void Sys_WaitUntil(int64_t deadline)
+{
+	LARGE_INTEGER	due;
+	int64_t 		wake, remaining, late;
+
+	// a low resolution timer can wake up early, so go back to sleep if it does
+	while ((remaining = deadline - sys_timer_slack - Sys_Nanoseconds()) > 0)
+	{
+		wake = deadline - sys_timer_slack;
+
+		if (!sys_timer)
+		{
+			if (remaining < 1000000)
+				break;
+
+			Sleep((DWORD)(remaining / 1000000));
+			continue;
+		}
+
+		// negative means relative, in 100ns units
+		due.QuadPart = -(remaining / 100);
+
+		if (!SetWaitableTimer(sys_timer, &due, 0, NULL, NULL, FALSE))
+			break;
+
+		WaitForSingleObject(sys_timer, INFINITE);
+
+		// follow the latest wakeups up at once and back down slowly, so one bad one doesn't make every wait spin
+		late = Sys_Nanoseconds() - wake;
+
+		if (late > sys_timer_slack)
+			sys_timer_slack = late < TIMER_SLACK_MAX ? late : TIMER_SLACK_MAX;
+		else
+			sys_timer_slack -= (sys_timer_slack - (late > 0 ? late : 0)) / 16;
+	}
+
+	while (Sys_Nanoseconds() < deadline)
+		SwitchToThread();
+}
+
+/*
+================
+Sys_DedicatedLoop
+
+Runs a dedicated server frame when the next game frame is due or a packet
+arrives, and sleeps in between
+================
+*/
+static void Sys_DedicatedLoop()
+{
+	int64_t 	base;			// the time svs.realtime was last advanced to
+	int64_t 	deadline, now, late, early;
+	int32_t 	msec;
+	bool		packet;
+
+	sys_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	sys_timer_slack = TIMER_SLACK_HIGH_RES;
+
+	if (!sys_timer)
+	{
+		Com_Printf("High resolution timers aren't available, frame timing will be less accurate\n");
+		sys_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+		sys_timer_slack = TIMER_SLACK_LOW_RES;
+	}
+
+	base = Sys_Nanoseconds();
+	wake_stats_start = base;
+	wake_stats_start_cpu = Sys_ProcessTime();
+
+	while (1)
+	{
+		deadline = base + SV_FrameDelay() * 1000000LL;
+
+		// Common_Frame needs at least a millisecond
+		if (deadline < base + 1000000)
+			deadline = base + 1000000;
+
+		early = (int64_t)sys_wake_early->value * 1000;
+		packet = false;
+
+		// wait on the socket until just before the frame is due, select isn't accurate enough to hit it
+		now = Sys_Nanoseconds();
+
+		if (deadline - early > now)
+			packet = Net_Wait(deadline - early - now);
+
+		if (packet)
+		{
+			// same latency as the old loop: packets are handled within a millisecond
+			Sys_WaitUntil(base + 1000000);
+		}
+		else
+		{
+			Sys_WaitUntil(deadline);
+
+			late = Sys_Nanoseconds() - deadline;
+
+			if (late < 0)
+				late = 0;
+
+			wake_count++;
+			wake_total_ns += late;
+
+			if (late > wake_max_ns)
+				wake_max_ns = late;
+
+			if (late > (int64_t)sys_jitter_target->value * 1000)
+				wake_missed++;
+
+			wake_histogram[late / WAKE_BUCKET_NS < WAKE_BUCKETS ? late / WAKE_BUCKET_NS : WAKE_BUCKETS - 1]++;
+		}
+
+		msec = (int32_t)((Sys_Nanoseconds() - base) / 1000000);
+
+		if (msec < 1)
+			continue;
+
+		// keep the sub millisecond remainder for the next frame
+		base += msec * 1000000LL;
+		Common_Frame(msec);
+	}
+}
+
 /*
 ==================
 WinMain
@@ -538,6 +812,10 @@ int32_t WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmd
 	Common_Init(argc, argv);
 	oldtime = Sys_Milliseconds();
 
+	if (dedicated->value
+		&& sys_eventloop->value)
+		Sys_DedicatedLoop();	// never returns
+
 	/* main window message loop */
 	while (1)
 	{
@@ -24,18 +24,23 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "winsock.h"
 #include <common/common.h>
 
-#define	MAX_LOOPBACK	4
+#define	MAX_LOOPBACK		4		// initial queue length, doubled whenever it fills up and halved as it drains
+#define	MAX_LOOPBACK_QUEUE	1024	// past this the oldest message is dropped
 
 typedef struct
 {
-	uint8_t	data[MAX_MSGLEN];
-	int32_t datalen;
+	uint8_t*	data;				// MAX_MSGLEN bytes, swapped with net_message->data on delivery
+	int32_t 	datalen;
 } loopmsg_t;
 
 typedef struct
 {
-	loopmsg_t	msgs[MAX_LOOPBACK];
+	loopmsg_t*	msgs;				// [size], size is always a power of two
+	int32_t 	size;
 	int32_t 	get, send;
+	int32_t 	peak;				// most messages ever queued at once
+	int32_t 	drained_peak;		// most messages queued at once since the queue was last empty
+	int32_t 	overruns;			// messages dropped because MAX_LOOPBACK_QUEUE was reached
 } loopback_t;
 
 cvar_t* net_shownet;
@@ -92,6 +97,9 @@ bool Net_CompareAdr(netadr_t a, netadr_t b)
 		return false;
 	}
 
+	if (a.type == NA_BOT)
+		return a.port == b.port;
+
 	return TRUE;
 }
 
@@ -117,6 +125,10 @@ bool Net_CompareBaseAdr(netadr_t a, netadr_t b)
 		return false;
 	}
 
+	// every bot is its own "machine", or they would all share one challenge
+	if (a.type == NA_BOT)
+		return a.port == b.port;
+
 	return TRUE;
 }
 
@@ -128,6 +140,8 @@ char* Net_AdrToString(netadr_t a)
 		snprintf(s, sizeof(s), "loopback");
 	else if (a.type == NA_IP)
 		snprintf(s, sizeof(s), "%i.%i.%i.%i:%i", a.ip[0], a.ip[1], a.ip[2], a.ip[3], ntohs(a.port));
+	else if (a.type == NA_BOT)
+		snprintf(s, sizeof(s), "bot%i", a.port);
 	return s;
 }
 
@@ -227,30 +241,112 @@ LOOPBACK BUFFERS FOR LOCAL PLAYER
 =============================================================================
 */
 
+/*
+====================
+Net_ShrinkLoopback
+
+Called when a loopback queue is empty. Halves it if nothing since it was last empty
+came near filling it, so a burst doesn't keep MAX_LOOPBACK_QUEUE buffers for good,
+while a queue that is busy every frame keeps its size.
+====================
+*/
+static void Net_ShrinkLoopback(loopback_t* loop)
+{
+	loopmsg_t*	msgs;
+	int32_t 	size;
+	int32_t 	i;
+
+	if (loop->size > MAX_LOOPBACK
+		&& loop->drained_peak <= loop->size / 4)
+	{
+		size = loop->size / 2;
+		msgs = Memory_ZoneMalloc(size * sizeof(loopmsg_t));
+
+		// nothing is queued, so it doesn't matter which buffers are kept. net_message's
+		// own static buffer can be one of them after Net_GetLoopPacket has swapped it in.
+		memcpy(msgs, loop->msgs, size * sizeof(loopmsg_t));
+
+		for (i = size; i < loop->size; i++)
+		{
+			if (loop->msgs[i].data && loop->msgs[i].data != net_message_buffer)
+				Memory_ZoneFree(loop->msgs[i].data);
+		}
+
+		Memory_ZoneFree(loop->msgs);
+		loop->msgs = msgs;
+		loop->size = size;
+		loop->get = loop->send = 0;
+	}
+
+	loop->drained_peak = 0;
+}
+
 bool Net_GetLoopPacket(netsrc_t sock, netadr_t* net_from, sizebuf_t* net_message)
 {
 	int32_t 	i;
 	loopback_t* loop;
+	uint8_t*	data;
 
 	loop = &loopbacks[sock];
 
-	if (loop->send - loop->get > MAX_LOOPBACK)
-		loop->get = loop->send - MAX_LOOPBACK;
-
 	if (loop->get >= loop->send)
 		return false;
 
-	i = loop->get & (MAX_LOOPBACK - 1);
+	i = loop->get & (loop->size - 1);
 	loop->get++;
 
-	memcpy(net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
+	// hand the queued buffer to net_message instead of copying it, the old
+	// net_message buffer takes its place in the queue and gets reused by a later send
+	if (net_message->maxsize == MAX_MSGLEN)
+	{
+		data = net_message->data;
+		net_message->data = loop->msgs[i].data;
+		loop->msgs[i].data = data;
+	}
+	else
+	{
+		memcpy(net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
+	}
+
 	net_message->cursize = loop->msgs[i].datalen;
 	memset(net_from, 0, sizeof(*net_from));
 	net_from->type = NA_LOOPBACK;
+
+	if (loop->get == loop->send)
+		Net_ShrinkLoopback(loop);
+
 	return true;
 
 }
 
+/*
+====================
+Net_GrowLoopback
+
+Doubles the length of a loopback queue, keeping the queued messages in order
+====================
+*/
+static void Net_GrowLoopback(loopback_t* loop)
+{
+	loopmsg_t*	msgs;
+	int32_t 	size;
+	int32_t 	i;
+
+	size = loop->size ? loop->size * 2 : MAX_LOOPBACK;
+	msgs = Memory_ZoneMalloc(size * sizeof(loopmsg_t));
+
+	// the old slots, including the buffers of the ones that are empty, move to the front
+	for (i = 0; i < loop->size; i++)
+		msgs[i] = loop->msgs[(loop->get + i) & (loop->size - 1)];
+
+	if (loop->msgs)
+		Memory_ZoneFree(loop->msgs);
+
+	loop->send -= loop->get;
+	loop->get = 0;
+	loop->msgs = msgs;
+	loop->size = size;
+}
 
 void Net_SendLoopPacket(netsrc_t sock, int32_t length, void* data, netadr_t to)
 {
@@ -259,13 +355,51 @@ void Net_SendLoopPacket(netsrc_t sock, int32_t length, void* data, netadr_t to)
 
 	loop = &loopbacks[sock ^ 1];
 
-	i = loop->send & (MAX_LOOPBACK - 1);
+	if (loop->send - loop->get >= loop->size)
+	{
+		if (loop->size < MAX_LOOPBACK_QUEUE)
+		{
+			Net_GrowLoopback(loop);
+		}
+		else
+		{
+			// the other side has stopped reading, drop the oldest message
+			loop->get++;
+			loop->overruns++;
+			Com_DPrintf("Net_SendLoopPacket: loopback overrun (%i)\n", loop->overruns);
+		}
+	}
+
+	i = loop->send & (loop->size - 1);
 	loop->send++;
 
+	if (loop->send - loop->get > loop->peak)
+		loop->peak = loop->send - loop->get;
+
+	if (loop->send - loop->get > loop->drained_peak)
+		loop->drained_peak = loop->send - loop->get;
+
+	// buffers are only allocated the first time a slot is used
+	if (!loop->msgs[i].data)
+		loop->msgs[i].data = Memory_ZoneMalloc(MAX_MSGLEN);
+
 	memcpy(loop->msgs[i].data, data, length);
 	loop->msgs[i].datalen = length;
 }
 
+/*
+====================
+Net_Loopback_f
+====================
+*/
+static void Net_Loopback_f()
+{
+	Com_Printf("client: %i queued, %i peak, %i slots, %i overruns\n", loopbacks[NS_CLIENT].send - loopbacks[NS_CLIENT].get,
+		loopbacks[NS_CLIENT].peak, loopbacks[NS_CLIENT].size, loopbacks[NS_CLIENT].overruns);
+	Com_Printf("server: %i queued, %i peak, %i slots, %i overruns\n", loopbacks[NS_SERVER].send - loopbacks[NS_SERVER].get,
+		loopbacks[NS_SERVER].peak, loopbacks[NS_SERVER].size, loopbacks[NS_SERVER].overruns);
+}
+
 //=============================================================================
 
 bool Net_GetPacket(netsrc_t sock, netadr_t* net_from, sizebuf_t* net_message)
@@ -279,6 +413,10 @@ bool Net_GetPacket(netsrc_t sock, netadr_t* net_from, sizebuf_t* net_message)
 	if (Net_GetLoopPacket(sock, net_from, net_message))
 		return true;
 
+	if (sock == NS_SERVER
+		&& LoadTest_GetPacket(net_from, net_message))
+		return true;
+
 	net_socket = ip_sockets[sock];
 
 	if (!net_socket)
@@ -335,6 +473,12 @@ void Net_SendPacket(netsrc_t sock, int32_t length, void* data, netadr_t to)
 		return;
 	}
 
+	if (to.type == NA_BOT)
+	{
+		LoadTest_SendPacket(sock, length, data, to);
+		return;
+	}
+
 	if (to.type == NA_BROADCAST)
 	{
 		net_socket = ip_sockets[sock];
@@ -546,6 +690,9 @@ void Net_Sleep(int32_t msec)
 	if (!dedicated || !dedicated->value)
 		return; // we're not a server, just run full speed
 
+	if (sys_eventloop && sys_eventloop->value)
+		return; // the main loop already waits for the next frame
+
 	FD_ZERO(&fdset);
 	i = 0;
 	if (ip_sockets[NS_SERVER]) {
@@ -558,6 +705,24 @@ void Net_Sleep(int32_t msec)
 	select(i + 1, &fdset, NULL, NULL, &timeout);
 }
 
+// waits up to nsec for a packet on the server socket, returns true if one arrived
+bool Net_Wait(int64_t nsec)
+{
+	struct timeval timeout;
+	fd_set	fdset;
+
+	if (!ip_sockets[NS_SERVER])
+		return false;
+
+	FD_ZERO(&fdset);
+	FD_SET(ip_sockets[NS_SERVER], &fdset);
+
+	timeout.tv_sec = (long)(nsec / 1000000000);
+	timeout.tv_usec = (long)((nsec % 1000000000) / 1000);
+
+	return select(ip_sockets[NS_SERVER] + 1, &fdset, NULL, NULL, &timeout) > 0;
+}
+
 //===================================================================
 
 
@@ -585,6 +750,8 @@ void Net_Init()
 	noudp = Cvar_Get("noudp", "0", CVAR_NOSET);
 
 	net_shownet = Cvar_Get("net_shownet", "0", 0);
+
+	Cmd_AddCommand("net_loopback", Net_Loopback_f);
 }
 
 
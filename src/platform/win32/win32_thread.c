@@ -0,0 +1,161 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// win32_thread.c -- threads, mutexes and condition variables
+
+#include <common/common.h>
+#include <windows.h>
+#include <process.h>
+
+typedef struct sys_thread_s
+{
+	HANDLE	handle;
+	void	(*func)(void* arg);
+	void*	arg;
+} sys_thread_t;
+
+struct sys_mutex_s
+{
+	CRITICAL_SECTION	cs;
+};
+
+struct sys_cond_s
+{
+	CONDITION_VARIABLE	cv;
+};
+
+static unsigned __stdcall Sys_ThreadProc(void* param)
+{
+	sys_thread_t* thread = param;
+
+	thread->func(thread->arg);
+	return 0;
+}
+
+/*
+================
+Sys_ThreadCreate
+
+Starts func(arg) on a new thread. The name shows up in debuggers.
+================
+*/
+sys_thread_t* Sys_ThreadCreate(void (*func)(void* arg), void* arg, char* name)
+{
+	sys_thread_t*	thread;
+	wchar_t			wide_name[64];
+
+	thread = malloc(sizeof(sys_thread_t));
+
+	if (!thread)
+		Sys_Error("Sys_ThreadCreate: out of memory");
+
+	thread->func = func;
+	thread->arg = arg;
+	thread->handle = (HANDLE)_beginthreadex(NULL, 0, Sys_ThreadProc, thread, 0, NULL);
+
+	if (!thread->handle)
+		Sys_Error("Sys_ThreadCreate: couldn't create %s", name);
+
+	if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wide_name, sizeof(wide_name) / sizeof(wchar_t)))
+		SetThreadDescription(thread->handle, wide_name);
+
+	return thread;
+}
+
+/*
+================
+Sys_ThreadJoin
+
+Waits for the thread to return and frees it
+================
+*/
+void Sys_ThreadJoin(sys_thread_t* thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	free(thread);
+}
+
+int32_t Sys_CPUCount()
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
+sys_mutex_t* Sys_MutexCreate()
+{
+	sys_mutex_t* mutex = malloc(sizeof(sys_mutex_t));
+
+	if (!mutex)
+		Sys_Error("Sys_MutexCreate: out of memory");
+
+	InitializeCriticalSection(&mutex->cs);
+	return mutex;
+}
+
+void Sys_MutexDestroy(sys_mutex_t* mutex)
+{
+	DeleteCriticalSection(&mutex->cs);
+	free(mutex);
+}
+
+void Sys_MutexLock(sys_mutex_t* mutex)
+{
+	EnterCriticalSection(&mutex->cs);
+}
+
+void Sys_MutexUnlock(sys_mutex_t* mutex)
+{
+	LeaveCriticalSection(&mutex->cs);
+}
+
+sys_cond_t* Sys_CondCreate()
+{
+	sys_cond_t* cond = malloc(sizeof(sys_cond_t));
+
+	if (!cond)
+		Sys_Error("Sys_CondCreate: out of memory");
+
+	InitializeConditionVariable(&cond->cv);
+	return cond;
+}
+
+void Sys_CondDestroy(sys_cond_t* cond)
+{
+	// condition variables have nothing to release on windows
+	free(cond);
+}
+
+// the mutex must be held, it is released while waiting and held again on return
+void Sys_CondWait(sys_cond_t* cond, sys_mutex_t* mutex)
+{
+	SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE);
+}
+
+void Sys_CondSignal(sys_cond_t* cond)
+{
+	WakeConditionVariable(&cond->cv);
+}
+
+void Sys_CondBroadcast(sys_cond_t* cond)
+{
+	WakeAllConditionVariable(&cond->cv);
+}
@@ -349,6 +349,12 @@ IMPORTED FUNCTIONS
 
 extern	refimport_t	ri;
 
+// the renderer doesn't link against common, so its zones go through ri
+#undef TIMELINE_BEGIN
+#undef TIMELINE_END
+#define TIMELINE_BEGIN(name)	do { if (*ri.timeline_active) ri.Timeline_Begin(name); } while (0)
+#define TIMELINE_END()			do { if (*ri.timeline_active) ri.Timeline_End(); } while (0)
+
 /*
 ====================================================================
 
@@ -914,6 +914,8 @@ void R_BeginRegistration(char* model)
 	char	fullname[MAX_QPATH];
 	cvar_t* flushmap;
 
+	TIMELINE_BEGIN("R_BeginRegistration");
+
 	registration_sequence++;
 	r_oldviewcluster = -1;		// force markleafs
 
@@ -929,6 +931,8 @@ void R_BeginRegistration(char* model)
 	r_worldmodel = Mod_ForName(fullname, true);
 
 	r_viewcluster = -1;
+
+	TIMELINE_END();
 }
 
 
@@ -945,6 +949,7 @@ struct model_s* R_RegisterModel(char* name)
 	dsprite_t*	sprout;
 	dmdl_t*		pheader;
 
+	TIMELINE_BEGIN("R_RegisterModel");
 	mod = Mod_ForName(name, false);
 	if (mod)
 	{
@@ -971,6 +976,7 @@ struct model_s* R_RegisterModel(char* name)
 		}
 	}
 
+	TIMELINE_END();
 	return mod;
 }
 
@@ -984,6 +990,8 @@ void R_EndRegistration()
 	int32_t	 i;
 	model_t* mod;
 
+	TIMELINE_BEGIN("R_EndRegistration");
+
 	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
 	{
 		if (!mod->name[0])
@@ -996,6 +1004,8 @@ void R_EndRegistration()
 	}
 
 	GL_FreeUnusedImages();
+
+	TIMELINE_END();
 }
 
 
@@ -700,9 +700,11 @@ R_RenderFrame
 */
 void R_RenderFrame(refdef_t* fd)
 {
+	TIMELINE_BEGIN("R_RenderFrame");
 	R_RenderView(fd);
 	R_SetLightLevel();
 	R_SetGL2D();
+	TIMELINE_END();
 }
 
 void R_Register(void)
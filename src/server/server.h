@@ -68,6 +68,15 @@ typedef struct
 	// demo server information
 	FILE*			demofile;
 	bool			timedemo;		// don't time sync
+
+	// signon data, encoded once per map and copied into the reliable stream of each connecting client
+	sizebuf_t		signon_configstrings;		// rebuilt on demand after a configstring changes
+	bool			signon_configstrings_valid;
+	int32_t 		signon_configstring_offsets[MAX_CONFIGSTRINGS + 1];	// where each configstring starts
+	sizebuf_t		signon_baselines;			// built once the baselines are created
+	int32_t 		signon_baseline_offsets[MAX_EDICTS + 1];			// where each baseline starts
+
+	msg_quantize_t	quantize;			// frame precision for PROTOCOL_VERSION_QUANTIZED clients, fixed for the level
 } server_t;
 
 #define EDICT_NUM(n) ((edict_t *)((uint8_t *)ge->edicts + ge->edict_size*(n)))
@@ -135,6 +144,11 @@ typedef struct client_s
 	int32_t 		challenge;			// challenge of this user, randomly generated
 
 	netchan_t		netchan;
+
+	int32_t 		protocol;			// PROTOCOL_VERSION or PROTOCOL_VERSION_QUANTIZED
+
+	bool			relay_start;		// ZombieTV viewer waiting for the relay to have a map
+	player_state_t	relay_ps;			// ZombieTV viewer's free flying camera, viewers have no edict
 } client_t;
 
 // a client can leave the server in one of four ways:
@@ -193,6 +207,7 @@ extern server_static_t	svs;				// persistant server info
 extern server_t			sv;					// local server
 
 extern cvar_t* sv_tickrate;			// server tickrate
+extern cvar_t* sv_timedemo;
 
 extern cvar_t* hostname;
 extern cvar_t* sv_paused;
@@ -212,6 +227,11 @@ extern cvar_t* sv_friction;
 extern cvar_t* sv_waterfriction;
 extern cvar_t* sv_waterspeed;
 
+// bit packed frames
+extern cvar_t* sv_quantize;
+extern cvar_t* sv_quantize_coordbits;
+extern cvar_t* sv_quantize_anglebits;
+
 // master stuff
 extern cvar_t* public_server;
 // development tool
@@ -265,6 +285,11 @@ void Netservices_MasterHeartbeatLegacy(); // DEPRECATED!!!!
 void SV_InitGame();
 void SV_Map(bool attractloop, char* levelstring, bool loadgame);
 
+void SV_BuildSignon();
+void SV_InvalidateSignon();
+void SV_FreeSignon();
+sizebuf_t* SV_SignonConfigstrings();
+
 
 //
 // sv_phys.c
@@ -294,7 +319,10 @@ void SV_BroadcastCommand(char* fmt, ...);
 // sv_user.c
 //
 void SV_Nextserver();
+void SV_New_f();
 void SV_ExecuteClientMessage(client_t* cl);
+int32_t SV_ClientSnapScale(client_t* cl);
+void SV_PlayerMove(pmove_t* pm);
 
 //
 // sv_ccmds.c
@@ -305,8 +333,11 @@ void SV_Status_f();
 //
 // sv_ents.c
 //
+extern uint8_t fatpvs[65536 / 8];
+
 void SV_WriteFrameToClient(client_t* client, sizebuf_t* msg);
 void SV_RecordDemoMessage();
+void SV_FatPVS(vec3_t org);
 void SV_BuildClientFrame(client_t* client);
 
 //
@@ -317,6 +348,93 @@ extern game_export_t* ge;
 void SV_InitGameProgs();
 void SV_ShutdownGameProgs();
 
+//
+// server_perf.c
+//
+typedef enum perfphase_e
+{
+	perf_frame,				// the whole tick
+	perf_readpackets,
+	perf_gameframe,
+	perf_buildframe,
+	perf_writeframe,
+	perf_transmit,
+	perf_trace,				// only with sv_perf_traces
+	perf_netservices,
+	perf_traces,			// counts, from c_traces and c_pointcontents
+	perf_pointcontents,
+	perf_max
+} perfphase_t;
+
+extern cvar_t* sv_perf_enable;
+extern cvar_t* sv_perf_traces;
+
+void SV_PerfInit();
+void SV_PerfEnd(perfphase_t phase, int64_t start);
+void SV_PerfAdd(perfphase_t phase, int64_t amount);
+void SV_PerfFrame();
+
+//
+// server_demo.c
+//
+void SV_DemoInit();
+void SV_DemoConfigstrings(int32_t maxsize, void (*write)(uint8_t* data, int32_t length));
+void SV_DemoBaselines(int32_t maxsize, void (*write)(uint8_t* data, int32_t length));
+void SV_DemoServerdata(sizebuf_t* msg);
+bool SV_DemoStart(char* name);
+void SV_DemoStop();
+void SV_DemoWriteMessage(sizebuf_t* msg);
+void SV_DemoKeyframe();
+void SV_DemoFrame();
+void SV_DemoOpen(char* name);
+void SV_DemoClose();
+bool SV_DemoReadMessage(uint8_t* msgbuf, int32_t* msglen);
+bool SV_DemoCatchUp();
+
+//
+// server_save.c
+//
+void SV_SaveBegin(char* description);
+void SV_SaveWrite(char* name, uint8_t* data, int32_t length);
+void SV_SaveRename(char* name);
+void SV_SaveCopy(char* source, char* name);
+void SV_SaveRemove(char* name);
+bool SV_SavePending(char* name);
+void SV_SaveCommit();
+void SV_SaveWait();
+void SV_SaveDiscard();
+void SV_SaveFrame();
+
+//
+// server_relay.c
+//
+#define RELAY_MARKER		-2			// leads every ZombieTV stream packet, connectionless packets have -1
+#define RELAY_PLAYERNUM		(MAX_EDICTS - 2)	// sent to viewers as their playernum, no relayed entity is theirs
+
+void SV_RelayInit();
+void SV_RelayShutdown();
+void SV_RelayFrame();
+void SV_RelayPacket();
+void SV_RelaySubscribe();
+void SV_RelayUnsubscribe();
+void SV_RelayDisconnect();
+void SV_RelayBroadcast(uint8_t* data, int32_t length);
+int32_t SV_RelaySubscribers();
+bool SV_RelayUpstream();
+bool SV_RelayReady();
+void SV_RelayBuildClientFrame(client_t* client);
+void SV_RelayBeginViewer(client_t* client);
+void SV_RelayViewerThink(client_t* client, usercmd_t* cmd);
+void SV_RelayPrepFrame();
+
+//
+// server_loadtest.c
+//
+void LoadTest_Init();
+void LoadTest_Frame();
+void LoadTest_FrameTime(int64_t ns, bool game_frame);
+bool LoadTest_Active();
+
 //============================================================
 
 //
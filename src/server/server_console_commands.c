@@ -161,6 +161,9 @@ void SV_WipeSavegame(char* savename)
 
 	Com_DPrintf("SV_WipeSaveGame(%s)\n", savename);
 
+	// don't let a save in flight put files back
+	SV_SaveWait();
+
 	snprintf(name, sizeof(name), "%s/save/%s/server.ssv", FS_Gamedir(), savename);
 	remove(name);
 	snprintf(name, sizeof(name), "%s/save/%s/game.ssv", FS_Gamedir(), savename);
@@ -184,89 +187,110 @@ void SV_WipeSavegame(char* savename)
 	Sys_FindClose();
 }
 
+#define MAX_SAVE_LEVELS		128
 
 /*
 ================
-CopyFile
+SV_FindSaveLevels
+
+Names of the levels saved in save/<savename>/, without the .sav
 ================
 */
-void SV_CopyFile(char* src, char* dst)
+static int32_t SV_FindSaveLevels(char* savename, char levels[MAX_SAVE_LEVELS][MAX_QPATH])
 {
-	FILE* f1, * f2;
-	size_t	l;
-	uint8_t	buffer[65536];
-
-	Com_DPrintf("CopyFile (%s, %s)\n", src, dst);
+	char	name[MAX_OSPATH];
+	char*	found;
+	int32_t count, len;
 
-	f1 = fopen(src, "rb");
-	if (!f1)
-		return;
-	f2 = fopen(dst, "wb");
-	if (!f2)
-	{
-		fclose(f1);
-		return;
-	}
+	snprintf(name, sizeof(name), "%s/save/%s/", FS_Gamedir(), savename);
+	len = (int32_t)strlen(name);
+	snprintf(name, sizeof(name), "%s/save/%s/*.sav", FS_Gamedir(), savename);
 
-	while (1)
+	count = 0;
+	found = Sys_FindFirst(name, 0, 0);
+	while (found && count < MAX_SAVE_LEVELS)
 	{
-		l = fread(buffer, 1, sizeof(buffer), f1);
-		if (!l)
-			break;
-		fwrite(buffer, 1, l, f2);
+		strncpy(levels[count], found + len, MAX_QPATH - 1);
+		levels[count][MAX_QPATH - 1] = 0;
+		COM_StripExtension(levels[count], levels[count]);
+		count++;
+		found = Sys_FindNext(0, 0);
 	}
+	Sys_FindClose();
 
-	fclose(f1);
-	fclose(f2);
+	return count;
 }
 
-
 /*
 ================
 SV_CopySaveGame
+
+Adds copying save/<src>/ over save/<dst>/ to the save being captured.
+The directories are listed now, the files are copied by the save thread.
 ================
 */
 void SV_CopySaveGame(char* src, char* dst)
 {
-	char	name[MAX_OSPATH], name2[MAX_OSPATH];
-	int32_t 	l, len;
-	char* found;
+	static char	levels[MAX_SAVE_LEVELS][MAX_QPATH];
+	static char	old_levels[MAX_SAVE_LEVELS][MAX_QPATH];
+	char		name[MAX_OSPATH], name2[MAX_OSPATH];
+	int32_t 	num_levels, num_old_levels, i, j;
 
 	Com_DPrintf("SV_CopySaveGame(%s, %s)\n", src, dst);
 
-	SV_WipeSavegame(dst);
+	num_levels = SV_FindSaveLevels(src, levels);
+	num_old_levels = SV_FindSaveLevels(dst, old_levels);
+
+	// the level being saved right now isn't on disk yet
+	snprintf(name, sizeof(name), "%s/save/%s/%s.sav", FS_Gamedir(), src, sv.name);
+	if (SV_SavePending(name) && num_levels < MAX_SAVE_LEVELS)
+	{
+		for (i = 0; i < num_levels; i++)
+		{
+			if (!Q_stricmp(levels[i], sv.name))
+				break;
+		}
+
+		if (i == num_levels)
+			strcpy(levels[num_levels++], sv.name);
+	}
 
 	// copy the savegame over
 	snprintf(name, sizeof(name), "%s/save/%s/server.ssv", FS_Gamedir(), src);
 	snprintf(name2, sizeof(name2), "%s/save/%s/server.ssv", FS_Gamedir(), dst);
 	FS_CreatePath(name2);
-	SV_CopyFile(name, name2);
+	SV_SaveCopy(name, name2);
 
 	snprintf(name, sizeof(name), "%s/save/%s/game.ssv", FS_Gamedir(), src);
 	snprintf(name2, sizeof(name2), "%s/save/%s/game.ssv", FS_Gamedir(), dst);
-	SV_CopyFile(name, name2);
+	SV_SaveCopy(name, name2);
 
-	snprintf(name, sizeof(name), "%s/save/%s/", FS_Gamedir(), src);
-	len = (int32_t)strlen(name);
-	snprintf(name, sizeof(name), "%s/save/%s/*.sav", FS_Gamedir(), src);
-	found = Sys_FindFirst(name, 0, 0);
-	while (found)
+	for (i = 0; i < num_levels; i++)
 	{
-		strcpy(name + len, found + len);
+		snprintf(name, sizeof(name), "%s/save/%s/%s.sav", FS_Gamedir(), src, levels[i]);
+		snprintf(name2, sizeof(name2), "%s/save/%s/%s.sav", FS_Gamedir(), dst, levels[i]);
+		SV_SaveCopy(name, name2);
 
-		snprintf(name2, sizeof(name2), "%s/save/%s/%s", FS_Gamedir(), dst, found + len);
-		SV_CopyFile(name, name2);
+		snprintf(name, sizeof(name), "%s/save/%s/%s.sv2", FS_Gamedir(), src, levels[i]);
+		snprintf(name2, sizeof(name2), "%s/save/%s/%s.sv2", FS_Gamedir(), dst, levels[i]);
+		SV_SaveCopy(name, name2);
+	}
 
-		// change sav to sv2
-		l = (int32_t)strlen(name);
-		strcpy(name + l - 3, "sv2");
-		l = (int32_t)strlen(name2);
-		strcpy(name2 + l - 3, "sv2");
-		SV_CopyFile(name, name2);
+	// remove levels that were in dst but aren't in src
+	for (i = 0; i < num_old_levels; i++)
+	{
+		for (j = 0; j < num_levels; j++)
+		{
+			if (!Q_stricmp(old_levels[i], levels[j]))
+				break;
+		}
 
-		found = Sys_FindNext(0, 0);
+		if (j < num_levels)
+			continue;
+
+		SV_SaveRemove(va("%s/save/%s/%s.sav", FS_Gamedir(), dst, old_levels[i]));
+		SV_SaveRemove(va("%s/save/%s/%s.sv2", FS_Gamedir(), dst, old_levels[i]));
 	}
-	Sys_FindClose();
 }
 
 
@@ -274,28 +298,31 @@ void SV_CopySaveGame(char* src, char* dst)
 ==============
 SV_WriteLevelFile
 
+Adds the current level to the save being captured
 ==============
 */
 void SV_WriteLevelFile()
 {
-	char	name[MAX_OSPATH];
-	FILE* f;
+	char		name[MAX_OSPATH];
+	uint8_t*	data;
+	void*		portals;
+	int32_t 	portals_length;
 
 	Com_DPrintf("SV_WriteLevelFile()\n");
 
+	// the configstrings and areaportals are copied now and written by the save thread
+	portals = Map_PortalState(&portals_length);
+	data = Memory_ZoneMalloc(sizeof(sv.configstrings) + portals_length);
+	memcpy(data, sv.configstrings, sizeof(sv.configstrings));
+	memcpy(data + sizeof(sv.configstrings), portals, portals_length);
+
 	snprintf(name, sizeof(name), "%s/save/current/%s.sv2", FS_Gamedir(), sv.name);
-	f = fopen(name, "wb");
-	if (!f)
-	{
-		Com_Printf("Failed to open %s\n", name);
-		return;
-	}
-	fwrite(sv.configstrings, sizeof(sv.configstrings), 1, f);
-	Map_WritePortalState(f);
-	fclose(f);
+	SV_SaveWrite(name, data, sizeof(sv.configstrings) + portals_length);
 
+	// the game writes its own file, to a temporary name until the save thread renames it
 	snprintf(name, sizeof(name), "%s/save/current/%s.sav", FS_Gamedir(), sv.name);
-	ge->Level_Write(name);
+	ge->Level_Write(va("%s.tmp", name));
+	SV_SaveRename(name);
 }
 
 /*
@@ -311,6 +338,8 @@ void SV_ReadLevelFile()
 
 	Com_DPrintf("SV_ReadLevelFile()\n");
 
+	SV_SaveWait();
+
 	snprintf(name, sizeof(name), "%s/save/current/%s.sv2", FS_Gamedir(), sv.name);
 	f = fopen(name, "rb");
 	if (!f)
@@ -319,6 +348,7 @@ void SV_ReadLevelFile()
 		return;
 	}
 	FS_Read(sv.configstrings, sizeof(sv.configstrings), f);
+	SV_InvalidateSignon();
 	Map_ReadPortalState(f);
 	fclose(f);
 
@@ -330,26 +360,21 @@ void SV_ReadLevelFile()
 ==============
 SV_WriteServerFile
 
+Adds the server state to the save being captured
 ==============
 */
 void SV_WriteServerFile(bool autosave)
 {
-	FILE* f;
 	cvar_t* var;
 	char	name[MAX_OSPATH], string[128];
 	char	comment[32];
 	time_t	aclock;
 	struct tm* newtime;
+	uint8_t* data;
+	int32_t length, count;
 
 	Com_DPrintf("SV_WriteServerFile(%s)\n", autosave ? "true" : "false");
 
-	snprintf(name, sizeof(name), "%s/save/current/server.ssv", FS_Gamedir());
-	f = fopen(name, "wb");
-	if (!f)
-	{
-		Com_Printf("Couldn't write %s\n", name);
-		return;
-	}
 	// write the comment field
 	memset(comment, 0, sizeof(comment));
 
@@ -367,10 +392,22 @@ void SV_WriteServerFile(bool autosave)
 		snprintf(comment, sizeof(comment), "ENTERING %s", sv.configstrings[CS_NAME]);
 	}
 
-	fwrite(comment, 1, sizeof(comment), f);
+	count = 0;
+
+	for (var = cvar_vars; var; var = var->next)
+	{
+		if (var->flags & CVAR_LATCH)
+			count++;
+	}
+
+	data = Memory_ZoneMalloc(sizeof(comment) + sizeof(svs.mapcmd) + count * (sizeof(name) + sizeof(string)));
+
+	memcpy(data, comment, sizeof(comment));
+	length = sizeof(comment);
 
 	// write the mapcmd
-	fwrite(svs.mapcmd, 1, sizeof(svs.mapcmd), f);
+	memcpy(data + length, svs.mapcmd, sizeof(svs.mapcmd));
+	length += sizeof(svs.mapcmd);
 
 	// write all CVAR_LATCH cvars
 	// these will be things like skill and gamemode
@@ -388,15 +425,18 @@ void SV_WriteServerFile(bool autosave)
 		memset(string, 0, sizeof(string));
 		strcpy(name, var->name);
 		strcpy(string, var->string);
-		fwrite(name, 1, sizeof(name), f);
-		fwrite(string, 1, sizeof(string), f);
+		memcpy(data + length, name, sizeof(name));
+		memcpy(data + length + sizeof(name), string, sizeof(string));
+		length += sizeof(name) + sizeof(string);
 	}
 
-	fclose(f);
+	snprintf(name, sizeof(name), "%s/save/current/server.ssv", FS_Gamedir());
+	SV_SaveWrite(name, data, length);
 
 	// write game state
 	snprintf(name, sizeof(name), "%s/save/current/game.ssv", FS_Gamedir());
-	ge->Game_Write(name, autosave);
+	ge->Game_Write(va("%s.tmp", name), autosave);
+	SV_SaveRename(name);
 }
 
 /*
@@ -414,6 +454,8 @@ void SV_ReadServerFile()
 
 	Com_DPrintf("SV_ReadServerFile()\n");
 
+	SV_SaveWait();
+
 	snprintf(name, sizeof(name), "%s/save/current/server.ssv", FS_Gamedir());
 	f = fopen(name, "rb");
 	if (!f)
@@ -525,7 +567,9 @@ void SV_GameMap_f()
 				cl->edict->inuse = false;
 			}
 
+			SV_SaveBegin("level");
 			SV_WriteLevelFile();
+			SV_SaveCommit();
 
 			// we must restore these for clients to transfer over correctly
 			for (i = 0, cl = svs.clients; i < sv_maxclients->value; i++, cl++)
@@ -541,10 +585,13 @@ void SV_GameMap_f()
 	strncpy(svs.mapcmd, Cmd_Argv(1), sizeof(svs.mapcmd) - 1);
 
 	// copy off the level to the autosave slot
+	// on the save thread, so big units don't hold up the first frames of the map
 	if (!dedicated->value)
 	{
+		SV_SaveBegin("autosave");
 		SV_WriteServerFile(true);
 		SV_CopySaveGame("current", "save0");
+		SV_SaveCommit();
 	}
 }
 
@@ -643,6 +690,7 @@ void SV_Loadgame_f()
 	char	name[MAX_OSPATH];
 	FILE* f;
 	char* dir;
+	int64_t start;
 
 	if (Cmd_Argc() != 2)
 	{
@@ -651,6 +699,7 @@ void SV_Loadgame_f()
 	}
 
 	Com_Printf("Loading game...\n");
+	start = Sys_Nanoseconds();
 
 	dir = Cmd_Argv(1);
 	if (strstr(dir, "..") || strstr(dir, "/") || strstr(dir, "\\"))
@@ -658,7 +707,8 @@ void SV_Loadgame_f()
 		Com_Printf("Bad savedir.\n");
 	}
 
-	// make sure the server.ssv file exists
+	// make sure the server.ssv file exists, and that a save of it has finished
+	SV_SaveWait();
 	snprintf(name, sizeof(name), "%s/save/%s/server.ssv", FS_Gamedir(), Cmd_Argv(1));
 	f = fopen(name, "rb");
 	if (!f)
@@ -668,13 +718,17 @@ void SV_Loadgame_f()
 	}
 	fclose(f);
 
+	SV_SaveBegin("loadgame");
 	SV_CopySaveGame(Cmd_Argv(1), "current");
+	SV_SaveCommit();
 
 	SV_ReadServerFile();
 
 	// go to the map
 	sv.state = ss_dead;		// don't save current level when changing
 	SV_Map(false, svs.mapcmd, true);
+
+	Com_Printf("Loaded in %.2f ms\n", (Sys_Nanoseconds() - start) / 1000000.0);
 }
 
 
@@ -728,6 +782,8 @@ void SV_Savegame_f()
 
 	Com_Printf("Saving game...\n");
 
+	SV_SaveBegin(va("savegame %s", dir));
+
 	// archive current level, including all client edicts.
 	// when the level is reloaded, they will be shells awaiting
 	// a connecting client
@@ -739,7 +795,8 @@ void SV_Savegame_f()
 	// copy it off
 	SV_CopySaveGame("current", dir);
 
-	Com_Printf("Done.\n");
+	// the files are written by the save thread, which reports when it's done
+	SV_SaveCommit();
 }
 
 //===============================================================
@@ -931,10 +988,6 @@ recorded, but no playerinfo will be stored.  Primarily for demo merging.
 void SV_ServerRecord_f()
 {
 	char	name[MAX_OSPATH];
-	char	buf_data[32768];
-	sizebuf_t	buf;
-	int32_t 	len;
-	int32_t 	i;
 
 	if (Cmd_Argc() != 2)
 	{
@@ -961,49 +1014,16 @@ void SV_ServerRecord_f()
 
 	Com_Printf("recording to %s.\n", name);
 	FS_CreatePath(name);
-	svs.demofile = fopen(name, "wb");
-	if (!svs.demofile)
-	{
-		Com_Printf("ERROR: couldn't open.\n");
-		return;
-	}
 
 	// setup a buffer to catch all multicasts
 	SZ_Init(&svs.demo_multicast, svs.demo_multicast_buf, sizeof(svs.demo_multicast_buf));
 
-	//
-	// write a single giant fake message with all the startup info
-	//
-	SZ_Init(&buf, buf_data, sizeof(buf_data));
-
-	//
-	// serverdata needs to go over for all types of servers
-	// to make sure the protocol is right, and to set the gamedir
-	//
-	// send the serverdata
-	MSG_WriteByte(&buf, svc_serverdata);
-	MSG_WriteInt(&buf, PROTOCOL_VERSION);
-	MSG_WriteInt(&buf, svs.spawncount);
-	// 2 means server demo
-	MSG_WriteByte(&buf, 2);	// demos are always attract loops
-	MSG_WriteString(&buf, Cvar_VariableString("game_asset_path"));
-	MSG_WriteShort(&buf, -1);
-	// send full levelname
-	MSG_WriteString(&buf, sv.configstrings[CS_NAME]);
-
-	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
-		if (sv.configstrings[i][0])
-		{
-			MSG_WriteByte(&buf, svc_configstring);
-			MSG_WriteShort(&buf, i);
-			MSG_WriteString(&buf, sv.configstrings[i]);
-		}
-
-	// write it to the demo file
-	Com_DPrintf("signon message length: %i\n", buf.cursize);
-	len = LittleInt(buf.cursize);
-	fwrite(&len, 4, 1, svs.demofile);
-	fwrite(buf.data, buf.cursize, 1, svs.demofile);
+	// the demo writer starts with a keyframe
+	if (!SV_DemoStart(name))
+	{
+		Com_Printf("ERROR: couldn't open.\n");
+		return;
+	}
 
 	// the rest of the demo file will be individual frames
 }
@@ -1023,8 +1043,7 @@ void SV_ServerStop_f()
 		Com_Printf("Not doing a serverrecord.\n");
 		return;
 	}
-	fclose(svs.demofile);
-	svs.demofile = NULL;
+	SV_DemoStop();
 	Com_Printf("Recording completed.\n");
 }
 
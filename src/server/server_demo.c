@@ -0,0 +1,844 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// server_demo.c -- serverrecord file writer and demo playback
+//
+// The main thread appends demo messages to the front buffer. At the end of the
+// frame the buffer is handed to the writer thread, which compresses and writes
+// it while the next frames fill the other one. If the disk is slow the front
+// buffer grows instead of blocking the tick.
+//
+// The file is a stream of messages, each prefixed by its little endian length.
+// With sv_demo_compress, a message is huffman coded when that makes it smaller:
+// its length has DEMO_COMPRESSED set and is followed by the uncompressed length.
+//
+// The recording starts with a keyframe: the serverdata, the configstrings and
+// the baselines. Every sv_demo_keyframe seconds another one is written and the
+// file is flushed. Server demo frames are never delta compressed, so from a
+// keyframe on the demo holds the full game state. A recording cut short still
+// plays up to its last keyframe, a demo cut at a keyframe plays on its own, and
+// recordings of the same map can be joined. Playback skips the serverdata of
+// every keyframe but the first.
+//
+// Next to the demo, <demo>.idx lists the file offset and first server frame of
+// every keyframe. demo_seek and demo_ff use it to jump to the nearest keyframe
+// and play quickly from there to the requested frame.
+
+#include "server.h"
+
+#define DEMO_BUFFER_SIZE		262144		// initial size of each buffer, they grow if the writer falls behind
+
+typedef struct demobuffer_s
+{
+	uint8_t*	data;
+	int32_t 	size;
+	int32_t 	length;
+	bool		flush;			// fflush after writing, set for keyframes
+} demobuffer_t;
+
+static demobuffer_t		demo_buffers[2];
+static int32_t 			demo_front;			// the buffer the main thread appends to
+static bool				demo_busy;			// the writer thread owns the other buffer
+static bool				demo_quit;
+
+static sys_thread_t*	demo_thread;
+static sys_mutex_t*		demo_lock;
+static sys_cond_t*		demo_wake;			// signalled when the writer has work, or should quit
+static sys_cond_t*		demo_done;			// signalled when the writer has finished a buffer
+
+static bool				demo_compress;		// sv_demo_compress when the recording started
+static int32_t 			demo_last_keyframe;	// curtime
+
+// only touched by the writer thread once it is running
+static FILE*			demo_index_file;
+static int32_t 			demo_written;		// bytes written to the demo so far
+static int32_t 			demo_keyframe;		// offset of a keyframe waiting for its frame number, or -1
+
+static cvar_t*	sv_demo_compress;
+static cvar_t*	sv_demo_keyframe;
+
+/*
+==================
+SV_DemoWriteBuffer
+
+Runs on the writer thread
+==================
+*/
+static void SV_DemoWriteBuffer(demobuffer_t* buffer)
+{
+	uint8_t		compressed[MAX_MSGLEN];
+	uint8_t*	message;
+	int32_t 	offset, length, compressed_length;
+	int32_t 	header[2];
+	demoindex_t	entry;
+
+	for (offset = 0; offset < buffer->length; offset += 4 + length)
+	{
+		length = LittleInt(*(int32_t*)(buffer->data + offset));
+
+		// the end marker
+		if (length == -1)
+		{
+			fwrite(buffer->data + offset, 4, 1, svs.demofile);
+			demo_written += 4;
+			break;
+		}
+
+		message = buffer->data + offset + 4;
+
+		// a keyframe starts with the serverdata, it is indexed by the frame that follows it
+		if (length && message[0] == svc_serverdata)
+		{
+			demo_keyframe = demo_written;
+		}
+		else if (length >= 5 && message[0] == svc_frame && demo_keyframe >= 0)
+		{
+			memcpy(&entry.frame, message + 1, 4);		// already little endian
+			entry.offset = LittleInt(demo_keyframe);
+			fwrite(&entry, sizeof(entry), 1, demo_index_file);
+			demo_keyframe = -1;
+		}
+
+		if (demo_compress)
+		{
+			compressed_length = Huffman_Compress(message, length, compressed, sizeof(compressed));
+
+			if (compressed_length >= 0 && compressed_length + 4 < length)
+			{
+				header[0] = LittleInt(compressed_length | DEMO_COMPRESSED);
+				header[1] = LittleInt(length);
+				fwrite(header, sizeof(header), 1, svs.demofile);
+				fwrite(compressed, compressed_length, 1, svs.demofile);
+				demo_written += sizeof(header) + compressed_length;
+				continue;
+			}
+		}
+
+		fwrite(buffer->data + offset, 4 + length, 1, svs.demofile);
+		demo_written += 4 + length;
+	}
+
+	if (buffer->flush)
+	{
+		fflush(svs.demofile);
+		fflush(demo_index_file);
+	}
+}
+
+static void SV_DemoWriterThread(void* arg)
+{
+	demobuffer_t* buffer;
+
+	Sys_MutexLock(demo_lock);
+
+	while (true)
+	{
+		while (!demo_busy && !demo_quit)
+			Sys_CondWait(demo_wake, demo_lock);
+
+		if (!demo_busy)
+			break;		// asked to quit, with nothing left to write
+
+		buffer = &demo_buffers[demo_front ^ 1];
+
+		Sys_MutexUnlock(demo_lock);
+		SV_DemoWriteBuffer(buffer);
+		Sys_MutexLock(demo_lock);
+
+		buffer->length = 0;
+		buffer->flush = false;
+		demo_busy = false;
+		Sys_CondSignal(demo_done);
+	}
+
+	Sys_MutexUnlock(demo_lock);
+}
+
+/*
+==================
+SV_DemoReserve
+
+Makes room for length more bytes in the front buffer
+==================
+*/
+static demobuffer_t* SV_DemoReserve(int32_t length)
+{
+	demobuffer_t*	buffer = &demo_buffers[demo_front];
+	uint8_t*		new_data;
+
+	if (buffer->length + length <= buffer->size)
+		return buffer;
+
+	// the writer is behind, keep going in a bigger buffer rather than waiting for it
+	while (buffer->length + length > buffer->size)
+		buffer->size *= 2;
+
+	new_data = Memory_ZoneMalloc(buffer->size);
+	memcpy(new_data, buffer->data, buffer->length);
+	Memory_ZoneFree(buffer->data);
+	buffer->data = new_data;
+
+	Com_DPrintf("SV_DemoReserve: demo writer is behind, buffer grown to %i bytes\n", buffer->size);
+	return buffer;
+}
+
+/*
+==================
+SV_DemoAppend
+
+Appends a length prefixed message to the front buffer
+==================
+*/
+static void SV_DemoAppend(uint8_t* data, int32_t length)
+{
+	demobuffer_t*	buffer = SV_DemoReserve(4 + length);
+	int32_t 		prefix;
+
+	prefix = LittleInt(length);
+	memcpy(buffer->data + buffer->length, &prefix, 4);
+	memcpy(buffer->data + buffer->length + 4, data, length);
+	buffer->length += 4 + length;
+}
+
+/*
+==================
+SV_DemoWriteMessage
+==================
+*/
+void SV_DemoWriteMessage(sizebuf_t* msg)
+{
+	SV_DemoAppend(msg->data, msg->cursize);
+}
+
+/*
+==================
+SV_DemoConfigstrings
+
+The configstrings can be more than one message can hold, so they are split where a configstring starts.
+write is called with each message of at most maxsize bytes. ZombieTV relays send them the same way.
+==================
+*/
+void SV_DemoConfigstrings(int32_t maxsize, void (*write)(uint8_t* data, int32_t length))
+{
+	sizebuf_t*	signon;
+	int32_t 	start, end, i;
+
+	signon = SV_SignonConfigstrings();
+	start = sv.signon_configstring_offsets[0];
+
+	for (i = 1; i <= MAX_CONFIGSTRINGS; i++)
+	{
+		// keep going while configstring i still fits in this message
+		if (i < MAX_CONFIGSTRINGS && sv.signon_configstring_offsets[i + 1] - start <= maxsize)
+			continue;
+
+		end = sv.signon_configstring_offsets[i];
+
+		if (end > start)
+			write(signon->data + start, end - start);
+
+		start = end;
+	}
+}
+
+/*
+==================
+SV_DemoBaselines
+
+Splits the precomputed baselines into messages of at most maxsize bytes, like SV_DemoConfigstrings
+==================
+*/
+void SV_DemoBaselines(int32_t maxsize, void (*write)(uint8_t* data, int32_t length))
+{
+	int32_t 	start, end, i;
+
+	start = sv.signon_baseline_offsets[0];
+
+	for (i = 1; i <= MAX_EDICTS; i++)
+	{
+		if (i < MAX_EDICTS && sv.signon_baseline_offsets[i + 1] - start <= maxsize)
+			continue;
+
+		end = sv.signon_baseline_offsets[i];
+
+		if (end > start)
+			write(sv.signon_baselines.data + start, end - start);
+
+		start = end;
+	}
+}
+
+/*
+==================
+SV_DemoServerdata
+
+The serverdata message that starts a serverrecord demo or relay stream
+==================
+*/
+void SV_DemoServerdata(sizebuf_t* msg)
+{
+	//
+	// serverdata needs to go over for all types of servers
+	// to make sure the protocol is right, and to set the gamedir
+	//
+	MSG_WriteByte(msg, svc_serverdata);
+	MSG_WriteInt(msg, PROTOCOL_VERSION);
+	MSG_WriteInt(msg, svs.spawncount);
+	// 2 means server demo
+	MSG_WriteByte(msg, 2);	// demos are always attract loops
+	MSG_WriteString(msg, game_asset_path->string);
+	MSG_WriteShort(msg, -1);
+	// send full levelname
+	MSG_WriteString(msg, sv.configstrings[CS_NAME]);
+}
+
+/*
+==================
+SV_DemoFrame
+
+Called after the frame's demo message has been written. Hands the front buffer to the writer if it is idle.
+==================
+*/
+void SV_DemoFrame()
+{
+	if (!svs.demofile)
+		return;
+
+	Sys_MutexLock(demo_lock);
+
+	if (!demo_busy && demo_buffers[demo_front].length)
+	{
+		demo_front ^= 1;
+		demo_busy = true;
+		Sys_CondSignal(demo_wake);
+	}
+
+	Sys_MutexUnlock(demo_lock);
+}
+
+/*
+==================
+SV_DemoWriteKeyframe
+
+Everything a client needs before the next frame, so playback can start from here
+==================
+*/
+static void SV_DemoWriteKeyframe()
+{
+	sizebuf_t	buf;
+	uint8_t		buf_data[MAX_MSGLEN];
+
+	SZ_Init(&buf, buf_data, sizeof(buf_data));
+	SV_DemoServerdata(&buf);
+	SV_DemoWriteMessage(&buf);
+
+	SV_DemoConfigstrings(MAX_MSGLEN, SV_DemoAppend);
+	SV_DemoBaselines(MAX_MSGLEN, SV_DemoAppend);
+	demo_buffers[demo_front].flush = true;
+}
+
+/*
+==================
+SV_DemoKeyframe
+
+Called before every frame message, writes a keyframe every sv_demo_keyframe seconds
+==================
+*/
+void SV_DemoKeyframe()
+{
+	if (sv_demo_keyframe->value <= 0
+		|| curtime - demo_last_keyframe < sv_demo_keyframe->value * 1000)
+		return;
+
+	demo_last_keyframe = curtime;
+	SV_DemoWriteKeyframe();
+}
+
+/*
+==================
+SV_DemoStart
+
+Opens the file, writes the first keyframe and starts the writer
+==================
+*/
+bool SV_DemoStart(char* name)
+{
+	int32_t i;
+	int32_t header[2];
+
+	svs.demofile = fopen(name, "wb");
+
+	if (!svs.demofile)
+		return false;
+
+	demo_index_file = fopen(va("%s.idx", name), "wb");
+
+	if (!demo_index_file)
+	{
+		fclose(svs.demofile);
+		svs.demofile = NULL;
+		return false;
+	}
+
+	header[0] = LittleInt(DEMO_INDEX_MAGIC);
+	header[1] = LittleInt(DEMO_INDEX_VERSION);
+	fwrite(header, sizeof(header), 1, demo_index_file);
+
+	demo_written = 0;
+	demo_keyframe = -1;
+
+	for (i = 0; i < 2; i++)
+	{
+		demo_buffers[i].size = DEMO_BUFFER_SIZE;
+		demo_buffers[i].data = Memory_ZoneMalloc(DEMO_BUFFER_SIZE);
+		demo_buffers[i].length = 0;
+		demo_buffers[i].flush = false;
+	}
+
+	demo_front = 0;
+	demo_busy = false;
+	demo_quit = false;
+	demo_compress = sv_demo_compress->value != 0;
+	demo_last_keyframe = curtime;
+
+	demo_lock = Sys_MutexCreate();
+	demo_wake = Sys_CondCreate();
+	demo_done = Sys_CondCreate();
+
+	SV_DemoWriteKeyframe();
+
+	demo_thread = Sys_ThreadCreate(SV_DemoWriterThread, NULL, "demo writer");
+	SV_DemoFrame();
+
+	return true;
+}
+
+/*
+==================
+SV_DemoStop
+
+Writes the end marker, waits for everything to reach the disk and closes the file
+==================
+*/
+void SV_DemoStop()
+{
+	demobuffer_t*	buffer;
+	int32_t 		end = -1;
+	int32_t 		i;
+
+	if (!svs.demofile)
+		return;
+
+	// the -1 doesn't have a length prefix, so it can't go through SV_DemoAppend
+	buffer = SV_DemoReserve(4);
+	memcpy(buffer->data + buffer->length, &end, 4);
+	buffer->length += 4;
+
+	Sys_MutexLock(demo_lock);
+
+	// wait for the buffer the writer has, then give it the last one
+	while (demo_busy)
+		Sys_CondWait(demo_done, demo_lock);
+
+	if (demo_buffers[demo_front].length)
+	{
+		demo_front ^= 1;
+		demo_busy = true;
+		Sys_CondSignal(demo_wake);
+	}
+
+	demo_quit = true;
+	Sys_CondSignal(demo_wake);
+	Sys_MutexUnlock(demo_lock);
+
+	Sys_ThreadJoin(demo_thread);
+	demo_thread = NULL;
+
+	Sys_CondDestroy(demo_wake);
+	Sys_CondDestroy(demo_done);
+	Sys_MutexDestroy(demo_lock);
+
+	for (i = 0; i < 2; i++)
+	{
+		Memory_ZoneFree(demo_buffers[i].data);
+		demo_buffers[i].data = NULL;
+	}
+
+	fclose(svs.demofile);
+	svs.demofile = NULL;
+	fclose(demo_index_file);
+	demo_index_file = NULL;
+}
+
+/*
+=============================================================================
+
+PLAYBACK
+
+=============================================================================
+*/
+
+#define DEMO_PREFETCH_MAX		(512 * 1024 * 1024)	// timedemo reads demos up to this size into memory first
+#define DEMO_FF_MESSAGES		32					// messages sent per server frame while seeking
+
+static uint8_t*			demo_prefetch;			// the whole demo, for timedemo
+static int32_t 			demo_prefetch_length;
+static int32_t 			demo_prefetch_pos;
+static int32_t 			demo_file_start;		// where the demo starts in sv.demofile, which may be a pak
+
+static demoindex_t*		demo_index;
+static int32_t 			demo_index_count;
+
+static int32_t 			demo_frame;				// server frame of the last message read
+static int32_t 			demo_first_frame;		// -1 until the first svc_frame
+static int32_t 			demo_target_frame;		// fast forward until demo_frame reaches this, -1 when not seeking
+
+static bool SV_DemoRead(void* data, int32_t length)
+{
+	if (!demo_prefetch)
+		return fread(data, length, 1, sv.demofile) == 1;
+
+	if (demo_prefetch_pos + length > demo_prefetch_length)
+		return false;
+
+	memcpy(data, demo_prefetch + demo_prefetch_pos, length);
+	demo_prefetch_pos += length;
+	return true;
+}
+
+static void SV_DemoSetPosition(int32_t offset)
+{
+	if (demo_prefetch)
+		demo_prefetch_pos = offset;
+	else
+		fseek(sv.demofile, demo_file_start + offset, SEEK_SET);
+}
+
+/*
+==================
+SV_DemoLoadIndex
+==================
+*/
+static void SV_DemoLoadIndex(char* name)
+{
+	int32_t*	data;
+	int32_t 	length, i;
+
+	length = FS_LoadFile(va("%s.idx", name), (void**)&data);
+
+	if (!data)
+		return;
+
+	if (length < 8
+		|| LittleInt(data[0]) != DEMO_INDEX_MAGIC
+		|| LittleInt(data[1]) != DEMO_INDEX_VERSION)
+	{
+		Com_Printf("%s.idx is not a demo index\n", name);
+		FS_FreeFile(data);
+		return;
+	}
+
+	demo_index_count = (length - 8) / sizeof(demoindex_t);
+	demo_index = Memory_ZoneMalloc(demo_index_count * sizeof(demoindex_t) + 1);
+	memcpy(demo_index, data + 2, demo_index_count * sizeof(demoindex_t));
+
+	for (i = 0; i < demo_index_count; i++)
+	{
+		demo_index[i].frame = LittleInt(demo_index[i].frame);
+		demo_index[i].offset = LittleInt(demo_index[i].offset);
+	}
+
+	FS_FreeFile(data);
+}
+
+/*
+==================
+SV_DemoOpen
+
+Opens a demo for playback. With timedemo set the whole file is read first, so disk access isn't measured.
+==================
+*/
+void SV_DemoOpen(char* name)
+{
+	int32_t length;
+
+	SV_DemoClose();
+
+	length = FS_FOpenFile(name, &sv.demofile);
+
+	if (!sv.demofile)
+		Com_Error(ERR_DROP, "Couldn't open %s\n", name);
+
+	demo_file_start = ftell(sv.demofile);
+	demo_frame = 0;
+	demo_first_frame = -1;
+	demo_target_frame = -1;
+
+	if (sv_timedemo->value && length > 0 && length <= DEMO_PREFETCH_MAX)
+	{
+		demo_prefetch = Memory_ZoneMalloc(length);
+		demo_prefetch_length = length;
+		demo_prefetch_pos = 0;
+
+		if (fread(demo_prefetch, length, 1, sv.demofile) != 1)
+		{
+			Memory_ZoneFree(demo_prefetch);
+			demo_prefetch = NULL;
+			fseek(sv.demofile, demo_file_start, SEEK_SET);
+		}
+	}
+
+	SV_DemoLoadIndex(name);
+}
+
+/*
+==================
+SV_DemoClose
+==================
+*/
+void SV_DemoClose()
+{
+	if (sv.demofile)
+	{
+		fclose(sv.demofile);
+		sv.demofile = NULL;
+	}
+
+	if (demo_prefetch)
+	{
+		Memory_ZoneFree(demo_prefetch);
+		demo_prefetch = NULL;
+	}
+
+	if (demo_index)
+	{
+		Memory_ZoneFree(demo_index);
+		demo_index = NULL;
+	}
+
+	demo_index_count = 0;
+}
+
+/*
+==================
+SV_DemoReadMessage
+
+Reads the next message, decompressing it if needed. Returns false at the end of the demo.
+==================
+*/
+bool SV_DemoReadMessage(uint8_t* msgbuf, int32_t* msglen)
+{
+	uint8_t		compressed[MAX_MSGLEN];
+	int32_t 	length, compressed_length;
+
+	if (!SV_DemoRead(&length, 4))
+		return false;
+
+	length = LittleInt(length);
+
+	if (length == -1)
+		return false;
+
+	// huffman coded by sv_demo_compress, the uncompressed length follows
+	if (length & DEMO_COMPRESSED)
+	{
+		compressed_length = length & ~DEMO_COMPRESSED;
+
+		if (!SV_DemoRead(&length, 4))
+			return false;
+
+		length = LittleInt(length);
+
+		if (compressed_length > MAX_MSGLEN || length > MAX_MSGLEN
+			|| !SV_DemoRead(compressed, compressed_length)
+			|| Huffman_Decompress(compressed, compressed_length, msgbuf, length) < 0)
+			return false;
+	}
+	else
+	{
+		if (length > MAX_MSGLEN)
+			Com_Error(ERR_DROP, "SV_DemoReadMessage: msglen > MAX_MSGLEN");
+
+		if (!SV_DemoRead(msgbuf, length))
+			return false;
+	}
+
+	// the serverdata of a later keyframe would restart the client
+	if (length && msgbuf[0] == svc_serverdata && demo_first_frame >= 0)
+		return SV_DemoReadMessage(msgbuf, msglen);
+
+	// server demo frames start with the frame number, as do most client demo packets
+	if (length >= 5 && msgbuf[0] == svc_frame)
+	{
+		memcpy(&demo_frame, msgbuf + 1, 4);
+		demo_frame = LittleInt(demo_frame);
+
+		if (demo_first_frame < 0)
+			demo_first_frame = demo_frame;
+	}
+	else if (demo_first_frame >= 0)
+	{
+		demo_frame++;
+	}
+
+	*msglen = length;
+	return true;
+}
+
+/*
+==================
+SV_DemoCatchUp
+
+While seeking, sends messages to the clients as fast as they'll take them.
+Returns false at the end of the demo.
+==================
+*/
+bool SV_DemoCatchUp()
+{
+	uint8_t		msgbuf[MAX_MSGLEN];
+	int32_t 	msglen, count, i;
+	client_t*	c;
+
+	for (count = 0; demo_target_frame >= 0 && count < DEMO_FF_MESSAGES; count++)
+	{
+		// the last message before the target is sent by SV_SendClientMessages as usual
+		if (demo_frame >= demo_target_frame - 1)
+		{
+			demo_target_frame = -1;
+			break;
+		}
+
+		if (!SV_DemoReadMessage(msgbuf, &msglen))
+			return false;
+
+		for (i = 0, c = svs.clients; i < sv_maxclients->value; i++, c++)
+		{
+			if (c->state)
+				Netchan_Transmit(&c->netchan, msglen, msgbuf);
+		}
+	}
+
+	return true;
+}
+
+/*
+==================
+SV_DemoSeek
+
+Goes to the given server frame, from the nearest keyframe at or before it when the demo has an index
+==================
+*/
+static void SV_DemoSeek(int32_t target)
+{
+	int32_t best, i;
+
+	if (demo_first_frame < 0)
+	{
+		Com_Printf("The demo hasn't started yet.\n");
+		return;
+	}
+
+	if (target < demo_first_frame)
+		target = demo_first_frame;
+
+	best = -1;
+
+	for (i = 0; i < demo_index_count; i++)
+	{
+		if (demo_index[i].frame <= target)
+			best = i;
+	}
+
+	// jump if going backwards, or if there's a keyframe between here and the target
+	if (best >= 0
+		&& (target <= demo_frame || demo_index[best].frame > demo_frame))
+	{
+		SV_DemoSetPosition(demo_index[best].offset);
+		demo_frame = demo_index[best].frame - 1;
+	}
+	else if (target <= demo_frame)
+	{
+		Com_Printf("This demo has no index, it can only be fast forwarded.\n");
+		return;
+	}
+
+	demo_target_frame = target;
+}
+
+/*
+==================
+SV_DemoSeek_f
+
+demo_seek <seconds>, from the start of the demo
+==================
+*/
+static void SV_DemoSeek_f()
+{
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("demo_seek <seconds>: go to this time in the demo\n");
+		return;
+	}
+
+	if (sv.state != ss_demo || !sv.demofile)
+	{
+		Com_Printf("Not playing a demo.\n");
+		return;
+	}
+
+	SV_DemoSeek(demo_first_frame + (int32_t)(atof(Cmd_Argv(1)) * sv_tickrate->value));
+}
+
+/*
+==================
+SV_DemoFastForward_f
+
+demo_ff <seconds>, negative to go back
+==================
+*/
+static void SV_DemoFastForward_f()
+{
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("demo_ff <seconds>: skip forward, or back if negative\n");
+		return;
+	}
+
+	if (sv.state != ss_demo || !sv.demofile)
+	{
+		Com_Printf("Not playing a demo.\n");
+		return;
+	}
+
+	SV_DemoSeek(demo_frame + (int32_t)(atof(Cmd_Argv(1)) * sv_tickrate->value));
+}
+
+/*
+==================
+SV_DemoInit
+==================
+*/
+void SV_DemoInit()
+{
+	sv_demo_compress = Cvar_Get("sv_demo_compress", "0", CVAR_ARCHIVE);
+	sv_demo_keyframe = Cvar_Get("sv_demo_keyframe", "10", CVAR_ARCHIVE);
+
+	Cmd_AddCommand("demo_seek", SV_DemoSeek_f);
+	Cmd_AddCommand("demo_ff", SV_DemoFastForward_f);
+}
@@ -36,13 +36,12 @@ SV_EmitPacketEntities
 Writes a delta update of an entity_state_t list to the message.
 =============
 */
-void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t *msg)
+void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t *msg, msg_quantize_t *quant)
 {
 	entity_state_t	*oldent = NULL, *newent = NULL;
 	int32_t 	oldindex, newindex;
 	int32_t 	oldnum, newnum;
 	int32_t 	from_num_entities;
-	int32_t 	bits;
 
 	MSG_WriteByte (msg, svc_packetentities);
 
@@ -77,7 +76,7 @@ void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t
 			// in any bytes being emited if the entity has not changed at all
 			// note that players are always 'newentities', this updates their oldorigin always
 			// and prevents warping
-			MSG_WriteDeltaEntity (oldent, newent, msg, false, newent->number <= sv_maxclients->value);
+			MSG_WriteDeltaEntityPacked (oldent, newent, msg, false, newent->number <= sv_maxclients->value, quant);
 			oldindex++;
 			newindex++;
 			continue;
@@ -85,32 +84,21 @@ void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t
 
 		if (newnum < oldnum)
 		{	// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (&sv.baselines[newnum], newent, msg, true, true);
+			MSG_WriteDeltaEntityPacked (&sv.baselines[newnum], newent, msg, true, true, quant);
 			newindex++;
 			continue;
 		}
 
 		if (newnum > oldnum)
 		{	// the old entity isn't present in the new message
-			bits = U_REMOVE;
-			if (oldnum >= 256)
-				bits |= U_NUMBER16 | U_MOREBITS1;
-
-			MSG_WriteByte (msg,	bits&255 );
-			if (bits & 0x0000ff00)
-				MSG_WriteByte (msg,	(bits>>8)&255 );
-
-			if (bits & U_NUMBER16)
-				MSG_WriteShort (msg, oldnum);
-			else
-				MSG_WriteByte (msg, oldnum);
+			MSG_WriteEntityHeader (msg, U_REMOVE, oldnum, quant);
 
 			oldindex++;
 			continue;
 		}
 	}
 
-	MSG_WriteShort (msg, 0);	// end of packetentities
+	MSG_WriteEntityHeader (msg, 0, 0, quant);	// end of packetentities
 }
 
 
@@ -121,197 +109,15 @@ SV_WritePlayerstateToClient
 
 =============
 */
-void SV_WritePlayerstateToClient (client_frame_t *from, client_frame_t *to, sizebuf_t *msg)
+void SV_WritePlayerstateToClient (client_frame_t *from, client_frame_t *to, sizebuf_t *msg, msg_quantize_t *quant)
 {
-	int32_t 		i;
-	int32_t 		pflags;
-	player_state_t	*ps, *ops;
 	player_state_t	dummy;
-	int32_t 		statbits;
 
-	ps = &to->ps;
 	if (!from)
-	{
 		memset (&dummy, 0, sizeof(dummy));
-		ops = &dummy;
-	}
-	else
-		ops = &from->ps;
-
-	//
-	// determine what needs to be sent
-	//
-	pflags = 0;
-
-	if (ps->pmove.pm_type != ops->pmove.pm_type)
-		pflags |= PS_M_TYPE;
-
-	if (ps->pmove.origin[0] != ops->pmove.origin[0]
-		|| ps->pmove.origin[1] != ops->pmove.origin[1]
-		|| ps->pmove.origin[2] != ops->pmove.origin[2] )
-		pflags |= PS_M_ORIGIN;
-
-	if (ps->pmove.velocity[0] != ops->pmove.velocity[0]
-		|| ps->pmove.velocity[1] != ops->pmove.velocity[1]
-		|| ps->pmove.velocity[2] != ops->pmove.velocity[2] )
-		pflags |= PS_M_VELOCITY;
-
-	if (ps->pmove.pm_time != ops->pmove.pm_time)
-		pflags |= PS_M_TIME;
-
-	if (ps->pmove.pm_flags != ops->pmove.pm_flags)
-		pflags |= PS_M_FLAGS;
-
-	if (ps->pmove.gravity != ops->pmove.gravity)
-		pflags |= PS_M_GRAVITY;
-
-	if (ps->pmove.delta_angles[0] != ops->pmove.delta_angles[0]
-		|| ps->pmove.delta_angles[1] != ops->pmove.delta_angles[1]
-		|| ps->pmove.delta_angles[2] != ops->pmove.delta_angles[2] )
-		pflags |= PS_M_DELTA_ANGLES;
-
-	if (ps->vieworigin[0] != ops->vieworigin[0]
-		|| ps->vieworigin[1] != ops->vieworigin[1]
-		|| ps->vieworigin[2] != ops->vieworigin[2])
-		pflags |= PS_VIEWORIGIN;
-
-	if (ps->camera_type != ops->camera_type)
-		pflags |= PS_CAMERATYPE;
 
-	if (ps->viewoffset[0] != ops->viewoffset[0]
-		|| ps->viewoffset[1] != ops->viewoffset[1]
-		|| ps->viewoffset[2] != ops->viewoffset[2] )
-		pflags |= PS_VIEWOFFSET;
-
-	if (ps->viewangles[0] != ops->viewangles[0]
-		|| ps->viewangles[1] != ops->viewangles[1]
-		|| ps->viewangles[2] != ops->viewangles[2] )
-		pflags |= PS_VIEWANGLES;
-
-	if (ps->kick_angles[0] != ops->kick_angles[0]
-		|| ps->kick_angles[1] != ops->kick_angles[1]
-		|| ps->kick_angles[2] != ops->kick_angles[2] )
-		pflags |= PS_KICKANGLES;
-
-	if (ps->blend[0] != ops->blend[0]
-		|| ps->blend[1] != ops->blend[1]
-		|| ps->blend[2] != ops->blend[2]
-		|| ps->blend[3] != ops->blend[3] )
-		pflags |= PS_BLEND;
-
-	if (ps->fov != ops->fov)
-		pflags |= PS_FOV;
-
-	if (ps->rdflags != ops->rdflags)
-		pflags |= PS_RDFLAGS;
-
-	if (ps->gunframe != ops->gunframe)
-		pflags |= PS_WEAPONFRAME;
-
-	pflags |= PS_WEAPONINDEX;
-
-	//
-	// write it
-	//
 	MSG_WriteByte (msg, svc_playerinfo);
-	MSG_WriteInt (msg, pflags);
-
-	//
-	// write the pmove_state_t
-	//
-	if (pflags & PS_M_TYPE)
-		MSG_WriteByte(msg, ps->pmove.pm_type);
-
-	if (pflags & PS_M_ORIGIN)
-		MSG_WritePos(msg, ps->pmove.origin);
-
-	if (pflags & PS_M_VELOCITY)
-		MSG_WritePos(msg, ps->pmove.velocity);
-
-	if (pflags & PS_M_TIME)
-		MSG_WriteByte(msg, ps->pmove.pm_time);
-
-	if (pflags & PS_M_FLAGS)
-		MSG_WriteByte(msg, ps->pmove.pm_flags);
-
-	if (pflags & PS_M_GRAVITY)
-		MSG_WriteShort(msg, ps->pmove.gravity);
-
-	if (pflags & PS_M_DELTA_ANGLES)
-	{
-		MSG_WriteShort(msg, ps->pmove.delta_angles[0]);
-		MSG_WriteShort(msg, ps->pmove.delta_angles[1]);
-		MSG_WriteShort(msg, ps->pmove.delta_angles[2]);
-	}
-
-	//
-	// write the rest of the player_state_t
-	//
-
-	if (pflags & PS_VIEWORIGIN)
-		MSG_WritePos(msg, ps->vieworigin);
-
-	if (pflags & PS_CAMERATYPE)
-		MSG_WriteByte(msg, ps->camera_type);
-
-	if (pflags & PS_VIEWOFFSET)
-	{
-		MSG_WriteChar(msg, ps->viewoffset[0]*4);
-		MSG_WriteChar(msg, ps->viewoffset[1]*4);
-		MSG_WriteChar(msg, ps->viewoffset[2]*4);
-	}
-
-	if (pflags & PS_VIEWANGLES)
-	{
-		MSG_WriteAngle16(msg, ps->viewangles[0]);
-		MSG_WriteAngle16(msg, ps->viewangles[1]);
-		MSG_WriteAngle16(msg, ps->viewangles[2]);
-	}
-
-	if (pflags & PS_KICKANGLES)
-	{
-		MSG_WriteChar(msg, ps->kick_angles[0]*4);
-		MSG_WriteChar(msg, ps->kick_angles[1]*4);
-		MSG_WriteChar(msg, ps->kick_angles[2]*4);
-	}
-
-	if (pflags & PS_WEAPONINDEX)
-	{
-		MSG_WriteByte(msg, ps->gunindex);
-	}
-
-	if (pflags & PS_WEAPONFRAME)
-	{
-		MSG_WriteByte(msg, ps->gunframe);
-		MSG_WriteByte(msg, ps->gunoffset[0]*4);
-		MSG_WriteByte(msg, ps->gunoffset[1]*4);
-		MSG_WriteByte(msg, ps->gunoffset[2]*4);
-		MSG_WriteByte(msg, ps->gunangles[0]*4);
-		MSG_WriteByte(msg, ps->gunangles[1]*4);
-		MSG_WriteByte(msg, ps->gunangles[2]*4);
-	}
-
-	if (pflags & PS_BLEND)
-	{
-		MSG_WriteByte(msg, ps->blend[0]*255);
-		MSG_WriteByte(msg, ps->blend[1]*255);
-		MSG_WriteByte(msg, ps->blend[2]*255);
-		MSG_WriteByte(msg, ps->blend[3]*255);
-	}
-	if (pflags & PS_FOV)
-		MSG_WriteByte(msg, ps->fov);
-	if (pflags & PS_RDFLAGS)
-		MSG_WriteByte(msg, ps->rdflags);
-
-	// send stats
-	statbits = 0;
-	for (i=0 ; i<MAX_STATS ; i++)
-		if (ps->stats[i] != ops->stats[i])
-			statbits |= 1<<i;
-	MSG_WriteInt (msg, statbits);
-	for (i=0 ; i<MAX_STATS ; i++)
-		if (statbits & (1<<i) )
-			MSG_WriteShort (msg, ps->stats[i]);
+	MSG_WriteDeltaPlayerstate (from ? &from->ps : &dummy, &to->ps, msg, quant);
 }
 
 
@@ -324,6 +130,7 @@ void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg)
 {
 	client_frame_t		*frame, *oldframe;
 	int32_t 				lastframe;
+	msg_quantize_t		*quant;
 
 //Com_Printf ("%i -> %i\n", client->lastframe, sv.framenum);
 	// this is the frame we are creating
@@ -354,11 +161,14 @@ void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg)
 	MSG_WriteByte (msg, frame->areabytes);
 	SZ_Write (msg, frame->areabits, frame->areabytes);
 
+	// protocol 1 clients get the byte aligned encoding
+	quant = (client->protocol == PROTOCOL_VERSION_QUANTIZED) ? &sv.quantize : NULL;
+
 	// delta encode the playerstate
-	SV_WritePlayerstateToClient (oldframe, frame, msg);
+	SV_WritePlayerstateToClient (oldframe, frame, msg, quant);
 
 	// delta encode the entities
-	SV_EmitPacketEntities (oldframe, frame, msg);
+	SV_EmitPacketEntities (oldframe, frame, msg, quant);
 }
 
 
@@ -413,8 +223,7 @@ void SV_FatPVS (vec3_t org)
 		if (j != i)
 			continue;		// already have the cluster we want
 		src = Map_ClusterPVS(leafs[i]);
-		for (j=0 ; j<longs ; j++)
-			((long *)fatpvs)[j] |= ((long *)src)[j];
+		Com_OrBytes (fatpvs, src, longs<<2);
 	}
 }
 
@@ -442,6 +251,13 @@ void SV_BuildClientFrame (client_t *client)
 	uint8_t*		clientphs;
 	uint8_t*		bitvector;
 
+	// relay viewers see the relayed entities, not the edicts
+	if (SV_RelayUpstream())
+	{
+		SV_RelayBuildClientFrame(client);
+		return;
+	}
+
 	clent = client->edict;
 
 	if (!clent->client)
@@ -583,11 +399,14 @@ void SV_RecordDemoMessage ()
 	entity_state_t	nostate;
 	sizebuf_t		buf;
 	uint8_t			buf_data[32768];
-	int32_t 		len;
 
-	if (!svs.demofile)
+	if (!svs.demofile
+		&& !(sv.state == ss_game && SV_RelaySubscribers()))
 		return;
 
+	if (svs.demofile)
+		SV_DemoKeyframe();
+
 	memset (&nostate, 0, sizeof(nostate));
 	SZ_Init (&buf, buf_data, sizeof(buf_data));
 
@@ -618,9 +437,13 @@ void SV_RecordDemoMessage ()
 	SZ_Write (&buf, svs.demo_multicast.data, svs.demo_multicast.cursize);
 	SZ_Clear (&svs.demo_multicast);
 
-	// now write the entire message to the file, prefixed by the length
-	len = LittleInt (buf.cursize);
-	fwrite (&len, 4, 1, svs.demofile);
-	fwrite (buf.data, buf.cursize, 1, svs.demofile);
+	// hand it to the demo writer and the relays
+	if (svs.demofile)
+	{
+		SV_DemoWriteMessage (&buf);
+		SV_DemoFrame ();
+	}
+
+	SV_RelayBroadcast (buf.data, buf.cursize);
 }
 
@@ -218,6 +218,7 @@ void PF_Configstring(int32_t index, char* val)
 
 	// change the string in sv
 	strcpy(sv.configstrings[index], val);
+	SV_InvalidateSignon();
 
 	if (sv.state != ss_loading)
 	{	// send the update to everyone
@@ -376,7 +377,7 @@ void SV_InitGameProgs()
 	import.setmodel = PF_setmodel;
 	import.inPVS = PF_inPVS;
 	import.inPHS = PF_inPHS;
-	import.Player_Move = Player_Move;
+	import.Player_Move = SV_PlayerMove;
 
 	import.modelindex = SV_ModelIndex;
 	import.soundindex = SV_SoundIndex;
@@ -50,6 +50,7 @@ int32_t SV_FindIndex(char* name, int32_t start, int32_t max, bool create)
 		Com_Error(ERR_DROP, "*Index: overflow");
 
 	strncpy(sv.configstrings[start + i], name, sizeof(sv.configstrings[i]));
+	SV_InvalidateSignon();
 
 	if (sv.state != ss_loading)
 	{	// send the update to everyone
@@ -112,6 +113,161 @@ void SV_CreateBaseline()
 }
 
 
+/*
+================
+SV_BuildSignonConfigstrings
+
+Encodes every configstring exactly as SV_Configstrings_f would send them,
+recording where each one starts so they can be sent in chunks with one copy
+================
+*/
+void SV_BuildSignonConfigstrings()
+{
+	sizebuf_t*	buf = &sv.signon_configstrings;
+	int32_t 	size;
+	int32_t 	i;
+
+	size = 0;
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		if (sv.configstrings[i][0])
+			size += 1 + 2 + (int32_t)strlen(sv.configstrings[i]) + 1;
+	}
+
+	if (buf->data)
+		Memory_ZoneFree(buf->data);
+
+	SZ_Init(buf, Memory_ZoneMalloc(size + 1), size + 1);
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		sv.signon_configstring_offsets[i] = buf->cursize;
+
+		if (sv.configstrings[i][0])
+		{
+			MSG_WriteByte(buf, svc_configstring);
+			MSG_WriteShort(buf, i);
+			MSG_WriteString(buf, sv.configstrings[i]);
+		}
+	}
+
+	sv.signon_configstring_offsets[MAX_CONFIGSTRINGS] = buf->cursize;
+	sv.signon_configstrings_valid = true;
+}
+
+/*
+================
+SV_BuildSignonBaselines
+
+Delta encodes every baseline against the null state once per map
+================
+*/
+void SV_BuildSignonBaselines()
+{
+	sizebuf_t*		buf = &sv.signon_baselines;
+	entity_state_t	nullstate;
+	entity_state_t* base;
+	int32_t 		size;
+	int32_t 		i;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+
+	// the encoded size isn't known up front, so grow until it fits
+	size = MAX_MSGLEN;
+
+	while (true)
+	{
+		if (buf->data)
+			Memory_ZoneFree(buf->data);
+
+		SZ_Init(buf, Memory_ZoneMalloc(size), size);
+		buf->allowoverflow = true;
+
+		for (i = 0; i < MAX_EDICTS; i++)
+		{
+			sv.signon_baseline_offsets[i] = buf->cursize;
+
+			base = &sv.baselines[i];
+			if (base->modelindex || base->sound || base->effects)
+			{
+				MSG_WriteByte(buf, svc_spawnbaseline);
+				MSG_WriteDeltaEntity(&nullstate, base, buf, true, true);
+			}
+		}
+
+		if (!buf->overflowed)
+			break;
+
+		size *= 2;
+	}
+
+	buf->allowoverflow = false;
+	sv.signon_baseline_offsets[MAX_EDICTS] = buf->cursize;
+}
+
+/*
+================
+SV_BuildSignon
+
+Called once the level has finished spawning
+================
+*/
+void SV_BuildSignon()
+{
+	SV_BuildSignonConfigstrings();
+	SV_BuildSignonBaselines();
+
+	Com_DPrintf("signon: %i bytes of configstrings, %i bytes of baselines\n",
+		sv.signon_configstrings.cursize, sv.signon_baselines.cursize);
+}
+
+/*
+================
+SV_InvalidateSignon
+
+Called whenever a configstring changes after the level has spawned.
+The configstrings are only encoded again when the next client connects.
+================
+*/
+void SV_InvalidateSignon()
+{
+	sv.signon_configstrings_valid = false;
+}
+
+/*
+================
+SV_SignonConfigstrings
+================
+*/
+sizebuf_t* SV_SignonConfigstrings()
+{
+	if (!sv.signon_configstrings_valid)
+		SV_BuildSignonConfigstrings();
+
+	return &sv.signon_configstrings;
+}
+
+/*
+================
+SV_FreeSignon
+
+Must be called before sv is wiped
+================
+*/
+void SV_FreeSignon()
+{
+	if (sv.signon_configstrings.data)
+		Memory_ZoneFree(sv.signon_configstrings.data);
+
+	if (sv.signon_baselines.data)
+		Memory_ZoneFree(sv.signon_baselines.data);
+
+	memset(&sv.signon_configstrings, 0, sizeof(sv.signon_configstrings));
+	memset(&sv.signon_baselines, 0, sizeof(sv.signon_baselines));
+	sv.signon_configstrings_valid = false;
+}
+
 /*
 =================
 SV_CheckForSavegame
@@ -129,6 +285,9 @@ void SV_CheckForSavegame()
 	if (Cvar_VariableValue("gamemode"))
 		return;
 
+	// the level may have been saved by the last frame of the previous map
+	SV_SaveWait();
+
 	snprintf(name, sizeof(name), "%s/save/current/%s.sav", FS_Gamedir(), sv.name);
 	f = fopen(name, "rb");
 	if (!f)
@@ -188,8 +347,9 @@ void SV_SpawnServer(char* server, char* spawnpoint, server_state_t serverstate,
 		return;
 	}
 #endif
-	if (sv.demofile)
-		fclose(sv.demofile);
+
+	TIMELINE_BEGIN("SV_SpawnServer");
+	SV_DemoClose();
 
 	svs.spawncount++;		// any partially connected client will be
 	// restarted
@@ -197,11 +357,26 @@ void SV_SpawnServer(char* server, char* spawnpoint, server_state_t serverstate,
 	Com_SetServerState(sv.state);
 
 	// wipe the entire per-level structure
+	SV_FreeSignon();
 	memset(&sv, 0, sizeof(sv));
 	svs.realtime = 0;
 	sv.loadgame = loadgame;
 	sv.attractloop = attractloop;
 
+	// the quantized frame precision is sent in svc_serverdata, so it can't change mid level
+	sv.quantize.coord_bits = (int32_t)sv_quantize_coordbits->value;
+	sv.quantize.angle_bits = (int32_t)sv_quantize_anglebits->value;
+
+	if (sv.quantize.coord_bits < 0)
+		sv.quantize.coord_bits = 0;
+	else if (sv.quantize.coord_bits > 8)
+		sv.quantize.coord_bits = 8;
+
+	if (sv.quantize.angle_bits < 8)
+		sv.quantize.angle_bits = 8;
+	else if (sv.quantize.angle_bits > 16)
+		sv.quantize.angle_bits = 16;
+
 	// save name for levels that don't set message
 	strcpy(sv.configstrings[CS_NAME], server);
 
@@ -297,9 +472,13 @@ void SV_SpawnServer(char* server, char* spawnpoint, server_state_t serverstate,
 	// check for a savegame
 	SV_CheckForSavegame();
 
+	// encode the configstrings and baselines every connecting client is sent
+	SV_BuildSignon();
+
 	// set serverinfo variable
 	Cvar_FullSet("mapname", sv.name, CVAR_SERVERINFO | CVAR_NOSET);
 
+	TIMELINE_END();
 	Com_Printf("-------------------------------------\n");
 }
 
@@ -0,0 +1,754 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// server_loadtest.c -- synthetic clients for measuring server frame cost
+//
+// Each bot is a real netchan client living inside the server process. Packets
+// between the server and the bots go through NA_BOT addresses, which the
+// platform network code hands to LoadTest_SendPacket / LoadTest_GetPacket
+// instead of a socket.
+//
+// Usage, on a running server (usually a dedicated one):
+//   loadtest <count> [cmdfile]	connect count bots, replaying cmdfile (see cmdrecord) or a scripted walk
+//   loadtest_report			print frame time percentiles, bandwidth and loss since the last report
+//   loadtest_stop				disconnect the bots
+
+#include "server.h"
+
+#define	MAX_LOADTEST_BOTS		256
+#define	LOADTEST_SAMPLES		16384		// server frame times kept for the percentiles
+#define	LOADTEST_RESEND			1000		// msec between connection attempts
+#define	LOADTEST_TIMEOUT		3000		// msec without frames before a bot asks for the level again
+#define	LOADTEST_QPORT			0x4000		// bots use LOADTEST_QPORT + their number
+#define	LOADTEST_CMDS			4			// usercmd history, the last 3 are sent with every move
+
+typedef enum
+{
+	bot_free,
+	bot_challenging,		// waiting for a challenge
+	bot_connecting,			// waiting for client_connect
+	bot_signon,				// connected, waiting for svc_serverdata
+	bot_spawned				// sending moves and receiving frames
+} botstate_t;
+
+typedef struct loadpacket_s
+{
+	struct loadpacket_s* next;
+	netadr_t		adr;			// the bot that sent it, or is receiving it
+	int32_t 		length;
+	uint8_t			data[];
+} loadpacket_t;
+
+typedef struct loadbot_s
+{
+	botstate_t		state;
+	netadr_t		adr;			// NA_BOT, port is the bot number
+	netchan_t		netchan;
+	int32_t 		challenge;
+	int32_t 		spawncount;
+	int32_t 		serverframe;	// last svc_frame, acknowledged in every move
+	int32_t 		last_frame;		// curtime of the last svc_frame
+	int32_t 		last_request;	// curtime of the last connection request, "new" or "begin"
+	int32_t 		next_cmd;		// curtime the next move is due
+
+	usercmd_t		cmds[LOADTEST_CMDS];
+	int32_t 		cmd_offset;		// into loadtest_cmds
+	usercmd_t		cmd_last;		// the recorded cmds are deltas from the previous one
+
+	loadpacket_t*	queue;			// packets from the server
+	loadpacket_t*	queue_tail;
+
+	// stats
+	int64_t 		bytes_in, bytes_out;
+	int32_t 		packets_in, packets_out;
+	int32_t 		dropped;		// gaps in the incoming netchan sequence
+	int32_t 		frames;
+} loadbot_t;
+
+static loadbot_t	loadtest_bots[MAX_LOADTEST_BOTS];
+static int32_t 		loadtest_count;
+
+static loadpacket_t* loadtest_server_queue;		// packets from the bots
+static loadpacket_t* loadtest_server_queue_tail;
+
+static uint8_t*		loadtest_cmds;				// recorded usercmds (cmdrecord), NULL for the scripted walk
+static int32_t 		loadtest_cmds_length;
+
+static int64_t 		loadtest_frametimes[LOADTEST_SAMPLES];
+static int32_t 		loadtest_frametime_count;
+static int64_t 		loadtest_frametime_pending;	// packet handling in the frames between game frames
+static int32_t 		loadtest_start;				// curtime the stats were last reset
+static int32_t 		loadtest_lost_to_server;
+static int32_t 		loadtest_lost_to_bots;
+
+static cvar_t*		loadtest_loss;				// percentage of packets to drop in each direction
+static cvar_t*		loadtest_protocol;			// protocol version the bots connect with
+
+/*
+=============================================================================
+
+TRANSPORT
+
+=============================================================================
+*/
+
+static void LoadTest_Enqueue(loadpacket_t** head, loadpacket_t** tail, netadr_t adr, int32_t length, void* data)
+{
+	loadpacket_t* packet;
+
+	packet = Memory_ZoneMalloc(sizeof(loadpacket_t) + length);
+	packet->adr = adr;
+	packet->length = length;
+	memcpy(packet->data, data, length);
+
+	if (*tail)
+		(*tail)->next = packet;
+	else
+		*head = packet;
+
+	*tail = packet;
+}
+
+static loadpacket_t* LoadTest_Dequeue(loadpacket_t** head, loadpacket_t** tail)
+{
+	loadpacket_t* packet;
+
+	packet = *head;
+
+	if (!packet)
+		return NULL;
+
+	*head = packet->next;
+
+	if (!*head)
+		*tail = NULL;
+
+	return packet;
+}
+
+static void LoadTest_FreeQueue(loadpacket_t** head, loadpacket_t** tail)
+{
+	loadpacket_t* packet;
+
+	while ((packet = LoadTest_Dequeue(head, tail)))
+		Memory_ZoneFree(packet);
+}
+
+/*
+==================
+LoadTest_SendPacket
+
+Called by Net_SendPacket for NA_BOT addresses. NS_CLIENT packets come from a bot
+and go to the server, NS_SERVER packets go to the bot numbered to.port.
+==================
+*/
+void LoadTest_SendPacket(netsrc_t sock, int32_t length, void* data, netadr_t to)
+{
+	loadbot_t* bot;
+
+	if (to.port >= MAX_LOADTEST_BOTS)
+		return;
+
+	bot = &loadtest_bots[to.port];
+
+	if (bot->state == bot_free)
+		return;
+
+	if (sock == NS_CLIENT)
+	{
+		bot->bytes_out += length;
+		bot->packets_out++;
+
+		if (frand() * 100 < loadtest_loss->value)
+		{
+			loadtest_lost_to_server++;
+			return;
+		}
+
+		LoadTest_Enqueue(&loadtest_server_queue, &loadtest_server_queue_tail, to, length, data);
+	}
+	else
+	{
+		if (frand() * 100 < loadtest_loss->value)
+		{
+			loadtest_lost_to_bots++;
+			return;
+		}
+
+		LoadTest_Enqueue(&bot->queue, &bot->queue_tail, to, length, data);
+	}
+}
+
+/*
+==================
+LoadTest_GetPacket
+
+Called by Net_GetPacket for the server socket
+==================
+*/
+bool LoadTest_GetPacket(netadr_t* net_from, sizebuf_t* net_message)
+{
+	loadpacket_t* packet;
+
+	packet = LoadTest_Dequeue(&loadtest_server_queue, &loadtest_server_queue_tail);
+
+	if (!packet)
+		return false;
+
+	if (packet->length > net_message->maxsize)
+	{
+		Memory_ZoneFree(packet);
+		return false;
+	}
+
+	memcpy(net_message->data, packet->data, packet->length);
+	net_message->cursize = packet->length;
+	*net_from = packet->adr;
+
+	Memory_ZoneFree(packet);
+	return true;
+}
+
+/*
+=============================================================================
+
+BOTS
+
+=============================================================================
+*/
+
+/*
+==================
+LoadTest_NextCmd
+
+Replays the next recorded usercmd, or makes up a walk around the level
+==================
+*/
+static void LoadTest_NextCmd(loadbot_t* bot, usercmd_t* cmd)
+{
+	sizebuf_t	msg;
+	int32_t 	t;
+	int32_t 	number = bot->adr.port;
+
+	if (loadtest_cmds)
+	{
+		// start over at the end of the recording
+		if (bot->cmd_offset >= loadtest_cmds_length)
+		{
+			bot->cmd_offset = 0;
+			memset(&bot->cmd_last, 0, sizeof(bot->cmd_last));
+		}
+
+		SZ_Init(&msg, loadtest_cmds, loadtest_cmds_length);
+		msg.cursize = loadtest_cmds_length;
+		msg.readcount = bot->cmd_offset;
+
+		MSG_ReadDeltaUsercmd(&msg, &bot->cmd_last, cmd);
+		bot->cmd_offset = msg.readcount;
+		bot->cmd_last = *cmd;
+		return;
+	}
+
+	// each bot runs around in its own circle, strafing and jumping now and then
+	t = curtime + number * 379;
+
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->msec = 16;
+	cmd->forwardmove = 300;
+	cmd->sidemove = ((t / 1000) & 3) < 2 ? 100 : -100;
+	cmd->upmove = (t % 2000) < 100 ? 200 : 0;
+	cmd->angles[YAW] = ANGLE2SHORT((t / 20) % 360);
+}
+
+static void LoadTest_SendMove(loadbot_t* bot)
+{
+	sizebuf_t	buf;
+	uint8_t		data[128];
+	usercmd_t	nullcmd;
+	usercmd_t*	cmd, * oldcmd;
+	int32_t 	checksum_index;
+	int32_t 	i;
+
+	i = bot->netchan.outgoing_sequence & (LOADTEST_CMDS - 1);
+	LoadTest_NextCmd(bot, &bot->cmds[i]);
+
+	// the same message CL_SendCmd builds
+	SZ_Init(&buf, data, sizeof(data));
+	MSG_WriteByte(&buf, clc_move);
+
+	checksum_index = buf.cursize;
+	MSG_WriteByte(&buf, 0);
+	MSG_WriteInt(&buf, bot->serverframe);
+
+	memset(&nullcmd, 0, sizeof(nullcmd));
+	cmd = &bot->cmds[(bot->netchan.outgoing_sequence - 2) & (LOADTEST_CMDS - 1)];
+	MSG_WriteDeltaUsercmd(&buf, &nullcmd, cmd);
+	oldcmd = cmd;
+
+	cmd = &bot->cmds[(bot->netchan.outgoing_sequence - 1) & (LOADTEST_CMDS - 1)];
+	MSG_WriteDeltaUsercmd(&buf, oldcmd, cmd);
+	oldcmd = cmd;
+
+	cmd = &bot->cmds[bot->netchan.outgoing_sequence & (LOADTEST_CMDS - 1)];
+	MSG_WriteDeltaUsercmd(&buf, oldcmd, cmd);
+
+	buf.data[checksum_index] = Com_BlockSequenceCRCByte(
+		buf.data + checksum_index + 1, buf.cursize - checksum_index - 1,
+		bot->netchan.outgoing_sequence);
+
+	Netchan_Transmit(&bot->netchan, buf.cursize, buf.data);
+
+	bot->next_cmd += cmd->msec ? cmd->msec : 1;
+}
+
+static void LoadTest_SendCommand(loadbot_t* bot, char* command)
+{
+	MSG_WriteByte(&bot->netchan.message, clc_stringcmd);
+	MSG_WriteString(&bot->netchan.message, command);
+	Netchan_Transmit(&bot->netchan, 0, NULL);
+
+	bot->last_request = curtime;
+}
+
+static void LoadTest_Connectionless(loadbot_t* bot, sizebuf_t* msg)
+{
+	char*	s;
+	char*	c;
+
+	MSG_BeginReading(msg);
+	MSG_ReadInt(msg);		// skip the -1
+
+	s = MSG_ReadStringLine(msg);
+	Cmd_TokenizeString(s, false);
+	c = Cmd_Argv(0);
+
+	if (!strcmp(c, "challenge") && bot->state == bot_challenging)
+	{
+		bot->challenge = atoi(Cmd_Argv(1));
+		bot->state = bot_connecting;
+		bot->last_request = curtime - LOADTEST_RESEND;	// connect right away
+	}
+	else if (!strcmp(c, "client_connect") && bot->state == bot_connecting)
+	{
+		Netchan_Setup(NS_CLIENT, &bot->netchan, bot->adr, LOADTEST_QPORT + bot->adr.port,
+			atoi(Cmd_Argv(1)) & Netchan_SupportedFlags());
+
+		bot->state = bot_signon;
+		LoadTest_SendCommand(bot, "new");
+	}
+	else if (!strcmp(c, "print"))
+	{
+		// rejected, most likely because the server is full
+		s = MSG_ReadString(msg);
+		Com_DPrintf("bot%i: %s", bot->adr.port, s);
+	}
+}
+
+/*
+==================
+LoadTest_Parse
+
+reliable_length is how much of the payload is reliable messages, or -1 for a reliable message of
+unknown length, which is all a netchan without NETCHAN_FLAG_WINDOW can say
+==================
+*/
+static void LoadTest_Parse(loadbot_t* bot, sizebuf_t* msg, int32_t reliable_length)
+{
+	int32_t 	protocol, payload;
+
+	payload = bot->netchan.incoming_payload;
+
+	// the signon starts with svc_serverdata, the rest of the reliable stream is skipped
+	if (reliable_length
+		&& payload < msg->cursize
+		&& msg->data[payload] == svc_serverdata)
+	{
+		msg->readcount = payload + 1;
+		protocol = MSG_ReadInt(msg);
+
+		if (protocol == PROTOCOL_VERSION_QUANTIZED)
+		{
+			MSG_ReadByte(msg);
+			MSG_ReadByte(msg);
+		}
+
+		bot->spawncount = MSG_ReadInt(msg);
+		bot->serverframe = -1;
+		bot->state = bot_spawned;
+		bot->last_frame = curtime;
+		bot->next_cmd = curtime;
+
+		LoadTest_SendCommand(bot, va("begin %i\n", bot->spawncount));
+	}
+
+	// there's no telling where the reliable message ends, so the frame after it is missed
+	if (reliable_length < 0)
+		return;
+
+	// the unreliable part always starts with the frame
+	msg->readcount = payload + reliable_length;
+
+	if (msg->readcount < msg->cursize
+		&& MSG_ReadByte(msg) == svc_frame)
+	{
+		bot->serverframe = MSG_ReadInt(msg);
+		bot->last_frame = curtime;
+		bot->frames++;
+	}
+}
+
+static void LoadTest_ReadPackets(loadbot_t* bot)
+{
+	loadpacket_t*	packet;
+	sizebuf_t		msg;
+	uint8_t			data[MAX_MSGLEN];
+	int32_t 		sequence, reliable_sequence, reliable_length;
+
+	while ((packet = LoadTest_Dequeue(&bot->queue, &bot->queue_tail)))
+	{
+		SZ_Init(&msg, data, sizeof(data));
+		SZ_Write(&msg, packet->data, packet->length);
+
+		bot->bytes_in += packet->length;
+		bot->packets_in++;
+
+		Memory_ZoneFree(packet);
+
+		if (*(int32_t*)msg.data == -1)
+		{
+			LoadTest_Connectionless(bot, &msg);
+			continue;
+		}
+
+		if (bot->state < bot_signon)
+			continue;
+
+		sequence = bot->netchan.incoming_sequence;
+		reliable_sequence = bot->netchan.incoming_reliable_sequence;
+
+		if (!Netchan_Process(&bot->netchan, &msg))
+			continue;
+
+		bot->dropped += bot->netchan.incoming_sequence - sequence - 1;
+
+		// a plain netchan only says whether the packet had a reliable message
+		if (bot->netchan.flags & NETCHAN_FLAG_WINDOW)
+			reliable_length = bot->netchan.incoming_reliable_length;
+		else
+			reliable_length = bot->netchan.incoming_reliable_sequence != reliable_sequence ? -1 : 0;
+
+		LoadTest_Parse(bot, &msg, reliable_length);
+	}
+}
+
+static void LoadTest_RunBot(loadbot_t* bot)
+{
+	char	userinfo[MAX_INFO_STRING];
+
+	LoadTest_ReadPackets(bot);
+
+	switch (bot->state)
+	{
+	case bot_challenging:
+		if (curtime - bot->last_request >= LOADTEST_RESEND)
+		{
+			Netchan_OutOfBandPrint(NS_CLIENT, bot->adr, "getchallenge\n");
+			bot->last_request = curtime;
+		}
+		break;
+
+	case bot_connecting:
+		if (curtime - bot->last_request >= LOADTEST_RESEND)
+		{
+			snprintf(userinfo, sizeof(userinfo), "\\name\\bot%i", bot->adr.port);
+			Netchan_OutOfBandPrint(NS_CLIENT, bot->adr, "connect %i %i %i \"%s\" %i\n",
+				(int32_t)loadtest_protocol->value, LOADTEST_QPORT + bot->adr.port, bot->challenge, userinfo, Netchan_SupportedFlags());
+			bot->last_request = curtime;
+		}
+		break;
+
+	case bot_signon:
+		if (curtime - bot->last_request >= LOADTEST_TIMEOUT)
+			LoadTest_SendCommand(bot, "new");
+		else if (Netchan_NeedTransmit(&bot->netchan) || curtime - bot->netchan.last_sent > 100)
+			Netchan_Transmit(&bot->netchan, 0, NULL);
+		break;
+
+	case bot_spawned:
+		// the level changed, or the server stopped sending frames for another reason
+		if (curtime - bot->last_frame >= LOADTEST_TIMEOUT)
+		{
+			bot->state = bot_signon;
+			LoadTest_SendCommand(bot, "new");
+			break;
+		}
+
+		// don't try to catch up after a long server frame
+		if (curtime - bot->next_cmd > 100)
+			bot->next_cmd = curtime;
+
+		while (bot->next_cmd <= curtime)
+			LoadTest_SendMove(bot);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+==================
+LoadTest_Frame
+
+Runs the bots, before the server reads its packets
+==================
+*/
+void LoadTest_Frame()
+{
+	int32_t i;
+
+	if (!loadtest_count)
+		return;
+
+	Sys_Milliseconds();		// update curtime
+
+	for (i = 0; i < loadtest_count; i++)
+		LoadTest_RunBot(&loadtest_bots[i]);
+}
+
+bool LoadTest_Active()
+{
+	return loadtest_count > 0;
+}
+
+/*
+==================
+LoadTest_FrameTime
+
+Called at the end of SV_Frame. Frames that only read packets are added to the
+next game frame, so each sample is the full cost of one server tick.
+==================
+*/
+void LoadTest_FrameTime(int64_t ns, bool game_frame)
+{
+	loadtest_frametime_pending += ns;
+
+	if (!game_frame)
+		return;
+
+	loadtest_frametimes[loadtest_frametime_count % LOADTEST_SAMPLES] = loadtest_frametime_pending;
+	loadtest_frametime_count++;
+	loadtest_frametime_pending = 0;
+}
+
+/*
+=============================================================================
+
+COMMANDS
+
+=============================================================================
+*/
+
+static void LoadTest_ResetStats()
+{
+	int32_t i;
+
+	for (i = 0; i < loadtest_count; i++)
+	{
+		loadtest_bots[i].bytes_in = loadtest_bots[i].bytes_out = 0;
+		loadtest_bots[i].packets_in = loadtest_bots[i].packets_out = 0;
+		loadtest_bots[i].dropped = 0;
+		loadtest_bots[i].frames = 0;
+	}
+
+	loadtest_frametime_count = 0;
+	loadtest_frametime_pending = 0;
+	loadtest_lost_to_server = loadtest_lost_to_bots = 0;
+	loadtest_start = Sys_Milliseconds();
+}
+
+static void LoadTest_Stop_f()
+{
+	int32_t i;
+
+	for (i = 0; i < loadtest_count; i++)
+	{
+		if (loadtest_bots[i].state >= bot_signon)
+		{
+			// twice, in case the first one is lost
+			LoadTest_SendCommand(&loadtest_bots[i], "disconnect");
+			LoadTest_SendCommand(&loadtest_bots[i], "disconnect");
+		}
+
+		LoadTest_FreeQueue(&loadtest_bots[i].queue, &loadtest_bots[i].queue_tail);
+		loadtest_bots[i].state = bot_free;
+	}
+
+	LoadTest_FreeQueue(&loadtest_server_queue, &loadtest_server_queue_tail);
+
+	if (loadtest_cmds)
+		FS_FreeFile(loadtest_cmds);
+
+	loadtest_cmds = NULL;
+	loadtest_count = 0;
+}
+
+static void LoadTest_f()
+{
+	char		name[MAX_QPATH];
+	int32_t 	count, i;
+	loadbot_t*	bot;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("loadtest <count> [cmdfile]\n");
+		return;
+	}
+
+	if (!svs.initialized)
+	{
+		Com_Printf("No server running.\n");
+		return;
+	}
+
+	count = atoi(Cmd_Argv(1));
+
+	if (count < 1 || count > MAX_LOADTEST_BOTS)
+	{
+		Com_Printf("Between 1 and %i bots.\n", MAX_LOADTEST_BOTS);
+		return;
+	}
+
+	if (count > sv_maxclients->value)
+		Com_Printf("WARNING: sv_maxclients is %i, only that many bots will get in.\n", (int32_t)sv_maxclients->value);
+
+	LoadTest_Stop_f();
+
+	if (Cmd_Argc() > 2)
+	{
+		snprintf(name, sizeof(name), "cmds/%s.cmd", Cmd_Argv(2));
+		loadtest_cmds_length = FS_LoadFile(name, (void**)&loadtest_cmds);
+
+		if (!loadtest_cmds)
+		{
+			Com_Printf("Couldn't load %s, using the scripted walk.\n", name);
+		}
+		else if (loadtest_cmds_length <= 0)
+		{
+			FS_FreeFile(loadtest_cmds);
+			loadtest_cmds = NULL;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		bot = &loadtest_bots[i];
+		memset(bot, 0, sizeof(*bot));
+
+		bot->adr.type = NA_BOT;
+		bot->adr.port = i;
+		bot->state = bot_challenging;
+		bot->last_request = curtime - LOADTEST_RESEND;
+		bot->serverframe = -1;
+	}
+
+	loadtest_count = count;
+	LoadTest_ResetStats();
+
+	Com_Printf("Started %i bots.\n", count);
+}
+
+static int LoadTest_CompareTimes(const void* a, const void* b)
+{
+	int64_t x = *(int64_t*)a, y = *(int64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+static void LoadTest_Report_f()
+{
+	int64_t*	sorted;
+	int32_t 	samples, spawned, frames, dropped, i;
+	int64_t 	bytes_in, bytes_out;
+	float		seconds;
+
+	if (!loadtest_count)
+	{
+		Com_Printf("No load test running.\n");
+		return;
+	}
+
+	seconds = (Sys_Milliseconds() - loadtest_start) / 1000.0f;
+
+	if (seconds <= 0)
+		seconds = 0.001f;
+
+	spawned = frames = dropped = 0;
+	bytes_in = bytes_out = 0;
+
+	for (i = 0; i < loadtest_count; i++)
+	{
+		if (loadtest_bots[i].state == bot_spawned)
+			spawned++;
+
+		frames += loadtest_bots[i].frames;
+		dropped += loadtest_bots[i].dropped;
+		bytes_in += loadtest_bots[i].bytes_in;
+		bytes_out += loadtest_bots[i].bytes_out;
+	}
+
+	Com_Printf("%i bots, %i in game, over %.1f seconds\n", loadtest_count, spawned, seconds);
+
+	samples = loadtest_frametime_count < LOADTEST_SAMPLES ? loadtest_frametime_count : LOADTEST_SAMPLES;
+
+	if (samples)
+	{
+		sorted = Memory_ZoneMalloc(samples * sizeof(int64_t));
+		memcpy(sorted, loadtest_frametimes, samples * sizeof(int64_t));
+		qsort(sorted, samples, sizeof(int64_t), LoadTest_CompareTimes);
+
+		Com_Printf("server frame: p50 %.3fms p95 %.3fms p99 %.3fms max %.3fms (%i frames)\n",
+			sorted[samples / 2] / 1000000.0, sorted[samples * 95 / 100] / 1000000.0,
+			sorted[samples * 99 / 100] / 1000000.0, sorted[samples - 1] / 1000000.0, samples);
+
+		Memory_ZoneFree(sorted);
+	}
+
+	Com_Printf("per client: %.0f bytes/s down, %.0f bytes/s up, %.1f bytes/frame down\n",
+		bytes_in / seconds / loadtest_count, bytes_out / seconds / loadtest_count, frames ? (double)bytes_in / frames : 0.0);
+	Com_Printf("loss: %i packets seen missing by the bots (%.2f%%), %i dropped to the server and %i to the bots by loadtest_loss\n",
+		dropped, frames + dropped ? 100.0f * dropped / (frames + dropped) : 0.0f, loadtest_lost_to_server, loadtest_lost_to_bots);
+
+	LoadTest_ResetStats();
+}
+
+/*
+==================
+LoadTest_Init
+==================
+*/
+void LoadTest_Init()
+{
+	loadtest_loss = Cvar_Get("loadtest_loss", "0", 0);
+	loadtest_protocol = Cvar_Get("loadtest_protocol", va("%i", PROTOCOL_VERSION_QUANTIZED), 0);
+
+	Cmd_AddCommand("loadtest", LoadTest_f);
+	Cmd_AddCommand("loadtest_report", LoadTest_Report_f);
+	Cmd_AddCommand("loadtest_stop", LoadTest_Stop_f);
+}
@@ -63,6 +63,10 @@ cvar_t* sv_debug_heartbeat;		// send heartbeat at a debug rate
 cvar_t* hostname;
 cvar_t* public_server;			// should heartbeats be sent?
 
+cvar_t* sv_quantize;			// allow PROTOCOL_VERSION_QUANTIZED clients
+cvar_t* sv_quantize_coordbits;	// fractional bits of a quantized coordinate
+cvar_t* sv_quantize_anglebits;	// bits of a quantized entity angle
+
 cvar_t* sv_reconnect_limit;	// minimum seconds between connect messages
 
 void Master_Shutdown();
@@ -85,7 +89,7 @@ void SV_DropClient(client_t* drop)
 	// add the disconnect
 	MSG_WriteByte(&drop->netchan.message, svc_disconnect);
 
-	if (drop->state == cs_spawned)
+	if (drop->state == cs_spawned && !SV_RelayUpstream())
 	{
 		// call the prog function for removing a client
 		// this will remove the body, among other things
@@ -177,13 +181,15 @@ void SVC_DirectConnect()
 	int32_t 	version;
 	int32_t 	qport;
 	int32_t 	challenge;
+	int32_t 	netchan_flags;
 
 	adr = net_from;
 
 	Com_DPrintf("SVC_DirectConnect ()\n");
 
 	version = atoi(Cmd_Argv(1));
-	if (version != PROTOCOL_VERSION)
+	if (version != PROTOCOL_VERSION
+		&& version != PROTOCOL_VERSION_QUANTIZED)
 	{
 		Netchan_OutOfBandPrint(NS_SERVER, adr, "print\nServer is game version %s.\n", ENGINE_VERSION);
 		Com_DPrintf("    rejected connect from version %i\n", version);
@@ -197,6 +203,13 @@ void SVC_DirectConnect()
 	strncpy(userinfo, Cmd_Argv(4), sizeof(userinfo) - 1);
 	userinfo[sizeof(userinfo) - 1] = 0;
 
+	// netchan capabilities offered by the client, older clients don't send any
+	netchan_flags = atoi(Cmd_Argv(5)) & Netchan_SupportedFlags();
+
+	// the client can always fall back to the byte aligned frames
+	if (!sv_quantize->value)
+		version = PROTOCOL_VERSION;
+
 	// force the IP key/value pair so the game can filter based on ip
 	Info_SetValueForKey(userinfo, "ip", Net_AdrToString(net_from));
 
@@ -299,10 +312,11 @@ gotnewcl:
 	SV_UserinfoChanged(newcl);
 
 	// send the connect packet to the client
-	Netchan_OutOfBandPrint(NS_SERVER, adr, "client_connect");
+	Netchan_OutOfBandPrint(NS_SERVER, adr, "client_connect %i", netchan_flags);
 
-	Netchan_Setup(NS_SERVER, &newcl->netchan, adr, qport);
+	Netchan_Setup(NS_SERVER, &newcl->netchan, adr, qport, netchan_flags);
 
+	newcl->protocol = version;
 	newcl->state = cs_connected;
 
 	SZ_Init(&newcl->datagram, newcl->datagram_buf, sizeof(newcl->datagram_buf));
@@ -404,6 +418,10 @@ void SV_ConnectionlessPacket()
 		SVC_DirectConnect();
 	else if (!strcmp(c, "rcon"))
 		SVC_RemoteCommand();
+	else if (!strcmp(c, "relay"))
+		SV_RelaySubscribe();
+	else if (!strcmp(c, "relay_stop"))
+		SV_RelayUnsubscribe();
 	else
 		Com_Printf("bad connectionless packet from %s:\n%s\n"
 			, Net_AdrToString(net_from), s);
@@ -505,6 +523,13 @@ void SV_ReadPackets()
 			continue;
 		}
 
+		// ZombieTV stream from the server being relayed
+		if (LittleInt(*(int32_t*)net_message.data) == RELAY_MARKER)
+		{
+			SV_RelayPacket();
+			continue;
+		}
+
 		// read the qport out of the message so we can fix up
 		// stupid address translating routers
 		MSG_BeginReading(&net_message);
@@ -601,6 +626,9 @@ void SV_PrepWorldFrame()
 	edict_t* ent;
 	int32_t 	i;
 
+	if (SV_RelayUpstream())
+		SV_RelayPrepFrame();
+
 	for (i = 0; i < ge->num_edicts; i++, ent++)
 	{
 		ent = EDICT_NUM(i);
@@ -647,6 +675,26 @@ void SV_RunGameFrame()
 
 }
 
+/*
+==================
+SV_FrameDelay
+
+Milliseconds until the next game frame is due, so a dedicated server can
+sleep until then. Can be zero or negative if the frame is already late.
+==================
+*/
+int32_t SV_FrameDelay()
+{
+	// nothing to run, just keep the console responsive
+	if (!svs.initialized)
+		return 100;
+
+	if (sv_timedemo->value)
+		return 0;
+
+	return sv.time - svs.realtime;
+}
+
 /*
 ==================
 SV_Frame
@@ -654,12 +702,23 @@ SV_Frame
 */
 void SV_Frame(int32_t msec)
 {
+	int64_t frame_start, perf_start;
+
 	time_before_game = time_after_game = 0;
 
 	// if server is not active, do nothing
 	if (!svs.initialized)
 		return;
 
+	// run the load test bots outside of the measured frame
+	if (LoadTest_Active())
+		LoadTest_Frame();
+
+	// report a finished save
+	SV_SaveFrame();
+
+	frame_start = Sys_Nanoseconds();
+
 	svs.realtime += msec;
 
 	// keep the random time dependent
@@ -669,7 +728,14 @@ void SV_Frame(int32_t msec)
 	SV_CheckTimeouts();
 
 	// get packets from clients
+	TIMELINE_BEGIN("SV_ReadPackets");
+	perf_start = SV_PerfBegin();
 	SV_ReadPackets();
+	SV_PerfEnd(perf_readpackets, perf_start);
+	TIMELINE_END();
+
+	// pass on the ZombieTV stream
+	SV_RelayFrame();
 
 	// move autonomous things around if enough time has passed
 	if (!sv_timedemo->value && svs.realtime < sv.time)
@@ -681,6 +747,13 @@ void SV_Frame(int32_t msec)
 				Com_Printf("sv lowclamp\n");
 			svs.realtime = sv.time - 100;
 		}
+
+		if (sv_perf_enable->value)
+			SV_PerfAdd(perf_frame, Sys_Nanoseconds() - frame_start);
+
+		if (LoadTest_Active())
+			LoadTest_FrameTime(Sys_Nanoseconds() - frame_start, false);
+
 		Net_Sleep(sv.time - svs.realtime);
 		return;
 	}
@@ -692,10 +765,16 @@ void SV_Frame(int32_t msec)
 	SV_GiveMsec();
 
 	// let everything in the world think and move
+	TIMELINE_BEGIN("SV_RunGameFrame");
+	perf_start = SV_PerfBegin();
 	SV_RunGameFrame();
+	SV_PerfEnd(perf_gameframe, perf_start);
+	TIMELINE_END();
 
 	// send messages back to the clients that had packets read this frame
+	TIMELINE_BEGIN("SV_SendClientMessages");
 	SV_SendClientMessages();
+	TIMELINE_END();
 
 	// save the entire world state if recording a serverdemo
 	SV_RecordDemoMessage();
@@ -706,6 +785,14 @@ void SV_Frame(int32_t msec)
 	// clear teleport flags, etc for next frame
 	SV_PrepWorldFrame();
 
+	if (sv_perf_enable->value)
+	{
+		SV_PerfAdd(perf_frame, Sys_Nanoseconds() - frame_start);
+		SV_PerfFrame();
+	}
+
+	if (LoadTest_Active())
+		LoadTest_FrameTime(Sys_Nanoseconds() - frame_start, true);
 }
 
 //============================================================================
@@ -758,6 +845,10 @@ Only called at zombono.exe startup, not for each game
 void SV_Init()
 {
 	SV_InitOperatorCommands();
+	SV_PerfInit();
+	SV_DemoInit();
+	SV_RelayInit();
+	LoadTest_Init();
 
 	rcon_password = Cvar_Get("rcon_password", "", 0);
 	Cvar_Get("skill", "1", 0);
@@ -787,6 +878,10 @@ void SV_Init()
 
 	sv_noreload = Cvar_Get("sv_noreload", "0", 0);
 
+	sv_quantize = Cvar_Get("sv_quantize", "1", 0);
+	sv_quantize_coordbits = Cvar_Get("sv_quantize_coordbits", "3", CVAR_LATCH);
+	sv_quantize_anglebits = Cvar_Get("sv_quantize_anglebits", "10", CVAR_LATCH);
+
 	sv_stopspeed = Cvar_Get("sv_stopspeed", "100", CVAR_SERVERINFO);
 	sv_maxspeed_player = Cvar_Get("sv_maxspeed_player", "300", CVAR_SERVERINFO);
 	sv_maxspeed_director = Cvar_Get("sv_maxspeed_director", "300", CVAR_SERVERINFO);
@@ -866,8 +961,9 @@ void SV_Shutdown(char* finalmsg, bool reconnect)
 	//SV_ShutdownGameProgs ();
 
 	// free current level
-	if (sv.demofile)
-		fclose(sv.demofile);
+	SV_DemoClose();
+	SV_RelayShutdown();
+	SV_FreeSignon();
 	memset(&sv, 0, sizeof(sv));
 	Com_SetServerState(sv.state);
 
@@ -876,8 +972,9 @@ void SV_Shutdown(char* finalmsg, bool reconnect)
 		Memory_ZoneFree(svs.clients);
 	if (svs.client_entities)
 		Memory_ZoneFree(svs.client_entities);
-	if (svs.demofile)
-		fclose(svs.demofile);
+	SV_DemoStop();
+	SV_SaveWait();
+	SV_SaveDiscard();
 	memset(&svs, 0, sizeof(svs));
 }
 
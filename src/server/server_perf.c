@@ -0,0 +1,325 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// server_perf.c -- per phase server tick timers
+//
+// Each phase is accumulated over a server tick (packet only frames between ticks
+// are added to the next one) and the totals are kept for the last SV_PERF_SAMPLES
+// ticks. `sv_perf` prints the percentiles, which also works through rcon, and
+// sv_perf_file names a JSON file in the game directory that is rewritten every
+// sv_perf_interval seconds for monitoring to pick up.
+
+#include "server.h"
+
+// traces add to their phases from whatever thread they run on
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PERF_ADD(x, amount)		_InterlockedExchangeAdd64((volatile int64_t*)&(x), (amount))
+#else
+#define PERF_ADD(x, amount)		__sync_fetch_and_add(&(x), (amount))
+#endif
+
+#define SV_PERF_SAMPLES		1024		// ticks kept for the percentiles
+
+typedef struct perfphaseinfo_s
+{
+	const char*	name;
+	bool		count;			// a counter rather than nanoseconds
+} perfphaseinfo_t;
+
+static perfphaseinfo_t perf_phases[perf_max] =
+{
+	{ "frame", false },
+	{ "readpackets", false },
+	{ "gameframe", false },
+	{ "buildframe", false },
+	{ "writeframe", false },
+	{ "transmit", false },
+	{ "trace", false },
+	{ "netservices", false },
+	{ "traces", true },
+	{ "pointcontents", true },
+};
+
+static int64_t	perf_current[perf_max];							// this tick so far
+static int64_t	perf_samples[perf_max][SV_PERF_SAMPLES];
+static int32_t 	perf_count;										// ticks recorded, perf_count % SV_PERF_SAMPLES is the next one
+static int32_t 	perf_last_write;								// curtime sv_perf_file was last written
+static int32_t 	perf_last_traces;								// c_traces at the end of the last tick
+static int32_t 	perf_last_pointcontents;
+
+cvar_t*	sv_perf_enable;
+cvar_t*	sv_perf_traces;				// time every trace, this costs a timer read per trace
+static cvar_t*	sv_perf_file;
+static cvar_t*	sv_perf_interval;
+
+typedef struct perfstats_s
+{
+	int64_t	p50, p95, p99, max;
+	double	avg;
+} perfstats_t;
+
+/*
+==================
+SV_PerfBegin
+==================
+*/
+int64_t SV_PerfBegin()
+{
+	if (!sv_perf_enable->value)
+		return 0;
+
+	return Sys_Nanoseconds();
+}
+
+/*
+==================
+SV_PerfEnd
+
+Adds the time since SV_PerfBegin to a phase of the current tick
+==================
+*/
+void SV_PerfEnd(perfphase_t phase, int64_t start)
+{
+	if (!start)
+		return;
+
+	PERF_ADD(perf_current[phase], Sys_Nanoseconds() - start);
+}
+
+void SV_PerfAdd(perfphase_t phase, int64_t amount)
+{
+	PERF_ADD(perf_current[phase], amount);
+}
+
+// Netservices_Frame runs in Common_Frame, which can't see perfphase_t
+void SV_PerfNetservices(int64_t start)
+{
+	SV_PerfEnd(perf_netservices, start);
+}
+
+static int SV_PerfCompare(const void* a, const void* b)
+{
+	int64_t x = *(int64_t*)a, y = *(int64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+static int32_t SV_PerfStats(perfphase_t phase, perfstats_t* stats)
+{
+	static int64_t	sorted[SV_PERF_SAMPLES];
+	int32_t 		samples, i;
+	int64_t 		total;
+
+	memset(stats, 0, sizeof(*stats));
+
+	samples = perf_count < SV_PERF_SAMPLES ? perf_count : SV_PERF_SAMPLES;
+
+	if (!samples)
+		return 0;
+
+	memcpy(sorted, perf_samples[phase], samples * sizeof(int64_t));
+	qsort(sorted, samples, sizeof(int64_t), SV_PerfCompare);
+
+	total = 0;
+
+	for (i = 0; i < samples; i++)
+		total += sorted[i];
+
+	stats->p50 = sorted[samples / 2];
+	stats->p95 = sorted[samples * 95 / 100];
+	stats->p99 = sorted[samples * 99 / 100];
+	stats->max = sorted[samples - 1];
+	stats->avg = (double)total / samples;
+
+	return samples;
+}
+
+// milliseconds for timers, the plain number for counters
+static double SV_PerfValue(perfphase_t phase, double value)
+{
+	return perf_phases[phase].count ? value : value / 1000000.0;
+}
+
+/*
+==================
+SV_PerfWriteFile
+
+Writes the stats to a temporary file and renames it over sv_perf_file, so a reader never sees half of it
+==================
+*/
+static void SV_PerfWriteFile()
+{
+	char			name[MAX_OSPATH];
+	char			temp_name[MAX_OSPATH];
+	FILE*			file;
+	perfstats_t		stats;
+	int32_t 		samples, clients, i;
+
+	snprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), sv_perf_file->string);
+	snprintf(temp_name, sizeof(temp_name), "%s.tmp", name);
+
+	FS_CreatePath(name);
+	file = fopen(temp_name, "w");
+
+	if (!file)
+	{
+		Com_Printf("SV_PerfWriteFile: couldn't open %s\n", temp_name);
+		return;
+	}
+
+	clients = 0;
+
+	for (i = 0; i < sv_maxclients->value; i++)
+	{
+		if (svs.clients[i].state >= cs_connected)
+			clients++;
+	}
+
+	fprintf(file, "{\n\t\"map\": \"%s\",\n\t\"clients\": %i,\n\t\"ticks\": %i,\n\t\"tickrate\": %g,\n\t\"phases\": {\n",
+		sv.name, clients, perf_count, sv_tickrate->value);
+
+	for (i = 0; i < perf_max; i++)
+	{
+		samples = SV_PerfStats(i, &stats);
+
+		fprintf(file, "\t\t\"%s\": { \"unit\": \"%s\", \"samples\": %i, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+			perf_phases[i].name, perf_phases[i].count ? "count" : "ms", samples,
+			SV_PerfValue(i, stats.avg), SV_PerfValue(i, stats.p50), SV_PerfValue(i, stats.p95),
+			SV_PerfValue(i, stats.p99), SV_PerfValue(i, stats.max), i < perf_max - 1 ? "," : "");
+	}
+
+	fprintf(file, "\t}\n}\n");
+	fclose(file);
+
+	if (!Sys_ReplaceFile(temp_name, name))
+		Com_Printf("SV_PerfWriteFile: couldn't rename %s to %s\n", temp_name, name);
+}
+
+/*
+==================
+SV_PerfCount
+
+How far a collision counter has gone since the last tick. showtrace zeroes them, in which case
+what was counted before that is lost
+==================
+*/
+static int32_t SV_PerfCount(int32_t counter, int32_t* last)
+{
+	int32_t count;
+
+	count = counter >= *last ? counter - *last : counter;
+	*last = counter;
+
+	return count;
+}
+
+/*
+==================
+SV_PerfFrame
+
+Called at the end of every server tick
+==================
+*/
+void SV_PerfFrame()
+{
+	extern int32_t	c_traces, c_pointcontents;
+	int32_t 		i;
+
+	if (!sv_perf_enable->value)
+		return;
+
+	// the collision code counts every trace and pointcontents, whichever thread they run on
+	perf_current[perf_traces] = SV_PerfCount(c_traces, &perf_last_traces);
+	perf_current[perf_pointcontents] = SV_PerfCount(c_pointcontents, &perf_last_pointcontents);
+
+	for (i = 0; i < perf_max; i++)
+	{
+		perf_samples[i][perf_count % SV_PERF_SAMPLES] = perf_current[i];
+		perf_current[i] = 0;
+	}
+
+	perf_count++;
+
+	if (sv_perf_file->string[0]
+		&& curtime - perf_last_write >= sv_perf_interval->value * 1000)
+	{
+		perf_last_write = curtime;
+		SV_PerfWriteFile();
+	}
+}
+
+/*
+==================
+SV_Perf_f
+
+sv_perf [reset]
+==================
+*/
+static void SV_Perf_f()
+{
+	perfstats_t		stats;
+	int32_t 		samples, i;
+
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		memset(perf_current, 0, sizeof(perf_current));
+		perf_count = 0;
+		Com_Printf("Server perf stats reset.\n");
+		return;
+	}
+
+	if (!sv_perf_enable->value)
+	{
+		Com_Printf("sv_perf_enable is 0.\n");
+		return;
+	}
+
+	samples = perf_count < SV_PERF_SAMPLES ? perf_count : SV_PERF_SAMPLES;
+	Com_Printf("last %i ticks\n", samples);
+	Com_Printf("%-14s %9s %9s %9s %9s %9s %6s\n", "phase", "avg", "p50", "p95", "p99", "max", "unit");
+
+	for (i = 0; i < perf_max; i++)
+	{
+		// trace times are only taken with sv_perf_traces
+		if (i == perf_trace && !sv_perf_traces->value)
+			continue;
+
+		SV_PerfStats(i, &stats);
+
+		Com_Printf("%-14s %9.3f %9.3f %9.3f %9.3f %9.3f %6s\n", perf_phases[i].name,
+			SV_PerfValue(i, stats.avg), SV_PerfValue(i, stats.p50), SV_PerfValue(i, stats.p95),
+			SV_PerfValue(i, stats.p99), SV_PerfValue(i, stats.max), perf_phases[i].count ? "count" : "ms");
+	}
+}
+
+/*
+==================
+SV_PerfInit
+==================
+*/
+void SV_PerfInit()
+{
+	sv_perf_enable = Cvar_Get("sv_perf_enable", "1", 0);
+	sv_perf_traces = Cvar_Get("sv_perf_traces", "0", 0);
+	sv_perf_file = Cvar_Get("sv_perf_file", "", 0);
+	sv_perf_interval = Cvar_Get("sv_perf_interval", "10", 0);
+
+	Cmd_AddCommand("sv_perf", SV_Perf_f);
+}
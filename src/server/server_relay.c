@@ -0,0 +1,1222 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// server_relay.c -- ZombieTV spectator relays
+//
+// A game server with sv_relay_password set streams the serverrecord messages
+// (every entity, no deltas, with all multicasts) to up to sv_relay_max relays.
+// The message is built once per frame however many relays and viewers there
+// are, so the game server's cost doesn't grow with the audience.
+//
+// `relay <address> [password]` turns a server into a relay of that address. It
+// subscribes to the stream, holds it back sv_relay_delay seconds, and keeps its
+// own copy of the match from it: the configstrings, the baselines, the map and
+// the entities of the last frame. Viewers connect to it like to any server and
+// are sent ordinary client frames, culled by the PVS of a free flying camera
+// each of them moves, followed by the frame's multicasts. A relay passes the
+// stream on to relays of its own, so relays can be chained.
+//
+// A relay that subscribes, or whose server changes map, is sent the serverdata,
+// the configstrings and the baselines. The game server sends the configstrings
+// again every sv_relay_keyframe seconds, and changes to them also come in the
+// frames' multicasts.
+//
+// The stream goes in plain datagrams starting with RELAY_MARKER. A message
+// bigger than one datagram, like a frame of a crowded map, is split in
+// fragments that carry its length and their offset in it, and is put back
+// together by the relay. Nothing is resent: frames are never delta compressed
+// and keyframes repeat, so a lost packet, and the message it was part of, is
+// made good by the ones after it. relay_status counts the lost packets. Door state isn't in the stream, so
+// a relay sees through every areaportal.
+
+#include "server.h"
+
+#define RELAY_MAX_PAYLOAD		(MAX_MSGLEN - 16)	// message bytes in a packet, after the header
+#define RELAY_MAX_MESSAGE		32768		// as the frames SV_RecordDemoMessage builds
+#define RELAY_MAX_SUBSCRIBERS	16
+#define RELAY_KEEPALIVE			1000		// ms between a relay's subscription refreshes
+#define RELAY_TIMEOUT			10000		// ms without a refresh before a relay is dropped
+#define RELAY_MAX_ENT_LEAFS		256			// as in SV_LinkEdict
+
+typedef struct relaysub_s
+{
+	bool		active;
+	netadr_t	adr;
+	int32_t 	last_keepalive;		// curtime
+	bool		started;			// has been sent the serverdata and a keyframe
+	int32_t 	spawncount;			// svs.spawncount when started, a new map starts it again
+	int32_t 	sequence;
+} relaysub_t;
+
+typedef struct relaymsg_s
+{
+	struct relaymsg_s*	next;
+	int32_t 			time;		// curtime it arrived
+	int32_t 			length;
+	uint8_t				data[1];	// variable sized
+} relaymsg_t;
+
+// a relayed entity, with the areas and clusters SV_LinkEdict would give it
+typedef struct relayent_s
+{
+	entity_state_t	s;
+	int32_t 		framecount;		// relay_framecount of the last frame it was in
+	int32_t 		areanum, areanum2;
+	int32_t 		num_clusters;	// -1 if it touches too many, then headnode is checked
+	int32_t 		clusternums[MAX_ENT_CLUSTERS];
+	int32_t 		headnode;
+} relayent_t;
+
+static relaysub_t	relay_subs[RELAY_MAX_SUBSCRIBERS];
+static int32_t 		relay_num_subs;
+static int32_t 		relay_last_keyframe;	// curtime the game server last sent configstrings to relays
+static relaysub_t*	relay_target;			// for SV_RelayWriteTarget
+
+// when this server is a relay
+static bool			relay_upstream;
+static netadr_t		relay_upstream_adr;
+static char			relay_password[MAX_QPATH];
+static int32_t 		relay_last_keepalive;
+static int32_t 		relay_last_received;
+static int32_t 		relay_sequence;			// last sequence received
+static int32_t 		relay_lost;				// packets that never arrived
+
+static uint8_t		relay_partial[RELAY_MAX_MESSAGE];	// a message being put back together from its fragments
+static int32_t 		relay_partial_length;	// bytes of it received so far
+static int32_t 		relay_partial_total;	// its full length, 0 if there is none
+
+static relaymsg_t*	relay_queue;			// waiting out sv_relay_delay
+static relaymsg_t*	relay_queue_tail;
+
+static bool			relay_have_map;			// the relayed map is loaded
+static bool			relay_ready;			// has the map and a frame, so viewers can be started
+static relayent_t	relay_ents[MAX_EDICTS];		// by entity number
+static int16_t		relay_frame_ents[MAX_EDICTS];	// the numbers of the entities in the last frame, in order
+static int32_t 		relay_num_frame_ents;
+static int32_t 		relay_framecount;
+
+static cvar_t*	sv_relay_password;
+static cvar_t*	sv_relay_max;
+static cvar_t*	sv_relay_delay;
+static cvar_t*	sv_relay_keyframe;
+
+static void SV_RelayFreeList(relaymsg_t* msg)
+{
+	relaymsg_t* next;
+
+	for (; msg; msg = next)
+	{
+		next = msg->next;
+		Memory_ZoneFree(msg);
+	}
+}
+
+/*
+==================
+SV_RelaySendMessage
+
+Sends a stream message to a relay, in as many packets as it takes
+==================
+*/
+static void SV_RelaySendMessage(relaysub_t* sub, uint8_t* data, int32_t length)
+{
+	uint8_t		packet[MAX_MSGLEN];
+	int32_t 	header[4];
+	int32_t 	offset, fragment;
+
+	for (offset = 0; offset < length; offset += fragment)
+	{
+		fragment = length - offset;
+
+		if (fragment > RELAY_MAX_PAYLOAD)
+			fragment = RELAY_MAX_PAYLOAD;
+
+		header[0] = LittleInt(RELAY_MARKER);
+		header[1] = LittleInt(++sub->sequence);
+		header[2] = LittleInt(offset);
+		header[3] = LittleInt(length);
+
+		memcpy(packet, header, sizeof(header));
+		memcpy(packet + sizeof(header), data + offset, fragment);
+		Net_SendPacket(NS_SERVER, sizeof(header) + fragment, packet, sub->adr);
+	}
+}
+
+/*
+==================
+SV_RelayBroadcast
+
+Sends a stream message to every relay subscribed to this server
+==================
+*/
+void SV_RelayBroadcast(uint8_t* data, int32_t length)
+{
+	relaysub_t* sub;
+	int32_t 	i;
+
+	if (!relay_num_subs)
+		return;
+
+	// the relays couldn't put it back together
+	if (length > RELAY_MAX_MESSAGE)
+		Com_Error(ERR_DROP, "SV_RelayBroadcast: %i byte message is too big to relay", length);
+
+	for (i = 0, sub = relay_subs; i < RELAY_MAX_SUBSCRIBERS; i++, sub++)
+	{
+		if (sub->active && sub->started)
+			SV_RelaySendMessage(sub, data, length);
+	}
+}
+
+static void SV_RelayWriteTarget(uint8_t* data, int32_t length)
+{
+	SV_RelaySendMessage(relay_target, data, length);
+}
+
+/*
+==================
+SV_RelayStart
+
+Sends a relay that just subscribed, or whose server changed map, the serverdata and a keyframe
+==================
+*/
+static void SV_RelayStart(relaysub_t* sub)
+{
+	sizebuf_t	buf;
+	uint8_t		buf_data[MAX_MSGLEN];
+
+	// a relay starts its relays from its own copy of the match
+	if (relay_upstream ? !relay_ready : sv.state != ss_game)
+		return;
+
+	SZ_Init(&buf, buf_data, sizeof(buf_data));
+	SV_DemoServerdata(&buf);
+	SV_RelaySendMessage(sub, buf.data, buf.cursize);
+
+	relay_target = sub;
+	SV_DemoConfigstrings(RELAY_MAX_PAYLOAD, SV_RelayWriteTarget);
+	SV_DemoBaselines(RELAY_MAX_PAYLOAD, SV_RelayWriteTarget);
+
+	sub->started = true;
+	sub->spawncount = svs.spawncount;
+}
+
+/*
+==================
+SV_RelaySubscribe
+
+"relay <password>" from a relay, sent every RELAY_KEEPALIVE
+==================
+*/
+void SV_RelaySubscribe()
+{
+	relaysub_t* sub;
+	relaysub_t* free_sub;
+	int32_t 	i;
+
+	if (!sv_relay_password->string[0]
+		|| strcmp(Cmd_Argv(1), sv_relay_password->string))
+	{
+		Netchan_OutOfBandPrint(NS_SERVER, net_from, "print\nThis server doesn't allow ZombieTV relays.\n");
+		return;
+	}
+
+	free_sub = NULL;
+
+	for (i = 0, sub = relay_subs; i < RELAY_MAX_SUBSCRIBERS; i++, sub++)
+	{
+		if (!sub->active)
+		{
+			if (!free_sub)
+				free_sub = sub;
+			continue;
+		}
+
+		if (Net_CompareAdr(net_from, sub->adr))
+		{
+			sub->last_keepalive = curtime;
+			return;
+		}
+	}
+
+	if (!free_sub || relay_num_subs >= sv_relay_max->value)
+	{
+		Netchan_OutOfBandPrint(NS_SERVER, net_from, "print\nThis server has all the ZombieTV relays it allows.\n");
+		return;
+	}
+
+	memset(free_sub, 0, sizeof(*free_sub));
+	free_sub->active = true;
+	free_sub->adr = net_from;
+	free_sub->last_keepalive = curtime;
+	relay_num_subs++;
+
+	Com_Printf("ZombieTV relay %s subscribed\n", Net_AdrToString(net_from));
+}
+
+static void SV_RelayDropSubscriber(relaysub_t* sub, char* reason)
+{
+	Com_Printf("ZombieTV relay %s %s\n", Net_AdrToString(sub->adr), reason);
+	sub->active = false;
+	relay_num_subs--;
+}
+
+/*
+==================
+SV_RelayUnsubscribe
+
+"relay_stop" from a relay
+==================
+*/
+void SV_RelayUnsubscribe()
+{
+	relaysub_t* sub;
+	int32_t 	i;
+
+	for (i = 0, sub = relay_subs; i < RELAY_MAX_SUBSCRIBERS; i++, sub++)
+	{
+		if (sub->active && Net_CompareAdr(net_from, sub->adr))
+			SV_RelayDropSubscriber(sub, "unsubscribed");
+	}
+}
+
+int32_t SV_RelaySubscribers()
+{
+	return relay_num_subs;
+}
+
+bool SV_RelayUpstream()
+{
+	return relay_upstream;
+}
+
+bool SV_RelayReady()
+{
+	return relay_ready;
+}
+
+/*
+==================
+SV_RelayPacket
+
+A stream packet, which is only accepted from the server being relayed. A message is
+queued once all of its fragments have come in, in order
+==================
+*/
+void SV_RelayPacket()
+{
+	relaymsg_t* msg;
+	int32_t 	sequence, offset, total, length;
+	bool		in_order;
+
+	if (!relay_upstream
+		|| !Net_CompareAdr(net_from, relay_upstream_adr))
+		return;
+
+	MSG_BeginReading(&net_message);
+	MSG_ReadInt(&net_message);		// RELAY_MARKER
+	sequence = MSG_ReadInt(&net_message);
+	offset = MSG_ReadInt(&net_message);
+	total = MSG_ReadInt(&net_message);
+
+	// drop duplicated and out of order packets, unless the server has restarted
+	if (sequence <= relay_sequence && sequence > 1)
+		return;
+
+	in_order = (sequence == relay_sequence + 1);
+
+	if (sequence > relay_sequence + 1 && relay_sequence)
+		relay_lost += sequence - relay_sequence - 1;
+
+	relay_sequence = sequence;
+	relay_last_received = curtime;
+
+	length = net_message.cursize - net_message.readcount;
+
+	if (length <= 0
+		|| offset < 0
+		|| total > RELAY_MAX_MESSAGE
+		|| offset + length > total)
+	{
+		relay_partial_total = 0;
+		return;
+	}
+
+	if (!offset)
+	{
+		relay_partial_length = 0;
+		relay_partial_total = total;
+	}
+	else if (!in_order
+		|| total != relay_partial_total
+		|| offset != relay_partial_length)
+	{
+		// an earlier fragment of the message was lost
+		relay_partial_total = 0;
+		return;
+	}
+
+	memcpy(relay_partial + offset, net_message.data + net_message.readcount, length);
+	relay_partial_length += length;
+
+	if (relay_partial_length < relay_partial_total)
+		return;
+
+	relay_partial_total = 0;
+
+	msg = Memory_ZoneMalloc(sizeof(relaymsg_t) + total);
+	msg->time = curtime;
+	msg->length = total;
+	memcpy(msg->data, relay_partial, total);
+
+	if (relay_queue_tail)
+		relay_queue_tail->next = msg;
+	else
+		relay_queue = msg;
+
+	relay_queue_tail = msg;
+}
+
+/*
+==================
+SV_RelayPhysics
+
+The viewers predict their cameras with the relayed server's physics, so move them with it too
+==================
+*/
+static void SV_RelayPhysics()
+{
+	phys_stopspeed = (float)atof(sv.configstrings[CS_PHYS_STOPSPEED]);
+	phys_maxspeed_player = (float)atof(sv.configstrings[CS_PHYS_MAXSPEED_PLAYER]);
+	phys_maxspeed_director = (float)atof(sv.configstrings[CS_PHYS_MAXSPEED_DIRECTOR]);
+	phys_duckspeed = (float)atof(sv.configstrings[CS_PHYS_DUCKSPEED]);
+	phys_accelerate_player = (float)atof(sv.configstrings[CS_PHYS_ACCELERATE_PLAYER]);
+	phys_accelerate_director = (float)atof(sv.configstrings[CS_PHYS_ACCELERATE_DIRECTOR]);
+	phys_airaccelerate = (float)atof(sv.configstrings[CS_PHYS_ACCELERATE_AIR]);
+	phys_wateraccelerate = (float)atof(sv.configstrings[CS_PHYS_ACCELERATE_WATER]);
+	phys_friction = (float)atof(sv.configstrings[CS_PHYS_FRICTION]);
+	phys_waterfriction = (float)atof(sv.configstrings[CS_PHYS_FRICTION_WATER]);
+}
+
+/*
+==================
+SV_RelayLoadMap
+
+Loads the map and its inline models once the configstrings name it
+==================
+*/
+static void SV_RelayLoadMap()
+{
+	uint32_t	checksum;
+	bool*		portalopen;
+	int32_t 	i, length;
+
+	if (relay_have_map || !sv.configstrings[CS_MODELS + 1][0])
+		return;
+
+	sv.models[1] = Map_Load(sv.configstrings[CS_MODELS + 1], false, &checksum);
+
+	if (checksum != atoi(sv.configstrings[CS_MAPCHECKSUM]))
+		Com_Printf("WARNING: %s isn't the same as the relayed server's\n", sv.configstrings[CS_MODELS + 1]);
+
+	for (i = 1; i < Map_NumInlineModels(); i++)
+		sv.models[i + 1] = Map_LoadInlineModel(va("*%i", i));
+
+	// open every areaportal, there's no door state to close them with
+	portalopen = Map_PortalState(&length);
+	memset(portalopen, true, length);
+	Map_SetAreaPortalState(0, true);
+
+	relay_have_map = true;
+}
+
+/*
+==================
+SV_RelayServerdata
+
+A new map. Everything kept so far is out of date, and the viewers load the map again
+once the relay has it.
+==================
+*/
+static void SV_RelayServerdata(sizebuf_t* msg)
+{
+	client_t*	c;
+	char*		levelname;
+	int32_t 	i;
+
+	MSG_ReadByte(msg);		// svc_serverdata
+	MSG_ReadInt(msg);		// protocol
+	MSG_ReadInt(msg);		// spawncount
+	MSG_ReadByte(msg);		// attractloop
+	MSG_ReadString(msg);	// gamedir
+	MSG_ReadShort(msg);		// playernum
+	levelname = MSG_ReadString(msg);
+
+	svs.spawncount++;
+	relay_have_map = relay_ready = false;
+	relay_num_frame_ents = 0;
+
+	SV_FreeSignon();
+	memset(sv.configstrings, 0, sizeof(sv.configstrings));
+	memset(sv.baselines, 0, sizeof(sv.baselines));
+	strncpy(sv.configstrings[CS_NAME], levelname, sizeof(sv.configstrings[CS_NAME]) - 1);
+
+	for (i = 0, c = svs.clients; i < sv_maxclients->value; i++, c++)
+	{
+		if (c->state < cs_connected)
+			continue;
+
+		c->state = cs_connected;
+		c->lastframe = -1;
+		c->relay_start = false;
+
+		MSG_WriteByte(&c->netchan.message, svc_stufftext);
+		MSG_WriteString(&c->netchan.message, "changing\n");
+		MSG_WriteByte(&c->netchan.message, svc_stufftext);
+		MSG_WriteString(&c->netchan.message, "reconnect\n");
+	}
+}
+
+/*
+==================
+SV_RelayConfigstrings
+
+A run of configstrings from a keyframe. The ones that changed are sent on to the viewers.
+==================
+*/
+static void SV_RelayConfigstrings(sizebuf_t* msg)
+{
+	sizebuf_t	changed;
+	uint8_t		changed_buf[MAX_MSGLEN];
+	client_t*	c;
+	char*		str;
+	int32_t 	i, index;
+
+	SZ_Init(&changed, changed_buf, sizeof(changed_buf));
+
+	while (MSG_ReadByte(msg) == svc_configstring)
+	{
+		index = MSG_ReadShort(msg);
+		str = MSG_ReadString(msg);
+
+		if (index < 0 || index >= MAX_CONFIGSTRINGS)
+			break;
+
+		if (!strcmp(sv.configstrings[index], str))
+			continue;
+
+		strcpy(sv.configstrings[index], str);
+
+		MSG_WriteByte(&changed, svc_configstring);
+		MSG_WriteShort(&changed, index);
+		MSG_WriteString(&changed, str);
+	}
+
+	if (!changed.cursize)
+		return;
+
+	SV_InvalidateSignon();
+	SV_RelayPhysics();
+	SV_RelayLoadMap();
+
+	for (i = 0, c = svs.clients; i < sv_maxclients->value; i++, c++)
+	{
+		if (c->state >= cs_connected && !c->relay_start)
+			SZ_Write(&c->netchan.message, changed.data, changed.cursize);
+	}
+}
+
+/*
+==================
+SV_RelayBaselines
+
+A run of baselines. They're kept until the relay is ready, after that the viewers
+have been started with the ones it has and every viewer has to delta from the same ones.
+==================
+*/
+static void SV_RelayBaselines(sizebuf_t* msg)
+{
+	entity_state_t	nullstate;
+	uint32_t		bits;
+	int32_t 		number;
+
+	if (relay_ready)
+		return;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+
+	while (MSG_ReadByte(msg) == svc_spawnbaseline)
+	{
+		number = MSG_ReadEntityBits(msg, &bits, NULL);
+
+		if (number <= 0 || number >= MAX_EDICTS
+			|| msg->readcount > msg->cursize)
+			break;
+
+		MSG_ReadDeltaEntity(msg, &nullstate, &sv.baselines[number], number, bits, NULL);
+	}
+}
+
+/*
+==================
+SV_RelayLinkEntity
+
+Finds the areas and clusters of a relayed entity like SV_LinkEdict, from the inline
+model or the bounding box packed into the solid
+==================
+*/
+static void SV_RelayLinkEntity(relayent_t* ent)
+{
+	int32_t 	leafs[RELAY_MAX_ENT_LEAFS];
+	int32_t 	clusters[RELAY_MAX_ENT_LEAFS];
+	int32_t 	num_leafs;
+	int32_t 	i, j, x, zd, zu;
+	int32_t 	area, topnode;
+	vec3_t		mins, maxs;
+	float		max, v;
+	cmodel_t*	model;
+
+	model = NULL;
+
+	if (ent->s.modelindex > 0 && ent->s.modelindex < MAX_MODELS
+		&& sv.configstrings[CS_MODELS + ent->s.modelindex][0] == '*')
+		model = sv.models[ent->s.modelindex];
+
+	if (model)
+	{
+		VectorCopy3(model->mins, mins);
+		VectorCopy3(model->maxs, maxs);
+
+		// expand for rotation
+		if (ent->s.angles[0] || ent->s.angles[1] || ent->s.angles[2])
+		{
+			max = 0;
+			for (i = 0; i < 3; i++)
+			{
+				v = fabsf(mins[i]);
+				if (v > max)
+					max = v;
+				v = fabsf(maxs[i]);
+				if (v > max)
+					max = v;
+			}
+			for (i = 0; i < 3; i++)
+			{
+				mins[i] = -max;
+				maxs[i] = max;
+			}
+		}
+	}
+	else if (ent->s.solid && ent->s.solid != 31)
+	{
+		x = 8 * (ent->s.solid & 31);
+		zd = 8 * ((ent->s.solid >> 5) & 31);
+		zu = 8 * ((ent->s.solid >> 10) & 63) - 32;
+
+		mins[0] = mins[1] = -x;
+		maxs[0] = maxs[1] = x;
+		mins[2] = -zd;
+		maxs[2] = zu;
+	}
+	else
+	{
+		VectorClear3(mins);
+		VectorClear3(maxs);
+	}
+
+	// the same epsilon SV_LinkEdict adds
+	for (i = 0; i < 3; i++)
+	{
+		mins[i] += ent->s.origin[i] - 1;
+		maxs[i] += ent->s.origin[i] + 1;
+	}
+
+	ent->num_clusters = 0;
+	ent->areanum = 0;
+	ent->areanum2 = 0;
+
+	num_leafs = Map_BoxLeafnums(mins, maxs, leafs, RELAY_MAX_ENT_LEAFS, &topnode);
+
+	for (i = 0; i < num_leafs; i++)
+	{
+		clusters[i] = Map_GetLeafCluster(leafs[i]);
+		area = Map_LeafArea(leafs[i]);
+		if (area)
+		{
+			if (ent->areanum && ent->areanum != area)
+				ent->areanum2 = area;
+			else
+				ent->areanum = area;
+		}
+	}
+
+	if (num_leafs >= RELAY_MAX_ENT_LEAFS)
+	{
+		ent->num_clusters = -1;
+		ent->headnode = topnode;
+		return;
+	}
+
+	for (i = 0; i < num_leafs; i++)
+	{
+		if (clusters[i] == -1)
+			continue;		// not a visible leaf
+		for (j = 0; j < i; j++)
+			if (clusters[j] == clusters[i])
+				break;
+		if (j == i)
+		{
+			if (ent->num_clusters == MAX_ENT_CLUSTERS)
+			{
+				ent->num_clusters = -1;
+				ent->headnode = topnode;
+				return;
+			}
+
+			ent->clusternums[ent->num_clusters++] = clusters[i];
+		}
+	}
+}
+
+/*
+==================
+SV_RelayParseFrame
+
+Reads the entities of a frame, then hands its multicasts to the viewers. The
+viewers are sent it from their own cameras on the relay's next server frame.
+==================
+*/
+static void SV_RelayParseFrame(sizebuf_t* msg)
+{
+	entity_state_t	nullstate, state;
+	relayent_t*		ent;
+	client_t*		c;
+	uint32_t		bits;
+	int32_t 		i, number;
+	bool			moved;
+
+	MSG_ReadByte(msg);		// svc_frame
+	MSG_ReadInt(msg);		// the relayed server's frame, the viewers are sent the relay's own
+
+	if (MSG_ReadByte(msg) != svc_packetentities)
+		return;
+
+	memset(&nullstate, 0, sizeof(nullstate));
+
+	relay_framecount++;
+	relay_num_frame_ents = 0;
+
+	while (true)
+	{
+		number = MSG_ReadEntityBits(msg, &bits, NULL);
+
+		if (msg->readcount > msg->cursize
+			|| number < 0 || number >= MAX_EDICTS)
+		{
+			Com_DPrintf("SV_RelayParseFrame: bad frame\n");
+			relay_num_frame_ents = 0;
+			return;
+		}
+
+		if (!number)
+			break;		// end of packetentities
+
+		MSG_ReadDeltaEntity(msg, &nullstate, &state, number, bits, NULL);
+
+		ent = &relay_ents[number];
+
+		// only relink what moved, most things stand still from one frame to the next
+		moved = ent->framecount != relay_framecount - 1
+			|| !VectorCompare3(ent->s.origin, state.origin)
+			|| !VectorCompare3(ent->s.angles, state.angles)
+			|| ent->s.solid != state.solid
+			|| ent->s.modelindex != state.modelindex;
+
+		// an event that hasn't gone out yet isn't lost to a second frame arriving first
+		if (!state.event && ent->framecount == relay_framecount - 1)
+			state.event = ent->s.event;
+
+		ent->s = state;
+		ent->framecount = relay_framecount;
+
+		if (moved && relay_have_map)
+			SV_RelayLinkEntity(ent);
+
+		relay_frame_ents[relay_num_frame_ents++] = number;
+	}
+
+	// the relayed server's multicasts go to everyone, the relay can't tell who they were for
+	if (msg->readcount < msg->cursize)
+	{
+		for (i = 0, c = svs.clients; i < sv_maxclients->value; i++, c++)
+		{
+			if (c->state == cs_spawned)
+				SZ_Write(&c->datagram, msg->data + msg->readcount, msg->cursize - msg->readcount);
+		}
+	}
+
+	if (!relay_ready && relay_have_map)
+	{
+		// the entities seen before the map was loaded need linking
+		for (i = 0; i < relay_num_frame_ents; i++)
+			SV_RelayLinkEntity(&relay_ents[relay_frame_ents[i]]);
+
+		SV_BuildSignon();
+		relay_ready = true;
+	}
+}
+
+/*
+==================
+SV_RelayRelease
+
+Passes a message that has waited out sv_relay_delay on to the relays of this relay,
+and updates the relay's copy of the match with it
+==================
+*/
+static void SV_RelayRelease(relaymsg_t* msg)
+{
+	sizebuf_t	buf;
+
+	SV_RelayBroadcast(msg->data, msg->length);
+
+	SZ_Init(&buf, msg->data, msg->length);
+	buf.cursize = msg->length;
+	MSG_BeginReading(&buf);
+
+	switch (msg->data[0])
+	{
+	case svc_serverdata:
+		SV_RelayServerdata(&buf);
+		break;
+	case svc_configstring:
+		SV_RelayConfigstrings(&buf);
+		break;
+	case svc_spawnbaseline:
+		SV_RelayBaselines(&buf);
+		break;
+	case svc_frame:
+		SV_RelayParseFrame(&buf);
+		break;
+	}
+
+	Memory_ZoneFree(msg);
+}
+
+/*
+==================
+SV_RelayViewers
+
+Releases the messages that have waited long enough, and starts the viewers that were
+waiting for the relay to have a map
+==================
+*/
+static void SV_RelayViewers()
+{
+	relaymsg_t* msg;
+	client_t*	c;
+	int32_t 	i;
+
+	while (relay_queue
+		&& curtime - relay_queue->time >= sv_relay_delay->value * 1000)
+	{
+		msg = relay_queue;
+		relay_queue = msg->next;
+
+		if (!relay_queue)
+			relay_queue_tail = NULL;
+
+		SV_RelayRelease(msg);
+	}
+
+	if (!relay_ready)
+		return;
+
+	for (i = 0, c = svs.clients; i < sv_maxclients->value; i++, c++)
+	{
+		if (c->state == cs_connected && c->relay_start)
+		{
+			sv_client = c;
+			SV_New_f();
+		}
+	}
+}
+
+/*
+==================
+SV_RelayBuildClientFrame
+
+SV_BuildClientFrame for a viewer, the relayed entities seen from its camera
+==================
+*/
+void SV_RelayBuildClientFrame(client_t* client)
+{
+	client_frame_t* frame;
+	entity_state_t* state;
+	relayent_t*		ent;
+	player_state_t* ps;
+	vec3_t			org, delta;
+	int32_t 		e, i, l;
+	int32_t 		leafnum, clientarea, clientcluster;
+	uint8_t*		clientphs;
+
+	frame = &client->frames[sv.framenum & UPDATE_MASK];
+	frame->senttime = svs.realtime;
+
+	ps = &client->relay_ps;
+
+	for (i = 0; i < 3; i++)
+		org[i] = ps->pmove.origin[i] + ps->viewoffset[i];
+
+	leafnum = Map_PointLeafnum(org);
+	clientarea = Map_LeafArea(leafnum);
+	clientcluster = Map_GetLeafCluster(leafnum);
+
+	frame->areabytes = Map_WriteAreaBits(frame->areabits, clientarea);
+	frame->ps = *ps;
+
+	SV_FatPVS(org);
+	clientphs = Map_ClusterPHS(clientcluster);
+
+	frame->num_entities = 0;
+	frame->first_entity = svs.next_client_entities;
+
+	for (e = 0; e < relay_num_frame_ents; e++)
+	{
+		ent = &relay_ents[relay_frame_ents[e]];
+
+		if (!Map_AreasConnected(clientarea, ent->areanum)
+			&& (!ent->areanum2 || !Map_AreasConnected(clientarea, ent->areanum2)))
+			continue;
+
+		// beams just check one point for PHS
+		if (ent->s.renderfx & RF_BEAM)
+		{
+			l = ent->clusternums[0];
+			if (!(clientphs[l >> 3] & (1 << (l & 7))))
+				continue;
+		}
+		else
+		{
+			if (ent->num_clusters == -1)
+			{
+				if (!Map_HeadnodeVisible(ent->headnode, fatpvs))
+					continue;
+			}
+			else
+			{
+				for (i = 0; i < ent->num_clusters; i++)
+				{
+					l = ent->clusternums[i];
+					if (fatpvs[l >> 3] & (1 << (l & 7)))
+						break;
+				}
+				if (i == ent->num_clusters)
+					continue;
+			}
+
+			// don't send sounds if they will be attenuated away
+			if (!ent->s.modelindex)
+			{
+				VectorSubtract3(org, ent->s.origin, delta);
+				if (VectorLength3(delta) > 400)
+					continue;
+			}
+		}
+
+		state = &svs.client_entities[svs.next_client_entities % svs.num_client_entities];
+		*state = ent->s;
+
+		svs.next_client_entities++;
+		frame->num_entities++;
+	}
+}
+
+/*
+==================
+SV_RelayBeginViewer
+
+A viewer's camera starts on the first relayed entity, which is a player when there are any
+==================
+*/
+void SV_RelayBeginViewer(client_t* client)
+{
+	player_state_t* ps = &client->relay_ps;
+
+	memset(ps, 0, sizeof(*ps));
+	ps->pmove.pm_type = PM_SPECTATOR;
+	ps->viewoffset[2] = 22;
+	ps->fov = 90;
+
+	if (relay_num_frame_ents)
+		VectorCopy3(relay_ents[relay_frame_ents[0]].s.origin, ps->pmove.origin);
+
+	VectorCopy3(ps->pmove.origin, ps->vieworigin);
+}
+
+static trace_t SV_RelayTrace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	return Map_BoxTrace(start, end, mins, maxs, 0, MASK_PLAYERSOLID);
+}
+
+static int32_t SV_RelayPointContents(vec3_t point)
+{
+	return Map_PointContents(point, 0);
+}
+
+/*
+==================
+SV_RelayViewerThink
+
+Flies a viewer's camera, the way its client predicts it. A spectator doesn't clip,
+so only the world is there to trace.
+==================
+*/
+void SV_RelayViewerThink(client_t* client, usercmd_t* cmd)
+{
+	pmove_t pm;
+
+	memset(&pm, 0, sizeof(pm));
+	pm.s = client->relay_ps.pmove;
+	pm.cmd = *cmd;
+	pm.trace = SV_RelayTrace;
+	pm.pointcontents = SV_RelayPointContents;
+
+	Player_MoveRecord(client - svs.clients, &client->relay_ps.pmove, cmd);
+
+	Player_MoveSnapped(&pm, SV_ClientSnapScale(client));
+
+	client->relay_ps.pmove = pm.s;
+	VectorCopy3(pm.s.origin, client->relay_ps.vieworigin);
+	VectorCopy3(pm.viewangles, client->relay_ps.viewangles);
+}
+
+/*
+==================
+SV_RelayPrepFrame
+
+Events only go out in a single message, like SV_PrepWorldFrame does for edicts
+==================
+*/
+void SV_RelayPrepFrame()
+{
+	int32_t i;
+
+	for (i = 0; i < relay_num_frame_ents; i++)
+		relay_ents[relay_frame_ents[i]].s.event = 0;
+}
+
+/*
+==================
+SV_RelayFrame
+
+Called every time the server looks for packets, not just on server frames, so the stream is taken in and passed on as it arrives
+==================
+*/
+void SV_RelayFrame()
+{
+	relaysub_t* sub;
+	int32_t 	i;
+
+	if (relay_upstream)
+	{
+		// the server was changed to something else
+		if (sv.state != ss_demo)
+		{
+			SV_RelayDisconnect();
+			return;
+		}
+
+		if (curtime - relay_last_keepalive >= RELAY_KEEPALIVE)
+		{
+			relay_last_keepalive = curtime;
+			Netchan_OutOfBandPrint(NS_SERVER, relay_upstream_adr, "relay %s", relay_password);
+		}
+
+		SV_RelayViewers();
+	}
+
+	if (!relay_num_subs)
+		return;
+
+	// catch multicasts for the frames, if serverrecord isn't already
+	if (!svs.demo_multicast.maxsize)
+		SZ_Init(&svs.demo_multicast, svs.demo_multicast_buf, sizeof(svs.demo_multicast_buf));
+
+	for (i = 0, sub = relay_subs; i < RELAY_MAX_SUBSCRIBERS; i++, sub++)
+	{
+		if (!sub->active)
+			continue;
+
+		if (curtime - sub->last_keepalive > RELAY_TIMEOUT)
+			SV_RelayDropSubscriber(sub, "timed out");
+		else if (!sub->started
+			|| (!relay_upstream && sub->spawncount != svs.spawncount))
+			SV_RelayStart(sub);
+	}
+
+	// a relay's keyframes come from its own server
+	if (!relay_upstream
+		&& sv.state == ss_game
+		&& sv_relay_keyframe->value > 0
+		&& curtime - relay_last_keyframe >= sv_relay_keyframe->value * 1000)
+	{
+		relay_last_keyframe = curtime;
+		SV_DemoConfigstrings(RELAY_MAX_PAYLOAD, SV_RelayBroadcast);
+	}
+}
+
+/*
+==================
+SV_RelayDisconnect
+
+Stops relaying, this server's viewers and relays stay connected
+==================
+*/
+void SV_RelayDisconnect()
+{
+	if (!relay_upstream)
+		return;
+
+	Netchan_OutOfBandPrint(NS_SERVER, relay_upstream_adr, "relay_stop");
+	relay_upstream = false;
+
+	SV_RelayFreeList(relay_queue);
+	relay_queue = relay_queue_tail = NULL;
+
+	relay_have_map = relay_ready = false;
+	relay_num_frame_ents = 0;
+	relay_partial_total = 0;
+}
+
+/*
+==================
+SV_RelayShutdown
+==================
+*/
+void SV_RelayShutdown()
+{
+	SV_RelayDisconnect();
+
+	memset(relay_subs, 0, sizeof(relay_subs));
+	relay_num_subs = 0;
+}
+
+/*
+==================
+SV_Relay_f
+
+relay <address> [password]
+==================
+*/
+static void SV_Relay_f()
+{
+	netadr_t adr;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("relay <address> [password]: relay the match on that server to ZombieTV viewers\n");
+		return;
+	}
+
+	if (!Net_StringToAdr(Cmd_Argv(1), &adr))
+	{
+		Com_Printf("Bad address: %s\n", Cmd_Argv(1));
+		return;
+	}
+
+	if (!adr.port)
+		adr.port = BigShort(PORT_SERVER);
+
+	SV_RelayDisconnect();
+
+	// a server with no map of its own, the relayed one is loaded once the stream names it
+	SV_Map(false, "zombietv.dm2", false);
+
+	relay_upstream = true;
+	relay_upstream_adr = adr;
+	strncpy(relay_password, Cmd_Argc() > 2 ? Cmd_Argv(2) : "", sizeof(relay_password) - 1);
+	relay_last_keepalive = curtime - RELAY_KEEPALIVE;
+	relay_last_received = curtime;
+	relay_sequence = 0;
+	relay_lost = 0;
+
+	Com_Printf("Relaying %s\n", Net_AdrToString(adr));
+}
+
+static void SV_RelayStop_f()
+{
+	if (!relay_upstream)
+	{
+		Com_Printf("Not relaying.\n");
+		return;
+	}
+
+	SV_RelayDisconnect();
+	Com_Printf("Stopped relaying.\n");
+}
+
+static void SV_RelayStatus_f()
+{
+	relaysub_t* sub;
+	relaymsg_t* msg;
+	int32_t 	i, queued, viewers;
+
+	if (relay_upstream)
+	{
+		queued = viewers = 0;
+
+		for (msg = relay_queue; msg; msg = msg->next)
+			queued++;
+
+		for (i = 0; i < sv_maxclients->value; i++)
+		{
+			if (svs.clients[i].state >= cs_connected)
+				viewers++;
+		}
+
+		Com_Printf("relaying %s, last packet %i ms ago, %i packets lost, %i messages delayed, %i viewers\n",
+			Net_AdrToString(relay_upstream_adr), curtime - relay_last_received, relay_lost, queued, viewers);
+	}
+
+	Com_Printf("%i relays subscribed\n", relay_num_subs);
+
+	for (i = 0, sub = relay_subs; i < RELAY_MAX_SUBSCRIBERS; i++, sub++)
+	{
+		if (sub->active)
+			Com_Printf("  %s%s\n", Net_AdrToString(sub->adr), sub->started ? "" : " (starting)");
+	}
+}
+
+/*
+==================
+SV_RelayInit
+==================
+*/
+void SV_RelayInit()
+{
+	sv_relay_password = Cvar_Get("sv_relay_password", "", 0);
+	sv_relay_max = Cvar_Get("sv_relay_max", "4", 0);
+	sv_relay_delay = Cvar_Get("sv_relay_delay", "0", 0);
+	sv_relay_keyframe = Cvar_Get("sv_relay_keyframe", "5", 0);
+
+	Cmd_AddCommand("relay", SV_Relay_f);
+	Cmd_AddCommand("relay_stop", SV_RelayStop_f);
+	Cmd_AddCommand("relay_status", SV_RelayStatus_f);
+}
@@ -0,0 +1,363 @@
+/*
+Copyright (C) 2023-2024 starfrost
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// server_save.c -- savegame writer thread
+//
+// A save is captured on the main thread between SV_SaveBegin and SV_SaveCommit:
+// the server's own files are built in memory, the game dll writes its files
+// to <name>.tmp, and copying a save slot is turned into a list of files. The
+// writer thread then writes, renames and copies everything, each file to a
+// temporary name first and renamed over the old one, so a crash part way
+// leaves every file either old or new but never cut short.
+//
+// Only one save is in flight. Anything that reads or removes save files calls
+// SV_SaveWait first. A capture cut short by an error never reaches
+// SV_SaveCommit, and is thrown away by SV_SaveDiscard.
+
+#include "server.h"
+
+#define SAVE_MAX_OPS		512
+
+typedef enum saveoptype_e
+{
+	saveop_write,			// data to name
+	saveop_rename,			// name.tmp, written by the game, to name
+	saveop_copy,			// source to name
+	saveop_remove,			// name
+} saveoptype_t;
+
+typedef struct saveop_s
+{
+	saveoptype_t	type;
+	char			name[MAX_OSPATH];
+	char			source[MAX_OSPATH];
+	uint8_t*		data;
+	int32_t 		length;
+} saveop_t;
+
+typedef struct savejob_s
+{
+	saveop_t	ops[SAVE_MAX_OPS];
+	int32_t 	num_ops;
+	char		description[64];
+	int64_t 	start;				// Sys_Nanoseconds at SV_SaveBegin
+	int64_t 	captured;			// time spent in the frame
+	int64_t 	written;			// time the writer thread took
+	int32_t 	failed;
+} savejob_t;
+
+static savejob_t*		save_job;			// being captured, or written while save_thread is running
+static sys_thread_t*	save_thread;
+static sys_mutex_t*		save_lock;
+static bool				save_done;			// set by the writer thread when it's finished
+
+/*
+==================
+SV_SaveWriteFile
+
+Runs on the writer thread
+==================
+*/
+static bool SV_SaveWriteFile(char* name, uint8_t* data, int32_t length, char* source)
+{
+	char		temp_name[MAX_OSPATH];
+	uint8_t		buffer[65536];
+	FILE*		in;
+	FILE*		out;
+	size_t		l;
+
+	snprintf(temp_name, sizeof(temp_name), "%s.tmp", name);
+	out = fopen(temp_name, "wb");
+
+	if (!out)
+		return false;
+
+	if (source)
+	{
+		in = fopen(source, "rb");
+
+		if (!in)
+		{
+			fclose(out);
+			remove(temp_name);
+			return false;
+		}
+
+		while ((l = fread(buffer, 1, sizeof(buffer), in)) > 0)
+			fwrite(buffer, 1, l, out);
+
+		fclose(in);
+	}
+	else
+	{
+		fwrite(data, 1, length, out);
+	}
+
+	if (fclose(out))
+	{
+		remove(temp_name);
+		return false;
+	}
+
+	return Sys_ReplaceFile(temp_name, name);
+}
+
+static void SV_SaveWriterThread(void* arg)
+{
+	char		temp_name[MAX_OSPATH];
+	saveop_t*	op;
+	int64_t 	start;
+	int32_t 	i;
+	bool		ok;
+
+	start = Sys_Nanoseconds();
+
+	for (i = 0, op = save_job->ops; i < save_job->num_ops; i++, op++)
+	{
+		switch (op->type)
+		{
+		case saveop_write:
+			ok = SV_SaveWriteFile(op->name, op->data, op->length, NULL);
+			break;
+		case saveop_rename:
+			snprintf(temp_name, sizeof(temp_name), "%s.tmp", op->name);
+			ok = Sys_ReplaceFile(temp_name, op->name);
+			break;
+		case saveop_copy:
+			ok = SV_SaveWriteFile(op->name, NULL, 0, op->source);
+			break;
+		case saveop_remove:
+			remove(op->name);
+			ok = true;
+			break;
+		}
+
+		if (!ok)
+			save_job->failed++;
+	}
+
+	save_job->written = Sys_Nanoseconds() - start;
+
+	Sys_MutexLock(save_lock);
+	save_done = true;
+	Sys_MutexUnlock(save_lock);
+}
+
+static saveop_t* SV_SaveAddOp(saveoptype_t type, char* name)
+{
+	saveop_t* op;
+
+	if (!save_job)
+		Com_Error(ERR_FATAL, "SV_SaveAddOp: no save started");
+
+	if (save_job->num_ops >= SAVE_MAX_OPS)
+		Com_Error(ERR_DROP, "SV_SaveAddOp: more than %i savegame files", SAVE_MAX_OPS);
+
+	op = &save_job->ops[save_job->num_ops++];
+	op->type = type;
+	strncpy(op->name, name, sizeof(op->name) - 1);
+	return op;
+}
+
+static void SV_SaveFree()
+{
+	int32_t i;
+
+	for (i = 0; i < save_job->num_ops; i++)
+	{
+		if (save_job->ops[i].data)
+			Memory_ZoneFree(save_job->ops[i].data);
+	}
+
+	Memory_ZoneFree(save_job);
+	save_job = NULL;
+}
+
+/*
+==================
+SV_SaveFinish
+
+Joins the writer thread and reports how the save went
+==================
+*/
+static void SV_SaveFinish()
+{
+	Sys_ThreadJoin(save_thread);
+	save_thread = NULL;
+	save_done = false;
+
+	if (save_job->failed)
+		Com_Printf("%s: %i files couldn't be written\n", save_job->description, save_job->failed);
+	else
+		Com_Printf("%s: %.2f ms in the frame, %.2f ms writing\n", save_job->description,
+			save_job->captured / 1000000.0, save_job->written / 1000000.0);
+
+	SV_SaveFree();
+}
+
+/*
+==================
+SV_SaveWait
+
+Waits for the save in flight to reach the disk
+==================
+*/
+void SV_SaveWait()
+{
+	if (save_thread)
+		SV_SaveFinish();
+}
+
+/*
+==================
+SV_SaveDiscard
+
+Throws away a save that was begun but never committed, because an error
+ended its capture. Nothing of it has been written.
+==================
+*/
+void SV_SaveDiscard()
+{
+	if (!save_job || save_thread)
+		return;
+
+	Com_Printf("%s: not saved\n", save_job->description);
+	SV_SaveFree();
+}
+
+/*
+==================
+SV_SaveFrame
+
+Reports a finished save without waiting for one that isn't
+==================
+*/
+void SV_SaveFrame()
+{
+	bool done;
+
+	if (!save_thread)
+		return;
+
+	Sys_MutexLock(save_lock);
+	done = save_done;
+	Sys_MutexUnlock(save_lock);
+
+	if (done)
+		SV_SaveFinish();
+}
+
+/*
+==================
+SV_SaveBegin
+==================
+*/
+void SV_SaveBegin(char* description)
+{
+	SV_SaveWait();
+	SV_SaveDiscard();
+
+	if (!save_lock)
+		save_lock = Sys_MutexCreate();
+
+	save_job = Memory_ZoneMalloc(sizeof(savejob_t));
+	strncpy(save_job->description, description, sizeof(save_job->description) - 1);
+	save_job->start = Sys_Nanoseconds();
+}
+
+/*
+==================
+SV_SaveWrite
+
+Queues data to be written to name. The save frees it.
+==================
+*/
+void SV_SaveWrite(char* name, uint8_t* data, int32_t length)
+{
+	saveop_t* op = SV_SaveAddOp(saveop_write, name);
+
+	op->data = data;
+	op->length = length;
+}
+
+/*
+==================
+SV_SaveRename
+
+For files the game dll has written to name.tmp
+==================
+*/
+void SV_SaveRename(char* name)
+{
+	SV_SaveAddOp(saveop_rename, name);
+}
+
+void SV_SaveCopy(char* source, char* name)
+{
+	saveop_t* op = SV_SaveAddOp(saveop_copy, name);
+
+	strncpy(op->source, source, sizeof(op->source) - 1);
+}
+
+void SV_SaveRemove(char* name)
+{
+	SV_SaveAddOp(saveop_remove, name);
+}
+
+/*
+==================
+SV_SavePending
+
+True if the save being captured will write or rename name, for copies of files that aren't on disk yet
+==================
+*/
+bool SV_SavePending(char* name)
+{
+	int32_t i;
+
+	if (!save_job)
+		return false;
+
+	for (i = 0; i < save_job->num_ops; i++)
+	{
+		if (save_job->ops[i].type != saveop_copy
+			&& save_job->ops[i].type != saveop_remove
+			&& !Q_stricmp(save_job->ops[i].name, name))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+==================
+SV_SaveCommit
+
+Hands the captured save to the writer thread
+==================
+*/
+void SV_SaveCommit()
+{
+	if (!save_job)
+		return;
+
+	save_job->captured = Sys_Nanoseconds() - save_job->start;
+	save_done = false;
+	save_thread = Sys_ThreadCreate(SV_SaveWriterThread, NULL, "savegame writer");
+}
@@ -181,8 +181,8 @@ void SV_Multicast (vec3_t origin, multicast_t to)
 		area1 = 0;
 	}
 
-	// if doing a serverrecord, store everything
-	if (svs.demofile)
+	// if doing a serverrecord or streaming to ZombieTV relays, store everything
+	if (svs.demofile || SV_RelaySubscribers())
 		SZ_Write (&svs.demo_multicast, sv.multicast.data, sv.multicast.cursize);
 	
 	switch (to)
@@ -397,15 +397,20 @@ bool SV_SendClientDatagram (client_t *client)
 {
 	uint8_t		msg_buf[MAX_MSGLEN];
 	sizebuf_t	msg;
+	int64_t 	perf_start;
 
+	perf_start = SV_PerfBegin();
 	SV_BuildClientFrame (client);
+	SV_PerfEnd(perf_buildframe, perf_start);
 
 	SZ_Init (&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = true;
 
 	// send over all the relevant entity_state_t
 	// and the player_state_t
+	perf_start = SV_PerfBegin();
 	SV_WriteFrameToClient (client, &msg);
+	SV_PerfEnd(perf_writeframe, perf_start);
 
 	// copy the accumulated multicast datagram
 	// for this client out to the message
@@ -424,7 +429,9 @@ bool SV_SendClientDatagram (client_t *client)
 	}
 
 	// send the datagram
+	perf_start = SV_PerfBegin();
 	Netchan_Transmit (&client->netchan, msg.cursize, msg.data);
+	SV_PerfEnd(perf_transmit, perf_start);
 
 	// record the size for rate estimation
 	client->message_size[sv.framenum % RATE_MESSAGES] = msg.cursize;
@@ -440,11 +447,7 @@ SV_DemoCompleted
 */
 void SV_DemoCompleted ()
 {
-	if (sv.demofile)
-	{
-		fclose (sv.demofile);
-		sv.demofile = NULL;
-	}
+	SV_DemoClose ();
 	SV_Nextserver ();
 }
 
@@ -459,7 +462,7 @@ void SV_SendClientMessages ()
 	client_t*	c;
 	int32_t 	msglen;
 	uint8_t		msgbuf[MAX_MSGLEN];
-	size_t		r;
+	int64_t 	perf_start;
 
 	msglen = 0;
 
@@ -470,23 +473,8 @@ void SV_SendClientMessages ()
 			msglen = 0;
 		else
 		{
-			// get the next message
-			r = fread (&msglen, 4, 1, sv.demofile);
-			if (r != 1)
-			{
-				SV_DemoCompleted ();
-				return;
-			}
-			msglen = LittleInt (msglen);
-			if (msglen == -1)
-			{
-				SV_DemoCompleted ();
-				return;
-			}
-			if (msglen > MAX_MSGLEN)
-				Com_Error (ERR_DROP, "SV_SendClientMessages: msglen > MAX_MSGLEN");
-			r = fread (msgbuf, msglen, 1, sv.demofile);
-			if (r != 1)
+			// get the next message, after catching up with demo_seek / demo_ff
+			if (!SV_DemoCatchUp () || !SV_DemoReadMessage (msgbuf, &msglen))
 			{
 				SV_DemoCompleted ();
 				return;
@@ -509,9 +497,12 @@ void SV_SendClientMessages ()
 			SV_DropClient (c);
 		}
 
-		if (sv.state == ss_demo)
+		// relay viewers get client frames like on a game server
+		if (sv.state == ss_demo && !SV_RelayUpstream())
 		{
+			perf_start = SV_PerfBegin();
 			Netchan_Transmit(&c->netchan, msglen, msgbuf);
+			SV_PerfEnd(perf_transmit, perf_start);
 		}
 		else if (c->state == cs_spawned)
 		{
@@ -520,8 +511,12 @@ void SV_SendClientMessages ()
 		else
 		{
 	// just update reliable	if needed
-			if (c->netchan.message.cursize	|| curtime - c->netchan.last_sent > 1000 )
+			if (Netchan_NeedTransmit (&c->netchan) || curtime - c->netchan.last_sent > 1000 )
+			{
+				perf_start = SV_PerfBegin();
 				Netchan_Transmit (&c->netchan, 0, NULL);
+				SV_PerfEnd(perf_transmit, perf_start);
+			}
 		}
 	}
 }
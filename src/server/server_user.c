@@ -43,9 +43,7 @@ void SV_BeginDemoserver()
 	char		name[MAX_OSPATH];
 
 	snprintf(name, sizeof(name), "demos/%s", sv.name);
-	FS_FOpenFile(name, &sv.demofile);
-	if (!sv.demofile)
-		Com_Error(ERR_DROP, "Couldn't open %s\n", name);
+	SV_DemoOpen(name);
 }
 
 /*
@@ -70,11 +68,19 @@ void SV_New_f()
 		return;
 	}
 
-	// demo servers just dump the file message
+	// demo servers just dump the file message, a relay starts its viewers once it has a map
 	if (sv.state == ss_demo)
 	{
-		SV_BeginDemoserver();
-		return;
+		if (!SV_RelayUpstream())
+		{
+			SV_BeginDemoserver();
+			return;
+		}
+
+		sv_client->relay_start = !SV_RelayReady();
+
+		if (sv_client->relay_start)
+			return;
 	}
 
 	//
@@ -85,14 +91,22 @@ void SV_New_f()
 
 	// send the serverdata
 	MSG_WriteByte(&sv_client->netchan.message, svc_serverdata);
-	MSG_WriteInt(&sv_client->netchan.message, PROTOCOL_VERSION);
+	MSG_WriteInt(&sv_client->netchan.message, sv_client->protocol);
+
+	if (sv_client->protocol == PROTOCOL_VERSION_QUANTIZED)
+	{
+		MSG_WriteByte(&sv_client->netchan.message, sv.quantize.coord_bits);
+		MSG_WriteByte(&sv_client->netchan.message, sv.quantize.angle_bits);
+	}
+
 	MSG_WriteInt(&sv_client->netchan.message, svs.spawncount);
 	MSG_WriteByte(&sv_client->netchan.message, sv.attractloop);
 	MSG_WriteString(&sv_client->netchan.message, gamedir);
 
 	playernum = sv_client - svs.clients;
 
-	MSG_WriteShort(&sv_client->netchan.message, playernum);
+	// relay viewers have no entity, so no relayed one is hidden as theirs
+	MSG_WriteShort(&sv_client->netchan.message, SV_RelayUpstream() ? RELAY_PLAYERNUM : playernum);
 
 	// send full levelname
 	MSG_WriteString(&sv_client->netchan.message, sv.configstrings[CS_NAME]);
@@ -107,12 +121,60 @@ void SV_New_f()
 		ent->s.number = playernum + 1;
 		sv_client->edict = ent;
 		memset(&sv_client->lastcmd, 0, sizeof(sv_client->lastcmd));
+	}
 
-		// begin fetching configstrings
+	// begin fetching configstrings, a relay has the relayed server's
+	if (sv.state == ss_game || SV_RelayUpstream())
+	{
 		MSG_WriteByte(&sv_client->netchan.message, svc_stufftext);
 		MSG_WriteString(&sv_client->netchan.message, va("cmd configstrings %i 0\n", svs.spawncount));
 	}
+}
+
+/*
+==================
+SV_SignonChunkEnd
+
+Returns the index after the last precomputed configstring or baseline from
+start onwards that fits in the client's reliable message. Clients with a
+windowed netchan can take close to a full message per request.
+
+Returns start if not even the first one fits, and the client asks for it
+again with the next chunk once the message has gone.
+==================
+*/
+int32_t SV_SignonChunkEnd(int32_t* offsets, int32_t start, int32_t count)
+{
+	int32_t 	budget;
+	int32_t 	low, high, mid;
+
+	if (sv_client->netchan.flags & NETCHAN_FLAG_WINDOW)
+		budget = sizeof(sv_client->netchan.message_buf) - MAX_QPATH * 2;
+	else
+		budget = MAX_MSGLEN / 2;
+
+	budget -= sv_client->netchan.message.cursize;
+
+	// offsets only ever increase, so find the furthest end that fits
+	low = start;
+	high = count;
+
+	while (low < high)
+	{
+		mid = (low + high + 1) / 2;
+
+		if (offsets[mid] - offsets[start] <= budget)
+			low = mid;
+		else
+			high = mid - 1;
+	}
 
+	// an empty message can always take one, or the client would never get past it
+	if (low == start
+		&& !sv_client->netchan.message.cursize)
+		low = start + 1;
+
+	return low;
 }
 
 /*
@@ -122,7 +184,8 @@ SV_Configstrings_f
 */
 void SV_Configstrings_f()
 {
-	int32_t 		start;
+	int32_t 		start, end;
+	sizebuf_t*		signon;
 
 	Com_DPrintf("Configstrings() from %s\n", sv_client->name);
 
@@ -142,18 +205,18 @@ void SV_Configstrings_f()
 
 	start = atoi(Cmd_Argv(2));
 
-	// write a packet full of data
+	if (start < 0 || start > MAX_CONFIGSTRINGS)
+		start = MAX_CONFIGSTRINGS;
 
-	while (sv_client->netchan.message.cursize < MAX_MSGLEN / 2
-		&& start < MAX_CONFIGSTRINGS)
+	// write a packet full of data, straight out of the precomputed signon
+	if (start < MAX_CONFIGSTRINGS)
 	{
-		if (sv.configstrings[start][0])
-		{
-			MSG_WriteByte(&sv_client->netchan.message, svc_configstring);
-			MSG_WriteShort(&sv_client->netchan.message, start);
-			MSG_WriteString(&sv_client->netchan.message, sv.configstrings[start]);
-		}
-		start++;
+		signon = SV_SignonConfigstrings();
+		end = SV_SignonChunkEnd(sv.signon_configstring_offsets, start, MAX_CONFIGSTRINGS);
+
+		SZ_Write(&sv_client->netchan.message, signon->data + sv.signon_configstring_offsets[start],
+			sv.signon_configstring_offsets[end] - sv.signon_configstring_offsets[start]);
+		start = end;
 	}
 
 	// send next command
@@ -177,9 +240,7 @@ SV_Baselines_f
 */
 void SV_Baselines_f()
 {
-	int32_t 	start;
-	entity_state_t	nullstate;
-	entity_state_t* base;
+	int32_t 	start, end;
 
 	Com_DPrintf("Baselines() from %s\n", sv_client->name);
 
@@ -199,20 +260,17 @@ void SV_Baselines_f()
 
 	start = atoi(Cmd_Argv(2));
 
-	memset(&nullstate, 0, sizeof(nullstate));
+	if (start < 0 || start > MAX_EDICTS)
+		start = MAX_EDICTS;
 
-	// write a packet full of data
-
-	while (sv_client->netchan.message.cursize < MAX_MSGLEN / 2
-		&& start < MAX_EDICTS)
+	// write a packet full of data, straight out of the precomputed signon
+	if (start < MAX_EDICTS)
 	{
-		base = &sv.baselines[start];
-		if (base->modelindex || base->sound || base->effects)
-		{
-			MSG_WriteByte(&sv_client->netchan.message, svc_spawnbaseline);
-			MSG_WriteDeltaEntity(&nullstate, base, &sv_client->netchan.message, true, true);
-		}
-		start++;
+		end = SV_SignonChunkEnd(sv.signon_baseline_offsets, start, MAX_EDICTS);
+
+		SZ_Write(&sv_client->netchan.message, sv.signon_baselines.data + sv.signon_baseline_offsets[start],
+			sv.signon_baseline_offsets[end] - sv.signon_baseline_offsets[start]);
+		start = end;
 	}
 
 	// send next command
@@ -248,8 +306,11 @@ void SV_Begin_f()
 
 	sv_client->state = cs_spawned;
 
-	// call the game begin function
-	ge->Client_OnConnected(sv_player);
+	// call the game begin function, relay viewers get a camera instead
+	if (SV_RelayUpstream())
+		SV_RelayBeginViewer(sv_client);
+	else
+		ge->Client_OnConnected(sv_player);
 
 	Cbuf_InsertFromDefer();
 }
@@ -517,6 +578,32 @@ USER CMD EXECUTION
 */
 
 
+// the client whose commands the game is running, NULL between them
+static client_t* sv_think_client;
+
+/*
+==================
+SV_ClientSnapScale
+
+Moves for a client keep its state at the precision it gets it with, so its prediction starts from exactly it
+==================
+*/
+int32_t SV_ClientSnapScale(client_t* cl)
+{
+	return Player_MoveSnapScale(cl->protocol == PROTOCOL_VERSION_QUANTIZED ? &sv.quantize : NULL);
+}
+
+/*
+==================
+SV_PlayerMove
+
+The game's Player_Move, at the precision of the client whose commands it's running
+==================
+*/
+void SV_PlayerMove(pmove_t* pm)
+{
+	Player_MoveSnapped(pm, sv_think_client ? SV_ClientSnapScale(sv_think_client) : 0);
+}
 
 void SV_ClientThink(client_t* cl, usercmd_t* cmd)
 {
@@ -528,7 +615,18 @@ void SV_ClientThink(client_t* cl, usercmd_t* cmd)
 		return;
 	}
 
+	// there's no game on a relay, its viewers only fly their cameras
+	if (SV_RelayUpstream())
+	{
+		SV_RelayViewerThink(cl, cmd);
+		return;
+	}
+
+	Player_MoveRecord(cl - svs.clients, &cl->edict->client->ps.pmove, cmd);
+
+	sv_think_client = cl;
 	ge->Client_Think(cl->edict, cmd);
+	sv_think_client = NULL;
 }
 
 
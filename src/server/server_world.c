@@ -23,6 +23,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server.h"
 #include <inttypes.h>
 
+// SV_AreaEdicts, and so SV_Trace and SV_PointContents, can run on several threads at once
+#ifdef _MSC_VER
+#define AREA_THREAD		__declspec(thread)
+#else
+#define AREA_THREAD		_Thread_local
+#endif
+
 /*
 ===============================================================================
 
@@ -54,12 +61,12 @@ typedef struct areanode_s
 areanode_t	sv_areanodes[AREA_NODES];
 int32_t 	sv_numareanodes;
 
-float*		area_mins;
-float*		area_maxs;
-edict_t**	area_list;
-int32_t 	area_count;
-int32_t		area_maxcount;
-int32_t 	area_type;
+static AREA_THREAD float*		area_mins;
+static AREA_THREAD float*		area_maxs;
+static AREA_THREAD edict_t**	area_list;
+static AREA_THREAD int32_t 		area_count;
+static AREA_THREAD int32_t		area_maxcount;
+static AREA_THREAD int32_t 		area_type;
 
 int32_t SV_HullForEntity(edict_t* ent);
 
@@ -615,7 +622,7 @@ void SV_TraceBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t b
 
 /*
 ==================
-SV_Trace
+SV_TraceMove
 
 Moves the given mins/maxs volume through the world from start to end.
 
@@ -623,7 +630,7 @@ Passedict and edicts owned by passedict are explicitly not checked.
 
 ==================
 */
-trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t* passedict, int32_t contentmask)
+static trace_t SV_TraceMove(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t* passedict, int32_t contentmask)
 {
 	moveclip_t	clip;
 
@@ -659,3 +666,27 @@ trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t* pa
 	return clip.trace;
 }
 
+/*
+==================
+SV_Trace
+
+SV_TraceMove, optionally timed for sv_perf and trace_start
+==================
+*/
+trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t* passedict, int32_t contentmask)
+{
+	trace_t 	trace;
+	int64_t 	perf_start;
+
+	if (!sv_perf_traces->value && !timeline_active)
+		return SV_TraceMove(start, mins, maxs, end, passedict, contentmask);
+
+	TIMELINE_BEGIN("SV_Trace");
+	perf_start = sv_perf_traces->value ? SV_PerfBegin() : 0;
+	trace = SV_TraceMove(start, mins, maxs, end, passedict, contentmask);
+	SV_PerfEnd(perf_trace, perf_start);
+	TIMELINE_END();
+
+	return trace;
+}
+
@@ -226,6 +226,10 @@ typedef struct cvar_s
 	bool			modified;	// set each time the cvar is changed
 	float			value;
 	struct cvar_s*	next;
+
+	// engine only, after everything the game dll uses
+	struct cvar_s*	hash_next;
+	struct cvarcallback_s* callbacks;
 } cvar_t;
 
 /*
@@ -442,6 +446,15 @@ typedef struct
 	int32_t 		(*pointcontents) (vec3_t point);
 } pmove_t;
 
+// one player's queued commands for Player_MoveBatch
+typedef struct pmove_batch_s
+{
+	pmove_t*		pm;			// s, snapinitial and the callbacks in, s and the results out
+	usercmd_t*		cmds;		// run in order, so pm->cmd is the last one afterwards
+	int32_t 		numcmds;
+	int32_t 		snap_scale;	// 1 << the fractional coordinate bits the player is sent, 0 for full precision
+} pmove_batch_t;
+
 
 // entity_state_t->effects
 // Effects are things handled on the client side (lights, particles, frame animations)